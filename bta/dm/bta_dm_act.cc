@@ -1170,7 +1170,7 @@ void bta_dm_di_disc(tBTA_DM_MSG* p_data) {
   bta_dm_di_cb.p_di_db = p_data->di_disc.p_sdp_db;
 
   bta_dm_search_cb.p_sdp_db =
-      (tSDP_DISCOVERY_DB*)osi_malloc(BTA_DM_SDP_DB_SIZE);
+      (tSDP_DISCOVERY_DB*)osi_calloc(BTA_DM_SDP_DB_SIZE);
   if (SDP_DiDiscover(bta_dm_search_cb.peer_bdaddr, p_data->di_disc.p_sdp_db,
                      p_data->di_disc.len,
                      bta_dm_di_disc_callback) == SDP_SUCCESS) {
@@ -1514,8 +1514,7 @@ void bta_dm_sdp_result(tBTA_DM_MSG* p_data) {
       bta_dm_search_cb.wait_disc = false;
 
     /* not able to connect go to next device */
-    if (bta_dm_search_cb.p_sdp_db)
-      osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+    bta_dm_free_sdp_db(NULL);
 
     BTM_SecDeleteRmtNameNotifyCallback(&bta_dm_service_search_remname_cback);
 
@@ -1644,6 +1643,7 @@ static void bta_dm_search_timer_cback(UNUSED_ATTR void* data) {
  *
  ******************************************************************************/
 void bta_dm_free_sdp_db(UNUSED_ATTR tBTA_DM_MSG* p_data) {
+  SDP_FreeDiscoveryDb(bta_dm_search_cb.p_sdp_db);
   osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
 }
 
@@ -1719,7 +1719,7 @@ void bta_dm_search_cancel_cmpl(UNUSED_ATTR tBTA_DM_MSG* p_data) {
  *
  ******************************************************************************/
 void bta_dm_search_cancel_transac_cmpl(UNUSED_ATTR tBTA_DM_MSG* p_data) {
-  osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+  bta_dm_free_sdp_db(NULL);
   bta_dm_search_cancel_notify(NULL);
 }
 
@@ -1814,6 +1814,7 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
                uuid.ToString().c_str());
       SDP_InitDiscoveryDb(bta_dm_search_cb.p_sdp_db, BTA_DM_SDP_DB_SIZE, 1,
                           &uuid, 0, NULL);
+      bta_dm_search_cb.p_sdp_db->mem_max = BTA_DM_SDP_DB_MAX_SIZE;
 
       memset(g_disc_raw_data_buf, 0, sizeof(g_disc_raw_data_buf));
       bta_dm_search_cb.p_sdp_db->raw_data = g_disc_raw_data_buf;
@@ -1826,7 +1827,7 @@ static void bta_dm_find_services(const RawAddress& bd_addr) {
          * If discovery is not successful with this device, then
          * proceed with the next one.
          */
-        osi_free_and_reset((void**)&bta_dm_search_cb.p_sdp_db);
+        bta_dm_free_sdp_db(NULL);
         bta_dm_search_cb.service_index = BTA_MAX_SERVICE_ID;
 
       } else {
@@ -47,8 +47,6 @@
 using bluetooth::Uuid;
 using base::StringPrintf;
 
-static void bta_gattc_cache_write(const RawAddress& server_bda,
-                                  uint16_t num_attr, tBTA_GATTC_NV_ATTR* attr);
 static void bta_gattc_char_dscpt_disc_cmpl(uint16_t conn_id,
                                            tBTA_GATTC_SERV* p_srvc_cb);
 static tGATT_STATUS bta_gattc_sdp_service_disc(uint16_t conn_id,
@@ -61,7 +59,7 @@ tBTA_GATTC_CHARACTERISTIC* bta_gattc_get_characteristic_srcb(
 #define BTA_GATT_SDP_DB_SIZE 4096
 
 #define GATT_CACHE_PREFIX "/data/misc/bluetooth/gatt_cache_"
-#define GATT_CACHE_VERSION 4
+#define GATT_HASH_PREFIX "/data/misc/bluetooth/gatt_hash_"
 
 static void bta_gattc_generate_cache_file_name(char* buffer, size_t buffer_len,
                                                const RawAddress& bda) {
@@ -914,35 +912,8 @@ void bta_gattc_rebuild_cache(tBTA_GATTC_SERV* p_srvc_cb, uint16_t num_attr,
   /* first attribute loading, initialize buffer */
   LOG(INFO) << __func__ << " " << num_attr;
 
-  // clear reallocating
-  std::vector<tBTA_GATTC_SERVICE>().swap(p_srvc_cb->srvc_cache);
-
-  while (num_attr > 0 && p_attr != NULL) {
-    switch (p_attr->attr_type) {
-      case BTA_GATTC_ATTR_TYPE_SRVC:
-        add_service_to_gatt_db(p_srvc_cb->srvc_cache, p_attr->s_handle,
-                               p_attr->e_handle, p_attr->uuid,
-                               p_attr->is_primary);
-        break;
-
-      case BTA_GATTC_ATTR_TYPE_CHAR:
-        add_characteristic_to_gatt_db(p_srvc_cb->srvc_cache, p_attr->s_handle,
-                                      p_attr->s_handle, p_attr->uuid,
-                                      p_attr->prop);
-        break;
-
-      case BTA_GATTC_ATTR_TYPE_CHAR_DESCR:
-        add_descriptor_to_gatt_db(p_srvc_cb->srvc_cache, p_attr->s_handle,
-                                  p_attr->uuid);
-        break;
-      case BTA_GATTC_ATTR_TYPE_INCL_SRVC:
-        add_incl_srvc_to_gatt_db(p_srvc_cb->srvc_cache, p_attr->s_handle,
-                                 p_attr->uuid, p_attr->incl_srvc_handle);
-        break;
-    }
-    p_attr++;
-    num_attr--;
-  }
+  if (p_attr == NULL) num_attr = 0;
+  bta_gattc_cache_materialize(p_attr, num_attr, p_srvc_cb->srvc_cache);
 }
 
 /*******************************************************************************
@@ -1012,7 +983,10 @@ void bta_gattc_cache_save(tBTA_GATTC_SERV* p_srvc_cb, uint16_t conn_id) {
     }
   }
 
-  bta_gattc_cache_write(p_srvc_cb->server_bda, db_size, nv_attr);
+  char fname[255] = {0};
+  bta_gattc_generate_cache_file_name(fname, sizeof(fname),
+                                     p_srvc_cb->server_bda);
+  bta_gattc_cache_file_write(fname, GATT_HASH_PREFIX, nv_attr, db_size);
   osi_free(nv_attr);
 }
 
@@ -1032,97 +1006,15 @@ bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb) {
   bta_gattc_generate_cache_file_name(fname, sizeof(fname),
                                      p_clcb->p_srcb->server_bda);
 
-  FILE* fd = fopen(fname, "rb");
-  if (!fd) {
-    LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
-               << " for reading, error: " << strerror(errno);
-    return false;
-  }
-
-  uint16_t cache_ver = 0;
-  tBTA_GATTC_NV_ATTR* attr = NULL;
-  bool success = false;
-  uint16_t num_attr = 0;
-
-  if (fread(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't read GATT cache version from: " << fname;
-    goto done;
-  }
-
-  if (cache_ver != GATT_CACHE_VERSION) {
-    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
-    goto done;
-  }
-
-  if (fread(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't read number of GATT attributes: " << fname;
-    goto done;
-  }
-
-  attr = (tBTA_GATTC_NV_ATTR*)osi_malloc(sizeof(tBTA_GATTC_NV_ATTR) * num_attr);
-
-  if (fread(attr, sizeof(tBTA_GATTC_NV_ATTR), num_attr, fd) != num_attr) {
-    LOG(ERROR) << __func__ << "s: can't read GATT attributes: " << fname;
-    goto done;
-  }
-
-  bta_gattc_rebuild_cache(p_clcb->p_srcb, num_attr, attr);
-
-  success = true;
-
-done:
-  osi_free(attr);
-  fclose(fd);
-  return success;
-}
-
-/*******************************************************************************
- *
- * Function         bta_gattc_cache_write
- *
- * Description      This callout function is executed by GATT when a server
- *                  cache is available to save.
- *
- * Parameter        server_bda: server bd address of this cache belongs to
- *                  num_attr: number of attribute to be save.
- *                  attr: pointer to the list of attributes to save.
- * Returns
- *
- ******************************************************************************/
-static void bta_gattc_cache_write(const RawAddress& server_bda,
-                                  uint16_t num_attr, tBTA_GATTC_NV_ATTR* attr) {
-  char fname[255] = {0};
-  bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
-
-  FILE* fd = fopen(fname, "wb");
-  if (!fd) {
-    LOG(ERROR) << __func__
-               << ": can't open GATT cache file for writing: " << fname;
-    return;
-  }
-
-  uint16_t cache_ver = GATT_CACHE_VERSION;
-  if (fwrite(&cache_ver, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__ << ": can't write GATT cache version: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  if (fwrite(&num_attr, sizeof(uint16_t), 1, fd) != 1) {
-    LOG(ERROR) << __func__
-               << ": can't write GATT cache attribute count: " << fname;
-    fclose(fd);
-    return;
-  }
-
-  if (fwrite(attr, sizeof(tBTA_GATTC_NV_ATTR), num_attr, fd) != num_attr) {
-    LOG(ERROR) << __func__ << ": can't write GATT cache attributes: " << fname;
-    fclose(fd);
-    return;
-  }
+  tBTA_GATTC_CACHE_MAP map;
+  if (!bta_gattc_cache_file_map(fname, &map)) return false;
 
-  fclose(fd);
+  /* services are built straight from the mapped file */
+  LOG(INFO) << __func__ << " " << map.num_attr;
+  bta_gattc_cache_materialize(map.attr, map.num_attr,
+                              p_clcb->p_srcb->srvc_cache);
+  bta_gattc_cache_file_unmap(&map);
+  return true;
 }
 
 /*******************************************************************************
@@ -1141,5 +1033,5 @@ void bta_gattc_cache_reset(const RawAddress& server_bda) {
   VLOG(1) << __func__;
   char fname[255] = {0};
   bta_gattc_generate_cache_file_name(fname, sizeof(fname), server_bda);
-  unlink(fname);
+  bta_gattc_cache_file_remove(fname, GATT_HASH_PREFIX);
 }
@@ -0,0 +1,379 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the GATT client cache file format. A cache file is a
+ *  tBTA_GATTC_CACHE_HDR followed by the attributes as an array of
+ *  tBTA_GATTC_NV_ATTR, so it is used in place once mapped.
+ *
+ *  The database is stored once per content hash, and the file of each server
+ *  is a hard link to it: servers with identical databases, such as devices of
+ *  the same model, share one file on disk and in the page cache.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_bta_gattc"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <base/logging.h>
+
+#include "bta_gattc_int.h"
+#include "osi/include/osi.h"
+
+using bluetooth::Uuid;
+
+/* FNV-1a, over the attributes as they are stored */
+uint64_t bta_gattc_cache_hash(const tBTA_GATTC_NV_ATTR* attr,
+                              uint16_t num_attr) {
+  const uint8_t* p = (const uint8_t*)attr;
+  size_t len = num_attr * sizeof(tBTA_GATTC_NV_ATTR);
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  while (len--) {
+    hash ^= *p++;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void bta_gattc_generate_hash_file_name(char* buffer, size_t buffer_len,
+                                              const char* hash_prefix,
+                                              uint64_t hash) {
+  snprintf(buffer, buffer_len, "%s%016llx", hash_prefix,
+           (unsigned long long)hash);
+}
+
+static bool bta_gattc_cache_file_read_hdr(const char* fname,
+                                          tBTA_GATTC_CACHE_HDR* p_hdr) {
+  int fd;
+  OSI_NO_INTR(fd = open(fname, O_RDONLY | O_CLOEXEC));
+  if (fd < 0) return false;
+
+  ssize_t len;
+  OSI_NO_INTR(len = read(fd, p_hdr, sizeof(*p_hdr)));
+  close(fd);
+
+  return len == sizeof(*p_hdr) && p_hdr->version == GATT_CACHE_VERSION;
+}
+
+/* Writes the database to a temporary file and renames it to |fname|, so that
+ * a reader never sees a partial file */
+static bool bta_gattc_cache_file_create(const char* fname,
+                                        const tBTA_GATTC_CACHE_HDR* p_hdr,
+                                        const tBTA_GATTC_NV_ATTR* attr) {
+  char tmp_fname[255] = {0};
+  snprintf(tmp_fname, sizeof(tmp_fname), "%s.tmp", fname);
+
+  FILE* fd = fopen(tmp_fname, "wb");
+  if (!fd) {
+    LOG(ERROR) << __func__
+               << ": can't open GATT cache file for writing: " << tmp_fname;
+    return false;
+  }
+
+  if (fwrite(p_hdr, sizeof(*p_hdr), 1, fd) != 1 ||
+      fwrite(attr, sizeof(tBTA_GATTC_NV_ATTR), p_hdr->num_attr, fd) !=
+          p_hdr->num_attr) {
+    LOG(ERROR) << __func__ << ": can't write GATT cache: " << tmp_fname;
+    fclose(fd);
+    unlink(tmp_fname);
+    return false;
+  }
+
+  if (fclose(fd) != 0 || rename(tmp_fname, fname) != 0) {
+    LOG(ERROR) << __func__ << ": can't save GATT cache: " << fname
+               << ", error: " << strerror(errno);
+    unlink(tmp_fname);
+    return false;
+  }
+
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_file_write
+ *
+ * Description      Save |num_attr| attributes |attr| of a server as |fname|.
+ *                  The database is written to the file for its hash under
+ *                  |hash_prefix| unless it is already there, and |fname| is
+ *                  linked to it.
+ *
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+bool bta_gattc_cache_file_write(const char* fname, const char* hash_prefix,
+                                const tBTA_GATTC_NV_ATTR* attr,
+                                uint16_t num_attr) {
+  tBTA_GATTC_CACHE_HDR hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.version = GATT_CACHE_VERSION;
+  hdr.num_attr = num_attr;
+  hdr.hash = bta_gattc_cache_hash(attr, num_attr);
+
+  /* drop the previous database of the server first, it may be the last user
+   * of its hash file */
+  bta_gattc_cache_file_remove(fname, hash_prefix);
+
+  char hash_fname[255] = {0};
+  bta_gattc_generate_hash_file_name(hash_fname, sizeof(hash_fname),
+                                    hash_prefix, hdr.hash);
+
+  tBTA_GATTC_CACHE_MAP map;
+  bool shared = false;
+  if (access(hash_fname, F_OK) == 0 &&
+      bta_gattc_cache_file_map(hash_fname, &map)) {
+    shared = map.num_attr == num_attr &&
+             memcmp(map.attr, attr, num_attr * sizeof(*attr)) == 0;
+    bta_gattc_cache_file_unmap(&map);
+  }
+
+  if (!shared && !bta_gattc_cache_file_create(hash_fname, &hdr, attr))
+    return false;
+
+  if (link(hash_fname, fname) == 0) return true;
+
+  LOG(WARNING) << __func__ << ": can't link GATT cache " << fname << " to "
+               << hash_fname << ", error: " << strerror(errno);
+  return bta_gattc_cache_file_create(fname, &hdr, attr);
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_file_map
+ *
+ * Description      Map the cache file |fname| into memory, checking its
+ *                  version, size and hash.
+ *
+ * Returns          true on success, false otherwise
+ *
+ ******************************************************************************/
+bool bta_gattc_cache_file_map(const char* fname, tBTA_GATTC_CACHE_MAP* p_map) {
+  memset(p_map, 0, sizeof(*p_map));
+
+  int fd;
+  OSI_NO_INTR(fd = open(fname, O_RDONLY | O_CLOEXEC));
+  if (fd < 0) {
+    LOG(ERROR) << __func__ << ": can't open GATT cache file " << fname
+               << " for reading, error: " << strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      (size_t)st.st_size < sizeof(tBTA_GATTC_CACHE_HDR)) {
+    LOG(ERROR) << __func__ << ": can't read GATT cache header from: " << fname;
+    close(fd);
+    return false;
+  }
+
+  void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << __func__ << ": can't map GATT cache file " << fname
+               << ", error: " << strerror(errno);
+    return false;
+  }
+
+  const tBTA_GATTC_CACHE_HDR* p_hdr = (const tBTA_GATTC_CACHE_HDR*)addr;
+  const tBTA_GATTC_NV_ATTR* attr = (const tBTA_GATTC_NV_ATTR*)(p_hdr + 1);
+  if (p_hdr->version != GATT_CACHE_VERSION) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache version: " << fname;
+  } else if ((size_t)st.st_size !=
+             sizeof(*p_hdr) + p_hdr->num_attr * sizeof(tBTA_GATTC_NV_ATTR)) {
+    LOG(ERROR) << __func__ << ": wrong GATT cache size: " << fname;
+  } else if (p_hdr->hash != bta_gattc_cache_hash(attr, p_hdr->num_attr)) {
+    LOG(ERROR) << __func__ << ": corrupted GATT cache: " << fname;
+  } else {
+    p_map->addr = addr;
+    p_map->len = st.st_size;
+    p_map->attr = attr;
+    p_map->num_attr = p_hdr->num_attr;
+    p_map->hash = p_hdr->hash;
+    return true;
+  }
+
+  munmap(addr, st.st_size);
+  return false;
+}
+
+/* Unmap a cache file mapped by bta_gattc_cache_file_map() */
+void bta_gattc_cache_file_unmap(tBTA_GATTC_CACHE_MAP* p_map) {
+  if (p_map->addr) munmap(p_map->addr, p_map->len);
+  memset(p_map, 0, sizeof(*p_map));
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_file_remove
+ *
+ * Description      Remove the cache file |fname|, and the file for its hash
+ *                  under |hash_prefix| once no other server links to it.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_gattc_cache_file_remove(const char* fname, const char* hash_prefix) {
+  tBTA_GATTC_CACHE_HDR hdr;
+  bool has_hdr = bta_gattc_cache_file_read_hdr(fname, &hdr);
+
+  unlink(fname);
+  if (!has_hdr) return;
+
+  char hash_fname[255] = {0};
+  bta_gattc_generate_hash_file_name(hash_fname, sizeof(hash_fname),
+                                    hash_prefix, hdr.hash);
+
+  struct stat st;
+  if (stat(hash_fname, &st) == 0 && st.st_nlink == 1) unlink(hash_fname);
+}
+
+/* Returns the service of |services| that owns |handle|. Attributes are stored
+ * in handle order, so the search starts at the service of the previous
+ * attribute, |*p_cursor|. */
+static tBTA_GATTC_SERVICE* find_service(
+    std::vector<tBTA_GATTC_SERVICE>& services, size_t* p_cursor,
+    uint16_t handle) {
+  for (size_t i = *p_cursor; i < services.size(); i++) {
+    if (handle >= services[i].s_handle && handle <= services[i].e_handle) {
+      *p_cursor = i;
+      return &services[i];
+    }
+  }
+
+  for (size_t i = 0; i < *p_cursor && i < services.size(); i++) {
+    if (handle >= services[i].s_handle && handle <= services[i].e_handle) {
+      *p_cursor = i;
+      return &services[i];
+    }
+  }
+
+  return nullptr;
+}
+
+/*******************************************************************************
+ *
+ * Function         bta_gattc_cache_materialize
+ *
+ * Description      Rebuild the services of a server from |num_attr| attributes
+ *                  |attr|, as written by bta_gattc_cache_save(), in a single
+ *                  pass.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void bta_gattc_cache_materialize(const tBTA_GATTC_NV_ATTR* attr,
+                                 uint16_t num_attr,
+                                 std::vector<tBTA_GATTC_SERVICE>& services) {
+  std::vector<tBTA_GATTC_SERVICE>().swap(services);
+
+  uint16_t num_srvc = 0;
+  for (uint16_t i = 0; i < num_attr; i++)
+    if (attr[i].attr_type == BTA_GATTC_ATTR_TYPE_SRVC) num_srvc++;
+  /* included services point into the vector, it must not reallocate */
+  services.reserve(num_srvc);
+
+  for (uint16_t i = 0; i < num_attr; i++) {
+    const tBTA_GATTC_NV_ATTR& a = attr[i];
+    if (a.attr_type != BTA_GATTC_ATTR_TYPE_SRVC) continue;
+
+    services.emplace_back(tBTA_GATTC_SERVICE{
+        .uuid = a.uuid,
+        .is_primary = a.is_primary,
+        .handle = a.s_handle,
+        .s_handle = a.s_handle,
+        .e_handle = a.e_handle,
+    });
+  }
+
+  size_t cursor = 0;
+  for (uint16_t i = 0; i < num_attr; i++) {
+    const tBTA_GATTC_NV_ATTR& a = attr[i];
+    if (a.attr_type == BTA_GATTC_ATTR_TYPE_SRVC) continue;
+
+    tBTA_GATTC_SERVICE* service = find_service(services, &cursor, a.s_handle);
+    if (!service) {
+      LOG(ERROR) << __func__
+                 << ": no service for handle " << loghex(a.s_handle);
+      continue;
+    }
+
+    switch (a.attr_type) {
+      case BTA_GATTC_ATTR_TYPE_CHAR:
+        if (service->e_handle < a.s_handle) service->e_handle = a.s_handle;
+        service->characteristics.emplace_back(tBTA_GATTC_CHARACTERISTIC{
+            .uuid = a.uuid,
+            .declaration_handle = a.s_handle,
+            .value_handle = a.s_handle,
+            .properties = a.prop,
+        });
+        break;
+
+      case BTA_GATTC_ATTR_TYPE_CHAR_DESCR: {
+        if (service->characteristics.empty()) {
+          LOG(ERROR) << __func__ << ": descriptor before any characteristic";
+          break;
+        }
+
+        /* descriptors follow their characteristic */
+        tBTA_GATTC_CHARACTERISTIC* char_node = &service->characteristics.back();
+        if (char_node->value_handle > a.s_handle) {
+          char_node = nullptr;
+          for (tBTA_GATTC_CHARACTERISTIC& c : service->characteristics) {
+            if (c.value_handle > a.s_handle) break;
+            char_node = &c;
+          }
+        }
+        if (!char_node) {
+          LOG(ERROR) << __func__ << ": no characteristic for descriptor "
+                     << loghex(a.s_handle);
+          break;
+        }
+        char_node->descriptors.emplace_back(
+            tBTA_GATTC_DESCRIPTOR{.uuid = a.uuid, .handle = a.s_handle});
+        break;
+      }
+
+      case BTA_GATTC_ATTR_TYPE_INCL_SRVC: {
+        size_t incl_cursor = 0;
+        tBTA_GATTC_SERVICE* included_service =
+            find_service(services, &incl_cursor, a.incl_srvc_handle);
+        if (!included_service) {
+          LOG(ERROR) << __func__ << ": non-existing included service";
+          break;
+        }
+
+        service->included_svc.emplace_back(tBTA_GATTC_INCLUDED_SVC{
+            .uuid = a.uuid,
+            .handle = a.s_handle,
+            .owning_service = service,
+            .included_service = included_service,
+        });
+        break;
+      }
+    }
+  }
+}
@@ -459,4 +459,39 @@ extern bool bta_gattc_conn_dealloc(const RawAddress& remote_bda);
 extern bool bta_gattc_cache_load(tBTA_GATTC_CLCB* p_clcb);
 extern void bta_gattc_cache_reset(const RawAddress& server_bda);
 
+/* GATT cache file format */
+#define GATT_CACHE_VERSION 5
+
+/* Header of a GATT cache file, followed by num_attr tBTA_GATTC_NV_ATTR */
+typedef struct {
+  uint16_t version; /* GATT_CACHE_VERSION, first as in every version */
+  uint16_t num_attr;
+  uint32_t reserved;
+  uint64_t hash; /* bta_gattc_cache_hash() of the attributes */
+} tBTA_GATTC_CACHE_HDR;
+
+/* A cache file mapped into memory */
+typedef struct {
+  void* addr;
+  size_t len;
+  const tBTA_GATTC_NV_ATTR* attr;
+  uint16_t num_attr;
+  uint64_t hash;
+} tBTA_GATTC_CACHE_MAP;
+
+extern uint64_t bta_gattc_cache_hash(const tBTA_GATTC_NV_ATTR* attr,
+                                     uint16_t num_attr);
+extern bool bta_gattc_cache_file_write(const char* fname,
+                                       const char* hash_prefix,
+                                       const tBTA_GATTC_NV_ATTR* attr,
+                                       uint16_t num_attr);
+extern bool bta_gattc_cache_file_map(const char* fname,
+                                     tBTA_GATTC_CACHE_MAP* p_map);
+extern void bta_gattc_cache_file_unmap(tBTA_GATTC_CACHE_MAP* p_map);
+extern void bta_gattc_cache_file_remove(const char* fname,
+                                        const char* hash_prefix);
+extern void bta_gattc_cache_materialize(
+    const tBTA_GATTC_NV_ATTR* attr, uint16_t num_attr,
+    std::vector<tBTA_GATTC_SERVICE>& services);
+
 #endif /* BTA_GATTC_INT_H */
@@ -45,5 +45,7 @@ extern int bta_co_rfc_data_incoming(uint32_t rfcomm_slot_id, BT_HDR* p_buf);
 extern int bta_co_rfc_data_outgoing_size(uint32_t rfcomm_slot_id, int* size);
 extern int bta_co_rfc_data_outgoing(uint32_t rfcomm_slot_id, uint8_t* buf,
                                     uint16_t size);
+extern int bta_co_rfc_data_outgoing_batch(uint32_t rfcomm_slot_id,
+                                          BT_HDR** bufs, uint16_t num_bufs);
 
 #endif /* BTA_DG_CO_H */
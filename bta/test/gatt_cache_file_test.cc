@@ -18,8 +18,16 @@
 
 #include <gtest/gtest.h>
 
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
 #include <base/logging.h>
 #include <base/strings/string_number_conversions.h>
+#include "bta/gatt/bta_gattc_int.h"
 #include "bta/include/bta_gatt_api.h"
 
 using bluetooth::Uuid;
@@ -47,3 +55,292 @@ TEST(GattCacheTest, nv_attr_to_binary_test) {
   // LOG(ERROR) << " " << base::HexEncode(binary_form, len);
   EXPECT_EQ(memcmp(binary_form, &attr, len), 0);
 }
+
+namespace {
+
+constexpr int kCharsPerService = 5;
+
+// The attributes of |num_srvc| services with kCharsPerService characteristics
+// of one descriptor each, ordered the way bta_gattc_cache_save() stores them.
+// Every service but the first includes the previous one.
+std::vector<tBTA_GATTC_NV_ATTR> make_nv_attrs(int num_srvc) {
+  std::vector<tBTA_GATTC_NV_ATTR> attrs;
+  uint16_t handle = 1;
+  uint16_t prev_s_handle = 0;
+  for (int s = 0; s < num_srvc; s++) {
+    uint16_t s_handle = handle++;
+    uint16_t e_handle = s_handle + (s ? 1 : 0) + 3 * kCharsPerService;
+    attrs.push_back({Uuid::From16Bit(0x1800 + s), s_handle, e_handle,
+                     BTA_GATTC_ATTR_TYPE_SRVC, 0, 0, true, 0});
+    if (s) {
+      attrs.push_back({Uuid::From16Bit(0x1800 + s - 1), handle++, 0,
+                       BTA_GATTC_ATTR_TYPE_INCL_SRVC, 0, 0, false,
+                       prev_s_handle});
+    }
+    for (int c = 0; c < kCharsPerService; c++) {
+      handle++;  // characteristic declaration
+      attrs.push_back({Uuid::From16Bit(0x2A00 + c), handle++, 0,
+                       BTA_GATTC_ATTR_TYPE_CHAR, 0, 0x02, false, 0});
+      attrs.push_back({Uuid::From16Bit(0x2902), handle++, 0,
+                       BTA_GATTC_ATTR_TYPE_CHAR_DESCR, 0, 0, false, 0});
+    }
+    prev_s_handle = s_handle;
+  }
+  return attrs;
+}
+
+class GattCacheFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = ::testing::TempDir();
+    if (dir_.empty() || dir_.back() != '/') dir_ += "/";
+    hash_prefix_ = dir_ + "gatt_hash_";
+  }
+
+  void TearDown() override {
+    for (const std::string& fname : fnames_)
+      bta_gattc_cache_file_remove(fname.c_str(), hash_prefix_.c_str());
+  }
+
+  std::string CacheFile(const std::string& device) {
+    fnames_.push_back(dir_ + "gatt_cache_" + device);
+    return fnames_.back();
+  }
+
+  bool Write(const std::string& fname,
+             const std::vector<tBTA_GATTC_NV_ATTR>& attrs) {
+    return bta_gattc_cache_file_write(fname.c_str(), hash_prefix_.c_str(),
+                                      attrs.data(), attrs.size());
+  }
+
+  std::string dir_;
+  std::string hash_prefix_;
+  std::vector<std::string> fnames_;
+};
+
+ino_t inode_of(const std::string& fname) {
+  struct stat st;
+  return stat(fname.c_str(), &st) == 0 ? st.st_ino : 0;
+}
+
+}  // namespace
+
+TEST_F(GattCacheFileTest, write_and_map_test) {
+  std::vector<tBTA_GATTC_NV_ATTR> attrs = make_nv_attrs(3);
+  std::string fname = CacheFile("aabbccddeeff");
+  ASSERT_TRUE(Write(fname, attrs));
+
+  tBTA_GATTC_CACHE_MAP map;
+  ASSERT_TRUE(bta_gattc_cache_file_map(fname.c_str(), &map));
+  ASSERT_EQ(map.num_attr, attrs.size());
+  EXPECT_EQ(map.hash, bta_gattc_cache_hash(attrs.data(), attrs.size()));
+  EXPECT_EQ(memcmp(map.attr, attrs.data(), attrs.size() * sizeof(attrs[0])), 0);
+  bta_gattc_cache_file_unmap(&map);
+  EXPECT_EQ(map.addr, nullptr);
+}
+
+/* Servers with the same database share one file */
+TEST_F(GattCacheFileTest, shared_by_identical_servers_test) {
+  std::vector<tBTA_GATTC_NV_ATTR> attrs = make_nv_attrs(3);
+  std::string first = CacheFile("000000000001");
+  std::string second = CacheFile("000000000002");
+  std::string other = CacheFile("000000000003");
+  ASSERT_TRUE(Write(first, attrs));
+  ASSERT_TRUE(Write(second, attrs));
+  ASSERT_TRUE(Write(other, make_nv_attrs(4)));
+
+  EXPECT_NE(inode_of(first), 0u);
+  EXPECT_EQ(inode_of(first), inode_of(second));
+  EXPECT_NE(inode_of(first), inode_of(other));
+
+  char hash_fname[255];
+  snprintf(hash_fname, sizeof(hash_fname), "%s%016llx", hash_prefix_.c_str(),
+           (unsigned long long)bta_gattc_cache_hash(attrs.data(),
+                                                    attrs.size()));
+  EXPECT_EQ(inode_of(first), inode_of(hash_fname));
+
+  // The hash file stays until its last server is removed
+  bta_gattc_cache_file_remove(first.c_str(), hash_prefix_.c_str());
+  EXPECT_EQ(inode_of(first), 0u);
+  EXPECT_NE(inode_of(hash_fname), 0u);
+  bta_gattc_cache_file_remove(second.c_str(), hash_prefix_.c_str());
+  EXPECT_EQ(inode_of(hash_fname), 0u);
+
+  // Rewriting a server with a new database releases the old one
+  ino_t old_inode = inode_of(other);
+  ASSERT_TRUE(Write(other, attrs));
+  EXPECT_NE(inode_of(other), old_inode);
+  EXPECT_EQ(inode_of(other), inode_of(hash_fname));
+}
+
+TEST_F(GattCacheFileTest, reject_invalid_file_test) {
+  std::vector<tBTA_GATTC_NV_ATTR> attrs = make_nv_attrs(2);
+  std::string fname = CacheFile("aabbccddeeff");
+  tBTA_GATTC_CACHE_MAP map;
+
+  EXPECT_FALSE(bta_gattc_cache_file_map(fname.c_str(), &map));
+
+  // Version 4 files, with the attribute count right after the version
+  FILE* fd = fopen(fname.c_str(), "wb");
+  ASSERT_NE(fd, nullptr);
+  uint16_t v4_hdr[2] = {4, (uint16_t)attrs.size()};
+  fwrite(v4_hdr, sizeof(v4_hdr), 1, fd);
+  fwrite(attrs.data(), sizeof(attrs[0]), attrs.size(), fd);
+  fclose(fd);
+  EXPECT_FALSE(bta_gattc_cache_file_map(fname.c_str(), &map));
+
+  // Truncated files
+  ASSERT_TRUE(Write(fname, attrs));
+  ASSERT_EQ(truncate(fname.c_str(), sizeof(tBTA_GATTC_CACHE_HDR) + 1), 0);
+  EXPECT_FALSE(bta_gattc_cache_file_map(fname.c_str(), &map));
+
+  // Corrupted files
+  ASSERT_TRUE(Write(fname, attrs));
+  fd = fopen(fname.c_str(), "r+b");
+  ASSERT_NE(fd, nullptr);
+  fseek(fd, sizeof(tBTA_GATTC_CACHE_HDR) + 3, SEEK_SET);
+  fputc(0x5a, fd);
+  fclose(fd);
+  EXPECT_FALSE(bta_gattc_cache_file_map(fname.c_str(), &map));
+}
+
+TEST(GattCacheTest, materialize_test) {
+  std::vector<tBTA_GATTC_NV_ATTR> attrs = make_nv_attrs(3);
+  std::vector<tBTA_GATTC_SERVICE> services;
+  bta_gattc_cache_materialize(attrs.data(), attrs.size(), services);
+
+  ASSERT_EQ(services.size(), 3u);
+  for (size_t s = 0; s < services.size(); s++) {
+    const tBTA_GATTC_SERVICE& service = services[s];
+    EXPECT_EQ(service.uuid, Uuid::From16Bit(0x1800 + s));
+    EXPECT_EQ(service.handle, service.s_handle);
+    EXPECT_TRUE(service.is_primary);
+
+    ASSERT_EQ(service.characteristics.size(), (size_t)kCharsPerService);
+    for (const tBTA_GATTC_CHARACTERISTIC& c : service.characteristics) {
+      EXPECT_GT(c.value_handle, service.s_handle);
+      EXPECT_LE(c.value_handle, service.e_handle);
+      EXPECT_EQ(c.properties, 0x02);
+      ASSERT_EQ(c.descriptors.size(), 1u);
+      EXPECT_EQ(c.descriptors[0].handle, c.value_handle + 1);
+    }
+
+    if (s == 0) {
+      EXPECT_TRUE(service.included_svc.empty());
+      continue;
+    }
+    ASSERT_EQ(service.included_svc.size(), 1u);
+    EXPECT_EQ(service.included_svc[0].owning_service, &services[s]);
+    EXPECT_EQ(service.included_svc[0].included_service, &services[s - 1]);
+  }
+}
+
+TEST(GattCacheTest, materialize_orphan_descriptor_test) {
+  std::vector<tBTA_GATTC_NV_ATTR> attrs = {
+      {Uuid::From16Bit(0x1800), 0x0001, 0x000A, BTA_GATTC_ATTR_TYPE_SRVC, 0, 0,
+       true, 0},
+      // Before any characteristic
+      {Uuid::From16Bit(0x2902), 0x0002, 0, BTA_GATTC_ATTR_TYPE_CHAR_DESCR, 0,
+       0, false, 0},
+      {Uuid::From16Bit(0x2A00), 0x0005, 0, BTA_GATTC_ATTR_TYPE_CHAR, 0, 0x02,
+       false, 0},
+      // Before the value of the only characteristic
+      {Uuid::From16Bit(0x2902), 0x0003, 0, BTA_GATTC_ATTR_TYPE_CHAR_DESCR, 0,
+       0, false, 0},
+      {Uuid::From16Bit(0x2902), 0x0006, 0, BTA_GATTC_ATTR_TYPE_CHAR_DESCR, 0,
+       0, false, 0},
+  };
+  std::vector<tBTA_GATTC_SERVICE> services;
+  bta_gattc_cache_materialize(attrs.data(), attrs.size(), services);
+
+  ASSERT_EQ(services.size(), 1u);
+  ASSERT_EQ(services[0].characteristics.size(), 1u);
+  const tBTA_GATTC_CHARACTERISTIC& c = services[0].characteristics[0];
+  ASSERT_EQ(c.descriptors.size(), 1u);
+  EXPECT_EQ(c.descriptors[0].handle, 0x0006);
+}
+
+// Loads the cache of a reconnecting server with 10, 100 and 1000 services,
+// the way bta_gattc_cache_load() used to, reading the file and rebuilding the
+// services through the discovery helpers, and by mapping the file.
+TEST_F(GattCacheFileTest, load_speed_test) {
+  const int kNumLoads = 100;
+
+  for (int num_srvc : {10, 100, 1000}) {
+    std::vector<tBTA_GATTC_NV_ATTR> attrs = make_nv_attrs(num_srvc);
+    std::string fname = CacheFile("speed" + std::to_string(num_srvc));
+    ASSERT_TRUE(Write(fname, attrs));
+
+    std::vector<tBTA_GATTC_SERVICE> services;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumLoads; i++) {
+      FILE* fd = fopen(fname.c_str(), "rb");
+      ASSERT_NE(fd, nullptr);
+      tBTA_GATTC_CACHE_HDR hdr;
+      ASSERT_EQ(fread(&hdr, sizeof(hdr), 1, fd), 1u);
+      std::vector<tBTA_GATTC_NV_ATTR> read_attrs(hdr.num_attr);
+      ASSERT_EQ(fread(read_attrs.data(), sizeof(read_attrs[0]), hdr.num_attr,
+                      fd),
+                hdr.num_attr);
+      fclose(fd);
+
+      // The rebuild of bta_gattc_rebuild_cache(), looking up the owning
+      // service of every attribute from the first one
+      std::vector<tBTA_GATTC_SERVICE>().swap(services);
+      for (const tBTA_GATTC_NV_ATTR& a : read_attrs) {
+        if (a.attr_type == BTA_GATTC_ATTR_TYPE_SRVC) {
+          services.push_back(tBTA_GATTC_SERVICE{
+              .uuid = a.uuid,
+              .is_primary = a.is_primary,
+              .handle = a.s_handle,
+              .s_handle = a.s_handle,
+              .e_handle = a.e_handle,
+          });
+          continue;
+        }
+        tBTA_GATTC_SERVICE* service = nullptr;
+        for (tBTA_GATTC_SERVICE& s : services)
+          if (s.s_handle <= a.s_handle && s.e_handle >= a.s_handle)
+            service = &s;
+        ASSERT_NE(service, nullptr);
+        if (a.attr_type == BTA_GATTC_ATTR_TYPE_CHAR) {
+          service->characteristics.push_back(tBTA_GATTC_CHARACTERISTIC{
+              .uuid = a.uuid,
+              .declaration_handle = a.s_handle,
+              .value_handle = a.s_handle,
+              .properties = a.prop,
+          });
+        } else if (a.attr_type == BTA_GATTC_ATTR_TYPE_CHAR_DESCR) {
+          tBTA_GATTC_CHARACTERISTIC* char_node =
+              &service->characteristics.front();
+          for (tBTA_GATTC_CHARACTERISTIC& c : service->characteristics) {
+            if (c.value_handle > a.s_handle) break;
+            char_node = &c;
+          }
+          char_node->descriptors.push_back(
+              tBTA_GATTC_DESCRIPTOR{.uuid = a.uuid, .handle = a.s_handle});
+        }
+      }
+    }
+    auto read_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    ASSERT_EQ(services.size(), (size_t)num_srvc);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumLoads; i++) {
+      tBTA_GATTC_CACHE_MAP map;
+      ASSERT_TRUE(bta_gattc_cache_file_map(fname.c_str(), &map));
+      bta_gattc_cache_materialize(map.attr, map.num_attr, services);
+      bta_gattc_cache_file_unmap(&map);
+    }
+    auto mapped_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    ASSERT_EQ(services.size(), (size_t)num_srvc);
+
+    LOG(INFO) << num_srvc << " services, " << attrs.size() << " attributes, "
+              << kNumLoads << " loads: read and rebuilt " << read_us
+              << "us, mapped and materialized " << mapped_us << "us";
+  }
+}
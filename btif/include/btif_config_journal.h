@@ -0,0 +1,50 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+
+#include "osi/include/config.h"
+
+// Encoding of the bt_config journal. The journal holds the changes made to
+// the config since bt_config.conf was last written, one record per change.
+// A journal file starts with a header, followed by records that each carry
+// their own checksum so that a record torn by a crash is detected on replay.
+
+// Appends the journal file header to |journal|.
+void btif_config_journal_begin(std::string* journal);
+
+// Appends a record setting |key| in |section| to |value| to |journal|.
+void btif_config_journal_set(std::string* journal, const std::string& section,
+                             const std::string& key, const std::string& value);
+
+// Appends a record removing |key| from |section| to |journal|.
+void btif_config_journal_remove(std::string* journal,
+                                const std::string& section,
+                                const std::string& key);
+
+// Applies the records in the journal file contents |journal| to |config|, in
+// order. Replay stops at the first truncated or corrupt record. Returns the
+// length of the valid part of |journal|, which is 0 if it does not start with
+// a journal header. If |records| is not NULL, it is set to the number of
+// records applied.
+size_t btif_config_journal_replay(const std::string& journal,
+                                  config_t* config, size_t* records);
@@ -29,8 +29,21 @@
 
 #include <stdint.h>
 
+/* Counters of the data moved between a socket of the stack and its app */
+typedef struct {
+  uint64_t bytes_to_app;
+  uint64_t bytes_from_app;
+  uint32_t sends_to_app;   /* Syscalls writing data to the app */
+  uint32_t recvs_from_app; /* Syscalls reading data from the app */
+  uint64_t start_ms;       /* When the counters were reset */
+} sock_io_stats_t;
+
 int sock_send_fd(int sock_fd, const uint8_t* buffer, int len, int send_fd);
 int sock_send_all(int sock_fd, const uint8_t* buf, int len);
 int sock_recv_all(int sock_fd, uint8_t* buf, int len);
 
+void sock_io_stats_reset(sock_io_stats_t* stats);
+void sock_io_stats_dump(int fd, const char* type, uint32_t id,
+                        const sock_io_stats_t* stats);
+
 #endif
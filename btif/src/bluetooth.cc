@@ -59,16 +59,20 @@
 #include "btif_debug_btsnoop.h"
 #include "btif_debug_conn.h"
 #include "btif_hf.h"
+#include "btif_sock.h"
 #include "btif_storage.h"
 #include "btsnoop.h"
 #include "btsnoop_mem.h"
+#include "hci_layer.h"
 #include "device/include/interop.h"
 #include "osi/include/alarm.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/log.h"
 #include "osi/include/metrics.h"
 #include "osi/include/osi.h"
+#include "osi/include/slab_allocator.h"
 #include "osi/include/wakelock.h"
+#include "smp_api.h"
 #include "stack_manager.h"
 
 /* Test interface includes */
@@ -316,11 +320,15 @@ static void dump(int fd, const char** arguments) {
   btif_debug_av_dump(fd);
   bta_debug_av_dump(fd);
   stack_debug_avdtp_api_dump(fd);
+  SMP_DebugDump(fd);
   bluetooth::avrcp::AvrcpService::DebugDump(fd);
   btif_debug_config_dump(fd);
   BTA_HfClientDumpStatistics(fd);
+  btif_sock_dump(fd);
+  hci_layer_debug_dump(fd);
   wakelock_debug_dump(fd);
   osi_allocator_debug_dump(fd);
+  slab_allocator_debug_dump(fd);
   alarm_debug_dump(fd);
   HearingAid::DebugDump(fd);
 #if (BTSNOOP_MEM == TRUE)
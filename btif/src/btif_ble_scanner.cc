@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <array>
 #include <unordered_set>
 #include "device/include/controller.h"
 
@@ -65,20 +66,34 @@ extern const btgatt_callbacks_t* bt_gatt_callbacks;
 
 namespace {
 
-// all access to this variable should be done on the jni thread
-std::set<RawAddress> remote_bdaddr_cache;
-std::queue<RawAddress> remote_bdaddr_cache_ordered;
+struct RemoteBdaddrHash {
+  size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+// all access to these variables should be done on the jni thread
 const size_t remote_bdaddr_cache_max_size = 1024;
+std::unordered_set<RawAddress, RemoteBdaddrHash> remote_bdaddr_cache(
+    remote_bdaddr_cache_max_size);
+// Cached addresses in insertion order, oldest at |remote_bdaddr_cache_next|
+// once the ring is full
+std::array<RawAddress, remote_bdaddr_cache_max_size>
+    remote_bdaddr_cache_ordered;
+size_t remote_bdaddr_cache_next = 0;
 
 void btif_gattc_add_remote_bdaddr(const RawAddress& p_bda, uint8_t addr_type) {
-  // Remove the oldest entries
-  while (remote_bdaddr_cache.size() >= remote_bdaddr_cache_max_size) {
-    const RawAddress& raw_address = remote_bdaddr_cache_ordered.front();
-    remote_bdaddr_cache.erase(raw_address);
-    remote_bdaddr_cache_ordered.pop();
-  }
+  // Remove the oldest entry
+  if (remote_bdaddr_cache.size() >= remote_bdaddr_cache_max_size)
+    remote_bdaddr_cache.erase(
+        remote_bdaddr_cache_ordered[remote_bdaddr_cache_next]);
+
   remote_bdaddr_cache.insert(p_bda);
-  remote_bdaddr_cache_ordered.push(p_bda);
+  remote_bdaddr_cache_ordered[remote_bdaddr_cache_next] = p_bda;
+  remote_bdaddr_cache_next =
+      (remote_bdaddr_cache_next + 1) % remote_bdaddr_cache_max_size;
 }
 
 bool btif_gattc_find_bdaddr(const RawAddress& p_bda) {
@@ -87,7 +102,7 @@ bool btif_gattc_find_bdaddr(const RawAddress& p_bda) {
 
 void btif_gattc_init_dev_cb(void) {
   remote_bdaddr_cache.clear();
-  remote_bdaddr_cache_ordered = {};
+  remote_bdaddr_cache_next = 0;
 }
 
 void bta_batch_scan_threshold_cb(tBTM_BLE_REF_VALUE ref_value) {
@@ -22,10 +22,14 @@
 
 #include <base/logging.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
+#include <algorithm>
 #include <string>
 
 #include <mutex>
@@ -34,6 +38,7 @@
 #include "btcore/include/module.h"
 #include "btif_api.h"
 #include "btif_common.h"
+#include "btif_config_journal.h"
 #include "btif_config_transcode.h"
 #include "btif_util.h"
 #include "osi/include/alarm.h"
@@ -43,6 +48,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "osi/include/time.h"
 
 #define BT_CONFIG_SOURCE_TAG_NUM 1010001
 
@@ -56,21 +62,44 @@ static const char* TIME_STRING_FORMAT = "%Y-%m-%d %H:%M:%S";
 #if defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH = "bt_config.journal";
 static const char* CONFIG_LEGACY_FILE_PATH = "bt_config.xml";
 #else   // !defined(OS_GENERIC)
 static const char* CONFIG_FILE_PATH = "/data/misc/bluedroid/bt_config.conf";
 static const char* CONFIG_BACKUP_PATH = "/data/misc/bluedroid/bt_config.bak";
+static const char* CONFIG_JOURNAL_PATH =
+    "/data/misc/bluedroid/bt_config.journal";
 static const char* CONFIG_LEGACY_FILE_PATH =
     "/data/misc/bluedroid/bt_config.xml";
 #endif  // defined(OS_GENERIC)
 static const period_ms_t CONFIG_SETTLE_PERIOD_MS = 3000;
 
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+// Once the journal would grow past this size, the config file is rewritten
+// instead and the journal emptied.
+static const size_t CONFIG_JOURNAL_COMPACT_SIZE = 64 * 1024;
+#endif
+
 static void timer_config_save_cb(void* data);
 static void btif_config_write(uint16_t event, char* p_param);
+static void btif_config_write_file(void);
+static void btif_config_update(const std::string& section,
+                               const std::string& key,
+                               const std::string& value);
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+static void btif_config_journal_recover(void);
+static bool btif_config_journal_write(void);
+static void btif_config_journal_reset(void);
+static void btif_config_journal_section(const std::string& section,
+                                        bool remove);
+#endif
 static bool is_factory_reset(void);
 static void delete_config_files(void);
+static bool btif_config_is_unpaired(const config_t& conf,
+                                    const std::string& section);
 static void btif_config_remove_unpaired(config_t* config);
 static void btif_config_remove_restricted(config_t* config);
+static uint64_t bytes_per_hour(uint64_t bytes);
 static std::unique_ptr<config_t> btif_config_open(const char* filename);
 
 static enum ConfigSource {
@@ -118,6 +147,26 @@ static std::mutex config_lock;  // protects operations on |config|.
 static std::unique_ptr<config_t> config;
 static alarm_t* config_timer;
 
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+// Journal records not yet appended to the journal file, and the size of the
+// journal file. Both are protected by |config_lock|.
+static std::string journal_pending;
+static size_t journal_file_size;
+static size_t journal_records_replayed;
+// Set when |config| has changes without journal records, which only a
+// rewrite of the config file persists. Protected by |config_lock|.
+static bool config_unjournaled;
+#endif
+
+// Write statistics, protected by |config_lock|.
+static uint64_t config_file_bytes_written;
+static uint64_t config_file_writes;
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+static uint64_t journal_bytes_written;
+static uint64_t journal_writes;
+#endif
+static period_ms_t config_write_stats_start_ms;
+
 // Module lifecycle functions
 
 static future_t* init(void) {
@@ -153,9 +202,24 @@ static future_t* init(void) {
     file_source = "Empty";
   }
 
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  // Bring the config up to date with the changes made after the file was
+  // last written.
+  btif_config_journal_recover();
+
+  // The changes made below have no journal records. Tell them apart from the
+  // replayed ones, which do.
+  bool replayed = config_is_dirty(*config);
+  config_clear_dirty(config.get());
+#endif
+
   if (!file_source.empty())
     config_set_string(config.get(), INFO_SECTION, FILE_SOURCE, file_source);
 
+  // The config file is missing or corrupt, so have the next write replace it
+  // even if nothing changes before then.
+  if (btif_config_source != ORIGINAL) config_set_dirty(config.get());
+
   btif_config_remove_unpaired(config.get());
 
   // Cleanup temporary pairings if we have left guest mode
@@ -175,6 +239,11 @@ static future_t* init(void) {
                       btif_config_time_created);
   }
 
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  config_unjournaled = config_is_dirty(*config);
+  if (replayed) config_set_dirty(config.get());
+#endif
+
   // TODO(sharvil): use a non-wake alarm for this once we have
   // API support for it. There's no need to wake the system to
   // write back to disk.
@@ -186,6 +255,7 @@ static future_t* init(void) {
 
   LOG_EVENT_INT(BT_CONFIG_SOURCE_TAG_NUM, btif_config_source);
 
+  config_write_stats_start_ms = time_get_os_boottime_ms();
   return future_new_immediate(FUTURE_SUCCESS);
 
 error:
@@ -262,7 +332,7 @@ bool btif_config_set_int(const std::string& section, const std::string& key,
   CHECK(config != NULL);
 
   std::unique_lock<std::mutex> lock(config_lock);
-  config_set_int(config.get(), section, key, value);
+  btif_config_update(section, key, std::to_string(value));
 
   return true;
 }
@@ -284,7 +354,7 @@ bool btif_config_set_uint64(const std::string& section, const std::string& key,
   CHECK(config != NULL);
 
   std::unique_lock<std::mutex> lock(config_lock);
-  config_set_uint64(config.get(), section, key, value);
+  btif_config_update(section, key, std::to_string(value));
 
   return true;
 }
@@ -312,7 +382,7 @@ bool btif_config_set_str(const std::string& section, const std::string& key,
   CHECK(config != NULL);
 
   std::unique_lock<std::mutex> lock(config_lock);
-  config_set_string(config.get(), section, key, value);
+  btif_config_update(section, key, value);
   return true;
 }
 
@@ -369,20 +439,35 @@ bool btif_config_set_bin(const std::string& section, const std::string& key,
 
   {
     std::unique_lock<std::mutex> lock(config_lock);
-    config_set_string(config.get(), section, key, str);
+    btif_config_update(section, key, str);
   }
 
   osi_free(str);
   return true;
 }
 
-std::list<section_t>& btif_config_sections() { return config->sections; }
+const std::list<section_t>& btif_config_sections() {
+  return config->sections;
+}
 
 bool btif_config_remove(const std::string& section, const std::string& key) {
   CHECK(config != NULL);
 
   std::unique_lock<std::mutex> lock(config_lock);
-  return config_remove_key(config.get(), section, key);
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  bool was_unpaired = btif_config_is_unpaired(*config, section);
+#endif
+  if (!config_remove_key(config.get(), section, key)) return false;
+
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  // Unpaired devices are left out of the journal, as they are out of the
+  // config file. A device that has just been unpaired is removed from it.
+  if (was_unpaired) return true;
+  btif_config_journal_remove(&journal_pending, section, key);
+  if (btif_config_is_unpaired(*config, section))
+    btif_config_journal_section(section, true);
+#endif
+  return true;
 }
 
 void btif_config_save(void) {
@@ -397,7 +482,10 @@ void btif_config_flush(void) {
   CHECK(config_timer != NULL);
 
   alarm_cancel(config_timer);
-  btif_config_write(0, NULL);
+
+  // Always write the full file here so that it is self-contained again.
+  std::unique_lock<std::mutex> lock(config_lock);
+  btif_config_write_file();
 }
 
 bool btif_config_clear(void) {
@@ -411,6 +499,9 @@ bool btif_config_clear(void) {
   config = config_new_empty();
 
   bool ret = config_save(*config, CONFIG_FILE_PATH);
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  if (ret) btif_config_journal_reset();
+#endif
   btif_config_source = RESET;
   return ret;
 }
@@ -428,10 +519,187 @@ static void btif_config_write(UNUSED_ATTR uint16_t event,
   CHECK(config_timer != NULL);
 
   std::unique_lock<std::mutex> lock(config_lock);
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  if (btif_config_journal_write()) return;
+#endif
+  btif_config_write_file();
+}
+
+// Writes the paired devices in |config| to the config file. Must be called
+// with |config_lock| held.
+static void btif_config_write_file(void) {
+  // Nothing to do if the file on disk is already up to date.
+  if (!config_is_dirty(*config)) return;
+
   rename(CONFIG_FILE_PATH, CONFIG_BACKUP_PATH);
   std::unique_ptr<config_t> config_paired = config_new_clone(*config);
   btif_config_remove_unpaired(config_paired.get());
-  config_save(*config_paired, CONFIG_FILE_PATH);
+  if (!config_save(*config_paired, CONFIG_FILE_PATH)) return;
+
+  config_clear_dirty(config.get());
+  config_file_writes++;
+  struct stat file_stat;
+  if (stat(CONFIG_FILE_PATH, &file_stat) == 0)
+    config_file_bytes_written += file_stat.st_size;
+
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  // Everything in the journal is in the config file now.
+  btif_config_journal_reset();
+#endif
+}
+
+// Sets |key| in |section| to |value| and records the change in the journal.
+// Must be called with |config_lock| held.
+static void btif_config_update(const std::string& section,
+                               const std::string& key,
+                               const std::string& value) {
+  const std::string* stored = config_get_string(*config, section, key, NULL);
+  if (stored && *stored == value) return;
+
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  bool was_unpaired = btif_config_is_unpaired(*config, section);
+#endif
+  config_set_string(config.get(), section, key, value);
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  // Unpaired devices are left out of the journal, as they are out of the
+  // config file. A device that has just been paired is journaled whole.
+  if (btif_config_is_unpaired(*config, section)) return;
+  if (was_unpaired)
+    btif_config_journal_section(section, false);
+  else
+    btif_config_journal_set(&journal_pending, section, key, value);
+#endif
+}
+
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+// Replays the journal file on top of the loaded |config|. Must be called with
+// |config_lock| held.
+static void btif_config_journal_recover(void) {
+  journal_pending.clear();
+  journal_file_size = 0;
+  journal_records_replayed = 0;
+
+  int fd = TEMP_FAILURE_RETRY(open(CONFIG_JOURNAL_PATH, O_RDONLY));
+  if (fd == INVALID_FD) return;
+
+  std::string journal;
+  char buffer[4096];
+  ssize_t ret;
+  while ((ret = TEMP_FAILURE_RETRY(read(fd, buffer, sizeof(buffer)))) > 0)
+    journal.append(buffer, ret);
+  close(fd);
+
+  journal_file_size = btif_config_journal_replay(journal, config.get(),
+                                                 &journal_records_replayed);
+  if (journal_file_size < journal.size()) {
+    // Drop the record torn by a crash so that new records are appended after
+    // the last valid one.
+    LOG_WARN(LOG_TAG, "%s discarding %zu bytes at the end of %s", __func__,
+             journal.size() - journal_file_size, CONFIG_JOURNAL_PATH);
+    if (truncate(CONFIG_JOURNAL_PATH, journal_file_size) != 0) {
+      LOG_ERROR(LOG_TAG, "%s unable to truncate %s: %s", __func__,
+                CONFIG_JOURNAL_PATH, strerror(errno));
+      // Starting a new journal would drop the replayed records, which are
+      // only in memory. Write them to the config file, which resets the
+      // journal, and until that is done make the next write do it.
+      btif_config_write_file();
+      if (journal_file_size != 0)
+        journal_file_size = CONFIG_JOURNAL_COMPACT_SIZE;
+    }
+  }
+
+  if (journal_records_replayed > 0)
+    LOG_INFO(LOG_TAG, "%s replayed %zu journal records", __func__,
+             journal_records_replayed);
+}
+
+// Appends the pending changes to the journal file. Returns false if the
+// config file has to be rewritten instead, either because the config has
+// changes without journal records, or because the journal is full or could
+// not be written. Must be called with |config_lock| held.
+static bool btif_config_journal_write(void) {
+  if (config_unjournaled) return false;
+  if (journal_pending.empty()) return true;
+
+  std::string data;
+  if (journal_file_size == 0) btif_config_journal_begin(&data);
+  data.append(journal_pending);
+  if (journal_file_size + data.size() > CONFIG_JOURNAL_COMPACT_SIZE)
+    return false;
+
+  int flags = O_WRONLY | O_CREAT | O_APPEND;
+  if (journal_file_size == 0) flags |= O_TRUNC;
+  int fd = TEMP_FAILURE_RETRY(
+      open(CONFIG_JOURNAL_PATH, flags, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP));
+  if (fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to open %s: %s", __func__,
+              CONFIG_JOURNAL_PATH, strerror(errno));
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t ret = TEMP_FAILURE_RETRY(
+        write(fd, data.data() + written, data.size() - written));
+    if (ret <= 0) break;
+    written += ret;
+  }
+
+  if (written < data.size() || fdatasync(fd) != 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to write %s: %s", __func__,
+              CONFIG_JOURNAL_PATH, strerror(errno));
+    if (ftruncate(fd, journal_file_size) != 0) journal_file_size = 0;
+    close(fd);
+    return false;
+  }
+  close(fd);
+
+  journal_file_size += data.size();
+  journal_bytes_written += data.size();
+  journal_writes++;
+  journal_pending.clear();
+  return true;
+}
+
+// Empties the journal after its contents made it into the config file. Must
+// be called with |config_lock| held.
+static void btif_config_journal_reset(void) {
+  journal_pending.clear();
+  config_unjournaled = false;
+  journal_file_size = 0;
+  remove(CONFIG_JOURNAL_PATH);
+}
+
+// Records setting, or removing if |remove| is true, every key |section| has
+// in |config|. Must be called with |config_lock| held.
+static void btif_config_journal_section(const std::string& section,
+                                        bool remove) {
+  for (const section_t& sec : config->sections) {
+    if (sec.name != section) continue;
+    for (const entry_t& entry : sec.entries) {
+      if (remove)
+        btif_config_journal_remove(&journal_pending, section, entry.key);
+      else
+        btif_config_journal_set(&journal_pending, section, entry.key,
+                                entry.value);
+    }
+  }
+}
+#endif  // (BTIF_CONFIG_JOURNAL == TRUE)
+
+// Returns true if |section| of |conf| is for a device without any keys,
+// which is not saved to the config file.
+static bool btif_config_is_unpaired(const config_t& conf,
+                                    const std::string& section) {
+  // TODO: config_has_key loop thorugh all data, maybe just make it so we
+  // loop just once ?
+  return RawAddress::IsValidAddress(section) &&
+         !config_has_key(conf, section, "LinkKey") &&
+         !config_has_key(conf, section, "LE_KEY_PENC") &&
+         !config_has_key(conf, section, "LE_KEY_PID") &&
+         !config_has_key(conf, section, "LE_KEY_PCSRK") &&
+         !config_has_key(conf, section, "LE_KEY_LENC") &&
+         !config_has_key(conf, section, "LE_KEY_LCSRK");
 }
 
 static void btif_config_remove_unpaired(config_t* conf) {
@@ -442,17 +710,11 @@ static void btif_config_remove_unpaired(config_t* conf) {
   // discovered devices during regular inquiry scans.
   // We remove these now and cache them in memory instead.
   for (auto it = conf->sections.begin(); it != conf->sections.end();) {
-    std::string& section = it->name;
+    const std::string section = it->name;
     if (RawAddress::IsValidAddress(section)) {
-      // TODO: config_has_key loop thorugh all data, maybe just make it so we
-      // loop just once ?
-      if (!config_has_key(*conf, section, "LinkKey") &&
-          !config_has_key(*conf, section, "LE_KEY_PENC") &&
-          !config_has_key(*conf, section, "LE_KEY_PID") &&
-          !config_has_key(*conf, section, "LE_KEY_PCSRK") &&
-          !config_has_key(*conf, section, "LE_KEY_LENC") &&
-          !config_has_key(*conf, section, "LE_KEY_LCSRK")) {
-        it = conf->sections.erase(it);
+      if (btif_config_is_unpaired(*conf, section)) {
+        it++;
+        config_remove_section(conf, section);
         continue;
       }
       paired_devices++;
@@ -496,18 +758,40 @@ void btif_debug_config_dump(int fd) {
   dprintf(fd, "  File source: %s\n",
           config_get_string(*config, INFO_SECTION, FILE_SOURCE, &original)
               ->c_str());
+
+  std::unique_lock<std::mutex> lock(config_lock);
+  dprintf(fd, "  Config file writes: %llu (%llu bytes, %llu bytes/hour)\n",
+          (unsigned long long)config_file_writes,
+          (unsigned long long)config_file_bytes_written,
+          (unsigned long long)bytes_per_hour(config_file_bytes_written));
+#if (BTIF_CONFIG_JOURNAL == TRUE)
+  dprintf(fd, "  Journal writes: %llu (%llu bytes, %llu bytes/hour)\n",
+          (unsigned long long)journal_writes,
+          (unsigned long long)journal_bytes_written,
+          (unsigned long long)bytes_per_hour(journal_bytes_written));
+  dprintf(fd, "  Journal size: %zu bytes, %zu records replayed at init\n",
+          journal_file_size, journal_records_replayed);
+#endif
+}
+
+// Returns the average rate at which |bytes| were written since init.
+static uint64_t bytes_per_hour(uint64_t bytes) {
+  period_ms_t elapsed_ms =
+      time_get_os_boottime_ms() - config_write_stats_start_ms;
+  return bytes * 60 * 60 * 1000 / std::max<uint64_t>(elapsed_ms, 1);
 }
 
 static void btif_config_remove_restricted(config_t* config) {
   CHECK(config != NULL);
 
   for (auto it = config->sections.begin(); it != config->sections.end();) {
-    const std::string& section = it->name;
+    const std::string section = it->name;
     if (RawAddress::IsValidAddress(section) &&
         config_has_key(*config, section, "Restricted")) {
       BTIF_TRACE_DEBUG("%s: Removing restricted device %s", __func__,
                        section.c_str());
-      it = config->sections.erase(it);
+      it++;
+      config_remove_section(config, section);
       continue;
     }
     it++;
@@ -523,5 +807,6 @@ static bool is_factory_reset(void) {
 static void delete_config_files(void) {
   remove(CONFIG_FILE_PATH);
   remove(CONFIG_BACKUP_PATH);
+  remove(CONFIG_JOURNAL_PATH);
   osi_property_set("persist.bluetooth.factoryreset", "false");
 }
@@ -0,0 +1,155 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_btif_config_journal"
+
+#include "btif_config_journal.h"
+
+#include <base/logging.h>
+#include <stdint.h>
+#include <string.h>
+
+// Journal file header: a magic value followed by the format version.
+static const char JOURNAL_MAGIC[] = {'B', 'T', 'C', 'J'};
+static const uint8_t JOURNAL_VERSION = 1;
+#define JOURNAL_HEADER_SIZE (sizeof(JOURNAL_MAGIC) + 1)
+
+// Each record is laid out as
+//   uint8_t  type
+//   uint16_t section length
+//   uint16_t key length
+//   uint16_t value length
+//   section, key and value bytes
+//   uint32_t checksum (FNV-1a over everything above)
+// with all integers in little endian byte order.
+enum journal_record_type_t : uint8_t {
+  JOURNAL_RECORD_SET = 1,
+  JOURNAL_RECORD_REMOVE = 2,
+};
+#define RECORD_HEADER_SIZE 7
+#define RECORD_CHECKSUM_SIZE 4
+
+static uint32_t checksum(const uint8_t* data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void put_uint16(std::string* out, size_t value) {
+  CHECK(value <= UINT16_MAX);
+  out->push_back(static_cast<char>(value & 0xff));
+  out->push_back(static_cast<char>(value >> 8));
+}
+
+static uint16_t get_uint16(const uint8_t* data) {
+  return data[0] | (data[1] << 8);
+}
+
+static uint32_t get_uint32(const uint8_t* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) |
+         ((uint32_t)data[3] << 24);
+}
+
+static void append_record(std::string* journal, journal_record_type_t type,
+                          const std::string& section, const std::string& key,
+                          const std::string& value) {
+  CHECK(journal != NULL);
+
+  size_t start = journal->size();
+  journal->push_back(static_cast<char>(type));
+  put_uint16(journal, section.size());
+  put_uint16(journal, key.size());
+  put_uint16(journal, value.size());
+  journal->append(section);
+  journal->append(key);
+  journal->append(value);
+
+  uint32_t hash =
+      checksum(reinterpret_cast<const uint8_t*>(journal->data()) + start,
+               journal->size() - start);
+  for (int i = 0; i < RECORD_CHECKSUM_SIZE; i++)
+    journal->push_back(static_cast<char>((hash >> (8 * i)) & 0xff));
+}
+
+void btif_config_journal_begin(std::string* journal) {
+  CHECK(journal != NULL);
+
+  journal->append(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+  journal->push_back(static_cast<char>(JOURNAL_VERSION));
+}
+
+void btif_config_journal_set(std::string* journal, const std::string& section,
+                             const std::string& key,
+                             const std::string& value) {
+  append_record(journal, JOURNAL_RECORD_SET, section, key, value);
+}
+
+void btif_config_journal_remove(std::string* journal,
+                                const std::string& section,
+                                const std::string& key) {
+  append_record(journal, JOURNAL_RECORD_REMOVE, section, key, std::string());
+}
+
+size_t btif_config_journal_replay(const std::string& journal,
+                                  config_t* config, size_t* records) {
+  CHECK(config != NULL);
+
+  if (records) *records = 0;
+
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(journal.data());
+  size_t length = journal.size();
+  if (length < JOURNAL_HEADER_SIZE ||
+      memcmp(data, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+      data[sizeof(JOURNAL_MAGIC)] != JOURNAL_VERSION)
+    return 0;
+
+  size_t offset = JOURNAL_HEADER_SIZE;
+  while (length - offset >= RECORD_HEADER_SIZE) {
+    const uint8_t* record = data + offset;
+    size_t section_length = get_uint16(record + 1);
+    size_t key_length = get_uint16(record + 3);
+    size_t value_length = get_uint16(record + 5);
+    size_t body_length =
+        RECORD_HEADER_SIZE + section_length + key_length + value_length;
+    if (length - offset < body_length + RECORD_CHECKSUM_SIZE) break;
+    if (get_uint32(record + body_length) != checksum(record, body_length))
+      break;
+
+    const char* strings =
+        reinterpret_cast<const char*>(record + RECORD_HEADER_SIZE);
+    std::string section(strings, section_length);
+    std::string key(strings + section_length, key_length);
+    if (record[0] == JOURNAL_RECORD_SET) {
+      config_set_string(
+          config, section, key,
+          std::string(strings + section_length + key_length, value_length));
+    } else if (record[0] == JOURNAL_RECORD_REMOVE) {
+      config_remove_key(config, section, key);
+    } else {
+      break;
+    }
+
+    offset += body_length + RECORD_CHECKSUM_SIZE;
+    if (records) (*records)++;
+  }
+
+  return offset;
+}
@@ -16,6 +16,7 @@
  *
  ******************************************************************************/
 
+#include <algorithm>
 #include <mutex>
 
 #include <base/logging.h>
@@ -47,14 +48,18 @@ static ringbuffer_t* buffer = NULL;
 static uint64_t last_timestamp_ms = 0;
 
 static size_t btsnoop_calculate_packet_length(uint16_t type,
-                                              const uint8_t* data,
+                                              const uint8_t* data, size_t len,
+                                              const uint8_t* more,
                                               size_t length);
 
 static void btsnoop_cb(const uint16_t type, const uint8_t* data,
-                       const size_t length, const uint64_t timestamp_us) {
+                       const size_t len, const uint8_t* more,
+                       const size_t more_len, const uint64_t timestamp_us) {
   btsnooz_header_t header;
 
-  size_t included_length = btsnoop_calculate_packet_length(type, data, length);
+  size_t length = len + more_len;
+  size_t included_length =
+      btsnoop_calculate_packet_length(type, data, len, more, length);
   if (included_length == 0) return;
 
   std::lock_guard<std::mutex> lock(buffer_mutex);
@@ -76,11 +81,17 @@ static void btsnoop_cb(const uint16_t type, const uint8_t* data,
   last_timestamp_ms = timestamp_us;
 
   ringbuffer_insert(buffer, (uint8_t*)&header, sizeof(btsnooz_header_t));
-  ringbuffer_insert(buffer, data, included_length);
+  size_t first = std::min(included_length, len);
+  ringbuffer_insert(buffer, data, first);
+  if (included_length > first)
+    ringbuffer_insert(buffer, more, included_length - first);
 }
 
+// |length| bytes of packet data: |len| bytes at |data|, then the rest at
+// |more|.
 static size_t btsnoop_calculate_packet_length(uint16_t type,
-                                              const uint8_t* data,
+                                              const uint8_t* data, size_t len,
+                                              const uint8_t* more,
                                               size_t length) {
   static const size_t HCI_ACL_HEADER_SIZE = 4;
   static const size_t L2CAP_HEADER_SIZE = 4;
@@ -106,8 +117,11 @@ static size_t btsnoop_calculate_packet_length(uint16_t type,
       size_t len_hci_acl = HCI_ACL_HEADER_SIZE + L2CAP_HEADER_SIZE;
       // Check if we have enough data for an L2CAP header
       if (length > len_hci_acl) {
+        auto byte_at = [&](size_t i) {
+          return i < len ? data[i] : more[i - len];
+        };
         uint16_t l2cap_cid =
-            data[L2CAP_CID_OFFSET] | (data[L2CAP_CID_OFFSET + 1] << 8);
+            byte_at(L2CAP_CID_OFFSET) | (byte_at(L2CAP_CID_OFFSET + 1) << 8);
         if (l2cap_cid == L2CAP_SIGNALING_CID) {
           // For the signaling CID, take the full packet.
           // That way, the PSM setup is captured, allowing decoding of PSMs down
@@ -18,6 +18,7 @@
 
 #define LOG_TAG "bt_btif_sock"
 
+#include <stdio.h>
 #include <atomic>
 
 #include <base/logging.h>
@@ -127,6 +128,12 @@ void btif_sock_cleanup(void) {
   thread = NULL;
 }
 
+void btif_sock_dump(int fd) {
+  dprintf(fd, "\nSocket I/O:\n");
+  btsock_rfc_dump(fd);
+  btsock_l2cap_dump(fd);
+}
+
 static bt_status_t btsock_listen(btsock_type_t type, const char* service_name,
                                  const Uuid* service_uuid, int channel,
                                  int* sock_fd, int flags, int app_uid) {
@@ -24,7 +24,6 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
-#include <vector>
 
 #include <mutex>
 
@@ -53,6 +52,10 @@
 #include "port_api.h"
 #include "sdp_api.h"
 
+#define MAX_L2CAP_MMSG 16
+
+/* A packet and its data are a single allocation, the data follows the
+ * packet. */
 struct packet {
   struct packet *next, *prev;
   uint32_t len;
@@ -75,6 +78,7 @@ typedef struct l2cap_socket {
   unsigned bytes_buffered;
   struct packet* first_packet;  // fist packet to be delivered to app
   struct packet* last_packet;   // last packet to be delivered to app
+  sock_io_stats_t io_stats;     // data moved through our_fd
 
   unsigned fixed_chan : 1;        // fixed channel (or psm?)
   unsigned server : 1;            // is a server? (or connecting?)
@@ -111,74 +115,43 @@ static void btsock_l2cap_cbk(tBTA_JV_EVT event, tBTA_JV* p_data,
  * wait
  *       confirming the l2cap_ind until we have more space in the buffer. */
 
-/* returns false if none - caller must free "data" memory when done with it */
-static char packet_get_head_l(l2cap_socket* sock, uint8_t** data,
-                              uint32_t* len) {
+/* Allocates a packet with room for |len| bytes of data right after it */
+static struct packet* packet_alloc(uint32_t len) {
+  struct packet* p = (struct packet*)osi_malloc(sizeof(*p) + len);
+
+  p->next = NULL;
+  p->prev = NULL;
+  p->len = len;
+  p->data = (uint8_t*)(p + 1);
+  return p;
+}
+
+/* frees the first packet in the queue, returns false if none */
+static bool packet_free_head_l(l2cap_socket* sock) {
   struct packet* p = sock->first_packet;
 
   if (!p) return false;
 
-  if (data) *data = sock->first_packet->data;
-  if (len) *len = sock->first_packet->len;
   sock->first_packet = p->next;
   if (sock->first_packet)
     sock->first_packet->prev = NULL;
   else
     sock->last_packet = NULL;
 
-  if (len) sock->bytes_buffered -= *len;
+  sock->bytes_buffered -= p->len;
 
   osi_free(p);
 
   return true;
 }
 
-static struct packet* packet_alloc(const uint8_t* data, uint32_t len) {
-  struct packet* p = (struct packet*)osi_calloc(sizeof(*p));
-  uint8_t* buf = (uint8_t*)osi_malloc(len);
-
-  p->data = buf;
-  p->len = len;
-  memcpy(p->data, data, len);
-  return p;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_head_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
-
-  /*
-   * We do not check size limits here since this is used to undo "getting" a
-   * packet that the user read incompletely. That is to say the packet was
-   * already in the queue. We do check thos elimits in packet_put_tail_l() since
-   * that function is used to put new data into the queue.
-   */
-
-  if (!p) return false;
-
-  p->prev = NULL;
-  p->next = sock->first_packet;
-  sock->first_packet = p;
-  if (p->next)
-    p->next->prev = p;
-  else
-    sock->last_packet = p;
-
-  sock->bytes_buffered += len;
-
-  return true;
-}
-
-/* makes a copy of the data, returns true on success */
-static char packet_put_tail_l(l2cap_socket* sock, const void* data,
-                              uint32_t len) {
+/* takes ownership of |p| on success, returns false if the queue is full */
+static bool packet_put_tail_l(l2cap_socket* sock, struct packet* p) {
   if (sock->bytes_buffered >= L2CAP_MAX_RX_BUFFER) {
     LOG(ERROR) << __func__ << ": buffer overflow";
     return false;
   }
 
-  struct packet* p = packet_alloc((const uint8_t*)data, len);
   p->next = NULL;
   p->prev = sock->last_packet;
   sock->last_packet = p;
@@ -187,7 +160,7 @@ static char packet_put_tail_l(l2cap_socket* sock, const void* data,
   else
     sock->first_packet = p;
 
-  sock->bytes_buffered += len;
+  sock->bytes_buffered += p->len;
 
   return true;
 }
@@ -207,7 +180,6 @@ static l2cap_socket* btsock_l2cap_find_by_id_l(uint32_t id) {
 }
 
 static void btsock_l2cap_free_l(l2cap_socket* sock) {
-  uint8_t* buf;
   l2cap_socket* t = socks;
 
   while (t && t != sock) t = t->next;
@@ -230,7 +202,8 @@ static void btsock_l2cap_free_l(l2cap_socket* sock) {
     LOG(ERROR) << "SOCK_LIST: free(id = " << sock->id << ") - NO app_fd!";
   }
 
-  while (packet_get_head_l(sock, &buf, NULL)) osi_free(buf);
+  while (packet_free_head_l(sock))
+    ;
 
   // lower-level close() should be idempotent... so let's call it and see...
   if (sock->is_le_coc) {
@@ -302,6 +275,7 @@ static l2cap_socket* btsock_l2cap_alloc_l(const char* name,
 
   sock->first_packet = NULL;
   sock->last_packet = NULL;
+  sock_io_stats_reset(&sock->io_stats);
 
   sock->tx_mtu = L2CAP_LE_MIN_MTU;
 
@@ -643,15 +617,17 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
 
     tBTA_JV_LE_DATA_IND* p_le_data_ind = &evt->le_data_ind;
     BT_HDR* p_buf = p_le_data_ind->p_buf;
-    uint8_t* data = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    struct packet* p = packet_alloc(p_buf->len);
+    memcpy(p->data, (uint8_t*)(p_buf + 1) + p_buf->offset, p_buf->len);
 
-    if (packet_put_tail_l(sock, data, p_buf->len)) {
+    if (packet_put_tail_l(sock, p)) {
       bytes_read = p_buf->len;
       btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP, SOCK_THREAD_FD_WR,
                            sock->id);
     } else {  // connection must be dropped
       DVLOG(2) << __func__
                << ": unable to push data to socket - closing  fixed channel";
+      osi_free(p);
       BTA_JvL2capCloseLE(sock->handle);
       btsock_l2cap_free_l(sock);
     }
@@ -660,19 +636,21 @@ static void on_l2cap_data_ind(tBTA_JV* evt, uint32_t id) {
     uint32_t count;
 
     if (BTA_JvL2capReady(sock->handle, &count) == BTA_JV_SUCCESS) {
-      std::vector<uint8_t> buffer(count);
-      if (BTA_JvL2capRead(sock->handle, sock->id, buffer.data(), count) ==
+      /* read straight into the packet that is queued for the app */
+      struct packet* p = packet_alloc(count);
+      if (BTA_JvL2capRead(sock->handle, sock->id, p->data, count) !=
           BTA_JV_SUCCESS) {
-        if (packet_put_tail_l(sock, buffer.data(), count)) {
-          bytes_read = count;
-          btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
-                               SOCK_THREAD_FD_WR, sock->id);
-        } else {  // connection must be dropped
-          DVLOG(2) << __func__
-                   << ": unable to push data to socket - closing channel";
-          BTA_JvL2capClose(sock->handle);
-          btsock_l2cap_free_l(sock);
-        }
+        osi_free(p);
+      } else if (packet_put_tail_l(sock, p)) {
+        bytes_read = count;
+        btsock_thread_add_fd(pth, sock->our_fd, BTSOCK_L2CAP,
+                             SOCK_THREAD_FD_WR, sock->id);
+      } else {  // connection must be dropped
+        DVLOG(2) << __func__
+                 << ": unable to push data to socket - closing channel";
+        osi_free(p);
+        BTA_JvL2capClose(sock->handle);
+        btsock_l2cap_free_l(sock);
       }
     }
   }
@@ -894,26 +872,35 @@ bt_status_t btsock_l2cap_connect(const RawAddress* bd_addr, int channel,
  * (for example: unrecoverable error or no data)
  */
 static bool flush_incoming_que_on_wr_signal_l(l2cap_socket* sock) {
-  uint8_t* buf;
-  uint32_t len;
+  /* The socket is created with SOCK_SEQPACKET, so each queued packet is one
+   * message, and the kernel takes each of them whole or not at all. Hand
+   * over up to MAX_L2CAP_MMSG of them per syscall. */
+  while (sock->first_packet) {
+    struct mmsghdr msgs[MAX_L2CAP_MMSG];
+    struct iovec iov[MAX_L2CAP_MMSG];
+    unsigned int count = 0;
+
+    memset(msgs, 0, sizeof(msgs));
+    for (struct packet* p = sock->first_packet; p && count < MAX_L2CAP_MMSG;
+         p = p->next, count++) {
+      iov[count].iov_base = p->data;
+      iov[count].iov_len = p->len;
+      msgs[count].msg_hdr.msg_iov = &iov[count];
+      msgs[count].msg_hdr.msg_iovlen = 1;
+    }
 
-  while (packet_get_head_l(sock, &buf, &len)) {
-    ssize_t sent;
-    OSI_NO_INTR(sent = send(sock->our_fd, buf, len, MSG_DONTWAIT));
-    int saved_errno = errno;
-
-    if (sent == (signed)len)
-      osi_free(buf);
-    else if (sent >= 0) {
-      packet_put_head_l(sock, buf + sent, len - sent);
-      osi_free(buf);
-      if (!sent) /* special case if other end not keeping up */
-        return true;
-    } else {
-      packet_put_head_l(sock, buf, len);
-      osi_free(buf);
-      return saved_errno == EWOULDBLOCK || saved_errno == EAGAIN;
+    int sent;
+    OSI_NO_INTR(sent = sendmmsg(sock->our_fd, msgs, count, MSG_DONTWAIT));
+    if (sent < 0) return errno == EWOULDBLOCK || errno == EAGAIN;
+
+    sock->io_stats.sends_to_app++;
+    for (int i = 0; i < sent; i++) {
+      sock->io_stats.bytes_to_app += msgs[i].msg_len;
+      packet_free_head_l(sock);
     }
+
+    /* other end not keeping up */
+    if ((unsigned int)sent < count) return true;
   }
 
   return false;
@@ -974,6 +961,8 @@ void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
            length. */
         buffer->len = count;
         DVLOG(2) << __func__ << ": bytes received from socket: " << count;
+        sock->io_stats.recvs_from_app++;
+        if (count > 0) sock->io_stats.bytes_from_app += count;
 
         if (sock->fixed_chan) {
           // will take care of freeing buffer
@@ -999,3 +988,12 @@ void btsock_l2cap_signaled(int fd, int flags, uint32_t user_id) {
       btsock_l2cap_free_l(sock);
   }
 }
+
+void btsock_l2cap_dump(int fd) {
+  std::unique_lock<std::mutex> lock(state_lock);
+  for (l2cap_socket* sock = socks; sock; sock = sock->next) {
+    if (!sock->connected) continue;
+    sock_io_stats_dump(fd, sock->is_le_coc ? "LE CoC" : "L2CAP", sock->id,
+                       &sock->io_stats);
+  }
+}
@@ -26,6 +26,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <mutex>
@@ -67,6 +68,9 @@ using bluetooth::Uuid;
 // Maximum number of devices we can have an RFCOMM connection with.
 #define MAX_RFC_SESSION 7
 
+// Maximum number of buffers moved between the stack and the app per syscall.
+#define MAX_RFC_IOV 16
+
 typedef struct {
   int outgoing_congest : 1;
   int pending_sdp_request : 1;
@@ -97,6 +101,7 @@ typedef struct {
   int rfc_port_handle;
   int role;
   list_t* incoming_queue;
+  sock_io_stats_t io_stats;
 } rfc_slot_t;
 
 static rfc_slot_t rfc_slots[MAX_RFC_CHANNEL];
@@ -229,6 +234,7 @@ static rfc_slot_t* alloc_rfc_slot(const RawAddress* addr, const char* name,
 
   slot->id = rfc_slot_id;
   slot->f.server = server;
+  sock_io_stats_reset(&slot->io_stats);
 
   return slot;
 }
@@ -747,12 +753,12 @@ typedef enum {
   SENT_ALL,
 } sent_status_t;
 
-static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
+static sent_status_t send_data_to_app(rfc_slot_t* slot, BT_HDR* p_buf) {
   if (p_buf->len == 0) return SENT_ALL;
 
   ssize_t sent;
-  OSI_NO_INTR(
-      sent = send(fd, p_buf->data + p_buf->offset, p_buf->len, MSG_DONTWAIT));
+  OSI_NO_INTR(sent = send(slot->fd, p_buf->data + p_buf->offset, p_buf->len,
+                          MSG_DONTWAIT));
 
   if (sent == -1) {
     if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
@@ -763,6 +769,9 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
 
   if (sent == 0) return SENT_FAILED;
 
+  slot->io_stats.sends_to_app++;
+  slot->io_stats.bytes_to_app += sent;
+
   if (sent == p_buf->len) return SENT_ALL;
 
   p_buf->offset += sent;
@@ -770,10 +779,61 @@ static sent_status_t send_data_to_app(int fd, BT_HDR* p_buf) {
   return SENT_PARTIAL;
 }
 
+// Sends the head of the incoming queue to the app with a single sendmsg(),
+// freeing the buffers that were sent. Returns SENT_ALL if the whole batch was
+// sent.
+static sent_status_t send_queue_to_app(rfc_slot_t* slot) {
+  struct iovec iov[MAX_RFC_IOV];
+  int iovcnt = 0;
+  size_t total = 0;
+  for (const list_node_t* node = list_begin(slot->incoming_queue);
+       node != list_end(slot->incoming_queue) && iovcnt < MAX_RFC_IOV;
+       node = list_next(node)) {
+    BT_HDR* p_buf = (BT_HDR*)list_node(node);
+    iov[iovcnt].iov_base = p_buf->data + p_buf->offset;
+    iov[iovcnt].iov_len = p_buf->len;
+    total += p_buf->len;
+    iovcnt++;
+  }
+
+  ssize_t sent = 0;
+  if (total != 0) {
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    OSI_NO_INTR(sent = sendmsg(slot->fd, &msg, MSG_DONTWAIT));
+
+    if (sent == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) return SENT_NONE;
+      LOG_ERROR(LOG_TAG, "%s error writing RFCOMM data back to app: %s",
+                __func__, strerror(errno));
+      return SENT_FAILED;
+    }
+
+    if (sent == 0) return SENT_FAILED;
+
+    slot->io_stats.sends_to_app++;
+    slot->io_stats.bytes_to_app += sent;
+  }
+
+  size_t left = sent;
+  for (int i = 0; i < iovcnt; i++) {
+    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
+    if (p_buf->len > left) {
+      p_buf->offset += left;
+      p_buf->len -= left;
+      break;
+    }
+    left -= p_buf->len;
+    list_remove(slot->incoming_queue, p_buf);
+  }
+
+  return (size_t)sent == total ? SENT_ALL : SENT_PARTIAL;
+}
+
 static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
   while (!list_is_empty(slot->incoming_queue)) {
-    BT_HDR* p_buf = (BT_HDR*)list_front(slot->incoming_queue);
-    switch (send_data_to_app(slot->fd, p_buf)) {
+    switch (send_queue_to_app(slot)) {
       case SENT_NONE:
       case SENT_PARTIAL:
         // monitor the fd to get callback when app is ready to receive data
@@ -782,11 +842,9 @@ static bool flush_incoming_que_on_wr_signal(rfc_slot_t* slot) {
         return true;
 
       case SENT_ALL:
-        list_remove(slot->incoming_queue, p_buf);
         break;
 
       case SENT_FAILED:
-        list_remove(slot->incoming_queue, p_buf);
         return false;
     }
   }
@@ -855,7 +913,7 @@ int bta_co_rfc_data_incoming(uint32_t id, BT_HDR* p_buf) {
   bytes_rx = p_buf->len;
 
   if (list_is_empty(slot->incoming_queue)) {
-    switch (send_data_to_app(slot->fd, p_buf)) {
+    switch (send_data_to_app(slot, p_buf)) {
       case SENT_NONE:
       case SENT_PARTIAL:
         list_append(slot->incoming_queue, p_buf);
@@ -914,5 +972,58 @@ int bta_co_rfc_data_outgoing(uint32_t id, uint8_t* buf, uint16_t size) {
     return false;
   }
 
+  slot->io_stats.recvs_from_app++;
+  slot->io_stats.bytes_from_app += received;
   return true;
 }
+
+int bta_co_rfc_data_outgoing_batch(uint32_t id, BT_HDR** bufs,
+                                   uint16_t num_bufs) {
+  std::unique_lock<std::recursive_mutex> lock(slot_lock);
+  rfc_slot_t* slot = find_rfc_slot_by_id(id);
+  if (!slot) return false;
+
+  // Read straight into the payload of each buffer
+  size_t total = 0;
+  while (num_bufs) {
+    struct iovec iov[MAX_RFC_IOV];
+    int iovcnt = 0;
+    size_t size = 0;
+    for (; iovcnt < MAX_RFC_IOV && iovcnt < num_bufs; iovcnt++) {
+      BT_HDR* p_buf = bufs[iovcnt];
+      iov[iovcnt].iov_base = p_buf->data + p_buf->offset;
+      iov[iovcnt].iov_len = p_buf->len;
+      size += p_buf->len;
+    }
+
+    struct msghdr msg = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iovcnt;
+    ssize_t received;
+    OSI_NO_INTR(received = recvmsg(slot->fd, &msg, MSG_WAITALL));
+
+    if (received != (ssize_t)size) {
+      LOG_ERROR(LOG_TAG, "%s error receiving RFCOMM data from app: %s",
+                __func__, strerror(errno));
+      cleanup_rfc_slot(slot);
+      return false;
+    }
+
+    slot->io_stats.recvs_from_app++;
+    total += received;
+    bufs += iovcnt;
+    num_bufs -= iovcnt;
+  }
+
+  slot->io_stats.bytes_from_app += total;
+  return true;
+}
+
+void btsock_rfc_dump(int fd) {
+  std::unique_lock<std::recursive_mutex> lock(slot_lock);
+  for (size_t i = 0; i < ARRAY_SIZE(rfc_slots); ++i) {
+    const rfc_slot_t* slot = &rfc_slots[i];
+    if (!slot->id || !slot->f.connected) continue;
+    sock_io_stats_dump(fd, "RFCOMM", slot->id, &slot->io_stats);
+  }
+}
@@ -50,6 +50,7 @@
 #include "btu.h"
 #include "hcimsgs.h"
 #include "osi/include/log.h"
+#include "osi/include/time.h"
 #include "port_api.h"
 #include "sdp_api.h"
 
@@ -145,3 +146,33 @@ int sock_send_fd(int sock_fd, const uint8_t* buf, int len, int send_fd) {
   close(send_fd);
   return ret_len;
 }
+
+void sock_io_stats_reset(sock_io_stats_t* stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->start_ms = time_get_os_boottime_ms();
+}
+
+void sock_io_stats_dump(int fd, const char* type, uint32_t id,
+                        const sock_io_stats_t* stats) {
+  uint64_t elapsed_ms = time_get_os_boottime_ms() - stats->start_ms;
+  if (elapsed_ms == 0) elapsed_ms = 1;
+
+  dprintf(fd, "  %s socket %u: up %llu ms\n", type, id,
+          (unsigned long long)elapsed_ms);
+  dprintf(fd,
+          "    to app:   %llu bytes in %u syscalls (%llu bytes/syscall), "
+          "%llu KB/s\n",
+          (unsigned long long)stats->bytes_to_app, stats->sends_to_app,
+          (unsigned long long)(stats->sends_to_app
+                                   ? stats->bytes_to_app / stats->sends_to_app
+                                   : 0),
+          (unsigned long long)(stats->bytes_to_app / elapsed_ms));
+  dprintf(fd,
+          "    from app: %llu bytes in %u syscalls (%llu bytes/syscall), "
+          "%llu KB/s\n",
+          (unsigned long long)stats->bytes_from_app, stats->recvs_from_app,
+          (unsigned long long)(stats->recvs_from_app ? stats->bytes_from_app /
+                                                           stats->recvs_from_app
+                                                     : 0),
+          (unsigned long long)(stats->bytes_from_app / elapsed_ms));
+}
@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include <gtest/gtest.h>
+
+#include "btif/include/btif_config_journal.h"
+#include "osi/include/config.h"
+
+static const char SECTION[] = "00:11:22:33:44:55";
+
+static std::string make_journal() {
+  std::string journal;
+  btif_config_journal_begin(&journal);
+  btif_config_journal_set(&journal, SECTION, "Name", "Headset");
+  btif_config_journal_set(&journal, SECTION, "DevClass", "2360324");
+  btif_config_journal_set(&journal, SECTION, "Name", "Car kit");
+  btif_config_journal_remove(&journal, SECTION, "DevClass");
+  return journal;
+}
+
+TEST(BtifConfigJournalTest, test_replay) {
+  std::string journal = make_journal();
+  std::unique_ptr<config_t> config = config_new_empty();
+
+  size_t records;
+  EXPECT_EQ(journal.size(),
+            btif_config_journal_replay(journal, config.get(), &records));
+  EXPECT_EQ(4u, records);
+  EXPECT_EQ("Car kit", *config_get_string(*config, SECTION, "Name", NULL));
+  EXPECT_FALSE(config_has_key(*config, SECTION, "DevClass"));
+}
+
+TEST(BtifConfigJournalTest, test_replay_is_idempotent) {
+  std::string journal = make_journal();
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), SECTION, "DevClass", "7936");
+
+  btif_config_journal_replay(journal, config.get(), NULL);
+  btif_config_journal_replay(journal, config.get(), NULL);
+  EXPECT_EQ("Car kit", *config_get_string(*config, SECTION, "Name", NULL));
+  EXPECT_FALSE(config_has_key(*config, SECTION, "DevClass"));
+}
+
+TEST(BtifConfigJournalTest, test_missing_header) {
+  std::string journal;
+  btif_config_journal_set(&journal, SECTION, "Name", "Headset");
+  std::unique_ptr<config_t> config = config_new_empty();
+
+  size_t records;
+  EXPECT_EQ(0u, btif_config_journal_replay(journal, config.get(), &records));
+  EXPECT_EQ(0u, records);
+  EXPECT_FALSE(config_has_section(*config, SECTION));
+  EXPECT_EQ(0u, btif_config_journal_replay("", config.get(), NULL));
+}
+
+// A crash while appending leaves a partial record at the end of the journal;
+// everything before it must still be applied.
+TEST(BtifConfigJournalTest, test_truncated_record) {
+  std::string journal = make_journal();
+  size_t valid_size = journal.size();
+  btif_config_journal_set(&journal, SECTION, "Name", "Lost");
+
+  for (size_t size = valid_size; size < journal.size(); size++) {
+    std::unique_ptr<config_t> config = config_new_empty();
+    EXPECT_EQ(valid_size, btif_config_journal_replay(journal.substr(0, size),
+                                                     config.get(), NULL));
+    EXPECT_EQ("Car kit", *config_get_string(*config, SECTION, "Name", NULL));
+  }
+}
+
+TEST(BtifConfigJournalTest, test_corrupt_record) {
+  std::string journal;
+  btif_config_journal_begin(&journal);
+  btif_config_journal_set(&journal, SECTION, "Name", "Headset");
+  size_t valid_size = journal.size();
+  btif_config_journal_set(&journal, SECTION, "Name", "Car kit");
+  btif_config_journal_set(&journal, SECTION, "DevType", "1");
+  journal[valid_size + 12] ^= 0x01;
+
+  std::unique_ptr<config_t> config = config_new_empty();
+  size_t records;
+  EXPECT_EQ(valid_size,
+            btif_config_journal_replay(journal, config.get(), &records));
+  EXPECT_EQ(1u, records);
+  EXPECT_EQ("Headset", *config_get_string(*config, SECTION, "Name", NULL));
+  EXPECT_FALSE(config_has_key(*config, SECTION, "DevType"));
+}
@@ -0,0 +1,151 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+#include <base/logging.h>
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "btif/include/btif_sock_thread.h"
+#include "internal_include/bt_target.h"
+#include "internal_include/bt_trace.h"
+
+uint8_t appl_trace_level = BT_TRACE_LEVEL_WARNING;
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+static const int NUM_SOCKETS = 256;
+static const int NUM_ROUNDS = 100;
+
+static std::mutex signaled_mutex;
+static std::condition_variable signaled_cv;
+static std::vector<int> signaled_flags;
+static int num_signaled;
+
+static void signaled_cb(int fd, int type, int flags, uint32_t user_id) {
+  std::unique_lock<std::mutex> lock(signaled_mutex);
+  if (user_id < signaled_flags.size()) signaled_flags[user_id] |= flags;
+  if (flags & SOCK_THREAD_FD_RD) {
+    char byte;
+    while (recv(fd, &byte, sizeof(byte), MSG_DONTWAIT) == sizeof(byte)) {
+    }
+  }
+  num_signaled++;
+  signaled_cv.notify_all();
+}
+
+static bool wait_for_signaled(
+    int count, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+  std::unique_lock<std::mutex> lock(signaled_mutex);
+  return signaled_cv.wait_for(lock, timeout,
+                              [count] { return num_signaled >= count; });
+}
+
+class BtifSockThreadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    signaled_flags.assign(NUM_SOCKETS, 0);
+    num_signaled = 0;
+    btsock_thread_init();
+    handle = btsock_thread_create(signaled_cb, NULL);
+    ASSERT_GE(handle, 0);
+
+    for (int i = 0; i < NUM_SOCKETS; i++) {
+      int fds[2];
+      ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+      our_fds.push_back(fds[0]);
+      app_fds.push_back(fds[1]);
+    }
+  }
+
+  void TearDown() override {
+    btsock_thread_exit(handle);
+    for (int fd : our_fds)
+      if (fd != -1) close(fd);
+    for (int fd : app_fds)
+      if (fd != -1) close(fd);
+    our_fds.clear();
+    app_fds.clear();
+  }
+
+  int handle;
+  std::vector<int> our_fds;
+  std::vector<int> app_fds;
+};
+
+TEST_F(BtifSockThreadTest, test_read_is_one_shot) {
+  btsock_thread_add_fd(handle, our_fds[0], 0, SOCK_THREAD_FD_RD, 0);
+  ASSERT_EQ(1, write(app_fds[0], "a", 1));
+  ASSERT_TRUE(wait_for_signaled(1));
+  EXPECT_EQ(SOCK_THREAD_FD_RD, signaled_flags[0]);
+
+  // Not signaled again until the read monitor is added back.
+  ASSERT_EQ(1, write(app_fds[0], "b", 1));
+  EXPECT_FALSE(wait_for_signaled(2, std::chrono::milliseconds(100)));
+
+  btsock_thread_add_fd(handle, our_fds[0], 0, SOCK_THREAD_FD_RD, 0);
+  ASSERT_TRUE(wait_for_signaled(2));
+}
+
+TEST_F(BtifSockThreadTest, test_exception_on_close) {
+  btsock_thread_add_fd(handle, our_fds[0], 0, SOCK_THREAD_FD_EXCEPTION, 0);
+  close(app_fds[0]);
+  app_fds[0] = -1;
+  ASSERT_TRUE(wait_for_signaled(1));
+  EXPECT_TRUE(signaled_flags[0] & SOCK_THREAD_FD_EXCEPTION);
+}
+
+// Drives every socket through NUM_ROUNDS of read readiness: each round adds
+// the read monitor back for all 256 sockets, then writes to all of them.
+TEST_F(BtifSockThreadTest, test_256_sockets) {
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 1; round <= NUM_ROUNDS; round++) {
+    for (int i = 0; i < NUM_SOCKETS; i++)
+      btsock_thread_add_fd(handle, our_fds[i], 0, SOCK_THREAD_FD_RD, i);
+    for (int i = 0; i < NUM_SOCKETS; i++)
+      ASSERT_EQ(1, write(app_fds[i], "x", 1));
+    ASSERT_TRUE(wait_for_signaled(round * NUM_SOCKETS))
+        << "round " << round << " signaled " << num_signaled;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  EXPECT_EQ(NUM_ROUNDS * NUM_SOCKETS, num_signaled);
+  for (int i = 0; i < NUM_SOCKETS; i++)
+    EXPECT_EQ(SOCK_THREAD_FD_RD, signaled_flags[i]);
+  LOG(INFO) << NUM_SOCKETS << " sockets, " << NUM_ROUNDS
+            << " rounds: " << elapsed << "us";
+}
+
+TEST_F(BtifSockThreadTest, test_remove_fd_and_close) {
+  btsock_thread_add_fd(handle, our_fds[0], 0, SOCK_THREAD_FD_RD, 0);
+  ASSERT_TRUE(btsock_thread_remove_fd_and_close(handle, our_fds[0]));
+
+  // Commands run in order, so the remove is done once the next fd signals.
+  btsock_thread_add_fd(handle, our_fds[1], 0, SOCK_THREAD_FD_RD, 1);
+  ASSERT_EQ(1, write(app_fds[1], "x", 1));
+  ASSERT_TRUE(wait_for_signaled(1));
+  EXPECT_EQ(0, signaled_flags[0]);
+  EXPECT_EQ(-1, fcntl(our_fds[0], F_GETFD));
+  our_fds[0] = -1;
+}
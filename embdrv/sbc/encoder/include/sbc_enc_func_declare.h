@@ -26,6 +26,29 @@
 #define SBC_FUNCDECLARE_H
 
 #include "sbc_encoder.h"
+
+/* The SIMD analysis is bit-exact with the default configuration only */
+#if ((SBC_SIMD_OPT == TRUE) && (SBC_IPAQ_OPT == TRUE) &&                    \
+     (SBC_ARM_ASM_OPT == FALSE) && (SBC_DSP_OPT == FALSE) &&                \
+     (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE) && (SBC_FAST_DCT == TRUE) && \
+     (SBC_IS_64_MULT_IN_IDCT == FALSE))
+#define SBC_ANALYSIS_SIMD TRUE
+#else
+#define SBC_ANALYSIS_SIMD FALSE
+#endif
+
+/* Analysis filter and DCT code for one instruction set */
+typedef struct {
+  const char* name;
+  /* Window one block of one channel: ps16X points at the newest sample in
+   * s16X, ps32DCTY receives 2 * subbands values */
+  void (*window4)(const int16_t* ps16X, int32_t* ps32DCTY);
+  void (*window8)(const int16_t* ps16X, int32_t* ps32DCTY);
+  /* Fast DCT of s32NumOfDCT windowed blocks into subband samples */
+  void (*idct4)(int32_t* ps32DCTY, int32_t* ps32SbBuf, int32_t s32NumOfDCT);
+  void (*idct8)(int32_t* ps32DCTY, int32_t* ps32SbBuf, int32_t s32NumOfDCT);
+} SBC_ANALYSIS_KERNELS;
+
 /* Global data */
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == FALSE)
 extern const int16_t gas32CoeffFor4SBs[];
@@ -34,6 +57,12 @@ extern const int16_t gas32CoeffFor8SBs[];
 extern const int32_t gas32CoeffFor4SBs[];
 extern const int32_t gas32CoeffFor8SBs[];
 #endif
+#if (SBC_ANALYSIS_SIMD == TRUE)
+/* The window taps: s32DCTY[m] is the sum over j of gas16AnalWindow[j][m] *
+ * s16X[ChOffset + 2 * subbands * j + m] */
+extern const int16_t gas16AnalWindow4[5][8];
+extern const int16_t gas16AnalWindow8[5][16];
+#endif
 
 /* Global functions*/
 
@@ -41,6 +70,10 @@ extern void sbc_enc_bit_alloc_mono(SBC_ENC_PARAMS* CodecParams);
 extern void sbc_enc_bit_alloc_ste(SBC_ENC_PARAMS* CodecParams);
 
 extern void SbcAnalysisInit(void);
+extern bool SbcAnalysisSelectKernels(const char* name);
+#if (SBC_ANALYSIS_SIMD == TRUE)
+extern const SBC_ANALYSIS_KERNELS* SbcAnalysisSimdKernels(const char* name);
+#endif
 
 extern void SbcAnalysisFilter4(SBC_ENC_PARAMS* strEncParams, int16_t* input);
 extern void SbcAnalysisFilter8(SBC_ENC_PARAMS* strEncParams, int16_t* input);
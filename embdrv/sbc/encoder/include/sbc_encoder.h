@@ -138,6 +138,22 @@
 #define SBC_FAST_DCT TRUE
 #endif /*SBC_FAST_DCT */
 
+/* Set SBC_SIMD_OPT to TRUE to run the analysis filter and the fast DCT with
+ * SSE4.1, AVX2 or NEON when the CPU has them. The results are bit-exact with
+ * the C code. It only applies to the default configuration: SBC_IPAQ_OPT with
+ * 16 bit windowing and 32 bit fast DCT.
+ */
+#ifndef SBC_SIMD_OPT
+#define SBC_SIMD_OPT TRUE
+#endif /*SBC_SIMD_OPT */
+
+/* The NEON analysis code is off until stack_sbc_encoder_test has passed
+ * bit-exact with it on arm and arm64. Set SBC_SIMD_NEON to TRUE to use it.
+ */
+#ifndef SBC_SIMD_NEON
+#define SBC_SIMD_NEON FALSE
+#endif /*SBC_SIMD_NEON */
+
 /* In case we do not use joint stereo mode the flag save some RAM and ROM in
  * case it is set to FALSE */
 #ifndef SBC_JOINT_STE_INCLUDED
@@ -197,6 +213,11 @@ extern uint32_t SBC_Encode(SBC_ENC_PARAMS* strEncParams, int16_t* input,
                            uint8_t* output);
 extern void SBC_Encoder_Init(SBC_ENC_PARAMS* strEncParams);
 
+/* Select the analysis filter and DCT code by |name|: "c", "sse4.1", "avx2" or
+ * "neon". By default the fastest one the CPU supports is used. Return false if
+ * |name| isn't available on this CPU. */
+extern bool SBC_Encoder_SelectKernels(const char* name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -200,7 +200,9 @@
 #if (SBC_USE_ARM_PRAGMA == TRUE)
 #pragma arm section zidata = "sbc_s32_analysis_section"
 #endif
-static int32_t s32DCTY[16] = {0};
+/* The windowed blocks of a frame, 2 * subbands values each */
+static int32_t s32DCTYBuf[SBC_MAX_NUM_OF_BLOCKS * SBC_MAX_NUM_OF_CHANNELS *
+                          SBC_MAX_NUM_OF_SUBBANDS * 2] = {0};
 static int32_t s32X[ENC_VX_BUFFER_SIZE / 2];
 static int16_t* s16X =
     (int16_t*)s32X; /* s16X must be 32 bits aligned cf  SHIFTUP_X8_2*/
@@ -1187,18 +1189,10 @@ static int16_t* s16X =
 
 static int16_t ShiftCounter = 0;
 extern int16_t EncMaxShiftCounter;
-/****************************************************************************
-* SbcAnalysisFilter - performs Analysis of the input audio stream
-*
-* RETURNS : N/A
-*/
-void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
-  int16_t* ps16PcmBuf;
-  int32_t* ps32SbBuf;
-  int32_t s32Blk, s32Ch;
-  int32_t s32NumOfChannels, s32NumOfBlocks;
-  int32_t i, *ps32X, *ps32X2;
-  int32_t Offset, Offset2, ChOffset;
+
+/* The window macros read s16X[ChOffset + n] and write s32DCTY[n] */
+static void SbcWindow4(const int16_t* ps16X, int32_t* s32DCTY) {
+  int32_t ChOffset = (int32_t)(ps16X - s16X);
 #if (SBC_ARM_ASM_OPT == TRUE)
   register int32_t s32Hi, s32Hi2;
 #else
@@ -1209,20 +1203,157 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   register int32_t s32Temp, s32Temp2;
 #endif
 #else
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
+  int64_t s64Temp;
+#endif
+#endif
+#endif
+
+  WINDOW_PARTIAL_4
+}
 
+static void SbcWindow8(const int16_t* ps16X, int32_t* s32DCTY) {
+  int32_t ChOffset = (int32_t)(ps16X - s16X);
+#if (SBC_ARM_ASM_OPT == TRUE)
+  register int32_t s32Hi, s32Hi2;
+#else
+#if (SBC_IPAQ_OPT == TRUE)
+#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
+  register int64_t s64Temp, s64Temp2;
+#else
+  register int32_t s32Temp, s32Temp2;
+#endif
+#else
 #if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
   int64_t s64Temp;
 #endif
+#endif
+#endif
+
+  WINDOW_PARTIAL_8
+}
+
+static void SbcIdct4(int32_t* ps32DCTY, int32_t* ps32SbBuf,
+                     int32_t s32NumOfDCT) {
+  for (; s32NumOfDCT > 0; s32NumOfDCT--) {
+    SBC_FastIDCT4(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 2 * SUB_BANDS_4;
+    ps32SbBuf += SUB_BANDS_4;
+  }
+}
+
+static void SbcIdct8(int32_t* ps32DCTY, int32_t* ps32SbBuf,
+                     int32_t s32NumOfDCT) {
+  for (; s32NumOfDCT > 0; s32NumOfDCT--) {
+    SBC_FastIDCT8(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 2 * SUB_BANDS_8;
+    ps32SbBuf += SUB_BANDS_8;
+  }
+}
+
+static const SBC_ANALYSIS_KERNELS sAnalysisKernelsC = {
+    "c", SbcWindow4, SbcWindow8, SbcIdct4, SbcIdct8,
+};
+
+static const SBC_ANALYSIS_KERNELS* psAnalysisKernels = NULL;
+
+#if (SBC_ANALYSIS_SIMD == TRUE)
+/* WINDOW_PARTIAL_4 as a matrix: s32DCTY[0] and s32DCTY[4] fold the taps they
+ * share, s32DCTY[8 - n] uses the taps of s32DCTY[n] in reverse */
+const int16_t gas16AnalWindow4[5][8] = {
+    {0, WIND_4_SUBBANDS_1_0, WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_3_0,
+     WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_2_4,
+     WIND_4_SUBBANDS_1_4},
+    {WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_1, WIND_4_SUBBANDS_2_1,
+     WIND_4_SUBBANDS_3_1, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_3,
+     WIND_4_SUBBANDS_2_3, WIND_4_SUBBANDS_1_3},
+    {WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_2, WIND_4_SUBBANDS_2_2,
+     WIND_4_SUBBANDS_3_2, WIND_4_SUBBANDS_4_2, WIND_4_SUBBANDS_3_2,
+     WIND_4_SUBBANDS_2_2, WIND_4_SUBBANDS_1_2},
+    {-WIND_4_SUBBANDS_0_2, WIND_4_SUBBANDS_1_3, WIND_4_SUBBANDS_2_3,
+     WIND_4_SUBBANDS_3_3, WIND_4_SUBBANDS_4_1, WIND_4_SUBBANDS_3_1,
+     WIND_4_SUBBANDS_2_1, WIND_4_SUBBANDS_1_1},
+    {-WIND_4_SUBBANDS_0_1, WIND_4_SUBBANDS_1_4, WIND_4_SUBBANDS_2_4,
+     WIND_4_SUBBANDS_3_4, WIND_4_SUBBANDS_4_0, WIND_4_SUBBANDS_3_0,
+     WIND_4_SUBBANDS_2_0, WIND_4_SUBBANDS_1_0},
+};
 
+/* WINDOW_PARTIAL_8 as a matrix, laid out as gas16AnalWindow4 */
+const int16_t gas16AnalWindow8[5][16] = {
+    {0, WIND_8_SUBBANDS_1_0, WIND_8_SUBBANDS_2_0, WIND_8_SUBBANDS_3_0,
+     WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_5_0, WIND_8_SUBBANDS_6_0,
+     WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_8_0, WIND_8_SUBBANDS_7_4,
+     WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_5_4, WIND_8_SUBBANDS_4_4,
+     WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_2_4, WIND_8_SUBBANDS_1_4},
+    {WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_1, WIND_8_SUBBANDS_2_1,
+     WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_5_1,
+     WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_8_1,
+     WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_5_3,
+     WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_2_3,
+     WIND_8_SUBBANDS_1_3},
+    {WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_2, WIND_8_SUBBANDS_2_2,
+     WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_5_2,
+     WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_8_2,
+     WIND_8_SUBBANDS_7_2, WIND_8_SUBBANDS_6_2, WIND_8_SUBBANDS_5_2,
+     WIND_8_SUBBANDS_4_2, WIND_8_SUBBANDS_3_2, WIND_8_SUBBANDS_2_2,
+     WIND_8_SUBBANDS_1_2},
+    {-WIND_8_SUBBANDS_0_2, WIND_8_SUBBANDS_1_3, WIND_8_SUBBANDS_2_3,
+     WIND_8_SUBBANDS_3_3, WIND_8_SUBBANDS_4_3, WIND_8_SUBBANDS_5_3,
+     WIND_8_SUBBANDS_6_3, WIND_8_SUBBANDS_7_3, WIND_8_SUBBANDS_8_1,
+     WIND_8_SUBBANDS_7_1, WIND_8_SUBBANDS_6_1, WIND_8_SUBBANDS_5_1,
+     WIND_8_SUBBANDS_4_1, WIND_8_SUBBANDS_3_1, WIND_8_SUBBANDS_2_1,
+     WIND_8_SUBBANDS_1_1},
+    {-WIND_8_SUBBANDS_0_1, WIND_8_SUBBANDS_1_4, WIND_8_SUBBANDS_2_4,
+     WIND_8_SUBBANDS_3_4, WIND_8_SUBBANDS_4_4, WIND_8_SUBBANDS_5_4,
+     WIND_8_SUBBANDS_6_4, WIND_8_SUBBANDS_7_4, WIND_8_SUBBANDS_8_0,
+     WIND_8_SUBBANDS_7_0, WIND_8_SUBBANDS_6_0, WIND_8_SUBBANDS_5_0,
+     WIND_8_SUBBANDS_4_0, WIND_8_SUBBANDS_3_0, WIND_8_SUBBANDS_2_0,
+     WIND_8_SUBBANDS_1_0},
+};
 #endif
+
+/****************************************************************************
+* SbcAnalysisSelectKernels - selects the analysis code by name, "c" or one of
+* the SIMD instruction sets. NULL selects the fastest one the CPU supports.
+*
+* RETURNS : false if the CPU doesn't support |name|
+*/
+bool SbcAnalysisSelectKernels(const char* name) {
+  const SBC_ANALYSIS_KERNELS* p_kernels = NULL;
+
+#if (SBC_ANALYSIS_SIMD == TRUE)
+  if (name == NULL || strcmp(name, sAnalysisKernelsC.name) != 0)
+    p_kernels = SbcAnalysisSimdKernels(name);
 #endif
+  if (p_kernels == NULL) {
+    if (name != NULL && strcmp(name, sAnalysisKernelsC.name) != 0)
+      return false;
+    p_kernels = &sAnalysisKernelsC;
+  }
+
+  psAnalysisKernels = p_kernels;
+  return true;
+}
+
+/****************************************************************************
+* SbcAnalysisFilter - performs Analysis of the input audio stream
+*
+* RETURNS : N/A
+*/
+void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
+  int16_t* ps16PcmBuf;
+  int32_t s32Blk, s32Ch;
+  int32_t s32NumOfChannels, s32NumOfBlocks;
+  int32_t i, *ps32X, *ps32X2;
+  int32_t Offset, Offset2, ChOffset;
+  int32_t* ps32DCTY;
 
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
   ps16PcmBuf = input;
 
-  ps32SbBuf = pstrEncParams->s32SbBuffer;
+  ps32DCTY = s32DCTYBuf;
   Offset2 = (int32_t)(EncMaxShiftCounter + 40);
   for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
     Offset = (int32_t)(EncMaxShiftCounter - ShiftCounter);
@@ -1257,11 +1388,8 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_4
-
-      SBC_FastIDCT4(s32DCTY, ps32SbBuf);
-
-      ps32SbBuf += SUB_BANDS_4;
+      psAnalysisKernels->window4(s16X + ChOffset, ps32DCTY);
+      ps32DCTY += 2 * SUB_BANDS_4;
     }
     if (s32NumOfChannels == 1) {
       if (ShiftCounter >= EncMaxShiftCounter) {
@@ -1279,39 +1407,27 @@ void SbcAnalysisFilter4(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+
+  psAnalysisKernels->idct4(s32DCTYBuf, pstrEncParams->s32SbBuffer,
+                           s32NumOfBlocks * s32NumOfChannels);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
   int16_t* ps16PcmBuf;
-  int32_t* ps32SbBuf;
   int32_t s32Blk, s32Ch; /* counter for block*/
   int32_t Offset, Offset2;
   int32_t s32NumOfChannels, s32NumOfBlocks;
   int32_t i, *ps32X, *ps32X2;
   int32_t ChOffset;
-#if (SBC_ARM_ASM_OPT == TRUE)
-  register int32_t s32Hi, s32Hi2;
-#else
-#if (SBC_IPAQ_OPT == TRUE)
-#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
-  register int64_t s64Temp, s64Temp2;
-#else
-  register int32_t s32Temp, s32Temp2;
-#endif
-#else
-#if (SBC_IS_64_MULT_IN_WINDOW_ACCU == TRUE)
-  int64_t s64Temp;
-#endif
-#endif
-#endif
+  int32_t* ps32DCTY;
 
   s32NumOfChannels = pstrEncParams->s16NumOfChannels;
   s32NumOfBlocks = pstrEncParams->s16NumOfBlocks;
 
   ps16PcmBuf = input;
 
-  ps32SbBuf = pstrEncParams->s32SbBuffer;
+  ps32DCTY = s32DCTYBuf;
   Offset2 = (int32_t)(EncMaxShiftCounter + 80);
   for (s32Blk = 0; s32Blk < s32NumOfBlocks; s32Blk++) {
     Offset = (int32_t)(EncMaxShiftCounter - ShiftCounter);
@@ -1370,11 +1486,8 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
     for (s32Ch = 0; s32Ch < s32NumOfChannels; s32Ch++) {
       ChOffset = s32Ch * Offset2 + Offset;
 
-      WINDOW_PARTIAL_8
-
-      SBC_FastIDCT8(s32DCTY, ps32SbBuf);
-
-      ps32SbBuf += SUB_BANDS_8;
+      psAnalysisKernels->window8(s16X + ChOffset, ps32DCTY);
+      ps32DCTY += 2 * SUB_BANDS_8;
     }
     if (s32NumOfChannels == 1) {
       if (ShiftCounter >= EncMaxShiftCounter) {
@@ -1392,9 +1505,13 @@ void SbcAnalysisFilter8(SBC_ENC_PARAMS* pstrEncParams, int16_t* input) {
       }
     }
   }
+
+  psAnalysisKernels->idct8(s32DCTYBuf, pstrEncParams->s32SbBuffer,
+                           s32NumOfBlocks * s32NumOfChannels);
 }
 
 void SbcAnalysisInit(void) {
   memset(s16X, 0, ENC_VX_BUFFER_SIZE * sizeof(int16_t));
   ShiftCounter = 0;
+  if (psAnalysisKernels == NULL) SbcAnalysisSelectKernels(NULL);
 }
@@ -0,0 +1,611 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the SSE4.1, AVX2 and NEON versions of the analysis
+ *  windowing and of the fast DCT. They are bit-exact with the C code:
+ *  - the window sums the same 16 x 16 bit products, wrapping at 32 bits;
+ *  - the DCT runs the butterflies of SBC_FastIDCT8() and SBC_FastIDCT4() on
+ *    several blocks at once, one per lane. SBC_IDCT_MULT() keeps bits 15 to
+ *    46 of the 64 bit product, which is what the lane multiplies do.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+#include "sbc_dct.h"
+#include "sbc_enc_func_declare.h"
+#include "sbc_encoder.h"
+
+#if (SBC_ANALYSIS_SIMD == TRUE)
+
+#if defined(__i386__) || defined(__x86_64__)
+#define SBC_SIMD_X86 TRUE
+#include <cpuid.h>
+#include <immintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+    (SBC_SIMD_NEON == TRUE)
+#define SBC_SIMD_ARM TRUE
+#include <arm_neon.h>
+#endif
+
+/* The butterflies of SBC_FastIDCT8(), on vectors of blocks. The including
+ * code defines V_ADD, V_SUB, V_SRA, V_SLL and V_MULT for its vector type. */
+#define SBC_SIMD_FAST_IDCT8(in, out)                                     \
+  {                                                                      \
+    x0 = V_MULT(SBC_COS_PI_SUR_4, in[4]);                                \
+    x1 = V_SRA(V_ADD(in[3], in[5]), 1);                                  \
+    x2 = V_SRA(V_ADD(in[2], in[6]), 1);                                  \
+    x3 = V_SRA(V_ADD(in[1], in[7]), 1);                                  \
+    x4 = V_SRA(V_ADD(in[0], in[8]), 1);                                  \
+    x5 = V_SRA(V_SUB(in[9], in[15]), 1);                                 \
+    x6 = V_SRA(V_SUB(in[10], in[14]), 1);                                \
+    x7 = V_SRA(V_SUB(in[11], in[13]), 1);                                \
+                                                                         \
+    temp = x0;                                                           \
+    x0 = V_MULT(SBC_COS_PI_SUR_4, V_ADD(x0, x4));                        \
+    x4 = V_MULT(SBC_COS_PI_SUR_4, V_SUB(temp, x4));                      \
+                                                                         \
+    x2 = V_SUB(x2, x6);                                                  \
+    x6 = V_SLL(x6, 1);                                                   \
+    x6 = V_MULT(SBC_COS_PI_SUR_4, x6);                                   \
+    temp = x2;                                                           \
+    x2 = V_MULT(SBC_COS_PI_SUR_8, V_ADD(x2, x6));                        \
+    x6 = V_MULT(SBC_COS_3PI_SUR_8, V_SUB(temp, x6));                     \
+                                                                         \
+    even0 = V_ADD(x0, x2);                                               \
+    even1 = V_ADD(x4, x6);                                               \
+    even2 = V_SUB(x4, x6);                                               \
+    even3 = V_SUB(x0, x2);                                               \
+                                                                         \
+    x7 = V_SLL(x7, 1);                                                   \
+    x5 = V_SUB(V_SLL(x5, 1), x7);                                        \
+    x3 = V_SUB(V_SLL(x3, 1), x5);                                        \
+    x1 = V_SUB(x1, V_SRA(x3, 1));                                        \
+                                                                         \
+    x5 = V_MULT(SBC_COS_PI_SUR_4, x5);                                   \
+    temp = x1;                                                           \
+    x1 = V_ADD(x1, x5);                                                  \
+    x5 = V_SUB(temp, x5);                                                \
+                                                                         \
+    x3 = V_SUB(x3, x7);                                                  \
+    x7 = V_SLL(x7, 1);                                                   \
+    x7 = V_MULT(SBC_COS_PI_SUR_4, x7);                                   \
+                                                                         \
+    temp = x3;                                                           \
+    x3 = V_MULT(SBC_COS_PI_SUR_8, V_ADD(x3, x7));                        \
+    x7 = V_MULT(SBC_COS_3PI_SUR_8, V_SUB(temp, x7));                     \
+                                                                         \
+    odd0 = V_MULT(SBC_COS_PI_SUR_16, V_ADD(x1, x3));                     \
+    odd1 = V_MULT(SBC_COS_3PI_SUR_16, V_ADD(x5, x7));                    \
+    odd2 = V_MULT(SBC_COS_5PI_SUR_16, V_SUB(x5, x7));                    \
+    odd3 = V_MULT(SBC_COS_7PI_SUR_16, V_SUB(x1, x3));                    \
+                                                                         \
+    out[0] = V_ADD(even0, odd0);                                         \
+    out[1] = V_ADD(even1, odd1);                                         \
+    out[2] = V_ADD(even2, odd2);                                         \
+    out[3] = V_ADD(even3, odd3);                                         \
+    out[7] = V_SUB(even0, odd0);                                         \
+    out[6] = V_SUB(even1, odd1);                                         \
+    out[5] = V_SUB(even2, odd2);                                         \
+    out[4] = V_SUB(even3, odd3);                                         \
+  }
+
+/* The butterflies of SBC_FastIDCT4(), on vectors of blocks */
+#define SBC_SIMD_FAST_IDCT4(in, out)                      \
+  {                                                       \
+    x2 = V_SRA(in[2], 1);                                 \
+    temp = V_ADD(in[0], in[4]);                           \
+    tmp0 = V_MULT((SBC_COS_PI_SUR_4 >> 1), temp);         \
+    tmp1 = V_SUB(x2, tmp0);                               \
+    tmp0 = V_ADD(tmp0, x2);                               \
+    temp = V_ADD(in[1], in[3]);                           \
+    tmp3 = V_MULT((SBC_COS_3PI_SUR_8 >> 1), temp);        \
+    tmp2 = V_MULT((SBC_COS_PI_SUR_8 >> 1), temp);         \
+    temp = V_SUB(in[5], in[7]);                           \
+    tmp5 = V_MULT((SBC_COS_3PI_SUR_8 >> 1), temp);        \
+    tmp4 = V_MULT((SBC_COS_PI_SUR_8 >> 1), temp);         \
+    tmp6 = V_ADD(tmp2, tmp5);                             \
+    tmp7 = V_SUB(tmp3, tmp4);                             \
+    out[0] = V_ADD(tmp0, tmp6);                           \
+    out[1] = V_ADD(tmp1, tmp7);                           \
+    out[2] = V_SUB(tmp1, tmp7);                           \
+    out[3] = V_SUB(tmp0, tmp6);                           \
+  }
+
+#if (SBC_SIMD_X86 == TRUE)
+
+#define SBC_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define SBC_TARGET_AVX2 __attribute__((target("avx2")))
+
+/* (int32_t)(((int64_t)c * x) >> 15) in each lane: the even lanes multiply in
+ * place, the odd ones shifted down */
+static inline SBC_TARGET_SSE41 __m128i SbcMultSse41(int32_t c, __m128i x) {
+  __m128i s128c = _mm_set1_epi32(c);
+  __m128i even = _mm_srli_epi64(_mm_mul_epi32(x, s128c), 15);
+  __m128i odd = _mm_slli_epi64(_mm_mul_epi32(_mm_srli_epi64(x, 32), s128c), 17);
+  return _mm_blend_epi16(even, odd, 0xCC);
+}
+
+static inline SBC_TARGET_SSE41 void SbcTranspose4Sse41(__m128i* r0, __m128i* r1,
+                                                       __m128i* r2,
+                                                       __m128i* r3) {
+  __m128i t0 = _mm_unpacklo_epi32(*r0, *r1);
+  __m128i t1 = _mm_unpacklo_epi32(*r2, *r3);
+  __m128i t2 = _mm_unpackhi_epi32(*r0, *r1);
+  __m128i t3 = _mm_unpackhi_epi32(*r2, *r3);
+  *r0 = _mm_unpacklo_epi64(t0, t1);
+  *r1 = _mm_unpackhi_epi64(t0, t1);
+  *r2 = _mm_unpacklo_epi64(t2, t3);
+  *r3 = _mm_unpackhi_epi64(t2, t3);
+}
+
+/* Loads values k to k + 3 of 4 blocks |stride| apart, one vector per value */
+static inline SBC_TARGET_SSE41 void SbcLoadColumnsSse41(const int32_t* p,
+                                                        int32_t stride,
+                                                        __m128i* v) {
+  v[0] = _mm_loadu_si128((const __m128i*)p);
+  v[1] = _mm_loadu_si128((const __m128i*)(p + stride));
+  v[2] = _mm_loadu_si128((const __m128i*)(p + 2 * stride));
+  v[3] = _mm_loadu_si128((const __m128i*)(p + 3 * stride));
+  SbcTranspose4Sse41(&v[0], &v[1], &v[2], &v[3]);
+}
+
+/* Stores 4 vectors of values k to k + 3 back as 4 blocks |stride| apart */
+static inline SBC_TARGET_SSE41 void SbcStoreColumnsSse41(int32_t* p,
+                                                         int32_t stride,
+                                                         __m128i* v) {
+  __m128i r0 = v[0], r1 = v[1], r2 = v[2], r3 = v[3];
+  SbcTranspose4Sse41(&r0, &r1, &r2, &r3);
+  _mm_storeu_si128((__m128i*)p, r0);
+  _mm_storeu_si128((__m128i*)(p + stride), r1);
+  _mm_storeu_si128((__m128i*)(p + 2 * stride), r2);
+  _mm_storeu_si128((__m128i*)(p + 3 * stride), r3);
+}
+
+/* Windows 8 values: taps j and j + 1 of each value are summed by one
+ * multiply-add of interleaved samples and coefficients */
+static inline SBC_TARGET_SSE41 void SbcWindowSse41(const int16_t* ps16X,
+                                                   const int16_t* ps16Coeff,
+                                                   int32_t s32Step,
+                                                   int32_t* ps32DCTY) {
+  __m128i x[5], c[5], lo, hi;
+  __m128i zero = _mm_setzero_si128();
+  int32_t j;
+
+  for (j = 0; j < 5; j++) {
+    x[j] = _mm_loadu_si128((const __m128i*)(ps16X + j * s32Step));
+    c[j] = _mm_loadu_si128((const __m128i*)(ps16Coeff + j * s32Step));
+  }
+
+  lo = _mm_add_epi32(
+      _mm_madd_epi16(_mm_unpacklo_epi16(x[0], x[1]),
+                     _mm_unpacklo_epi16(c[0], c[1])),
+      _mm_madd_epi16(_mm_unpacklo_epi16(x[2], x[3]),
+                     _mm_unpacklo_epi16(c[2], c[3])));
+  lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(x[4], zero),
+                                        _mm_unpacklo_epi16(c[4], zero)));
+  hi = _mm_add_epi32(
+      _mm_madd_epi16(_mm_unpackhi_epi16(x[0], x[1]),
+                     _mm_unpackhi_epi16(c[0], c[1])),
+      _mm_madd_epi16(_mm_unpackhi_epi16(x[2], x[3]),
+                     _mm_unpackhi_epi16(c[2], c[3])));
+  hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(x[4], zero),
+                                        _mm_unpackhi_epi16(c[4], zero)));
+
+  _mm_storeu_si128((__m128i*)ps32DCTY, lo);
+  _mm_storeu_si128((__m128i*)(ps32DCTY + 4), hi);
+}
+
+static SBC_TARGET_SSE41 void SbcWindow4Sse41(const int16_t* ps16X,
+                                             int32_t* ps32DCTY) {
+  SbcWindowSse41(ps16X, gas16AnalWindow4[0], 2 * SUB_BANDS_4, ps32DCTY);
+}
+
+static SBC_TARGET_SSE41 void SbcWindow8Sse41(const int16_t* ps16X,
+                                             int32_t* ps32DCTY) {
+  SbcWindowSse41(ps16X, gas16AnalWindow8[0], 2 * SUB_BANDS_8, ps32DCTY);
+  SbcWindowSse41(ps16X + 8, gas16AnalWindow8[0] + 8, 2 * SUB_BANDS_8,
+                 ps32DCTY + 8);
+}
+
+#define V_ADD(a, b) _mm_add_epi32(a, b)
+#define V_SUB(a, b) _mm_sub_epi32(a, b)
+#define V_SRA(a, n) _mm_srai_epi32(a, n)
+#define V_SLL(a, n) _mm_slli_epi32(a, n)
+#define V_MULT(c, a) SbcMultSse41(c, a)
+
+/* The fast DCT of 4 blocks */
+static inline SBC_TARGET_SSE41 void SbcIdct4x4Sse41(int32_t* ps32DCTY,
+                                                    int32_t* ps32SbBuf) {
+  __m128i in[8], out[4];
+  __m128i x2, temp, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+
+  SbcLoadColumnsSse41(ps32DCTY, 2 * SUB_BANDS_4, &in[0]);
+  SbcLoadColumnsSse41(ps32DCTY + 4, 2 * SUB_BANDS_4, &in[4]);
+  SBC_SIMD_FAST_IDCT4(in, out);
+  SbcStoreColumnsSse41(ps32SbBuf, SUB_BANDS_4, out);
+}
+
+static inline SBC_TARGET_SSE41 void SbcIdct8x4Sse41(int32_t* ps32DCTY,
+                                                    int32_t* ps32SbBuf) {
+  __m128i in[16], out[8];
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, temp;
+  __m128i even0, even1, even2, even3, odd0, odd1, odd2, odd3;
+  int32_t k;
+
+  for (k = 0; k < 16; k += 4)
+    SbcLoadColumnsSse41(ps32DCTY + k, 2 * SUB_BANDS_8, &in[k]);
+  SBC_SIMD_FAST_IDCT8(in, out);
+  SbcStoreColumnsSse41(ps32SbBuf, SUB_BANDS_8, &out[0]);
+  SbcStoreColumnsSse41(ps32SbBuf + 4, SUB_BANDS_8, &out[4]);
+}
+
+#undef V_ADD
+#undef V_SUB
+#undef V_SRA
+#undef V_SLL
+#undef V_MULT
+
+static SBC_TARGET_SSE41 void SbcIdct4Sse41(int32_t* ps32DCTY,
+                                           int32_t* ps32SbBuf,
+                                           int32_t s32NumOfDCT) {
+  for (; s32NumOfDCT >= 4; s32NumOfDCT -= 4) {
+    SbcIdct4x4Sse41(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 4 * 2 * SUB_BANDS_4;
+    ps32SbBuf += 4 * SUB_BANDS_4;
+  }
+  for (; s32NumOfDCT > 0; s32NumOfDCT--) {
+    SBC_FastIDCT4(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 2 * SUB_BANDS_4;
+    ps32SbBuf += SUB_BANDS_4;
+  }
+}
+
+static SBC_TARGET_SSE41 void SbcIdct8Sse41(int32_t* ps32DCTY,
+                                           int32_t* ps32SbBuf,
+                                           int32_t s32NumOfDCT) {
+  for (; s32NumOfDCT >= 4; s32NumOfDCT -= 4) {
+    SbcIdct8x4Sse41(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 4 * 2 * SUB_BANDS_8;
+    ps32SbBuf += 4 * SUB_BANDS_8;
+  }
+  for (; s32NumOfDCT > 0; s32NumOfDCT--) {
+    SBC_FastIDCT8(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 2 * SUB_BANDS_8;
+    ps32SbBuf += SUB_BANDS_8;
+  }
+}
+
+static inline SBC_TARGET_AVX2 __m256i SbcMultAvx2(int32_t c, __m256i x) {
+  __m256i s256c = _mm256_set1_epi32(c);
+  __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(x, s256c), 15);
+  __m256i odd =
+      _mm256_slli_epi64(_mm256_mul_epi32(_mm256_srli_epi64(x, 32), s256c), 17);
+  return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+/* As SbcLoadColumnsSse41(), for 8 blocks */
+static inline SBC_TARGET_AVX2 void SbcLoadColumnsAvx2(const int32_t* p,
+                                                      int32_t stride,
+                                                      __m256i* v) {
+  __m128i lo[4], hi[4];
+  int32_t k;
+
+  SbcLoadColumnsSse41(p, stride, lo);
+  SbcLoadColumnsSse41(p + 4 * stride, stride, hi);
+  for (k = 0; k < 4; k++)
+    v[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo[k]), hi[k], 1);
+}
+
+/* As SbcStoreColumnsSse41(), for 8 blocks */
+static inline SBC_TARGET_AVX2 void SbcStoreColumnsAvx2(int32_t* p,
+                                                       int32_t stride,
+                                                       __m256i* v) {
+  __m128i lo[4], hi[4];
+  int32_t k;
+
+  for (k = 0; k < 4; k++) {
+    lo[k] = _mm256_castsi256_si128(v[k]);
+    hi[k] = _mm256_extracti128_si256(v[k], 1);
+  }
+  SbcStoreColumnsSse41(p, stride, lo);
+  SbcStoreColumnsSse41(p + 4 * stride, stride, hi);
+}
+
+/* Windows the 16 values of 8 subbands. The multiply-adds work on each 128 bit
+ * half, so the low interleave holds values 0-3 and 8-11. */
+static SBC_TARGET_AVX2 void SbcWindow8Avx2(const int16_t* ps16X,
+                                           int32_t* ps32DCTY) {
+  __m256i x[5], c[5], lo, hi;
+  __m256i zero = _mm256_setzero_si256();
+  int32_t j;
+
+  for (j = 0; j < 5; j++) {
+    x[j] = _mm256_loadu_si256((const __m256i*)(ps16X + j * 2 * SUB_BANDS_8));
+    c[j] = _mm256_loadu_si256((const __m256i*)gas16AnalWindow8[j]);
+  }
+
+  lo = _mm256_add_epi32(
+      _mm256_madd_epi16(_mm256_unpacklo_epi16(x[0], x[1]),
+                        _mm256_unpacklo_epi16(c[0], c[1])),
+      _mm256_madd_epi16(_mm256_unpacklo_epi16(x[2], x[3]),
+                        _mm256_unpacklo_epi16(c[2], c[3])));
+  lo = _mm256_add_epi32(lo,
+                        _mm256_madd_epi16(_mm256_unpacklo_epi16(x[4], zero),
+                                          _mm256_unpacklo_epi16(c[4], zero)));
+  hi = _mm256_add_epi32(
+      _mm256_madd_epi16(_mm256_unpackhi_epi16(x[0], x[1]),
+                        _mm256_unpackhi_epi16(c[0], c[1])),
+      _mm256_madd_epi16(_mm256_unpackhi_epi16(x[2], x[3]),
+                        _mm256_unpackhi_epi16(c[2], c[3])));
+  hi = _mm256_add_epi32(hi,
+                        _mm256_madd_epi16(_mm256_unpackhi_epi16(x[4], zero),
+                                          _mm256_unpackhi_epi16(c[4], zero)));
+
+  _mm256_storeu_si256((__m256i*)ps32DCTY, _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i*)(ps32DCTY + 8),
+                      _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+#define V_ADD(a, b) _mm256_add_epi32(a, b)
+#define V_SUB(a, b) _mm256_sub_epi32(a, b)
+#define V_SRA(a, n) _mm256_srai_epi32(a, n)
+#define V_SLL(a, n) _mm256_slli_epi32(a, n)
+#define V_MULT(c, a) SbcMultAvx2(c, a)
+
+static inline SBC_TARGET_AVX2 void SbcIdct4x8Avx2(int32_t* ps32DCTY,
+                                                  int32_t* ps32SbBuf) {
+  __m256i in[8], out[4];
+  __m256i x2, temp, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+
+  SbcLoadColumnsAvx2(ps32DCTY, 2 * SUB_BANDS_4, &in[0]);
+  SbcLoadColumnsAvx2(ps32DCTY + 4, 2 * SUB_BANDS_4, &in[4]);
+  SBC_SIMD_FAST_IDCT4(in, out);
+  SbcStoreColumnsAvx2(ps32SbBuf, SUB_BANDS_4, out);
+}
+
+static inline SBC_TARGET_AVX2 void SbcIdct8x8Avx2(int32_t* ps32DCTY,
+                                                  int32_t* ps32SbBuf) {
+  __m256i in[16], out[8];
+  __m256i x0, x1, x2, x3, x4, x5, x6, x7, temp;
+  __m256i even0, even1, even2, even3, odd0, odd1, odd2, odd3;
+  int32_t k;
+
+  for (k = 0; k < 16; k += 4)
+    SbcLoadColumnsAvx2(ps32DCTY + k, 2 * SUB_BANDS_8, &in[k]);
+  SBC_SIMD_FAST_IDCT8(in, out);
+  SbcStoreColumnsAvx2(ps32SbBuf, SUB_BANDS_8, &out[0]);
+  SbcStoreColumnsAvx2(ps32SbBuf + 4, SUB_BANDS_8, &out[4]);
+}
+
+#undef V_ADD
+#undef V_SUB
+#undef V_SRA
+#undef V_SLL
+#undef V_MULT
+
+static SBC_TARGET_AVX2 void SbcIdct4Avx2(int32_t* ps32DCTY, int32_t* ps32SbBuf,
+                                         int32_t s32NumOfDCT) {
+  for (; s32NumOfDCT >= 8; s32NumOfDCT -= 8) {
+    SbcIdct4x8Avx2(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 8 * 2 * SUB_BANDS_4;
+    ps32SbBuf += 8 * SUB_BANDS_4;
+  }
+  SbcIdct4Sse41(ps32DCTY, ps32SbBuf, s32NumOfDCT);
+}
+
+static SBC_TARGET_AVX2 void SbcIdct8Avx2(int32_t* ps32DCTY, int32_t* ps32SbBuf,
+                                         int32_t s32NumOfDCT) {
+  for (; s32NumOfDCT >= 8; s32NumOfDCT -= 8) {
+    SbcIdct8x8Avx2(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 8 * 2 * SUB_BANDS_8;
+    ps32SbBuf += 8 * SUB_BANDS_8;
+  }
+  SbcIdct8Sse41(ps32DCTY, ps32SbBuf, s32NumOfDCT);
+}
+
+static const SBC_ANALYSIS_KERNELS sAnalysisKernelsSse41 = {
+    "sse4.1", SbcWindow4Sse41, SbcWindow8Sse41, SbcIdct4Sse41, SbcIdct8Sse41,
+};
+
+/* The 4 subband window is only 128 bits wide */
+static const SBC_ANALYSIS_KERNELS sAnalysisKernelsAvx2 = {
+    "avx2", SbcWindow4Sse41, SbcWindow8Avx2, SbcIdct4Avx2, SbcIdct8Avx2,
+};
+
+static bool SbcCpuHasSse41(void) {
+  unsigned int eax, ebx, ecx, edx;
+
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return (ecx & bit_SSE4_1) != 0;
+}
+
+static bool SbcCpuHasAvx2(void) {
+  unsigned int eax, ebx, ecx, edx;
+  unsigned int xcr0_lo, xcr0_hi;
+
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) return false;
+
+  /* The OS must save the YMM registers */
+  __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  if ((xcr0_lo & 0x6) != 0x6) return false;
+
+  if (__get_cpuid_max(0, NULL) < 7) return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & bit_AVX2) != 0;
+}
+
+#elif (SBC_SIMD_ARM == TRUE)
+
+/* (int32_t)(((int64_t)c * x) >> 15) in each lane */
+static inline int32x4_t SbcMultNeon(int32_t c, int32x4_t x) {
+  int32x2_t s32c = vdup_n_s32(c);
+  return vcombine_s32(vshrn_n_s64(vmull_s32(vget_low_s32(x), s32c), 15),
+                      vshrn_n_s64(vmull_s32(vget_high_s32(x), s32c), 15));
+}
+
+static inline void SbcTranspose4Neon(int32x4_t* r0, int32x4_t* r1,
+                                     int32x4_t* r2, int32x4_t* r3) {
+  int32x4x2_t t01 = vtrnq_s32(*r0, *r1);
+  int32x4x2_t t23 = vtrnq_s32(*r2, *r3);
+  *r0 = vcombine_s32(vget_low_s32(t01.val[0]), vget_low_s32(t23.val[0]));
+  *r1 = vcombine_s32(vget_low_s32(t01.val[1]), vget_low_s32(t23.val[1]));
+  *r2 = vcombine_s32(vget_high_s32(t01.val[0]), vget_high_s32(t23.val[0]));
+  *r3 = vcombine_s32(vget_high_s32(t01.val[1]), vget_high_s32(t23.val[1]));
+}
+
+/* Loads values k to k + 3 of 4 blocks |stride| apart, one vector per value */
+static inline void SbcLoadColumnsNeon(const int32_t* p, int32_t stride,
+                                      int32x4_t* v) {
+  v[0] = vld1q_s32(p);
+  v[1] = vld1q_s32(p + stride);
+  v[2] = vld1q_s32(p + 2 * stride);
+  v[3] = vld1q_s32(p + 3 * stride);
+  SbcTranspose4Neon(&v[0], &v[1], &v[2], &v[3]);
+}
+
+/* Stores 4 vectors of values k to k + 3 back as 4 blocks |stride| apart */
+static inline void SbcStoreColumnsNeon(int32_t* p, int32_t stride,
+                                       int32x4_t* v) {
+  int32x4_t r0 = v[0], r1 = v[1], r2 = v[2], r3 = v[3];
+  SbcTranspose4Neon(&r0, &r1, &r2, &r3);
+  vst1q_s32(p, r0);
+  vst1q_s32(p + stride, r1);
+  vst1q_s32(p + 2 * stride, r2);
+  vst1q_s32(p + 3 * stride, r3);
+}
+
+/* Windows 4 values, accumulating the 5 taps with widening multiplies */
+static inline void SbcWindowNeon(const int16_t* ps16X,
+                                 const int16_t* ps16Coeff, int32_t s32Step,
+                                 int32_t* ps32DCTY) {
+  int32x4_t acc = vmull_s16(vld1_s16(ps16X), vld1_s16(ps16Coeff));
+  int32_t j;
+
+  for (j = 1; j < 5; j++)
+    acc = vmlal_s16(acc, vld1_s16(ps16X + j * s32Step),
+                    vld1_s16(ps16Coeff + j * s32Step));
+  vst1q_s32(ps32DCTY, acc);
+}
+
+static void SbcWindow4Neon(const int16_t* ps16X, int32_t* ps32DCTY) {
+  int32_t m;
+
+  for (m = 0; m < 2 * SUB_BANDS_4; m += 4)
+    SbcWindowNeon(ps16X + m, gas16AnalWindow4[0] + m, 2 * SUB_BANDS_4,
+                  ps32DCTY + m);
+}
+
+static void SbcWindow8Neon(const int16_t* ps16X, int32_t* ps32DCTY) {
+  int32_t m;
+
+  for (m = 0; m < 2 * SUB_BANDS_8; m += 4)
+    SbcWindowNeon(ps16X + m, gas16AnalWindow8[0] + m, 2 * SUB_BANDS_8,
+                  ps32DCTY + m);
+}
+
+#define V_ADD(a, b) vaddq_s32(a, b)
+#define V_SUB(a, b) vsubq_s32(a, b)
+#define V_SRA(a, n) vshrq_n_s32(a, n)
+#define V_SLL(a, n) vshlq_n_s32(a, n)
+#define V_MULT(c, a) SbcMultNeon(c, a)
+
+static void SbcIdct4Neon(int32_t* ps32DCTY, int32_t* ps32SbBuf,
+                         int32_t s32NumOfDCT) {
+  int32x4_t in[8], out[4];
+  int32x4_t x2, temp, tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+
+  for (; s32NumOfDCT >= 4; s32NumOfDCT -= 4) {
+    SbcLoadColumnsNeon(ps32DCTY, 2 * SUB_BANDS_4, &in[0]);
+    SbcLoadColumnsNeon(ps32DCTY + 4, 2 * SUB_BANDS_4, &in[4]);
+    SBC_SIMD_FAST_IDCT4(in, out);
+    SbcStoreColumnsNeon(ps32SbBuf, SUB_BANDS_4, out);
+    ps32DCTY += 4 * 2 * SUB_BANDS_4;
+    ps32SbBuf += 4 * SUB_BANDS_4;
+  }
+  for (; s32NumOfDCT > 0; s32NumOfDCT--) {
+    SBC_FastIDCT4(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 2 * SUB_BANDS_4;
+    ps32SbBuf += SUB_BANDS_4;
+  }
+}
+
+static void SbcIdct8Neon(int32_t* ps32DCTY, int32_t* ps32SbBuf,
+                         int32_t s32NumOfDCT) {
+  int32x4_t in[16], out[8];
+  int32x4_t x0, x1, x2, x3, x4, x5, x6, x7, temp;
+  int32x4_t even0, even1, even2, even3, odd0, odd1, odd2, odd3;
+  int32_t k;
+
+  for (; s32NumOfDCT >= 4; s32NumOfDCT -= 4) {
+    for (k = 0; k < 16; k += 4)
+      SbcLoadColumnsNeon(ps32DCTY + k, 2 * SUB_BANDS_8, &in[k]);
+    SBC_SIMD_FAST_IDCT8(in, out);
+    SbcStoreColumnsNeon(ps32SbBuf, SUB_BANDS_8, &out[0]);
+    SbcStoreColumnsNeon(ps32SbBuf + 4, SUB_BANDS_8, &out[4]);
+    ps32DCTY += 4 * 2 * SUB_BANDS_8;
+    ps32SbBuf += 4 * SUB_BANDS_8;
+  }
+  for (; s32NumOfDCT > 0; s32NumOfDCT--) {
+    SBC_FastIDCT8(ps32DCTY, ps32SbBuf);
+    ps32DCTY += 2 * SUB_BANDS_8;
+    ps32SbBuf += SUB_BANDS_8;
+  }
+}
+
+#undef V_ADD
+#undef V_SUB
+#undef V_SRA
+#undef V_SLL
+#undef V_MULT
+
+static const SBC_ANALYSIS_KERNELS sAnalysisKernelsNeon = {
+    "neon", SbcWindow4Neon, SbcWindow8Neon, SbcIdct4Neon, SbcIdct8Neon,
+};
+
+#endif
+
+/****************************************************************************
+* SbcAnalysisSimdKernels - finds the SIMD analysis code called |name|, or the
+* fastest one if |name| is NULL
+*
+* RETURNS : NULL if the CPU doesn't support it
+*/
+const SBC_ANALYSIS_KERNELS* SbcAnalysisSimdKernels(const char* name) {
+  const SBC_ANALYSIS_KERNELS* p_kernels[2];
+  int num_kernels = 0;
+  int i;
+
+#if (SBC_SIMD_X86 == TRUE)
+  /* fastest first */
+  if (SbcCpuHasAvx2()) p_kernels[num_kernels++] = &sAnalysisKernelsAvx2;
+  if (SbcCpuHasSse41()) p_kernels[num_kernels++] = &sAnalysisKernelsSse41;
+#elif (SBC_SIMD_ARM == TRUE)
+  p_kernels[num_kernels++] = &sAnalysisKernelsNeon;
+#endif
+
+  for (i = 0; i < num_kernels; i++) {
+    if (name == NULL || strcmp(name, p_kernels[i]->name) == 0)
+      return p_kernels[i];
+  }
+  return NULL;
+}
+
+#endif /* SBC_ANALYSIS_SIMD */
@@ -256,3 +256,12 @@ void SBC_Encoder_Init(SBC_ENC_PARAMS* pstrEncParams) {
 
   SbcAnalysisInit();
 }
+
+/****************************************************************************
+* SBC_Encoder_SelectKernels - Selects the analysis filter and DCT code
+*
+* RETURNS : false if the CPU doesn't support |name|
+*/
+bool SBC_Encoder_SelectKernels(const char* name) {
+  return SbcAnalysisSelectKernels(name);
+}
@@ -29,6 +29,11 @@ typedef struct btsnoop_t {
   // true, the packet is marked as incoming. Otherwise, the packet is marked
   // as outgoing.
   void (*capture)(const BT_HDR* packet, bool is_received);
+
+  // Capture an outgoing ACL fragment made of its ACL |header|, followed by
+  // |payload_len| bytes at |payload|, without gathering them into a packet.
+  void (*capture_acl_fragment)(const uint8_t* header, const uint8_t* payload,
+                               size_t payload_len);
 } btsnoop_t;
 
 const btsnoop_t* btsnoop_get_interface(void);
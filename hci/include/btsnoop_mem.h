@@ -22,10 +22,14 @@
 
 #include "bt_types.h"
 
-// Callback invoked for each HCI packet.
+// Callback invoked for each HCI packet. The packet is |len| bytes at
+// |p_data|, followed by |more_len| bytes at |p_more| for an ACL fragment
+// sent as a header and payload slice.
 // Highlander mode - there can be only one...
 typedef void (*btsnoop_data_cb)(const uint16_t type, const uint8_t* p_data,
-                                const size_t len, const uint64_t timestamp_us);
+                                const size_t len, const uint8_t* p_more,
+                                const size_t more_len,
+                                const uint64_t timestamp_us);
 
 // This call sets the (one and only) callback that will
 // be invoked once for each HCI packet/event.
@@ -35,3 +39,10 @@ void btsnoop_mem_set_callback(btsnoop_data_cb cb);
 // is sent/received. Packets will be filtered  and then
 // forwarded to the |btsnoop_data_cb|.
 void btsnoop_mem_capture(const BT_HDR* p_buf, const uint64_t timestamp_us);
+
+// Same as |btsnoop_mem_capture| for an outgoing ACL fragment made of its ACL
+// |header| followed by |payload_len| bytes at |payload|.
+void btsnoop_mem_capture_acl_fragment(const uint8_t* header,
+                                      const uint8_t* payload,
+                                      size_t payload_len,
+                                      const uint64_t timestamp_us);
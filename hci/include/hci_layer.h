@@ -95,3 +95,6 @@ void post_to_hci_message_loop(const tracked_objects::Location& from_here,
                               BT_HDR* p_msg);
 
 void hci_layer_cleanup_interface();
+
+// Writes the ACL reassembly counters of the packet fragmenter to |fd|.
+void hci_layer_debug_dump(int fd);
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "bt_types.h"
+#include "hci_internals.h"
 #include "hci_layer.h"
 #include "osi/include/allocator.h"
 
@@ -27,6 +28,18 @@ typedef void (*packet_reassembled_cb)(BT_HDR* packet);
 typedef void (*packet_fragmented_cb)(BT_HDR* packet,
                                      bool send_transmit_finished);
 
+// One ACL fragment of a larger packet: its own ACL |header|, followed by
+// |payload_len| bytes of the packet's data starting at |payload|.
+typedef struct {
+  uint8_t header[HCI_ACL_PREAMBLE_SIZE];
+  const uint8_t* payload;
+  uint16_t payload_len;
+} acl_fragment_t;
+
+typedef void (*packet_fragments_cb)(BT_HDR* packet,
+                                    const acl_fragment_t* fragments,
+                                    size_t count, bool send_transmit_finished);
+
 typedef struct {
   // Called for every packet fragment.
   packet_fragmented_cb fragmented;
@@ -37,8 +50,25 @@ typedef struct {
   // Called when the fragmenter finishes sending all requested fragments,
   // but the packet has not been entirely sent.
   transmit_finished_cb transmit_finished;
+
+  // If set, called once with all the fragments of an ACL packet that needs
+  // fragmenting, instead of |fragmented| for each one. The fragments point
+  // into the packet, which is left untouched until the callback returns.
+  packet_fragments_cb fragments;
 } packet_fragmenter_callbacks_t;
 
+// Counters kept by reassemble_and_dispatch() since init
+typedef struct {
+  // ACL packets holding a whole L2CAP PDU, delivered as they were received
+  uint64_t pdus_not_copied;
+  uint64_t bytes_not_copied;
+  // L2CAP PDUs rebuilt from several ACL packets
+  uint64_t pdus_reassembled;
+  uint64_t bytes_copied;
+  // Reassembly buffers of dropped PDUs that were reused for the next one
+  uint64_t buffers_reused;
+} reassembly_stats_t;
+
 typedef struct packet_fragmenter_t {
   // Initialize the fragmenter, specifying the |result_callbacks|.
   void (*init)(const packet_fragmenter_callbacks_t* result_callbacks);
@@ -55,6 +85,9 @@ typedef struct packet_fragmenter_t {
   // callback is called
   // with the reassembled data.
   void (*reassemble_and_dispatch)(BT_HDR* packet);
+
+  // Copies the reassembly counters into |stats|.
+  void (*get_reassembly_stats)(reassembly_stats_t* stats);
 } packet_fragmenter_t;
 
 const packet_fragmenter_t* packet_fragmenter_get_interface();
@@ -18,9 +18,16 @@
 
 #define LOG_TAG "bt_snoop"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <string>
+#include <thread>
 
 #include <arpa/inet.h>
+#include <endian.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
@@ -30,15 +37,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
+#include "bt_target.h"
 #include "bt_types.h"
 #include "hci/include/btsnoop.h"
 #include "hci/include/btsnoop_mem.h"
+#include "hci_internals.h"
 #include "hci_layer.h"
+#include "osi/include/allocator.h"
 #include "osi/include/log.h"
 #include "osi/include/properties.h"
 #include "osi/include/time.h"
@@ -55,6 +67,31 @@
 #define DEFAULT_BTSNOOP_PATH "/data/misc/bluetooth/logs/btsnoop_hci.log"
 #define BTSNOOP_MAX_PACKETS_PROPERTY "persist.bluetooth.btsnoopsize"
 
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+// Size of the buffer between capture() and the writer thread; must be a
+// power of two. Packets that do not fit are dropped and counted in the
+// dropped_packets field of the following btsnoop records.
+#define CAPTURE_RING_SIZE (1024 * 1024)
+
+// The writer thread flushes at least this often, or as soon as the capture
+// ring is half full.
+#define WRITER_FLUSH_INTERVAL_MS 100
+
+// How often the writer thread syncs the log file to storage.
+#define WRITER_SYNC_INTERVAL_MS 1000
+#endif
+
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+#if (BTSNOOP_ASYNC_WRITER != TRUE)
+#error "BTSNOOP_MMAP_WRITER requires BTSNOOP_ASYNC_WRITER"
+#endif
+
+// Size of each preallocated log file. A file is rotated when it is full or
+// holds |packets_per_file| packets, whichever comes first, and is trimmed to
+// the data actually written when it is closed.
+#define BTSNOOP_SEGMENT_SIZE (16 * 1024 * 1024)
+#endif
+
 typedef enum {
   kCommandPacket = 1,
   kAclPacket = 2,
@@ -71,6 +108,37 @@ static std::mutex btsnoop_mutex;
 static int32_t packets_per_file;
 static int32_t packet_counter;
 
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+// Captured packets are stored in the ring in their on-disk format. The ring
+// is filled by capture() under |btsnoop_mutex| and drained by the writer
+// thread without taking it. Once the writer thread is running, the log file
+// state above is owned by it.
+static uint8_t* capture_ring;
+static std::atomic<size_t> ring_write_pos;
+static std::atomic<size_t> ring_read_pos;
+static uint32_t dropped_packets;
+
+static std::thread writer_thread;
+static std::mutex writer_mutex;
+static std::condition_variable writer_cv;
+static bool writer_running;
+#endif
+
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+typedef struct {
+  int fd;
+  uint8_t* base;
+  size_t committed;  // Bytes of valid btsnoop data, including file header
+} snoop_segment_t;
+
+// |current_segment| backs |logfile_fd|. |spare_segment| is preallocated
+// ahead of time so that rotating only needs to swap the two. It is made by
+// |spare_thread|, which rotating joins before touching it.
+static snoop_segment_t current_segment = {INVALID_FD, NULL, 0};
+static snoop_segment_t spare_segment = {INVALID_FD, NULL, 0};
+static std::thread spare_thread;
+#endif
+
 // TODO(zachoverflow): merge btsnoop and btsnoop_net together
 void btsnoop_net_open();
 void btsnoop_net_close();
@@ -83,6 +151,24 @@ static char* get_btsnoop_last_log_path(char* last_log_path, char* log_path);
 static void open_next_snoop_file();
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us);
+static void btsnoop_write_record(packet_type_t type, uint32_t flags,
+                                 uint64_t timestamp_us, const uint8_t* data,
+                                 size_t length, const uint8_t* more,
+                                 size_t more_length);
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+static void writer_start();
+static void writer_stop();
+#endif
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+static char* get_btsnoop_next_log_path(char* next_log_path, char* log_path);
+static bool segment_create(snoop_segment_t* segment, const char* path);
+static void spare_segment_create(std::string path);
+static void spare_segment_wait();
+static void segment_close(snoop_segment_t* segment);
+static void segment_append(snoop_segment_t* segment, const void* data,
+                           size_t length);
+static void segment_repair(const char* path);
+#endif
 
 // Module lifecycle functions
 
@@ -96,6 +182,9 @@ static future_t* start_up(void) {
     packets_per_file = osi_property_get_int32(BTSNOOP_MAX_PACKETS_PROPERTY,
                                               DEFAULT_BTSNOOP_SIZE);
     btsnoop_net_open();
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+    if (logfile_fd != INVALID_FD) writer_start();
+#endif
   }
 
   return NULL;
@@ -108,6 +197,26 @@ static future_t* shut_down(void) {
     delete_btsnoop_files();
   }
 
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+  // Flushes whatever is still in the capture ring.
+  writer_stop();
+#endif
+
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+  segment_close(&current_segment);
+  logfile_fd = INVALID_FD;
+
+  spare_segment_wait();
+  if (spare_segment.fd != INVALID_FD) {
+    char log_path[PROPERTY_VALUE_MAX];
+    char next_log_path[PROPERTY_VALUE_MAX + sizeof(".next")];
+    get_btsnoop_log_path(log_path);
+    get_btsnoop_next_log_path(next_log_path, log_path);
+    segment_close(&spare_segment);
+    remove(next_log_path);
+  }
+#endif
+
   if (logfile_fd != INVALID_FD) close(logfile_fd);
   logfile_fd = INVALID_FD;
 
@@ -132,7 +241,11 @@ static void capture(const BT_HDR* buffer, bool is_received) {
   uint64_t timestamp_us = time_gettimeofday_us();
   btsnoop_mem_capture(buffer, timestamp_us);
 
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+  if (capture_ring == NULL) return;
+#else
   if (logfile_fd == INVALID_FD) return;
+#endif
 
   switch (buffer->event & MSG_EVT_MASK) {
     case MSG_HC_TO_STACK_HCI_EVT:
@@ -152,7 +265,23 @@ static void capture(const BT_HDR* buffer, bool is_received) {
   }
 }
 
-static const btsnoop_t interface = {capture};
+static void capture_acl_fragment(const uint8_t* header,
+                                 const uint8_t* payload, size_t payload_len) {
+  std::lock_guard<std::mutex> lock(btsnoop_mutex);
+  uint64_t timestamp_us = time_gettimeofday_us();
+  btsnoop_mem_capture_acl_fragment(header, payload, payload_len, timestamp_us);
+
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+  if (capture_ring == NULL) return;
+#else
+  if (logfile_fd == INVALID_FD) return;
+#endif
+
+  btsnoop_write_record(kAclPacket, 0 /* sent */, timestamp_us, header,
+                       HCI_ACL_PREAMBLE_SIZE, payload, payload_len);
+}
+
+static const btsnoop_t interface = {capture, capture_acl_fragment};
 
 const btsnoop_t* btsnoop_get_interface() {
   return &interface;
@@ -167,6 +296,11 @@ static void delete_btsnoop_files() {
   get_btsnoop_last_log_path(last_log_path, log_path);
   remove(log_path);
   remove(last_log_path);
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+  char next_log_path[PROPERTY_VALUE_MAX + sizeof(".next")];
+  get_btsnoop_next_log_path(next_log_path, log_path);
+  remove(next_log_path);
+#endif
 }
 
 static bool is_btsnoop_enabled() {
@@ -187,11 +321,24 @@ static char* get_btsnoop_last_log_path(char* last_log_path,
   return last_log_path;
 }
 
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+static char* get_btsnoop_next_log_path(char* next_log_path,
+                                       char* btsnoop_path) {
+  snprintf(next_log_path, PROPERTY_VALUE_MAX + sizeof(".next"), "%s.next",
+           btsnoop_path);
+  return next_log_path;
+}
+#endif
+
 static void open_next_snoop_file() {
   packet_counter = 0;
 
   if (logfile_fd != INVALID_FD) {
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+    segment_close(&current_segment);
+#else
     close(logfile_fd);
+#endif
     logfile_fd = INVALID_FD;
   }
 
@@ -200,10 +347,39 @@ static void open_next_snoop_file() {
   get_btsnoop_log_path(log_path);
   get_btsnoop_last_log_path(last_log_path, log_path);
 
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+  // A log left behind by a crash still has its preallocated tail.
+  segment_repair(log_path);
+#endif
+
   if (rename(log_path, last_log_path) != 0 && errno != ENOENT)
     LOG_ERROR(LOG_TAG, "%s unable to rename '%s' to '%s': %s", __func__,
               log_path, last_log_path, strerror(errno));
 
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+  char next_log_path[PROPERTY_VALUE_MAX + sizeof(".next")];
+  get_btsnoop_next_log_path(next_log_path, log_path);
+
+  spare_segment_wait();
+  if (spare_segment.fd == INVALID_FD)
+    segment_create(&spare_segment, next_log_path);
+
+  if (spare_segment.fd != INVALID_FD) {
+    if (rename(next_log_path, log_path) == 0) {
+      current_segment = spare_segment;
+      logfile_fd = current_segment.fd;
+    } else {
+      LOG_ERROR(LOG_TAG, "%s unable to rename '%s' to '%s': %s", __func__,
+                next_log_path, log_path, strerror(errno));
+      segment_close(&spare_segment);
+    }
+    spare_segment = {INVALID_FD, NULL, 0};
+  }
+
+  // Get the following file ready in the background, allocating and faulting
+  // in BTSNOOP_SEGMENT_SIZE bytes would hold up the writer.
+  spare_thread = std::thread(spare_segment_create, std::string(next_log_path));
+#else
   mode_t prevmask = umask(0);
   logfile_fd = open(log_path, O_WRONLY | O_CREAT | O_TRUNC,
                     S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
@@ -215,6 +391,7 @@ static void open_next_snoop_file() {
   }
 
   write(logfile_fd, "btsnoop\0\0\0\0\1\0\0\x3\xea", 16);
+#endif
 }
 
 typedef struct {
@@ -235,6 +412,326 @@ static uint64_t htonll(uint64_t ll) {
   return ll;
 }
 
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+static void ring_copy_in(size_t pos, const void* data, size_t length) {
+  size_t offset = pos & (CAPTURE_RING_SIZE - 1);
+  size_t first = std::min(length, CAPTURE_RING_SIZE - offset);
+  memcpy(capture_ring + offset, data, first);
+  memcpy(capture_ring, static_cast<const uint8_t*>(data) + first,
+         length - first);
+}
+
+static void ring_copy_out(void* data, size_t pos, size_t length) {
+  size_t offset = pos & (CAPTURE_RING_SIZE - 1);
+  size_t first = std::min(length, CAPTURE_RING_SIZE - offset);
+  memcpy(data, capture_ring + offset, first);
+  memcpy(static_cast<uint8_t*>(data) + first, capture_ring, length - first);
+}
+
+static size_t ring_used() {
+  return ring_write_pos.load(std::memory_order_acquire) -
+         ring_read_pos.load(std::memory_order_acquire);
+}
+
+// Called with |btsnoop_mutex| held; never blocks on the writer thread.
+static void capture_ring_push(const btsnoop_header_t* header,
+                              const uint8_t* packet, size_t length,
+                              const uint8_t* more, size_t more_length) {
+  size_t record_size = sizeof(btsnoop_header_t) + length + more_length;
+  size_t write_pos = ring_write_pos.load(std::memory_order_relaxed);
+  size_t used = write_pos - ring_read_pos.load(std::memory_order_acquire);
+  if (CAPTURE_RING_SIZE - used < record_size) {
+    dropped_packets++;
+    return;
+  }
+
+  ring_copy_in(write_pos, header, sizeof(btsnoop_header_t));
+  ring_copy_in(write_pos + sizeof(btsnoop_header_t), packet, length);
+  if (more_length)
+    ring_copy_in(write_pos + sizeof(btsnoop_header_t) + length, more,
+                 more_length);
+  ring_write_pos.store(write_pos + record_size, std::memory_order_release);
+
+  // Otherwise the writer thread picks the packet up on its next flush.
+  if (used + record_size >= CAPTURE_RING_SIZE / 2) writer_cv.notify_one();
+}
+
+// Writes the records in [begin_pos, end_pos) to the log file and the network
+// client with a single call each.
+static void writer_write(size_t begin_pos, size_t end_pos) {
+  size_t offset = begin_pos & (CAPTURE_RING_SIZE - 1);
+  size_t length = end_pos - begin_pos;
+  size_t first = std::min(length, CAPTURE_RING_SIZE - offset);
+  iovec iov[] = {{capture_ring + offset, first},
+                 {capture_ring, length - first}};
+  int iovcnt = (first == length) ? 1 : 2;
+
+  for (int i = 0; i < iovcnt; i++)
+    btsnoop_net_write(iov[i].iov_base, iov[i].iov_len);
+
+  if (logfile_fd == INVALID_FD) return;
+
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+  for (int i = 0; i < iovcnt; i++)
+    segment_append(&current_segment, iov[i].iov_base, iov[i].iov_len);
+#else
+  TEMP_FAILURE_RETRY(writev(logfile_fd, iov, iovcnt));
+#endif
+}
+
+// Returns how many more bytes fit into the current log file.
+static size_t writer_room() {
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+  if (current_segment.base != NULL)
+    return BTSNOOP_SEGMENT_SIZE - current_segment.committed;
+#endif
+  return SIZE_MAX;
+}
+
+static size_t ring_record_size(size_t pos) {
+  btsnoop_header_t header;
+  ring_copy_out(&header, pos, sizeof(btsnoop_header_t));
+  return sizeof(btsnoop_header_t) + ntohl(header.length_captured) - 1;
+}
+
+// Writes out everything captured so far, rotating the log file every
+// |packets_per_file| packets or when it is full. Returns true if anything
+// was written.
+static bool writer_flush() {
+  size_t read_pos = ring_read_pos.load(std::memory_order_relaxed);
+  size_t write_pos = ring_write_pos.load(std::memory_order_acquire);
+  if (read_pos == write_pos) return false;
+
+  while (read_pos != write_pos) {
+    if (packet_counter >= packets_per_file ||
+        writer_room() < ring_record_size(read_pos))
+      open_next_snoop_file();
+
+    size_t room = writer_room();
+    size_t end_pos = read_pos;
+    do {
+      size_t record_size = ring_record_size(end_pos);
+      if (end_pos != read_pos && end_pos - read_pos + record_size > room)
+        break;
+      end_pos += record_size;
+      packet_counter++;
+    } while (end_pos != write_pos && packet_counter < packets_per_file);
+
+    writer_write(read_pos, end_pos);
+    read_pos = end_pos;
+    ring_read_pos.store(read_pos, std::memory_order_release);
+  }
+
+  return true;
+}
+
+static void writer_run() {
+  prctl(PR_SET_NAME, (unsigned long)"bt_snoop_writer");
+
+  std::chrono::steady_clock::time_point last_sync =
+      std::chrono::steady_clock::now();
+  bool unsynced = false;
+
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  while (true) {
+    bool running = writer_running;
+    lock.unlock();
+
+    if (writer_flush()) unsynced = true;
+
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (unsynced &&
+        (!running || now - last_sync >= std::chrono::milliseconds(
+                                             WRITER_SYNC_INTERVAL_MS))) {
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+      if (current_segment.base != NULL)
+        msync(current_segment.base, current_segment.committed, MS_SYNC);
+#else
+      if (logfile_fd != INVALID_FD) fdatasync(logfile_fd);
+#endif
+      unsynced = false;
+      last_sync = now;
+    }
+
+    lock.lock();
+    if (!running) break;
+    writer_cv.wait_for(
+        lock, std::chrono::milliseconds(WRITER_FLUSH_INTERVAL_MS), [] {
+          return !writer_running || ring_used() >= CAPTURE_RING_SIZE / 2;
+        });
+  }
+}
+
+// Called with |btsnoop_mutex| held.
+static void writer_start() {
+  capture_ring = static_cast<uint8_t*>(osi_malloc(CAPTURE_RING_SIZE));
+  ring_write_pos = 0;
+  ring_read_pos = 0;
+  dropped_packets = 0;
+
+  writer_running = true;
+  writer_thread = std::thread(writer_run);
+}
+
+// Called with |btsnoop_mutex| held.
+static void writer_stop() {
+  if (capture_ring == NULL) return;
+
+  {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer_running = false;
+  }
+  writer_cv.notify_one();
+  writer_thread.join();
+
+  if (dropped_packets > 0)
+    LOG_WARN(LOG_TAG, "%s dropped %u packets while the writer fell behind",
+             __func__, dropped_packets);
+  osi_free_and_reset((void**)&capture_ring);
+}
+#endif
+
+#if (BTSNOOP_MMAP_WRITER == TRUE)
+// First record of every memory-mapped log file: an HCI vendor specific event
+// carrying the number of valid bytes in the file. It is updated after every
+// append, so a file left behind by a crash can be trimmed to its last
+// complete packet.
+typedef struct {
+  btsnoop_header_t header;
+  uint8_t event_code;
+  uint8_t parameter_length;
+  char magic[8];
+  uint64_t committed_length;  // Little endian
+} __attribute__((__packed__)) commit_record_t;
+
+static const char COMMIT_RECORD_MAGIC[8] = {'B', 'T', 'S', 'N',
+                                            'O', 'O', 'P', 'C'};
+#define BTSNOOP_FILE_HEADER_SIZE 16
+
+static commit_record_t* segment_commit_record(snoop_segment_t* segment) {
+  return reinterpret_cast<commit_record_t*>(segment->base +
+                                            BTSNOOP_FILE_HEADER_SIZE);
+}
+
+// Creates a preallocated, pre-faulted log file at |path| holding just the
+// btsnoop file header and the commit record.
+static bool segment_create(snoop_segment_t* segment, const char* path) {
+  mode_t prevmask = umask(0);
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC,
+                S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  umask(prevmask);
+  if (fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s unable to open '%s': %s", __func__, path,
+              strerror(errno));
+    return false;
+  }
+
+  // Reserve the blocks up front so running out of space can not turn into a
+  // SIGBUS on a later memcpy.
+  int error = posix_fallocate(fd, 0, BTSNOOP_SEGMENT_SIZE);
+  if (error != 0) {
+    LOG_ERROR(LOG_TAG, "%s unable to allocate '%s': %s", __func__, path,
+              strerror(error));
+    close(fd);
+    remove(path);
+    return false;
+  }
+
+  void* base = mmap(NULL, BTSNOOP_SEGMENT_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, 0);
+  if (base == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to map '%s': %s", __func__, path,
+              strerror(errno));
+    close(fd);
+    remove(path);
+    return false;
+  }
+
+  segment->fd = fd;
+  segment->base = static_cast<uint8_t*>(base);
+  memcpy(segment->base, "btsnoop\0\0\0\0\1\0\0\x3\xea",
+         BTSNOOP_FILE_HEADER_SIZE);
+
+  commit_record_t* record = segment_commit_record(segment);
+  uint32_t length_he = sizeof(commit_record_t) - sizeof(btsnoop_header_t) + 1;
+  record->header.length_original = htonl(length_he);
+  record->header.length_captured = record->header.length_original;
+  record->header.flags = htonl(3);
+  record->header.dropped_packets = 0;
+  record->header.timestamp =
+      htonll(time_gettimeofday_us() + BTSNOOP_EPOCH_DELTA);
+  record->header.type = kEventPacket;
+  record->event_code = 0xff;
+  record->parameter_length = length_he - 3;
+  memcpy(record->magic, COMMIT_RECORD_MAGIC, sizeof(record->magic));
+
+  segment->committed = BTSNOOP_FILE_HEADER_SIZE + sizeof(commit_record_t);
+  record->committed_length = htole64(segment->committed);
+  return true;
+}
+
+// Runs on |spare_thread|.
+static void spare_segment_create(std::string path) {
+  prctl(PR_SET_NAME, (unsigned long)"bt_snoop_spare");
+  segment_create(&spare_segment, path.c_str());
+}
+
+// Waits for |spare_thread| to be done with |spare_segment|.
+static void spare_segment_wait() {
+  if (spare_thread.joinable()) spare_thread.join();
+}
+
+// Unmaps |segment| and trims its file to the committed data.
+static void segment_close(snoop_segment_t* segment) {
+  if (segment->base == NULL) return;
+
+  munmap(segment->base, BTSNOOP_SEGMENT_SIZE);
+  if (ftruncate(segment->fd, segment->committed) != 0)
+    LOG_ERROR(LOG_TAG, "%s unable to truncate log: %s", __func__,
+              strerror(errno));
+  close(segment->fd);
+
+  segment->fd = INVALID_FD;
+  segment->base = NULL;
+  segment->committed = 0;
+}
+
+static void segment_append(snoop_segment_t* segment, const void* data,
+                           size_t length) {
+  if (BTSNOOP_SEGMENT_SIZE - segment->committed < length) return;
+
+  memcpy(segment->base + segment->committed, data, length);
+  segment->committed += length;
+  segment_commit_record(segment)->committed_length =
+      htole64(segment->committed);
+}
+
+// Trims the log file at |path| to its committed length if it was written
+// through a memory mapping and not closed properly.
+static void segment_repair(const char* path) {
+  int fd = open(path, O_RDWR);
+  if (fd == INVALID_FD) return;
+
+  commit_record_t record;
+  struct stat st;
+  ssize_t length;
+  OSI_NO_INTR(length = pread(fd, &record, sizeof(record),
+                             BTSNOOP_FILE_HEADER_SIZE));
+  if (length == (ssize_t)sizeof(record) && fstat(fd, &st) == 0 &&
+      memcmp(record.magic, COMMIT_RECORD_MAGIC, sizeof(record.magic)) == 0) {
+    off_t committed = le64toh(record.committed_length);
+    if (committed < st.st_size) {
+      LOG_WARN(LOG_TAG, "%s trimming '%s' to %lld bytes", __func__, path,
+               (long long)committed);
+      ftruncate(fd, committed);
+    }
+  }
+
+  close(fd);
+}
+#endif
+
 static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
                                  bool is_received, uint64_t timestamp_us) {
   uint32_t length_he = 0;
@@ -259,16 +756,36 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
       break;
   }
 
+  btsnoop_write_record(type, flags, timestamp_us, packet, length_he - 1, NULL,
+                       0);
+}
+
+// Writes one btsnoop record for a packet made of |length| bytes at |data|,
+// followed by |more_length| bytes at |more|.
+static void btsnoop_write_record(packet_type_t type, uint32_t flags,
+                                 uint64_t timestamp_us, const uint8_t* data,
+                                 size_t length, const uint8_t* more,
+                                 size_t more_length) {
+  uint32_t length_he = length + more_length + 1;
+
   btsnoop_header_t header;
   header.length_original = htonl(length_he);
   header.length_captured = header.length_original;
   header.flags = htonl(flags);
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+  header.dropped_packets = htonl(dropped_packets);
+#else
   header.dropped_packets = 0;
+#endif
   header.timestamp = htonll(timestamp_us + BTSNOOP_EPOCH_DELTA);
   header.type = type;
 
+#if (BTSNOOP_ASYNC_WRITER == TRUE)
+  capture_ring_push(&header, data, length, more, more_length);
+#else
   btsnoop_net_write(&header, sizeof(btsnoop_header_t));
-  btsnoop_net_write(packet, length_he - 1);
+  btsnoop_net_write(data, length);
+  if (more_length) btsnoop_net_write(more, more_length);
 
   if (logfile_fd != INVALID_FD) {
     packet_counter++;
@@ -277,7 +794,9 @@ static void btsnoop_write_packet(packet_type_t type, uint8_t* packet,
     }
 
     iovec iov[] = {{&header, sizeof(btsnoop_header_t)},
-                   {reinterpret_cast<void*>(packet), length_he - 1}};
-    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, 2));
+                   {const_cast<uint8_t*>(data), length},
+                   {const_cast<uint8_t*>(more), more_length}};
+    TEMP_FAILURE_RETRY(writev(logfile_fd, iov, more_length ? 3 : 2));
   }
+#endif
 }
@@ -19,6 +19,7 @@
 #include <base/logging.h>
 
 #include "hci/include/btsnoop_mem.h"
+#include "hci/include/hci_internals.h"
 
 static btsnoop_data_cb data_callback = NULL;
 
@@ -53,5 +54,17 @@ void btsnoop_mem_capture(const BT_HDR* packet, uint64_t timestamp_us) {
       break;
   }
 
-  if (length) (*data_callback)(type, data, length, timestamp_us);
+  if (length) (*data_callback)(type, data, length, NULL, 0, timestamp_us);
+}
+
+void btsnoop_mem_capture_acl_fragment(const uint8_t* header,
+                                      const uint8_t* payload,
+                                      size_t payload_len,
+                                      uint64_t timestamp_us) {
+  if (!data_callback) return;
+
+  CHECK(header);
+
+  (*data_callback)(BT_EVT_TO_LM_HCI_ACL, header, HCI_ACL_PREAMBLE_SIZE,
+                   payload, payload_len, timestamp_us);
 }
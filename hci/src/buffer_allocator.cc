@@ -23,7 +23,11 @@
 
 static void* buffer_alloc(size_t size) {
   CHECK(size <= BT_DEFAULT_BUFFER_SIZE);
+#if (HCI_BUFFER_SLAB_ALLOCATOR == TRUE)
+  return osi_pool_malloc(size);
+#else
   return osi_malloc(size);
+#endif
 }
 
 static const allocator_t interface = {buffer_alloc, osi_free};
@@ -26,6 +26,7 @@
 #include <base/sequenced_task_runner.h>
 #include <base/threading/thread.h>
 
+#include <inttypes.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/types.h>
@@ -52,6 +53,10 @@
 
 extern void hci_initialize();
 extern void hci_transmit(BT_HDR* packet);
+#if defined(OS_GENERIC)
+extern void hci_transmit_fragments(const acl_fragment_t* fragments,
+                                   size_t count);
+#endif
 extern void hci_close();
 extern int hci_open_firmware_log_file();
 extern void hci_close_firmware_log_file(int fd);
@@ -133,9 +138,22 @@ static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished);
 static void dispatch_reassembled(BT_HDR* packet);
 static void fragmenter_transmit_finished(BT_HDR* packet,
                                          bool all_fragments_sent);
-
+#if defined(OS_GENERIC)
+static void transmit_fragments(BT_HDR* packet, const acl_fragment_t* fragments,
+                               size_t count, bool send_transmit_finished);
+#endif
+
+// The HIDL transport takes one contiguous ACL packet per call, so on Android
+// the fragmenter keeps rewriting packets in place. The Linux HCI socket
+// gathers each fragment from its header and payload slice instead.
 static const packet_fragmenter_callbacks_t packet_fragmenter_callbacks = {
-    transmit_fragment, dispatch_reassembled, fragmenter_transmit_finished};
+    transmit_fragment, dispatch_reassembled, fragmenter_transmit_finished,
+#if defined(OS_GENERIC)
+    transmit_fragments
+#else
+    NULL
+#endif
+};
 
 void initialization_complete() {
   std::lock_guard<std::mutex> lock(message_loop_mutex);
@@ -467,6 +485,22 @@ static void transmit_fragment(BT_HDR* packet, bool send_transmit_finished) {
   }
 }
 
+#if defined(OS_GENERIC)
+// Callback for the fragmenter to send all the fragments of an ACL packet
+static void transmit_fragments(BT_HDR* packet, const acl_fragment_t* fragments,
+                               size_t count, bool send_transmit_finished) {
+  for (size_t i = 0; i < count; i++)
+    btsnoop->capture_acl_fragment(fragments[i].header, fragments[i].payload,
+                                  fragments[i].payload_len);
+
+  hci_transmit_fragments(fragments, count);
+
+  if (send_transmit_finished) {
+    buffer_allocator->free(packet);
+  }
+}
+#endif
+
 static void fragmenter_transmit_finished(BT_HDR* packet,
                                          bool all_fragments_sent) {
   if (all_fragments_sent) {
@@ -782,6 +816,25 @@ void hci_layer_cleanup_interface() {
   }
 }
 
+void hci_layer_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth HCI ACL Reassembly Statistics:\n");
+  if (packet_fragmenter == NULL) {
+    dprintf(fd, "  Not initialized\n");
+    return;
+  }
+
+  reassembly_stats_t stats;
+  packet_fragmenter->get_reassembly_stats(&stats);
+  dprintf(fd, "  PDUs delivered without copy : %" PRIu64 " (%" PRIu64
+              " bytes)\n",
+          stats.pdus_not_copied, stats.bytes_not_copied);
+  dprintf(fd, "  PDUs reassembled            : %" PRIu64 " (%" PRIu64
+              " bytes copied)\n",
+          stats.pdus_reassembled, stats.bytes_copied);
+  dprintf(fd, "  Reassembly buffers reused   : %" PRIu64 "\n",
+          stats.buffers_reused);
+}
+
 const hci_t* hci_layer_get_interface() {
   buffer_allocator = buffer_allocator_get_interface();
   btsnoop = btsnoop_get_interface();
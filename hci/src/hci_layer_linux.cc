@@ -40,6 +40,7 @@
 #include "osi/include/log.h"
 #include "osi/include/osi.h"
 #include "osi/include/properties.h"
+#include "packet_fragmenter.h"
 
 using base::Thread;
 
@@ -278,6 +279,46 @@ void hci_transmit(BT_HDR* packet) {
   if (ret == -1) LOG(FATAL) << strerror(errno);
 }
 
+// Sends all the ACL |fragments| of a packet with as few system calls as
+// possible. Every message written to the HCI socket is one HCI packet, so each
+// fragment is its own message, gathered from its header and payload slice.
+void hci_transmit_fragments(const acl_fragment_t* fragments, size_t count) {
+  static const size_t kMaxBatch = 64;
+  static uint8_t type = 2;
+
+  CHECK(bt_vendor_fd != -1);
+
+  struct iovec iov[kMaxBatch][3];
+  struct mmsghdr msgs[kMaxBatch];
+
+  while (count > 0) {
+    size_t batch = std::min(count, kMaxBatch);
+    memset(msgs, 0, batch * sizeof(msgs[0]));
+    for (size_t i = 0; i < batch; i++) {
+      iov[i][0] = {&type, 1};
+      iov[i][1] = {const_cast<uint8_t*>(fragments[i].header),
+                   HCI_ACL_PREAMBLE_SIZE};
+      iov[i][2] = {const_cast<uint8_t*>(fragments[i].payload),
+                   fragments[i].payload_len};
+      msgs[i].msg_hdr.msg_iov = iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 3;
+    }
+
+    int ret;
+    OSI_NO_INTR(ret = sendmmsg(bt_vendor_fd, msgs, batch, 0));
+    if (ret == -1) LOG(FATAL) << strerror(errno);
+
+    for (int i = 0; i < ret; i++) {
+      if (msgs[i].msg_len != fragments[i].payload_len +
+                                 HCI_ACL_PREAMBLE_SIZE + 1u)
+        LOG(ERROR) << "Should have send whole packet";
+    }
+
+    fragments += ret;
+    count -= ret;
+  }
+}
+
 static int wait_hcidev(void) {
   struct sockaddr_hci addr;
   struct pollfd fds[1];
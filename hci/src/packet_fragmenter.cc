@@ -23,6 +23,7 @@
 #include <base/logging.h>
 #include <string.h>
 #include <unordered_map>
+#include <vector>
 
 #include "bt_target.h"
 #include "buffer_allocator.h"
@@ -49,13 +50,52 @@ static const allocator_t* buffer_allocator;
 static const controller_t* controller;
 static const packet_fragmenter_callbacks_t* callbacks;
 
-static std::unordered_map<uint16_t /* handle */, BT_HDR*> partial_packets;
+// Number of reassembly buffers of dropped PDUs kept across all handles. They
+// can be as large as BT_DEFAULT_BUFFER_SIZE, so only a few are kept.
+#define MAX_SPARE_PACKETS 2
+
+// Reassembly state of one connection handle. The slot is kept while a PDU is
+// being reassembled or while it holds a spare buffer, so that the map doesn't
+// grow with every handle ever used.
+typedef struct {
+  // The PDU being reassembled, with |len| being its full length, and |offset|
+  // how much of it was received. NULL if there is none.
+  BT_HDR* partial_packet;
+  // Buffer of a dropped PDU, kept to reassemble the next one
+  BT_HDR* spare_packet;
+  // Size of the data area of |spare_packet|
+  uint16_t spare_size;
+  // Size of the data area of |partial_packet|
+  uint16_t partial_size;
+} reassembly_slot_t;
+
+static std::unordered_map<uint16_t /* handle */, reassembly_slot_t>
+    reassembly_slots;
+static size_t num_spare_packets;
+static reassembly_stats_t reassembly_stats;
+
+// Scratch list of fragments, reused for every packet
+static std::vector<acl_fragment_t> fragments;
+
+static void fragment_and_dispatch_batch(BT_HDR* packet,
+                                        uint16_t max_data_size);
 
 static void init(const packet_fragmenter_callbacks_t* result_callbacks) {
   callbacks = result_callbacks;
+  memset(&reassembly_stats, 0, sizeof(reassembly_stats));
 }
 
-static void cleanup() { partial_packets.clear(); }
+static void cleanup() {
+  for (auto& entry : reassembly_slots) {
+    reassembly_slot_t& slot = entry.second;
+    if (slot.partial_packet != NULL) buffer_allocator->free(slot.partial_packet);
+    if (slot.spare_packet != NULL) buffer_allocator->free(slot.spare_packet);
+  }
+  reassembly_slots.clear();
+  num_spare_packets = 0;
+  fragments.clear();
+  fragments.shrink_to_fit();
+}
 
 static void fragment_and_dispatch(BT_HDR* packet) {
   CHECK(packet != NULL);
@@ -77,6 +117,11 @@ static void fragment_and_dispatch(BT_HDR* packet) {
   uint16_t max_packet_size = max_data_size + HCI_ACL_PREAMBLE_SIZE;
   uint16_t remaining_length = packet->len;
 
+  if (callbacks->fragments && remaining_length > max_packet_size) {
+    fragment_and_dispatch_batch(packet, max_data_size);
+    return;
+  }
+
   uint16_t continuation_handle;
   STREAM_TO_UINT16(continuation_handle, stream);
   continuation_handle = APPLY_CONTINUATION_FLAG(continuation_handle);
@@ -115,6 +160,84 @@ static void fragment_and_dispatch(BT_HDR* packet) {
   callbacks->fragmented(packet, true);
 }
 
+// Describes the fragments of |packet| as header and payload slice pairs and
+// hands them over at once, without touching the packet. If L2CAP limited the
+// number of fragments through layer_specific, the rest of the packet is then
+// set up for the next call, as fragment_and_dispatch() does.
+static void fragment_and_dispatch_batch(BT_HDR* packet,
+                                        uint16_t max_data_size) {
+  const uint8_t* stream = packet->data + packet->offset;
+  uint16_t handle;
+  STREAM_TO_UINT16(handle, stream);
+  STREAM_SKIP_UINT16(stream);
+
+  uint16_t continuation_handle = APPLY_CONTINUATION_FLAG(handle);
+  uint16_t remaining_length = packet->len - HCI_ACL_PREAMBLE_SIZE;
+  uint16_t max_fragments = packet->layer_specific;
+
+  fragments.clear();
+  while (remaining_length > 0 &&
+         (max_fragments == 0 || fragments.size() < max_fragments)) {
+    uint16_t length =
+        remaining_length > max_data_size ? max_data_size : remaining_length;
+
+    acl_fragment_t fragment;
+    uint8_t* header = fragment.header;
+    UINT16_TO_STREAM(header, fragments.empty() ? handle : continuation_handle);
+    UINT16_TO_STREAM(header, length);
+    fragment.payload = stream;
+    fragment.payload_len = length;
+    fragments.push_back(fragment);
+
+    stream += length;
+    remaining_length -= length;
+  }
+
+  if (remaining_length == 0) {
+    callbacks->fragments(packet, fragments.data(), fragments.size(), true);
+    return;
+  }
+
+  callbacks->fragments(packet, fragments.data(), fragments.size(), false);
+
+  // Write the ACL header for the next fragment over the end of the data that
+  // was just sent
+  packet->offset = stream - packet->data - HCI_ACL_PREAMBLE_SIZE;
+  packet->len = remaining_length + HCI_ACL_PREAMBLE_SIZE;
+  uint8_t* next = packet->data + packet->offset;
+  UINT16_TO_STREAM(next, continuation_handle);
+  UINT16_TO_STREAM(next, remaining_length);
+
+  packet->layer_specific = 0;
+  packet->event = MSG_HC_TO_STACK_L2C_SEG_XMIT;
+  callbacks->transmit_finished(packet, false);
+}
+
+// Drops the PDU being reassembled in |slot|, keeping its buffer for the next
+// one unless MAX_SPARE_PACKETS are kept already.
+static void drop_partial_packet(reassembly_slot_t* slot) {
+  if (slot->spare_packet != NULL) {
+    if (slot->spare_size >= slot->partial_size) {
+      buffer_allocator->free(slot->partial_packet);
+      slot->partial_packet = NULL;
+      return;
+    }
+    buffer_allocator->free(slot->spare_packet);
+    slot->spare_packet = NULL;
+    num_spare_packets--;
+  }
+
+  if (num_spare_packets >= MAX_SPARE_PACKETS) {
+    buffer_allocator->free(slot->partial_packet);
+    slot->partial_packet = NULL;
+    return;
+  }
+  slot->spare_packet = slot->partial_packet;
+  slot->spare_size = slot->partial_size;
+  slot->partial_packet = NULL;
+  num_spare_packets++;
+}
+
 static bool check_uint16_overflow(uint16_t a, uint16_t b) {
   return (UINT16_MAX - a) < b;
 }
@@ -136,16 +259,16 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
     handle = handle & HANDLE_MASK;
 
     if (boundary_flag == START_PACKET_BOUNDARY) {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter != partial_packets.end()) {
+      auto map_iter = reassembly_slots.find(handle);
+      if (map_iter != reassembly_slots.end() &&
+          map_iter->second.partial_packet != NULL) {
         LOG_WARN(LOG_TAG,
                  "%s found unfinished packet for handle with start packet. "
                  "Dropping old.",
                  __func__);
-
-        BT_HDR* hdl = map_iter->second;
-        partial_packets.erase(map_iter);
-        buffer_allocator->free(hdl);
+        drop_partial_packet(&map_iter->second);
+        if (map_iter->second.spare_packet == NULL)
+          reassembly_slots.erase(map_iter);
       }
 
       if (acl_length < L2CAP_HEADER_PDU_LEN_SIZE) {
@@ -175,37 +298,54 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
                    "%s found l2cap full length %d less than the hci length %d.",
                    __func__, l2cap_length, packet->len);
 
+        reassembly_stats.pdus_not_copied++;
+        reassembly_stats.bytes_not_copied += packet->len;
         callbacks->reassembled(packet);
         return;
       }
 
-      BT_HDR* partial_packet =
-          (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
+      reassembly_slot_t& slot = reassembly_slots[handle];
+      BT_HDR* partial_packet;
+      if (slot.spare_packet != NULL && slot.spare_size >= full_length) {
+        partial_packet = slot.spare_packet;
+        slot.partial_size = slot.spare_size;
+        slot.spare_packet = NULL;
+        num_spare_packets--;
+        reassembly_stats.buffers_reused++;
+      } else {
+        partial_packet =
+            (BT_HDR*)buffer_allocator->alloc(full_length + sizeof(BT_HDR));
+        slot.partial_size = full_length;
+      }
       partial_packet->event = packet->event;
       partial_packet->len = full_length;
       partial_packet->offset = packet->len;
+      partial_packet->layer_specific = 0;
 
       memcpy(partial_packet->data, packet->data, packet->len);
+      reassembly_stats.bytes_copied += packet->len;
 
       // Update the ACL data size to indicate the full expected length
       stream = partial_packet->data;
       STREAM_SKIP_UINT16(stream);  // skip the handle
       UINT16_TO_STREAM(stream, full_length - HCI_ACL_PREAMBLE_SIZE);
 
-      partial_packets[handle] = partial_packet;
+      slot.partial_packet = partial_packet;
 
       // Free the old packet buffer, since we don't need it anymore
       buffer_allocator->free(packet);
     } else {
-      auto map_iter = partial_packets.find(handle);
-      if (map_iter == partial_packets.end()) {
+      auto map_iter = reassembly_slots.find(handle);
+      if (map_iter == reassembly_slots.end() ||
+          map_iter->second.partial_packet == NULL) {
         LOG_WARN(LOG_TAG,
                  "%s got continuation for unknown packet. Dropping it.",
                  __func__);
         buffer_allocator->free(packet);
         return;
       }
-      BT_HDR* partial_packet = map_iter->second;
+      reassembly_slot_t& slot = map_iter->second;
+      BT_HDR* partial_packet = slot.partial_packet;
 
       packet->offset = HCI_ACL_PREAMBLE_SIZE;
       uint16_t projected_offset =
@@ -222,14 +362,19 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
 
       memcpy(partial_packet->data + partial_packet->offset,
              packet->data + packet->offset, packet->len - packet->offset);
+      reassembly_stats.bytes_copied += packet->len - packet->offset;
 
       // Free the old packet buffer, since we don't need it anymore
       buffer_allocator->free(packet);
       partial_packet->offset = projected_offset;
 
       if (partial_packet->offset == partial_packet->len) {
-        partial_packets.erase(handle);
+        // L2CAP takes ownership of the completed PDU and frees it, so its
+        // buffer can't be recycled here. Only dropped PDUs leave a spare.
+        slot.partial_packet = NULL;
+        if (slot.spare_packet == NULL) reassembly_slots.erase(map_iter);
         partial_packet->offset = 0;
+        reassembly_stats.pdus_reassembled++;
         callbacks->reassembled(partial_packet);
       }
     }
@@ -238,10 +383,15 @@ static void reassemble_and_dispatch(UNUSED_ATTR BT_HDR* packet) {
   }
 }
 
+static void get_reassembly_stats(reassembly_stats_t* stats) {
+  *stats = reassembly_stats;
+}
+
 static const packet_fragmenter_t interface = {init, cleanup,
 
                                               fragment_and_dispatch,
-                                              reassemble_and_dispatch};
+                                              reassemble_and_dispatch,
+                                              get_reassembly_stats};
 
 const packet_fragmenter_t* packet_fragmenter_get_interface() {
   controller = controller_get_interface();
@@ -31,7 +31,8 @@
 
 DECLARE_TEST_MODES(init, set_data_sizes, no_fragmentation, fragmentation,
                    ble_no_fragmentation, ble_fragmentation,
-                   non_acl_passthrough_fragmentation, no_reassembly, reassembly,
+                   non_acl_passthrough_fragmentation, batch_fragmentation,
+                   batch_partial_fragmentation, no_reassembly, reassembly,
                    non_acl_passthrough_reassembly);
 
 #define LOCAL_BLE_CONTROLLER_ID 1
@@ -127,6 +128,53 @@ static void expect_packet_fragmented(uint16_t event, int max_acl_data_size,
   if (send_complete) osi_free(packet);
 }
 
+static void expect_packet_fragments(int max_acl_data_size, BT_HDR* packet,
+                                    const acl_fragment_t* fragments,
+                                    size_t count, const char* expected_data,
+                                    bool send_complete) {
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* header = fragments[i].header;
+    uint16_t handle;
+    uint16_t length;
+    STREAM_TO_UINT16(handle, header);
+    STREAM_TO_UINT16(length, header);
+
+    if (packet_index == 0)
+      EXPECT_EQ(test_handle_start, handle);
+    else
+      EXPECT_EQ(test_handle_continuation, handle);
+    EXPECT_EQ(fragments[i].payload_len, length);
+
+    int length_remaining = strlen(expected_data) - data_size_sum;
+    if (length_remaining > max_acl_data_size)
+      EXPECT_EQ(max_acl_data_size, length);
+
+    // Fragments are slices of the original packet
+    EXPECT_EQ(packet->data + HCI_ACL_PREAMBLE_SIZE + data_size_sum,
+              fragments[i].payload);
+    for (int j = 0; j < length; j++)
+      EXPECT_EQ(expected_data[data_size_sum + j], fragments[i].payload[j]);
+
+    data_size_sum += length;
+    packet_index++;
+  }
+
+  EXPECT_TRUE(send_complete == (data_size_sum == strlen(expected_data)));
+
+  // The packet itself is left as it was
+  const uint8_t* data = packet->data;
+  uint16_t handle;
+  uint16_t length;
+  STREAM_TO_UINT16(handle, data);
+  STREAM_TO_UINT16(length, data);
+  EXPECT_EQ(0, packet->offset);
+  EXPECT_EQ(test_handle_start, handle);
+  EXPECT_EQ(strlen(expected_data), length);
+  EXPECT_EQ(0, memcmp(expected_data, data, strlen(expected_data)));
+
+  if (send_complete) osi_free(packet);
+}
+
 static void manufacture_packet_and_then_reassemble(uint16_t event,
                                                    uint16_t acl_size,
                                                    const char* data) {
@@ -237,6 +285,25 @@ DURING(non_acl_passthrough_fragmentation) AT_CALL(0) {
 UNEXPECTED_CALL;
 }
 
+STUB_FUNCTION(void, fragments_callback,
+              (BT_HDR * packet, const acl_fragment_t* fragments, size_t count,
+               bool send_complete))
+DURING(batch_fragmentation) AT_CALL(0) {
+  expect_packet_fragments(10, packet, fragments, count, sample_data,
+                          send_complete);
+  return;
+}
+
+DURING(batch_partial_fragmentation) AT_CALL(0) {
+  EXPECT_EQ(3u, count);
+  expect_packet_fragments(10, packet, fragments, count, sample_data,
+                          send_complete);
+  return;
+}
+
+UNEXPECTED_CALL;
+}
+
 STUB_FUNCTION(void, reassembled_callback, (BT_HDR * packet))
 DURING(no_reassembly) AT_CALL(0) {
   expect_packet_reassembled(MSG_HC_TO_STACK_HCI_ACL, packet, small_sample_data);
@@ -257,15 +324,36 @@ UNEXPECTED_CALL;
 }
 
 STUB_FUNCTION(void, transmit_finished_callback,
-              (UNUSED_ATTR BT_HDR * packet,
-               UNUSED_ATTR bool sent_all_fragments))
+              (BT_HDR * packet, bool sent_all_fragments))
+DURING(batch_partial_fragmentation) AT_CALL(0) {
+  // The rest of the packet is ready to be sent the next time
+  uint16_t remaining_length = strlen(sample_data) - data_size_sum;
+  uint8_t* data = packet->data + packet->offset;
+  uint16_t handle;
+  uint16_t length;
+  STREAM_TO_UINT16(handle, data);
+  STREAM_TO_UINT16(length, data);
+
+  EXPECT_FALSE(sent_all_fragments);
+  EXPECT_EQ(MSG_HC_TO_STACK_L2C_SEG_XMIT, packet->event);
+  EXPECT_EQ(0, packet->layer_specific);
+  EXPECT_EQ(remaining_length + HCI_ACL_PREAMBLE_SIZE, packet->len);
+  EXPECT_EQ(test_handle_continuation, handle);
+  EXPECT_EQ(remaining_length, length);
+  EXPECT_EQ(0, memcmp(sample_data + data_size_sum, data, remaining_length));
+
+  osi_free(packet);
+  return;
+}
+
 UNEXPECTED_CALL;
 }
 
 STUB_FUNCTION(uint16_t, get_acl_data_size_classic, (void))
 DURING(no_fragmentation, non_acl_passthrough_fragmentation, no_reassembly)
 return 42;
-DURING(fragmentation) return 10;
+DURING(fragmentation, batch_fragmentation, batch_partial_fragmentation)
+return 10;
 DURING(no_reassembly) return 1337;
 
 UNEXPECTED_CALL;
@@ -282,6 +370,7 @@ return 0;
 
 static void reset_for(TEST_MODES_T next) {
   RESET_CALL_COUNT(fragmented_callback);
+  RESET_CALL_COUNT(fragments_callback);
   RESET_CALL_COUNT(reassembled_callback);
   RESET_CALL_COUNT(transmit_finished_callback);
   RESET_CALL_COUNT(get_acl_data_size_classic);
@@ -302,6 +391,7 @@ class PacketFragmenterTest : public AllocationTestHarness {
     callbacks.fragmented = fragmented_callback;
     callbacks.reassembled = reassembled_callback;
     callbacks.transmit_finished = transmit_finished_callback;
+    callbacks.fragments = NULL;
     controller.get_acl_data_size_classic = get_acl_data_size_classic;
     controller.get_acl_data_size_ble = get_acl_data_size_ble;
 
@@ -368,6 +458,31 @@ TEST_F(PacketFragmenterTest, test_non_acl_passthrough_fragmentation) {
   EXPECT_CALL_COUNT(fragmented_callback, 1);
 }
 
+TEST_F(PacketFragmenterTest, test_batch_fragment_necessary) {
+  reset_for(batch_fragmentation);
+  callbacks.fragments = fragments_callback;
+  BT_HDR* packet = manufacture_packet_for_fragmentation(MSG_STACK_TO_HC_HCI_ACL,
+                                                        sample_data);
+  fragmenter->fragment_and_dispatch(packet);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(fragments_callback, 1);
+  EXPECT_CALL_COUNT(fragmented_callback, 0);
+}
+
+TEST_F(PacketFragmenterTest, test_batch_fragment_limited) {
+  reset_for(batch_partial_fragmentation);
+  callbacks.fragments = fragments_callback;
+  BT_HDR* packet = manufacture_packet_for_fragmentation(MSG_STACK_TO_HC_HCI_ACL,
+                                                        sample_data);
+  packet->layer_specific = 3;
+  fragmenter->fragment_and_dispatch(packet);
+
+  EXPECT_EQ(30u, data_size_sum);
+  EXPECT_CALL_COUNT(fragments_callback, 1);
+  EXPECT_CALL_COUNT(transmit_finished_callback, 1);
+}
+
 TEST_F(PacketFragmenterTest, test_no_reassembly_necessary) {
   reset_for(no_reassembly);
   manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 1337,
@@ -375,6 +490,12 @@ TEST_F(PacketFragmenterTest, test_no_reassembly_necessary) {
 
   EXPECT_EQ(strlen(small_sample_data), data_size_sum);
   EXPECT_CALL_COUNT(reassembled_callback, 1);
+
+  reassembly_stats_t stats;
+  fragmenter->get_reassembly_stats(&stats);
+  EXPECT_EQ(1u, stats.pdus_not_copied);
+  EXPECT_EQ(0u, stats.pdus_reassembled);
+  EXPECT_EQ(0u, stats.bytes_copied);
 }
 
 TEST_F(PacketFragmenterTest, test_reassembly_necessary) {
@@ -384,6 +505,74 @@ TEST_F(PacketFragmenterTest, test_reassembly_necessary) {
 
   EXPECT_EQ(strlen(sample_data), data_size_sum);
   EXPECT_CALL_COUNT(reassembled_callback, 1);
+
+  reassembly_stats_t stats;
+  fragmenter->get_reassembly_stats(&stats);
+  EXPECT_EQ(0u, stats.pdus_not_copied);
+  EXPECT_EQ(1u, stats.pdus_reassembled);
+  EXPECT_EQ(0u, stats.buffers_reused);
+}
+
+// Starts a PDU as long as sample_data on |handle| and never finishes it
+static void start_unfinished_pdu(uint16_t handle) {
+  uint16_t l2cap_length = strlen(sample_data) - 2;
+  BT_HDR* packet = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 16);
+  packet->len = 16;
+  packet->offset = 0;
+  packet->event = MSG_HC_TO_STACK_HCI_ACL;
+  packet->layer_specific = 0;
+  uint8_t* packet_data = packet->data;
+  UINT16_TO_STREAM(packet_data, (handle & 0xCFFF) | 0x2000);
+  UINT16_TO_STREAM(packet_data, 12);
+  UINT16_TO_STREAM(packet_data, l2cap_length);
+  memcpy(packet_data, sample_data, 10);
+  fragmenter->reassemble_and_dispatch(packet);
+}
+
+// Drops the PDU started on |handle| with a start packet that is too short to
+// be reassembled itself
+static void drop_pdu(uint16_t handle) {
+  BT_HDR* packet = (BT_HDR*)osi_malloc(sizeof(BT_HDR) + 6);
+  packet->len = 4;
+  packet->offset = 0;
+  packet->event = MSG_HC_TO_STACK_HCI_ACL;
+  packet->layer_specific = 0;
+  uint8_t* packet_data = packet->data;
+  UINT16_TO_STREAM(packet_data, (handle & 0xCFFF) | 0x2000);
+  UINT16_TO_STREAM(packet_data, 0);
+  UINT16_TO_STREAM(packet_data, 0);
+  fragmenter->reassemble_and_dispatch(packet);
+}
+
+TEST_F(PacketFragmenterTest, test_reassembly_reuses_dropped_buffer) {
+  reset_for(reassembly);
+  start_unfinished_pdu(test_handle_start);
+
+  manufacture_packet_and_then_reassemble(MSG_HC_TO_STACK_HCI_ACL, 42,
+                                         sample_data);
+
+  EXPECT_EQ(strlen(sample_data), data_size_sum);
+  EXPECT_CALL_COUNT(reassembled_callback, 1);
+
+  reassembly_stats_t stats;
+  fragmenter->get_reassembly_stats(&stats);
+  EXPECT_EQ(1u, stats.pdus_reassembled);
+  EXPECT_EQ(1u, stats.buffers_reused);
+}
+
+TEST_F(PacketFragmenterTest, test_reassembly_caps_dropped_buffers) {
+  reset_for(reassembly);
+
+  // Only two of the three dropped buffers are kept
+  for (uint16_t handle = 1; handle <= 3; handle++) start_unfinished_pdu(handle);
+  for (uint16_t handle = 1; handle <= 3; handle++) drop_pdu(handle);
+  for (uint16_t handle = 1; handle <= 3; handle++) start_unfinished_pdu(handle);
+
+  EXPECT_CALL_COUNT(reassembled_callback, 0);
+
+  reassembly_stats_t stats;
+  fragmenter->get_reassembly_stats(&stats);
+  EXPECT_EQ(2u, stats.buffers_reused);
 }
 
 TEST_F(PacketFragmenterTest, test_non_acl_passthrough_reasseembly) {
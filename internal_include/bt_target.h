@@ -111,6 +111,12 @@
 #define BTA_DM_SDP_DB_SIZE 8000
 #endif
 
+/* The size the device discovery database may grow to when a device has more
+ * records than fit in BTA_DM_SDP_DB_SIZE. */
+#ifndef BTA_DM_SDP_DB_MAX_SIZE
+#define BTA_DM_SDP_DB_MAX_SIZE 65536
+#endif
+
 #ifndef HL_INCLUDED
 #define HL_INCLUDED TRUE
 #endif
@@ -123,6 +129,12 @@
 #define BTIF_DM_OOB_TEST TRUE
 #endif
 
+/* Append bt_config changes to a journal file and only rewrite bt_config.conf
+ * once the journal grows large, or at shutdown. */
+#ifndef BTIF_CONFIG_JOURNAL
+#define BTIF_CONFIG_JOURNAL FALSE
+#endif
+
 // How long to wait before activating sniff mode after entering the
 // idle state for server FT/RFCOMM, OPS connections
 #ifndef BTA_FTS_OPS_IDLE_TO_SNIFF_DELAY_MS
@@ -306,6 +318,12 @@
 #define BTM_INQ_DB_SIZE 40
 #endif
 
+/* The number of buckets of the index over the BTM inquiry database by
+ * address. A power of two, at least twice BTM_INQ_DB_SIZE. */
+#ifndef BTM_INQ_DB_INDEX_SIZE
+#define BTM_INQ_DB_INDEX_SIZE 128
+#endif
+
 /* The default scan mode */
 #ifndef BTM_DEFAULT_SCAN_TYPE
 #define BTM_DEFAULT_SCAN_TYPE BTM_SCAN_TYPE_INTERLACED
@@ -587,6 +605,11 @@
 #define L2CAP_ROUND_ROBIN_CHANNEL_SERVICE TRUE
 #endif
 
+/* Weighted deficit round robin between links sharing the controller buffers */
+#ifndef L2CAP_WEIGHTED_LINK_SCHEDULING
+#define L2CAP_WEIGHTED_LINK_SCHEDULING TRUE
+#endif
+
 /* used for monitoring eL2CAP data flow */
 #ifndef L2CAP_ERTM_STATS
 #define L2CAP_ERTM_STATS FALSE
@@ -694,6 +717,13 @@
 #define SMP_MAX_ENC_KEY_SIZE 16
 #endif
 
+/* Number of single-use LE Secure Connections key pairs to generate ahead of
+ * pairing on a background thread, overridden by the
+ * persist.bluetooth.smp_key_pool_depth property. 0 turns the pool off. */
+#ifndef SMP_KEY_POOL_DEPTH
+#define SMP_KEY_POOL_DEPTH 0
+#endif
+
 /* minimum link timeout after SMP pairing is done, leave room for key exchange
    and racing condition for the following service connection.
    Prefer greater than 0 second, and no less than default inactivity link idle
@@ -735,6 +765,12 @@
 #define SDP_MAX_ATTR_LEN 400
 #endif
 
+/* The number of service search attribute responses the server keeps
+ * serialized for repeated requests, until its database changes. */
+#ifndef SDP_MAX_CACHED_RSPS
+#define SDP_MAX_CACHED_RSPS 8
+#endif
+
 /* The maximum number of attribute filters supported by SDP databases. */
 #ifndef SDP_MAX_ATTR_FILTERS
 #define SDP_MAX_ATTR_FILTERS 15
@@ -750,8 +786,8 @@
 #define SDP_MAX_DISC_SERVER_RECS 21
 #endif
 
-/* The size of a scratchpad buffer, in bytes, for storing the response to an
- * attribute request. */
+/* The size of a scratchpad buffer, in bytes, for the part of an attribute
+ * split across two responses. It bounds the size of a single attribute. */
 #ifndef SDP_MAX_LIST_BYTE_COUNT
 #define SDP_MAX_LIST_BYTE_COUNT 4096
 #endif
@@ -854,6 +890,12 @@
 #define PORT_TX_BUF_CRITICAL_WM 15
 #endif
 
+/* The number of transmit buffers PORT_WriteDataCO reads from the app at once.
+ */
+#ifndef PORT_WRITE_CO_BATCH
+#define PORT_WRITE_CO_BATCH 8
+#endif
+
 /* The RFCOMM multiplexer preferred flow control mechanism. */
 #ifndef PORT_FC_DEFAULT
 #define PORT_FC_DEFAULT PORT_FC_CREDIT
@@ -1379,6 +1421,29 @@ single PDU.
 #define BTA_DM_AVOID_A2DP_ROLESWITCH_ON_INQUIRY TRUE
 #endif
 
+/******************************************************************************
+ *
+ * OSI
+ *
+ *****************************************************************************/
+/* Keep pending alarms in a hierarchical timer wheel (O(1) set/cancel) instead
+ * of a sorted list. */
+#ifndef OSI_ALARM_TIMER_WHEEL
+#define OSI_ALARM_TIMER_WHEEL TRUE
+#endif
+
+/* Serve every osi_malloc/osi_calloc from the size-class slab allocator.
+ * BT_HDR buffers are controlled separately by HCI_BUFFER_SLAB_ALLOCATOR. */
+#ifndef OSI_SLAB_ALLOCATOR
+#define OSI_SLAB_ALLOCATOR FALSE
+#endif
+
+/* Serve BT_HDR buffers from buffer_allocator_get_interface() out of the
+ * size-class slab allocator. */
+#ifndef HCI_BUFFER_SLAB_ALLOCATOR
+#define HCI_BUFFER_SLAB_ALLOCATOR TRUE
+#endif
+
 /******************************************************************************
  *
  * Tracing:  Include trace header file here.
@@ -1390,6 +1455,18 @@ single PDU.
 #define BTSNOOP_MEM TRUE
 #endif
 
+/* Hand captured packets to a dedicated btsnoop writer thread instead of
+ * writing them to the log file from the HCI thread. */
+#ifndef BTSNOOP_ASYNC_WRITER
+#define BTSNOOP_ASYNC_WRITER TRUE
+#endif
+
+/* Have the btsnoop writer thread append to preallocated, memory-mapped log
+ * files instead of writing to them. Requires BTSNOOP_ASYNC_WRITER. */
+#ifndef BTSNOOP_MMAP_WRITER
+#define BTSNOOP_MMAP_WRITER FALSE
+#endif
+
 #include "bt_trace.h"
 
 #endif /* BT_TARGET_H */
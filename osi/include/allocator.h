@@ -41,6 +41,11 @@ void* osi_malloc(size_t size);
 void* osi_calloc(size_t size);
 void osi_free(void* ptr);
 
+// Allocate |size| bytes from the size-class slab allocator, falling back to
+// |osi_malloc| semantics if no size class fits. Intended for short-lived
+// buffers on the data path; the buffer is released with |osi_free|.
+void* osi_pool_malloc(size_t size);
+
 // Free a buffer that was previously allocated with function |osi_malloc|
 // or |osi_calloc| and reset the pointer to that buffer to NULL.
 // |p_ptr| is a pointer to the buffer pointer to be reset.
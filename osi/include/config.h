@@ -15,16 +15,37 @@
 //   empty sections.
 // - Duplicate keys in a section will overwrite previous values.
 // - All strings are case sensitive.
+// - Sections and keys are kept in file order for |config_save|, and are
+//   indexed by name for lookups. The lists must therefore only be modified
+//   through the functions below.
 
 #include <stdbool.h>
 #include <list>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 // The default section name to use if a key/value pair is not defined within
 // a section.
 #define CONFIG_DEFAULT_SECTION "Global"
 
+// Name index into a std::list of |T|. It is rebuilt from the list whenever
+// its size does not match the list's, which is also the case for a copy, so
+// it never refers to elements of the list it was copied from.
+template <typename T>
+struct config_index_t {
+  config_index_t() = default;
+  config_index_t(const config_index_t&) {}
+  config_index_t(config_index_t&&) = default;
+  config_index_t& operator=(const config_index_t&) {
+    map.clear();
+    return *this;
+  }
+  config_index_t& operator=(config_index_t&&) = default;
+
+  mutable std::unordered_map<std::string, typename std::list<T>::iterator> map;
+};
+
 struct entry_t {
   std::string key;
   std::string value;
@@ -33,10 +54,20 @@ struct entry_t {
 struct section_t {
   std::string name;
   std::list<entry_t> entries;
+  config_index_t<entry_t> entry_index;
+
+  // Text |config_save| writes for this section; only valid while
+  // |serialized_dirty| is false.
+  mutable std::string serialized;
+  mutable bool serialized_dirty = true;
 };
 
 struct config_t {
   std::list<section_t> sections;
+  config_index_t<section_t> section_index;
+
+  // Set whenever the contents change; see |config_is_dirty|.
+  bool dirty = false;
 };
 
 // Creates a new config object with no entries (i.e. not backed by a file).
@@ -126,6 +157,18 @@ bool config_remove_section(config_t* config, const std::string& section);
 bool config_remove_key(config_t* config, const std::string& section,
                        const std::string& key);
 
+// Returns true if |config| was modified since it was loaded from a file or
+// last passed to |config_clear_dirty|. Setting a key to the value it already
+// has does not count as a modification.
+bool config_is_dirty(const config_t& config);
+
+// Marks the current contents of |config| as saved. |config| may not be NULL.
+void config_clear_dirty(config_t* config);
+
+// Marks |config| as modified, for contents that do not match the file they
+// should be saved to. |config| may not be NULL.
+void config_set_dirty(config_t* config);
+
 // Saves |config| to a file given by |filename|. Note that this could be a
 // destructive operation: if |filename| already exists, it will be overwritten.
 // The config module does not preserve comments or formatting so if a config
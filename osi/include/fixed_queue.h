@@ -36,6 +36,21 @@ typedef void (*fixed_queue_cb)(fixed_queue_t* queue, void* context);
 // the returned queue with |fixed_queue_free|.
 fixed_queue_t* fixed_queue_new(size_t capacity);
 
+// Creates a new fixed queue backed by a preallocated, lock-free ring buffer.
+// The queue supports any number of producers but only a single consumer, and
+// its |capacity| is rounded up to the next power of two. |capacity| may not be
+// 0. Enqueue and dequeue do not allocate or take a lock, and reactor wakeups
+// registered with |fixed_queue_register_dequeue| are coalesced: a single
+// wakeup may dispatch the ready callback for several elements.
+//
+// The consumer-side functions (|fixed_queue_dequeue|,
+// |fixed_queue_try_dequeue|, |fixed_queue_try_peek_first| and
+// |fixed_queue_flush|) must only be called from one thread at a time.
+// |fixed_queue_try_peek_last|, |fixed_queue_try_remove_from_queue|,
+// |fixed_queue_get_list| and the fd accessors are not supported. Returns NULL
+// on failure. The caller must free the returned queue with |fixed_queue_free|.
+fixed_queue_t* fixed_queue_new_mpsc(size_t capacity);
+
 // Frees a queue and (optionally) the enqueued elements.
 // |queue| is the queue to free. If the |free_cb| callback is not null,
 // it is called on each queue element to free it.
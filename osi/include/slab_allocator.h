@@ -0,0 +1,48 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Size-class slab allocator used by the osi allocator for the hot data path.
+//
+// Blocks are carved from a reserved virtual address range that is split into
+// one region per size class, so ownership and size class of a block are
+// derived from its address alone. Freed blocks are kept on a per-thread cache
+// and spill over into a shared depot; memory is never returned to the system.
+//
+// These functions are normally not called directly; use |osi_pool_malloc|
+// and |osi_free| instead.
+
+// Returns a block of at least |size| bytes, or NULL if |size| is larger than
+// the largest size class or the region for that class is exhausted. The
+// contents of the returned block are undefined.
+void* slab_allocator_alloc(size_t size);
+
+// Returns true if |ptr| was returned by |slab_allocator_alloc|.
+bool slab_allocator_owns(const void* ptr);
+
+// Returns the block |ptr| to the allocator. |ptr| must have been returned
+// by |slab_allocator_alloc|.
+void slab_allocator_free(void* ptr);
+
+// Dump per size class statistics to the |fd| file descriptor.
+// The information is in user-readable text format. The |fd| must be valid.
+void slab_allocator_debug_dump(int fd);
@@ -0,0 +1,109 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "osi/include/time.h"
+
+// A hierarchical timer wheel holding entries ordered by an absolute deadline
+// in milliseconds. Insertion and removal are O(1); finding the entry with the
+// earliest deadline is O(1) in the common case.
+//
+// Entries are intrusive: the caller embeds a |timer_wheel_node_t| in its own
+// structure, which avoids any allocation on insertion. Entries with the same
+// deadline are returned in insertion order.
+//
+// The wheel is not thread-safe; callers must provide their own locking.
+
+typedef struct timer_wheel_node_t {
+  // The fields below are private to the timer wheel.
+  struct timer_wheel_node_t* prev;
+  struct timer_wheel_node_t* next;
+  period_ms_t deadline;
+  void* data;
+  int8_t level;
+  uint8_t slot;
+} timer_wheel_node_t;
+
+typedef struct timer_wheel_t timer_wheel_t;
+
+// Iterator callback prototype used for |timer_wheel_foreach|.
+// |data| is the data associated with the node currently being iterated,
+// |context| is a user defined value passed into |timer_wheel_foreach|.
+// Callback must return true to continue iterating or false to stop iterating.
+typedef bool (*timer_wheel_iter_cb)(void* data, void* context);
+
+// Returns a new, empty timer wheel whose internal clock starts at |now_ms|.
+// Returns NULL on failure. The returned wheel must be freed with
+// |timer_wheel_free|.
+timer_wheel_t* timer_wheel_new(period_ms_t now_ms);
+
+// Frees the |wheel|. Nodes still linked into the wheel are simply
+// detached. |wheel| may be NULL.
+void timer_wheel_free(timer_wheel_t* wheel);
+
+// Initializes |node| so it can be inserted into a wheel. |data| is the value
+// returned by |timer_wheel_node_data| for this node. |node| may not be NULL.
+void timer_wheel_node_init(timer_wheel_node_t* node, void* data);
+
+// Returns the data associated with |node|. |node| may not be NULL.
+void* timer_wheel_node_data(const timer_wheel_node_t* node);
+
+// Returns true if |node| is currently linked into a wheel.
+// |node| may not be NULL.
+bool timer_wheel_node_is_linked(const timer_wheel_node_t* node);
+
+// Returns true if |wheel| has no entries. |wheel| may not be NULL.
+bool timer_wheel_is_empty(const timer_wheel_t* wheel);
+
+// Returns the number of entries in |wheel|. |wheel| may not be NULL.
+size_t timer_wheel_length(const timer_wheel_t* wheel);
+
+// Inserts |node| into |wheel| with the absolute |deadline_ms|. If |node| is
+// already linked, it is removed first. A deadline in the past is treated as
+// due immediately. Neither |wheel| nor |node| may be NULL.
+void timer_wheel_insert(timer_wheel_t* wheel, timer_wheel_node_t* node,
+                        period_ms_t deadline_ms);
+
+// Removes |node| from |wheel|. This function is a no-op if |node| is not
+// linked. Neither |wheel| nor |node| may be NULL.
+void timer_wheel_remove(timer_wheel_t* wheel, timer_wheel_node_t* node);
+
+// Returns the node with the earliest deadline, or NULL if |wheel| is empty.
+// |wheel| may not be NULL.
+timer_wheel_node_t* timer_wheel_front(timer_wheel_t* wheel);
+
+// Returns the deadline |node| was inserted with. |node| may not be NULL.
+period_ms_t timer_wheel_node_deadline(const timer_wheel_node_t* node);
+
+// Moves the internal clock of |wheel| forward to |now_ms|, cascading entries
+// from the coarser levels as needed. The clock never moves past the earliest
+// pending deadline, so it is safe to call this at any time. Advancing the
+// clock keeps lookups cheap; it does not remove any entries.
+// |wheel| may not be NULL.
+void timer_wheel_advance(timer_wheel_t* wheel, period_ms_t now_ms);
+
+// Iterates over all entries in |wheel| in no particular order, calling
+// |callback| with each entry's data and |context|. The callback may not modify
+// the wheel. Neither |wheel| nor |callback| may be NULL.
+void timer_wheel_foreach(const timer_wheel_t* wheel,
+                         timer_wheel_iter_cb callback, void* context);
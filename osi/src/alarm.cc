@@ -45,6 +45,7 @@
 #include "osi/include/osi.h"
 #include "osi/include/semaphore.h"
 #include "osi/include/thread.h"
+#include "osi/include/timer_wheel.h"
 #include "osi/include/wakelock.h"
 
 using base::Bind;
@@ -106,6 +107,10 @@ struct alarm_t {
 
   bool for_msg_loop;  // True, if the alarm should be processed on message loop
   CancelableClosureInStruct closure;  // posted to message loop for processing
+
+#if (OSI_ALARM_TIMER_WHEEL == TRUE)
+  timer_wheel_node_t wheel_node;  // Linkage into the pending |alarms| wheel
+#endif
 };
 
 // If the next wakeup time is less than this threshold, we should acquire
@@ -123,9 +128,16 @@ static const clockid_t CLOCK_ID_ALARM = CLOCK_BOOTTIME_ALARM;
 
 // This mutex ensures that the |alarm_set|, |alarm_cancel|, and alarm callback
 // functions execute serially and not concurrently. As a result, this mutex
-// also protects the |alarms| list.
+// also protects the |alarms| collection.
 static std::mutex alarms_mutex;
+#if (OSI_ALARM_TIMER_WHEEL == TRUE)
+// Pending alarms, kept in a hierarchical timer wheel so that setting and
+// cancelling an alarm is O(1) regardless of how many alarms are pending.
+static timer_wheel_t* alarms;
+#else
+// Pending alarms, kept sorted by deadline (earliest deadline first).
 static list_t* alarms;
+#endif
 static timer_t timer;
 static timer_t wakeup_timer;
 static bool timer_set;
@@ -146,6 +158,15 @@ static void alarm_set_internal(alarm_t* alarm, period_ms_t period,
                                alarm_callback_t cb, void* data,
                                fixed_queue_t* queue, bool for_msg_loop);
 static void alarm_cancel_internal(alarm_t* alarm);
+static bool pending_alarms_new(void);
+static void pending_alarms_free(void);
+static bool pending_alarms_is_empty(void);
+static size_t pending_alarms_length(void);
+static alarm_t* pending_alarms_front(void);
+static void pending_alarms_insert(alarm_t* alarm);
+static void pending_alarms_remove(alarm_t* alarm);
+static void pending_alarms_foreach(bool (*callback)(void* data, void* context),
+                                   void* context);
 static void remove_pending_alarm(alarm_t* alarm);
 static void schedule_next_instance(alarm_t* alarm);
 static void reschedule_root_alarm(void);
@@ -190,6 +211,10 @@ static alarm_t* alarm_new_internal(const char* name, bool is_periodic) {
   // placement new
   new (&ret->closure) CancelableClosureInStruct();
 
+#if (OSI_ALARM_TIMER_WHEEL == TRUE)
+  timer_wheel_node_init(&ret->wheel_node, ret);
+#endif
+
   // NOTE: The stats were reset by osi_calloc() above
 
   return ret;
@@ -267,7 +292,7 @@ void alarm_cancel(alarm_t* alarm) {
 // The caller must hold the |alarms_mutex|
 static void alarm_cancel_internal(alarm_t* alarm) {
   bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+      (!pending_alarms_is_empty() && pending_alarms_front() == alarm);
 
   remove_pending_alarm(alarm);
 
@@ -307,8 +332,7 @@ void alarm_cleanup(void) {
   semaphore_free(alarm_expired);
   alarm_expired = NULL;
 
-  list_free(alarms);
-  alarms = NULL;
+  pending_alarms_free();
 }
 
 static bool lazy_initialize(void) {
@@ -321,8 +345,7 @@ static bool lazy_initialize(void) {
 
   std::lock_guard<std::mutex> lock(alarms_mutex);
 
-  alarms = list_new(NULL);
-  if (!alarms) {
+  if (!pending_alarms_new()) {
     LOG_ERROR(LOG_TAG, "%s unable to allocate alarm list.", __func__);
     goto error;
   }
@@ -384,8 +407,7 @@ error:
 
   if (timer_initialized) timer_delete(timer);
 
-  list_free(alarms);
-  alarms = NULL;
+  pending_alarms_free();
 
   return false;
 }
@@ -403,10 +425,101 @@ static period_ms_t now(void) {
   return (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
 }
 
+// The pending_alarms_* functions below abstract the collection of pending
+// alarms. The caller must hold the |alarms_mutex|.
+#if (OSI_ALARM_TIMER_WHEEL == TRUE)
+static bool pending_alarms_new(void) {
+  // |now| relies on |alarms| being set, so read the clock directly.
+  struct timespec ts;
+  period_ms_t now_ms = 0;
+  if (clock_gettime(CLOCK_ID, &ts) == 0)
+    now_ms = (ts.tv_sec * 1000LL) + (ts.tv_nsec / 1000000LL);
+
+  alarms = timer_wheel_new(now_ms);
+  return alarms != NULL;
+}
+
+static void pending_alarms_free(void) {
+  timer_wheel_free(alarms);
+  alarms = NULL;
+}
+
+static bool pending_alarms_is_empty(void) {
+  return timer_wheel_is_empty(alarms);
+}
+
+static size_t pending_alarms_length(void) { return timer_wheel_length(alarms); }
+
+static alarm_t* pending_alarms_front(void) {
+  timer_wheel_node_t* node = timer_wheel_front(alarms);
+  return (node != NULL) ? static_cast<alarm_t*>(timer_wheel_node_data(node))
+                        : NULL;
+}
+
+static void pending_alarms_insert(alarm_t* alarm) {
+  timer_wheel_insert(alarms, &alarm->wheel_node, alarm->deadline);
+}
+
+static void pending_alarms_remove(alarm_t* alarm) {
+  timer_wheel_remove(alarms, &alarm->wheel_node);
+}
+
+static void pending_alarms_foreach(bool (*callback)(void* data, void* context),
+                                   void* context) {
+  timer_wheel_foreach(alarms, callback, context);
+}
+#else
+static bool pending_alarms_new(void) {
+  alarms = list_new(NULL);
+  return alarms != NULL;
+}
+
+static void pending_alarms_free(void) {
+  list_free(alarms);
+  alarms = NULL;
+}
+
+static bool pending_alarms_is_empty(void) { return list_is_empty(alarms); }
+
+static size_t pending_alarms_length(void) { return list_length(alarms); }
+
+static alarm_t* pending_alarms_front(void) {
+  if (list_is_empty(alarms)) return NULL;
+  return static_cast<alarm_t*>(list_front(alarms));
+}
+
+static void pending_alarms_insert(alarm_t* alarm) {
+  // Add it into the timer list sorted by deadline (earliest deadline first).
+  if (list_is_empty(alarms) ||
+      ((alarm_t*)list_front(alarms))->deadline > alarm->deadline) {
+    list_prepend(alarms, alarm);
+  } else {
+    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
+         node = list_next(node)) {
+      list_node_t* next = list_next(node);
+      if (next == list_end(alarms) ||
+          ((alarm_t*)list_node(next))->deadline > alarm->deadline) {
+        list_insert_after(alarms, node, alarm);
+        break;
+      }
+    }
+  }
+}
+
+static void pending_alarms_remove(alarm_t* alarm) {
+  list_remove(alarms, alarm);
+}
+
+static void pending_alarms_foreach(bool (*callback)(void* data, void* context),
+                                   void* context) {
+  list_foreach(alarms, callback, context);
+}
+#endif
+
 // Remove alarm from internal alarm list and the processing queue
 // The caller must hold the |alarms_mutex|
 static void remove_pending_alarm(alarm_t* alarm) {
-  list_remove(alarms, alarm);
+  pending_alarms_remove(alarm);
 
   if (alarm->for_msg_loop) {
     alarm->closure.i.Cancel();
@@ -424,7 +537,7 @@ static void schedule_next_instance(alarm_t* alarm) {
   // If the alarm is currently set and it's at the start of the list,
   // we'll need to re-schedule since we've adjusted the earliest deadline.
   bool needs_reschedule =
-      (!list_is_empty(alarms) && list_front(alarms) == alarm);
+      (!pending_alarms_is_empty() && pending_alarms_front() == alarm);
   if (alarm->callback) remove_pending_alarm(alarm);
 
   // Calculate the next deadline for this alarm
@@ -434,26 +547,11 @@ static void schedule_next_instance(alarm_t* alarm) {
     ms_into_period = ((just_now - alarm->creation_time) % alarm->period);
   alarm->deadline = just_now + (alarm->period - ms_into_period);
 
-  // Add it into the timer list sorted by deadline (earliest deadline first).
-  if (list_is_empty(alarms) ||
-      ((alarm_t*)list_front(alarms))->deadline > alarm->deadline) {
-    list_prepend(alarms, alarm);
-  } else {
-    for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-         node = list_next(node)) {
-      list_node_t* next = list_next(node);
-      if (next == list_end(alarms) ||
-          ((alarm_t*)list_node(next))->deadline > alarm->deadline) {
-        list_insert_after(alarms, node, alarm);
-        break;
-      }
-    }
-  }
+  pending_alarms_insert(alarm);
 
   // If the new alarm has the earliest deadline, we need to re-evaluate our
   // schedule.
-  if (needs_reschedule ||
-      (!list_is_empty(alarms) && list_front(alarms) == alarm)) {
+  if (needs_reschedule || pending_alarms_front() == alarm) {
     reschedule_root_alarm();
   }
 }
@@ -470,9 +568,9 @@ static void reschedule_root_alarm(void) {
   struct itimerspec timer_time;
   memset(&timer_time, 0, sizeof(timer_time));
 
-  if (list_is_empty(alarms)) goto done;
+  if (pending_alarms_is_empty()) goto done;
 
-  next = static_cast<alarm_t*>(list_front(alarms));
+  next = pending_alarms_front();
   next_expiration = next->deadline - now();
   if (next_expiration < TIMER_INTERVAL_FOR_WAKELOCK_IN_MS) {
     if (!timer_set) {
@@ -629,13 +727,18 @@ static void callback_dispatch(UNUSED_ATTR void* context) {
     // Take into account that the alarm may get cancelled before we get to it.
     // We're done here if there are no alarms or the alarm at the front is in
     // the future. Exit right away since there's nothing left to do.
-    if (list_is_empty(alarms) ||
-        (alarm = static_cast<alarm_t*>(list_front(alarms)))->deadline > now()) {
+    if (pending_alarms_is_empty() ||
+        (alarm = pending_alarms_front())->deadline > now()) {
       reschedule_root_alarm();
       continue;
     }
 
-    list_remove(alarms, alarm);
+    pending_alarms_remove(alarm);
+#if (OSI_ALARM_TIMER_WHEEL == TRUE)
+    // Keep the wheel clock close to real time so new alarms land on the
+    // finest possible level.
+    timer_wheel_advance(alarms, now());
+#endif
 
     if (alarm->is_periodic) {
       alarm->prev_deadline = alarm->deadline;
@@ -723,6 +826,46 @@ static void dump_stat(int fd, stat_t* stat, const char* description) {
           (unsigned long long)average_time_ms);
 }
 
+typedef struct {
+  int fd;
+  period_ms_t just_now;
+} alarm_dump_context_t;
+
+static bool dump_alarm(void* data, void* context) {
+  alarm_t* alarm = static_cast<alarm_t*>(data);
+  alarm_dump_context_t* dump_context =
+      static_cast<alarm_dump_context_t*>(context);
+  int fd = dump_context->fd;
+  period_ms_t just_now = dump_context->just_now;
+  alarm_stats_t* stats = &alarm->stats;
+
+  dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
+          (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
+
+  dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
+          "    Action counts (sched/resched/exec/cancel)",
+          stats->scheduled_count, stats->rescheduled_count,
+          stats->total_updates, stats->canceled_count);
+
+  dprintf(fd, "%-51s: %zu / %zu\n", "    Deviation counts (overdue/premature)",
+          stats->overdue_scheduling.count, stats->premature_scheduling.count);
+
+  dprintf(fd, "%-51s: %llu / %llu / %lld\n",
+          "    Time in ms (since creation/interval/remaining)",
+          (unsigned long long)(just_now - alarm->creation_time),
+          (unsigned long long)alarm->period,
+          (long long)(alarm->deadline - just_now));
+
+  dump_stat(fd, &stats->overdue_scheduling,
+            "    Overdue scheduling time in ms (total/max/avg)");
+
+  dump_stat(fd, &stats->premature_scheduling,
+            "    Premature scheduling time in ms (total/max/avg)");
+
+  dprintf(fd, "\n");
+  return true;
+}
+
 void alarm_debug_dump(int fd) {
   dprintf(fd, "\nBluetooth Alarms Statistics:\n");
 
@@ -735,38 +878,9 @@ void alarm_debug_dump(int fd) {
 
   period_ms_t just_now = now();
 
-  dprintf(fd, "  Total Alarms: %zu\n\n", list_length(alarms));
+  dprintf(fd, "  Total Alarms: %zu\n\n", pending_alarms_length());
 
   // Dump info for each alarm
-  for (list_node_t* node = list_begin(alarms); node != list_end(alarms);
-       node = list_next(node)) {
-    alarm_t* alarm = (alarm_t*)list_node(node);
-    alarm_stats_t* stats = &alarm->stats;
-
-    dprintf(fd, "  Alarm : %s (%s)\n", stats->name,
-            (alarm->is_periodic) ? "PERIODIC" : "SINGLE");
-
-    dprintf(fd, "%-51s: %zu / %zu / %zu / %zu\n",
-            "    Action counts (sched/resched/exec/cancel)",
-            stats->scheduled_count, stats->rescheduled_count,
-            stats->total_updates, stats->canceled_count);
-
-    dprintf(fd, "%-51s: %zu / %zu\n",
-            "    Deviation counts (overdue/premature)",
-            stats->overdue_scheduling.count, stats->premature_scheduling.count);
-
-    dprintf(fd, "%-51s: %llu / %llu / %lld\n",
-            "    Time in ms (since creation/interval/remaining)",
-            (unsigned long long)(just_now - alarm->creation_time),
-            (unsigned long long)alarm->period,
-            (long long)(alarm->deadline - just_now));
-
-    dump_stat(fd, &stats->overdue_scheduling,
-              "    Overdue scheduling time in ms (total/max/avg)");
-
-    dump_stat(fd, &stats->premature_scheduling,
-              "    Premature scheduling time in ms (total/max/avg)");
-
-    dprintf(fd, "\n");
-  }
+  alarm_dump_context_t context = {fd, just_now};
+  pending_alarms_foreach(dump_alarm, &context);
 }
@@ -19,8 +19,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "internal_include/bt_target.h"
 #include "osi/include/allocation_tracker.h"
 #include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
 
 static const allocator_id_t alloc_allocator_id = 42;
 
@@ -56,21 +58,43 @@ char* osi_strndup(const char* str, size_t len) {
 }
 
 void* osi_malloc(size_t size) {
+#if (OSI_SLAB_ALLOCATOR == TRUE)
+  return osi_pool_malloc(size);
+#else
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = malloc(real_size);
   CHECK(ptr);
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+#endif
 }
 
 void* osi_calloc(size_t size) {
+#if (OSI_SLAB_ALLOCATOR == TRUE)
+  void* ptr = osi_pool_malloc(size);
+  memset(ptr, 0, size);
+  return ptr;
+#else
   size_t real_size = allocation_tracker_resize_for_canary(size);
   void* ptr = calloc(1, real_size);
   CHECK(ptr);
   return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
+#endif
+}
+
+void* osi_pool_malloc(size_t size) {
+  size_t real_size = allocation_tracker_resize_for_canary(size);
+  void* ptr = slab_allocator_alloc(real_size);
+  if (!ptr) ptr = malloc(real_size);
+  CHECK(ptr);
+  return allocation_tracker_notify_alloc(alloc_allocator_id, ptr, size);
 }
 
 void osi_free(void* ptr) {
-  free(allocation_tracker_notify_free(alloc_allocator_id, ptr));
+  void* real_ptr = allocation_tracker_notify_free(alloc_allocator_id, ptr);
+  if (slab_allocator_owns(real_ptr))
+    slab_allocator_free(real_ptr);
+  else
+    free(real_ptr);
 }
 
 void osi_free_and_reset(void** p_ptr) {
@@ -38,13 +38,40 @@ struct config_section_iter_t {};
 
 static bool config_parse(FILE* fp, config_t* config);
 
+// Returns the index for |list|, rebuilding it first if it is out of date.
+template <typename T, typename Name>
+static auto& index_get(std::list<T>& list, const config_index_t<T>& index,
+                       Name name) {
+  if (index.map.size() != list.size()) {
+    index.map.clear();
+    for (auto it = list.begin(); it != list.end(); ++it)
+      index.map.emplace(name(*it), it);
+  }
+  return index.map;
+}
+
 template <typename T,
           class = typename std::enable_if<std::is_same<
               config_t, typename std::remove_const<T>::type>::value>>
 static auto section_find(T& config, const std::string& section) {
-  return std::find_if(
-      config.sections.begin(), config.sections.end(),
-      [&section](const section_t& sec) { return sec.name == section; });
+  auto& sections = const_cast<std::list<section_t>&>(config.sections);
+  auto& index = index_get(sections, config.section_index,
+                          [](const section_t& sec) { return sec.name; });
+  auto it = index.find(section);
+  if (it == index.end()) return config.sections.end();
+  return decltype(config.sections.end())(it->second);
+}
+
+template <typename T,
+          class = typename std::enable_if<std::is_same<
+              section_t, typename std::remove_const<T>::type>::value>>
+static auto entry_find(T& section, const std::string& key) {
+  auto& entries = const_cast<std::list<entry_t>&>(section.entries);
+  auto& index = index_get(entries, section.entry_index,
+                          [](const entry_t& entry) { return entry.key; });
+  auto it = index.find(key);
+  if (it == index.end()) return section.entries.end();
+  return decltype(section.entries.end())(it->second);
 }
 
 static const entry_t* entry_find(const config_t& config,
@@ -53,11 +80,28 @@ static const entry_t* entry_find(const config_t& config,
   auto sec = section_find(config, section);
   if (sec == config.sections.end()) return nullptr;
 
-  for (const entry_t& entry : sec->entries) {
-    if (entry.key == key) return &entry;
-  }
+  auto entry = entry_find(*sec, key);
+  if (entry == sec->entries.end()) return nullptr;
+
+  return &*entry;
+}
 
-  return nullptr;
+// Returns the text |config_save| writes for |section|, serializing it only
+// if it changed since the last call.
+static const std::string& section_serialize(const section_t& section) {
+  if (section.serialized_dirty) {
+    std::stringstream serialized;
+    serialized << "[" << section.name << "]" << std::endl;
+
+    for (const entry_t& entry : section.entries)
+      serialized << entry.key << " = " << entry.value << std::endl;
+
+    serialized << std::endl;
+
+    section.serialized = serialized.str();
+    section.serialized_dirty = false;
+  }
+  return section.serialized;
 }
 
 std::unique_ptr<config_t> config_new_empty(void) {
@@ -78,6 +122,8 @@ std::unique_ptr<config_t> config_new(const char* filename) {
 
   if (!config_parse(fp, config.get())) {
     config.reset();
+  } else {
+    config->dirty = false;
   }
 
   fclose(fp);
@@ -87,11 +133,14 @@ std::unique_ptr<config_t> config_new(const char* filename) {
 std::unique_ptr<config_t> config_new_clone(const config_t& src) {
   std::unique_ptr<config_t> ret = config_new_empty();
 
+  // Serializing |src| here lets both configs share the result, so saving
+  // either one only has to serialize the sections changed after this point.
   for (const section_t& sec : src.sections) {
-    for (const entry_t& entry : sec.entries) {
-      config_set_string(ret.get(), sec.name, entry.key, entry.value);
-    }
+    if (sec.entries.empty()) continue;
+    section_serialize(sec);
+    ret->sections.push_back(sec);
   }
+  ret->dirty = src.dirty;
 
   return ret;
 }
@@ -169,6 +218,7 @@ void config_set_string(config_t* config, const std::string& section,
   if (sec == config->sections.end()) {
     config->sections.emplace_back(section_t{.name = section});
     sec = std::prev(config->sections.end());
+    config->section_index.map.emplace(section, sec);
   }
 
   std::string value_no_newline;
@@ -180,14 +230,17 @@ void config_set_string(config_t* config, const std::string& section,
     value_no_newline = value;
   }
 
-  for (entry_t& entry : sec->entries) {
-    if (entry.key == key) {
-      entry.value = value_no_newline;
-      return;
-    }
+  auto entry = entry_find(*sec, key);
+  if (entry != sec->entries.end()) {
+    if (entry->value == value_no_newline) return;
+    entry->value = value_no_newline;
+  } else {
+    sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+    sec->entry_index.map.emplace(key, std::prev(sec->entries.end()));
   }
 
-  sec->entries.emplace_back(entry_t{.key = key, .value = value_no_newline});
+  sec->serialized_dirty = true;
+  config->dirty = true;
 }
 
 bool config_remove_section(config_t* config, const std::string& section) {
@@ -196,7 +249,9 @@ bool config_remove_section(config_t* config, const std::string& section) {
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) return false;
 
+  config->section_index.map.erase(section);
   config->sections.erase(sec);
+  config->dirty = true;
   return true;
 }
 
@@ -206,15 +261,26 @@ bool config_remove_key(config_t* config, const std::string& section,
   auto sec = section_find(*config, section);
   if (sec == config->sections.end()) return false;
 
-  for (auto entry = sec->entries.begin(); entry != sec->entries.end();
-       ++entry) {
-    if (entry->key == key) {
-      sec->entries.erase(entry);
-      return true;
-    }
-  }
+  auto entry = entry_find(*sec, key);
+  if (entry == sec->entries.end()) return false;
 
-  return false;
+  sec->entry_index.map.erase(key);
+  sec->entries.erase(entry);
+  sec->serialized_dirty = true;
+  config->dirty = true;
+  return true;
+}
+
+bool config_is_dirty(const config_t& config) { return config.dirty; }
+
+void config_clear_dirty(config_t* config) {
+  CHECK(config);
+  config->dirty = false;
+}
+
+void config_set_dirty(config_t* config) {
+  CHECK(config);
+  config->dirty = true;
 }
 
 bool config_save(const config_t& config, const std::string& filename) {
@@ -230,7 +296,7 @@ bool config_save(const config_t& config, const std::string& filename) {
   //    This ensures directory entries are up-to-date.
   int dir_fd = -1;
   FILE* fp = nullptr;
-  std::stringstream serialized;
+  std::string serialized;
 
   // Build temp config file based on config file (e.g. bt_config.conf.new).
   const std::string temp_filename = filename + ".new";
@@ -257,16 +323,10 @@ bool config_save(const config_t& config, const std::string& filename) {
     goto error;
   }
 
-  for (const section_t& section : config.sections) {
-    serialized << "[" << section.name << "]" << std::endl;
-
-    for (const entry_t& entry : section.entries)
-      serialized << entry.key << " = " << entry.value << std::endl;
-
-    serialized << std::endl;
-  }
+  for (const section_t& section : config.sections)
+    serialized.append(section_serialize(section));
 
-  if (fprintf(fp, "%s", serialized.str().c_str()) < 0) {
+  if (fprintf(fp, "%s", serialized.c_str()) < 0) {
     LOG(ERROR) << __func__ << ": unable to write to file '" << temp_filename
                << "': " << strerror(errno);
     goto error;
@@ -17,8 +17,14 @@
  ******************************************************************************/
 
 #include <base/logging.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
+#include <atomic>
 #include <mutex>
 
 #include "osi/include/allocator.h"
@@ -28,8 +34,37 @@
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+  std::atomic<size_t> sequence;
+  void* data;
+} ring_cell_t;
+
+// Bounded multi-producer, single-consumer ring buffer (Dmitry Vyukov's
+// algorithm). Producers claim a cell by advancing |enqueue_pos| and publish
+// it by bumping the cell sequence; the single consumer owns |dequeue_pos|.
+//
+// Wakeups are coalesced: the consumer announces that it is about to sleep via
+// |consumer_waiting| and producers only write |data_fd| when they observe that
+// flag. Likewise, producers blocked on a full ring announce themselves via
+// |blocked_producers| and the consumer only writes |space_fd| when needed.
+typedef struct {
+  size_t mask;
+  ring_cell_t* cells;
+  int data_fd;
+  int space_fd;
+  uint8_t pad0[CACHE_LINE_SIZE];
+  std::atomic<size_t> enqueue_pos;
+  uint8_t pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_pos;
+  std::atomic<bool> consumer_waiting;
+  std::atomic<int> blocked_producers;
+} ring_t;
+
 typedef struct fixed_queue_t {
   list_t* list;
+  ring_t* ring;  // Set for queues created with |fixed_queue_new_mpsc|
   semaphore_t* enqueue_sem;
   semaphore_t* dequeue_sem;
   std::mutex* mutex;
@@ -41,6 +76,14 @@ typedef struct fixed_queue_t {
 } fixed_queue_t;
 
 static void internal_dequeue_ready(void* context);
+static ring_t* ring_new(size_t capacity);
+static void ring_free(ring_t* ring);
+static bool ring_try_push(ring_t* ring, void* data);
+static void* ring_try_pop(ring_t* ring);
+static void* ring_peek(ring_t* ring);
+static size_t ring_length(ring_t* ring);
+static void ring_push(ring_t* ring, void* data);
+static void* ring_pop(ring_t* ring);
 
 fixed_queue_t* fixed_queue_new(size_t capacity) {
   fixed_queue_t* ret =
@@ -65,11 +108,38 @@ error:
   return NULL;
 }
 
+fixed_queue_t* fixed_queue_new_mpsc(size_t capacity) {
+  CHECK(capacity != 0);
+  CHECK(capacity <= (SIZE_MAX >> 1) + 1);
+
+  fixed_queue_t* ret =
+      static_cast<fixed_queue_t*>(osi_calloc(sizeof(fixed_queue_t)));
+
+  ret->ring = ring_new(capacity);
+  if (!ret->ring) {
+    osi_free(ret);
+    return NULL;
+  }
+  ret->capacity = ret->ring->mask + 1;
+
+  return ret;
+}
+
 void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   if (!queue) return;
 
   fixed_queue_unregister_dequeue(queue);
 
+  if (queue->ring) {
+    void* data;
+    while ((data = ring_try_pop(queue->ring)) != NULL) {
+      if (free_cb) free_cb(data);
+    }
+    ring_free(queue->ring);
+    osi_free(queue);
+    return;
+  }
+
   if (free_cb)
     for (const list_node_t* node = list_begin(queue->list);
          node != list_end(queue->list); node = list_next(node))
@@ -85,8 +155,8 @@ void fixed_queue_free(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
   if (!queue) return;
 
-  while (!fixed_queue_is_empty(queue)) {
-    void* data = fixed_queue_try_dequeue(queue);
+  void* data;
+  while ((data = fixed_queue_try_dequeue(queue)) != NULL) {
     if (free_cb != NULL) {
       free_cb(data);
     }
@@ -95,6 +165,7 @@ void fixed_queue_flush(fixed_queue_t* queue, fixed_queue_free_cb free_cb) {
 
 bool fixed_queue_is_empty(fixed_queue_t* queue) {
   if (queue == NULL) return true;
+  if (queue->ring) return ring_length(queue->ring) == 0;
 
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list);
@@ -102,6 +173,7 @@ bool fixed_queue_is_empty(fixed_queue_t* queue) {
 
 size_t fixed_queue_length(fixed_queue_t* queue) {
   if (queue == NULL) return 0;
+  if (queue->ring) return ring_length(queue->ring);
 
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_length(queue->list);
@@ -117,6 +189,11 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) {
+    ring_push(queue->ring, data);
+    return;
+  }
+
   semaphore_wait(queue->enqueue_sem);
 
   {
@@ -130,6 +207,8 @@ void fixed_queue_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_dequeue(fixed_queue_t* queue) {
   CHECK(queue != NULL);
 
+  if (queue->ring) return ring_pop(queue->ring);
+
   semaphore_wait(queue->dequeue_sem);
 
   void* ret = NULL;
@@ -148,6 +227,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
   CHECK(queue != NULL);
   CHECK(data != NULL);
 
+  if (queue->ring) return ring_try_push(queue->ring, data);
+
   if (!semaphore_try_wait(queue->enqueue_sem)) return false;
 
   {
@@ -162,6 +243,8 @@ bool fixed_queue_try_enqueue(fixed_queue_t* queue, void* data) {
 void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) return ring_try_pop(queue->ring);
+
   if (!semaphore_try_wait(queue->dequeue_sem)) return NULL;
 
   void* ret = NULL;
@@ -179,6 +262,8 @@ void* fixed_queue_try_dequeue(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  if (queue->ring) return ring_peek(queue->ring);
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_front(queue->list);
 }
@@ -186,6 +271,9 @@ void* fixed_queue_try_peek_first(fixed_queue_t* queue) {
 void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
   if (queue == NULL) return NULL;
 
+  // The last element of a ring may still be in flight from a producer.
+  CHECK(queue->ring == NULL);
+
   std::lock_guard<std::mutex> lock(*queue->mutex);
   return list_is_empty(queue->list) ? NULL : list_back(queue->list);
 }
@@ -193,6 +281,9 @@ void* fixed_queue_try_peek_last(fixed_queue_t* queue) {
 void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
   if (queue == NULL) return NULL;
 
+  // Elements cannot be removed from the middle of a ring.
+  CHECK(queue->ring == NULL);
+
   bool removed = false;
   {
     std::lock_guard<std::mutex> lock(*queue->mutex);
@@ -212,6 +303,7 @@ void* fixed_queue_try_remove_from_queue(fixed_queue_t* queue, void* data) {
 
 list_t* fixed_queue_get_list(fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL);
 
   // NOTE: Using the list in this way is not thread-safe.
   // Using this list in any context where threads can call other functions
@@ -221,11 +313,15 @@ list_t* fixed_queue_get_list(fixed_queue_t* queue) {
 
 int fixed_queue_get_dequeue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  // Ring wakeups are coalesced, so the fd is only meaningful together with
+  // |fixed_queue_register_dequeue|.
+  CHECK(queue->ring == NULL);
   return semaphore_get_fd(queue->dequeue_sem);
 }
 
 int fixed_queue_get_enqueue_fd(const fixed_queue_t* queue) {
   CHECK(queue != NULL);
+  CHECK(queue->ring == NULL);
   return semaphore_get_fd(queue->enqueue_sem);
 }
 
@@ -240,9 +336,11 @@ void fixed_queue_register_dequeue(fixed_queue_t* queue, reactor_t* reactor,
 
   queue->dequeue_ready = ready_cb;
   queue->dequeue_context = context;
+
+  int fd = queue->ring ? queue->ring->data_fd
+                       : fixed_queue_get_dequeue_fd(queue);
   queue->dequeue_object =
-      reactor_register(reactor, fixed_queue_get_dequeue_fd(queue), queue,
-                       internal_dequeue_ready, NULL);
+      reactor_register(reactor, fd, queue, internal_dequeue_ready, NULL);
 }
 
 void fixed_queue_unregister_dequeue(fixed_queue_t* queue) {
@@ -258,5 +356,168 @@ static void internal_dequeue_ready(void* context) {
   CHECK(context != NULL);
 
   fixed_queue_t* queue = static_cast<fixed_queue_t*>(context);
-  queue->dequeue_ready(queue, queue->dequeue_context);
+  ring_t* ring = queue->ring;
+  if (!ring) {
+    queue->dequeue_ready(queue, queue->dequeue_context);
+    return;
+  }
+
+  // Consume the wakeup, then drain everything that is ready in one go. The
+  // callback is expected to dequeue one element per invocation.
+  eventfd_t value;
+  eventfd_read(ring->data_fd, &value);
+  ring->consumer_waiting.store(false);
+
+  for (size_t budget = ring->mask + 1; budget > 0; --budget) {
+    if (ring_peek(ring) == NULL) {
+      // Announce that we are going to sleep, then re-check so that an element
+      // published concurrently is not missed.
+      ring->consumer_waiting.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ring_peek(ring) == NULL) return;
+      ring->consumer_waiting.store(false);
+    }
+    queue->dequeue_ready(queue, queue->dequeue_context);
+  }
+
+  // Out of budget; re-arm so other reactor objects get a turn first.
+  eventfd_write(ring->data_fd, 1);
+}
+
+static ring_t* ring_new(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+
+  ring_t* ring = new ring_t;
+  ring->mask = size - 1;
+  ring->cells = new ring_cell_t[size];
+  for (size_t i = 0; i < size; ++i) {
+    ring->cells[i].sequence.store(i, std::memory_order_relaxed);
+    ring->cells[i].data = NULL;
+  }
+  ring->enqueue_pos.store(0, std::memory_order_relaxed);
+  ring->dequeue_pos.store(0, std::memory_order_relaxed);
+  ring->consumer_waiting.store(true);
+  ring->blocked_producers.store(0);
+
+  ring->data_fd = eventfd(0, EFD_NONBLOCK);
+  ring->space_fd = eventfd(0, EFD_NONBLOCK);
+  if (ring->data_fd == INVALID_FD || ring->space_fd == INVALID_FD) {
+    ring_free(ring);
+    return NULL;
+  }
+
+  return ring;
+}
+
+static void ring_free(ring_t* ring) {
+  if (ring->data_fd != INVALID_FD) close(ring->data_fd);
+  if (ring->space_fd != INVALID_FD) close(ring->space_fd);
+  delete[] ring->cells;
+  delete ring;
+}
+
+// Blocks until |fd| is readable and consumes its counter.
+static void wait_on_eventfd(int fd) {
+  struct pollfd pfd = {fd, POLLIN, 0};
+  int ret;
+  OSI_NO_INTR(ret = poll(&pfd, 1, -1));
+
+  eventfd_t value;
+  eventfd_read(fd, &value);
+}
+
+static bool ring_try_push(ring_t* ring, void* data) {
+  ring_cell_t* cell;
+  size_t pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+  for (;;) {
+    cell = &ring->cells[pos & ring->mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+    if (diff == 0) {
+      if (ring->enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                  std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;  // Full
+    } else {
+      pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->data = data;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring->consumer_waiting.load(std::memory_order_relaxed) &&
+      ring->consumer_waiting.exchange(false))
+    eventfd_write(ring->data_fd, 1);
+
+  return true;
+}
+
+static void ring_push(ring_t* ring, void* data) {
+  while (!ring_try_push(ring, data)) {
+    ring->blocked_producers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ring_try_push(ring, data)) {
+      ring->blocked_producers.fetch_sub(1);
+      return;
+    }
+    wait_on_eventfd(ring->space_fd);
+    ring->blocked_producers.fetch_sub(1);
+  }
+}
+
+// Must only be called from the single consumer.
+static void* ring_peek(ring_t* ring) {
+  size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  ring_cell_t* cell = &ring->cells[pos & ring->mask];
+  size_t seq = cell->sequence.load(std::memory_order_acquire);
+  if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return NULL;
+  return cell->data;
+}
+
+// Must only be called from the single consumer.
+static void* ring_try_pop(ring_t* ring) {
+  size_t pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  ring_cell_t* cell = &ring->cells[pos & ring->mask];
+  size_t seq = cell->sequence.load(std::memory_order_acquire);
+  if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return NULL;
+
+  void* data = cell->data;
+  cell->sequence.store(pos + ring->mask + 1, std::memory_order_release);
+  ring->dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+
+  // Only wake blocked producers once half of the ring is free again, so they
+  // are not woken up for every single element. The consumer always drains
+  // the ring before sleeping, so the wakeup is never lost.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring->blocked_producers.load(std::memory_order_relaxed) > 0 &&
+      ring_length(ring) <= (ring->mask + 1) / 2)
+    eventfd_write(ring->space_fd, 1);
+
+  return data;
+}
+
+// Must only be called from the single consumer.
+static void* ring_pop(ring_t* ring) {
+  for (;;) {
+    void* data = ring_try_pop(ring);
+    if (data != NULL) return data;
+
+    ring->consumer_waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    data = ring_try_pop(ring);
+    if (data != NULL) return data;
+
+    wait_on_eventfd(ring->data_fd);
+  }
+}
+
+static size_t ring_length(ring_t* ring) {
+  // Includes elements claimed by producers but not yet published.
+  size_t dequeue_pos = ring->dequeue_pos.load(std::memory_order_relaxed);
+  size_t enqueue_pos = ring->enqueue_pos.load(std::memory_order_relaxed);
+  return (enqueue_pos > dequeue_pos) ? enqueue_pos - dequeue_pos : 0;
 }
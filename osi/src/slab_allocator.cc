@@ -0,0 +1,299 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_osi_slab_allocator"
+
+#include "osi/include/slab_allocator.h"
+
+#include <base/logging.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <atomic>
+#include <mutex>
+
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+
+// Block sizes, in ascending order. The classes cover the usual BT_HDR sizes:
+// small command/event buffers, BT_SMALL_BUFFER_SIZE (660), 1021 byte ACL
+// payloads plus headers, and BT_DEFAULT_BUFFER_SIZE (4096 + 16). Each class
+// leaves room for the allocation tracker canaries (2 * 8 bytes).
+static const size_t class_sizes[] = {32,  64,   128,  256, 512,
+                                     704, 1088, 2112, 4144};
+#define NUM_CLASSES ARRAY_SIZE(class_sizes)
+
+// Bytes of address space reserved for each size class. The region is only
+// backed by physical pages as blocks are carved out of it.
+#define REGION_SIZE ((size_t)2 * 1024 * 1024)
+
+// Number of free blocks each thread keeps per size class, and the number of
+// blocks moved between a thread cache and the shared depot at once.
+#define CACHE_CAPACITY 32
+#define CACHE_BATCH (CACHE_CAPACITY / 2)
+
+typedef struct free_block_t { struct free_block_t* next; } free_block_t;
+
+typedef struct {
+  std::mutex lock;
+  free_block_t* free_list;  // Blocks returned to the depot
+  uint8_t* next_unused;     // Start of the not yet carved part of the region
+  uint8_t* region_end;
+
+  std::atomic<size_t> cache_hits;
+  std::atomic<size_t> depot_refills;
+  std::atomic<size_t> misses;
+  std::atomic<size_t> carved;
+  std::atomic<size_t> in_use;
+  std::atomic<size_t> high_water;
+} size_class_t;
+
+typedef struct {
+  void* blocks[CACHE_CAPACITY];
+  size_t count;
+} class_cache_t;
+
+typedef enum {
+  CACHE_UNINITIALIZED = 0,
+  CACHE_ALIVE,
+  CACHE_DESTROYED
+} cache_state_t;
+
+typedef struct {
+  cache_state_t state;
+  class_cache_t classes[NUM_CLASSES];
+} thread_cache_t;
+
+// Flushes the calling thread's cache back to the depot when the thread exits.
+class thread_cache_flusher_t {
+ public:
+  ~thread_cache_flusher_t();
+  void touch() {}
+};
+
+static std::once_flag arena_once;
+static std::atomic<uintptr_t> arena_begin;
+static uintptr_t arena_end;
+static size_class_t size_classes[NUM_CLASSES];
+static std::atomic<size_t> oversized_count;
+
+// Kept trivially destructible so it remains usable while other thread local
+// destructors run; |thread_cache_flusher| does the actual cleanup.
+static thread_local thread_cache_t thread_cache;
+static thread_local thread_cache_flusher_t thread_cache_flusher;
+
+static void arena_init();
+static int class_for_size(size_t size);
+static int class_for_block(uintptr_t block);
+static thread_cache_t* get_thread_cache();
+static size_t depot_take(int index, void** blocks, size_t count);
+static void depot_return(int index, void** blocks, size_t count);
+static void note_allocated(size_class_t* size_class);
+
+void* slab_allocator_alloc(size_t size) {
+  int index = class_for_size(size);
+  if (index < 0) {
+    oversized_count++;
+    return NULL;
+  }
+
+  std::call_once(arena_once, arena_init);
+  if (!arena_begin.load(std::memory_order_relaxed)) return NULL;
+
+  size_class_t* size_class = &size_classes[index];
+  thread_cache_t* cache = get_thread_cache();
+  void* block = NULL;
+
+  if (cache == NULL) {
+    depot_take(index, &block, 1);
+  } else {
+    class_cache_t* class_cache = &cache->classes[index];
+    if (class_cache->count > 0) {
+      size_class->cache_hits.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      class_cache->count =
+          depot_take(index, class_cache->blocks, CACHE_BATCH);
+      if (class_cache->count > 0)
+        size_class->depot_refills.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (class_cache->count > 0)
+      block = class_cache->blocks[--class_cache->count];
+  }
+
+  if (block == NULL) {
+    size_class->misses.fetch_add(1, std::memory_order_relaxed);
+    return NULL;
+  }
+
+  note_allocated(size_class);
+  return block;
+}
+
+bool slab_allocator_owns(const void* ptr) {
+  uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+  uintptr_t begin = arena_begin.load(std::memory_order_acquire);
+  return begin != 0 && address >= begin && address < arena_end;
+}
+
+void slab_allocator_free(void* ptr) {
+  CHECK(slab_allocator_owns(ptr));
+
+  int index = class_for_block(reinterpret_cast<uintptr_t>(ptr));
+  size_classes[index].in_use.fetch_sub(1, std::memory_order_relaxed);
+
+  thread_cache_t* cache = get_thread_cache();
+  if (cache == NULL) {
+    depot_return(index, &ptr, 1);
+    return;
+  }
+
+  class_cache_t* class_cache = &cache->classes[index];
+  if (class_cache->count == CACHE_CAPACITY) {
+    // Hand the oldest half back so that a producer thread that only frees
+    // does not bounce single blocks through the depot.
+    depot_return(index, class_cache->blocks, CACHE_BATCH);
+    class_cache->count -= CACHE_BATCH;
+    memmove(class_cache->blocks, class_cache->blocks + CACHE_BATCH,
+            class_cache->count * sizeof(void*));
+  }
+  class_cache->blocks[class_cache->count++] = ptr;
+}
+
+void slab_allocator_debug_dump(int fd) {
+  dprintf(fd, "\nBluetooth Slab Allocator Statistics:\n");
+  if (!arena_begin.load(std::memory_order_acquire)) {
+    dprintf(fd, "  Not initialized\n");
+    return;
+  }
+
+  dprintf(fd,
+          "  Class  Cache hits  Depot refills      Misses  Carved  In use  "
+          "High water\n");
+  for (size_t i = 0; i < NUM_CLASSES; i++) {
+    const size_class_t* size_class = &size_classes[i];
+    dprintf(fd, "  %5zu  %10zu  %13zu  %10zu  %6zu  %6zu  %10zu\n",
+            class_sizes[i], size_class->cache_hits.load(),
+            size_class->depot_refills.load(), size_class->misses.load(),
+            size_class->carved.load(), size_class->in_use.load(),
+            size_class->high_water.load());
+  }
+  dprintf(fd, "  Oversized requests : %zu\n", oversized_count.load());
+}
+
+thread_cache_flusher_t::~thread_cache_flusher_t() {
+  for (size_t i = 0; i < NUM_CLASSES; i++) {
+    class_cache_t* class_cache = &thread_cache.classes[i];
+    depot_return(i, class_cache->blocks, class_cache->count);
+    class_cache->count = 0;
+  }
+  thread_cache.state = CACHE_DESTROYED;
+}
+
+static void arena_init() {
+  size_t size = NUM_CLASSES * REGION_SIZE;
+  void* arena = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (arena == MAP_FAILED) {
+    LOG_ERROR(LOG_TAG, "%s unable to reserve %zu bytes: %s", __func__, size,
+              strerror(errno));
+    return;
+  }
+
+  uint8_t* region = static_cast<uint8_t*>(arena);
+  for (size_t i = 0; i < NUM_CLASSES; i++, region += REGION_SIZE) {
+    size_classes[i].free_list = NULL;
+    size_classes[i].next_unused = region;
+    size_classes[i].region_end =
+        region + (REGION_SIZE / class_sizes[i]) * class_sizes[i];
+  }
+
+  arena_end = reinterpret_cast<uintptr_t>(arena) + size;
+  arena_begin.store(reinterpret_cast<uintptr_t>(arena),
+                    std::memory_order_release);
+}
+
+static int class_for_size(size_t size) {
+  for (size_t i = 0; i < NUM_CLASSES; i++)
+    if (size <= class_sizes[i]) return i;
+  return -1;
+}
+
+static int class_for_block(uintptr_t block) {
+  uintptr_t offset = block - arena_begin.load(std::memory_order_relaxed);
+  size_t index = offset / REGION_SIZE;
+  CHECK((offset % REGION_SIZE) % class_sizes[index] == 0);
+  return index;
+}
+
+// Returns NULL once the calling thread's cache has been torn down.
+static thread_cache_t* get_thread_cache() {
+  thread_cache_t* cache = &thread_cache;
+  if (cache->state == CACHE_ALIVE) return cache;
+  if (cache->state == CACHE_DESTROYED) return NULL;
+
+  // First use on this thread; make sure the flusher gets registered.
+  thread_cache_flusher.touch();
+  cache->state = CACHE_ALIVE;
+  return cache;
+}
+
+static size_t depot_take(int index, void** blocks, size_t count) {
+  size_class_t* size_class = &size_classes[index];
+  size_t block_size = class_sizes[index];
+  size_t taken = 0;
+
+  std::lock_guard<std::mutex> lock(size_class->lock);
+  while (taken < count && size_class->free_list != NULL) {
+    free_block_t* block = size_class->free_list;
+    size_class->free_list = block->next;
+    blocks[taken++] = block;
+  }
+
+  while (taken < count &&
+         size_class->next_unused + block_size <= size_class->region_end) {
+    blocks[taken++] = size_class->next_unused;
+    size_class->next_unused += block_size;
+    size_class->carved.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  return taken;
+}
+
+static void depot_return(int index, void** blocks, size_t count) {
+  if (count == 0) return;
+
+  size_class_t* size_class = &size_classes[index];
+  std::lock_guard<std::mutex> lock(size_class->lock);
+  for (size_t i = 0; i < count; i++) {
+    free_block_t* block = static_cast<free_block_t*>(blocks[i]);
+    block->next = size_class->free_list;
+    size_class->free_list = block;
+  }
+}
+
+static void note_allocated(size_class_t* size_class) {
+  size_t in_use =
+      size_class->in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+  size_t high_water = size_class->high_water.load(std::memory_order_relaxed);
+  while (in_use > high_water &&
+         !size_class->high_water.compare_exchange_weak(
+             high_water, in_use, std::memory_order_relaxed)) {
+  }
+}
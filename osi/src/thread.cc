@@ -36,6 +36,7 @@
 #include "osi/include/compat.h"
 #include "osi/include/fixed_queue.h"
 #include "osi/include/log.h"
+#include "osi/include/osi.h"
 #include "osi/include/reactor.h"
 #include "osi/include/semaphore.h"
 
@@ -60,7 +61,7 @@ typedef struct {
 } work_item_t;
 
 static void* run_thread(void* start_arg);
-static void work_queue_read_cb(void* context);
+static void work_queue_read_cb(fixed_queue_t* queue, void* context);
 
 static const size_t DEFAULT_WORK_QUEUE_CAPACITY = 128;
 
@@ -73,7 +74,12 @@ thread_t* thread_new_sized(const char* name, size_t work_queue_capacity) {
   ret->reactor = reactor_new();
   if (!ret->reactor) goto error;
 
-  ret->work_queue = fixed_queue_new(work_queue_capacity);
+  // Only the thread itself dequeues work items, so bounded work queues can use
+  // the lock-free single-consumer ring.
+  if (work_queue_capacity == SIZE_MAX)
+    ret->work_queue = fixed_queue_new(work_queue_capacity);
+  else
+    ret->work_queue = fixed_queue_new_mpsc(work_queue_capacity);
   if (!ret->work_queue) goto error;
 
   // Start is on the stack, but we use a semaphore, so it's safe
@@ -213,13 +219,10 @@ static void* run_thread(void* start_arg) {
 
   semaphore_post(start->start_sem);
 
-  int fd = fixed_queue_get_dequeue_fd(thread->work_queue);
-  void* context = thread->work_queue;
-
-  reactor_object_t* work_queue_object =
-      reactor_register(thread->reactor, fd, context, work_queue_read_cb, NULL);
+  fixed_queue_register_dequeue(thread->work_queue, thread->reactor,
+                               work_queue_read_cb, NULL);
   reactor_start(thread->reactor);
-  reactor_unregister(work_queue_object);
+  fixed_queue_unregister_dequeue(thread->work_queue);
 
   // Make sure we dispatch all queued work items before exiting the thread.
   // This allows a caller to safely tear down by enqueuing a teardown
@@ -243,10 +246,10 @@ static void* run_thread(void* start_arg) {
   return NULL;
 }
 
-static void work_queue_read_cb(void* context) {
-  CHECK(context != NULL);
+static void work_queue_read_cb(fixed_queue_t* queue,
+                               UNUSED_ATTR void* context) {
+  CHECK(queue != NULL);
 
-  fixed_queue_t* queue = (fixed_queue_t*)context;
   work_item_t* item = static_cast<work_item_t*>(fixed_queue_dequeue(queue));
   item->func(item->context);
   osi_free(item);
@@ -0,0 +1,314 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include "osi/include/timer_wheel.h"
+
+#include <base/logging.h>
+
+#include "osi/include/allocator.h"
+
+// The wheel has |LEVELS| levels of |SLOTS| slots each. Level N has a slot
+// granularity of SLOTS^N milliseconds, so with 6 bits per level and 5 levels
+// the wheel spans 2^30 ms (~12 days). Anything further out is kept on an
+// unsorted overflow list, which is only scanned when the wheel itself is
+// empty or when the clock crosses into a new top-level window.
+//
+// An entry lives on level N iff its deadline and the wheel clock agree on all
+// bits above level N. As a result, every entry on level N is earlier than
+// every entry on level N+1, and the lowest occupied slot on the lowest
+// occupied level holds the earliest deadline.
+#define LEVEL_BITS 6
+#define SLOTS (1 << LEVEL_BITS)
+#define SLOT_MASK (SLOTS - 1)
+#define LEVELS 5
+
+#define OVERFLOW_LEVEL (-1)
+
+struct timer_wheel_t {
+  period_ms_t clock;
+  size_t length;
+  timer_wheel_node_t* front;  // Cached earliest entry; NULL if unknown.
+  uint64_t occupied[LEVELS];  // One bit per non-empty slot.
+  timer_wheel_node_t slots[LEVELS][SLOTS];
+  timer_wheel_node_t overflow;
+};
+
+static void slot_init(timer_wheel_node_t* head) {
+  head->prev = head;
+  head->next = head;
+}
+
+static bool slot_is_empty(const timer_wheel_node_t* head) {
+  return head->next == head;
+}
+
+static void slot_append(timer_wheel_node_t* head, timer_wheel_node_t* node) {
+  node->prev = head->prev;
+  node->next = head;
+  head->prev->next = node;
+  head->prev = node;
+}
+
+static void node_unlink(timer_wheel_node_t* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  node->prev = NULL;
+  node->next = NULL;
+}
+
+// Moves all entries of |from| onto the empty list |to|, preserving order.
+static void slot_splice(timer_wheel_node_t* from, timer_wheel_node_t* to) {
+  slot_init(to);
+  if (slot_is_empty(from)) return;
+
+  to->next = from->next;
+  to->prev = from->prev;
+  to->next->prev = to;
+  to->prev->next = to;
+  slot_init(from);
+}
+
+static period_ms_t effective_deadline(const timer_wheel_t* wheel,
+                                      const timer_wheel_node_t* node) {
+  return (node->deadline < wheel->clock) ? wheel->clock : node->deadline;
+}
+
+static void place(timer_wheel_t* wheel, timer_wheel_node_t* node) {
+  period_ms_t key = effective_deadline(wheel, node);
+
+  for (int level = 0; level < LEVELS; ++level) {
+    int shift = LEVEL_BITS * (level + 1);
+    if ((key >> shift) != (wheel->clock >> shift)) continue;
+
+    uint8_t slot = (key >> (LEVEL_BITS * level)) & SLOT_MASK;
+    node->level = level;
+    node->slot = slot;
+    slot_append(&wheel->slots[level][slot], node);
+    wheel->occupied[level] |= (1ULL << slot);
+    return;
+  }
+
+  node->level = OVERFLOW_LEVEL;
+  node->slot = 0;
+  slot_append(&wheel->overflow, node);
+}
+
+static void unplace(timer_wheel_t* wheel, timer_wheel_node_t* node) {
+  node_unlink(node);
+  if (node->level == OVERFLOW_LEVEL) return;
+
+  if (slot_is_empty(&wheel->slots[node->level][node->slot]))
+    wheel->occupied[node->level] &= ~(1ULL << node->slot);
+}
+
+// Returns the earliest entry on |head|. Ties go to the entry closest to the
+// head of the list, i.e. the one inserted first.
+static timer_wheel_node_t* slot_min(timer_wheel_node_t* head) {
+  timer_wheel_node_t* min = NULL;
+  for (timer_wheel_node_t* node = head->next; node != head;
+       node = node->next) {
+    if (min == NULL || node->deadline < min->deadline) min = node;
+  }
+  return min;
+}
+
+static timer_wheel_node_t* find_front(timer_wheel_t* wheel) {
+  for (int level = 0; level < LEVELS; ++level) {
+    if (wheel->occupied[level] == 0) continue;
+
+    int slot = __builtin_ctzll(wheel->occupied[level]);
+    timer_wheel_node_t* head = &wheel->slots[level][slot];
+
+    // All level 0 entries of a slot share the same millisecond.
+    if (level == 0) return head->next;
+    return slot_min(head);
+  }
+
+  return slot_min(&wheel->overflow);
+}
+
+// Re-inserts every entry of |head| relative to the current clock.
+static void cascade(timer_wheel_t* wheel, timer_wheel_node_t* head) {
+  timer_wheel_node_t pending;
+  slot_splice(head, &pending);
+
+  while (!slot_is_empty(&pending)) {
+    timer_wheel_node_t* node = pending.next;
+    node_unlink(node);
+    place(wheel, node);
+  }
+}
+
+timer_wheel_t* timer_wheel_new(period_ms_t now_ms) {
+  timer_wheel_t* wheel =
+      static_cast<timer_wheel_t*>(osi_calloc(sizeof(timer_wheel_t)));
+
+  wheel->clock = now_ms;
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot)
+      slot_init(&wheel->slots[level][slot]);
+  }
+  slot_init(&wheel->overflow);
+
+  return wheel;
+}
+
+void timer_wheel_free(timer_wheel_t* wheel) {
+  if (!wheel) return;
+
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      timer_wheel_node_t* head = &wheel->slots[level][slot];
+      while (!slot_is_empty(head)) node_unlink(head->next);
+    }
+  }
+  while (!slot_is_empty(&wheel->overflow)) node_unlink(wheel->overflow.next);
+
+  osi_free(wheel);
+}
+
+void timer_wheel_node_init(timer_wheel_node_t* node, void* data) {
+  CHECK(node != NULL);
+
+  node->prev = NULL;
+  node->next = NULL;
+  node->deadline = 0;
+  node->data = data;
+  node->level = 0;
+  node->slot = 0;
+}
+
+void* timer_wheel_node_data(const timer_wheel_node_t* node) {
+  CHECK(node != NULL);
+  return node->data;
+}
+
+bool timer_wheel_node_is_linked(const timer_wheel_node_t* node) {
+  CHECK(node != NULL);
+  return node->next != NULL;
+}
+
+period_ms_t timer_wheel_node_deadline(const timer_wheel_node_t* node) {
+  CHECK(node != NULL);
+  return node->deadline;
+}
+
+bool timer_wheel_is_empty(const timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->length == 0;
+}
+
+size_t timer_wheel_length(const timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+  return wheel->length;
+}
+
+void timer_wheel_insert(timer_wheel_t* wheel, timer_wheel_node_t* node,
+                        period_ms_t deadline_ms) {
+  CHECK(wheel != NULL);
+  CHECK(node != NULL);
+
+  if (timer_wheel_node_is_linked(node)) timer_wheel_remove(wheel, node);
+
+  node->deadline = deadline_ms;
+  place(wheel, node);
+  wheel->length++;
+
+  // A new entry only displaces the cached front if it is strictly earlier;
+  // entries with equal deadlines keep their insertion order.
+  if (wheel->front != NULL &&
+      effective_deadline(wheel, node) <
+          effective_deadline(wheel, wheel->front)) {
+    wheel->front = node;
+  }
+}
+
+void timer_wheel_remove(timer_wheel_t* wheel, timer_wheel_node_t* node) {
+  CHECK(wheel != NULL);
+  CHECK(node != NULL);
+
+  if (!timer_wheel_node_is_linked(node)) return;
+
+  unplace(wheel, node);
+  wheel->length--;
+  if (wheel->front == node) wheel->front = NULL;
+}
+
+timer_wheel_node_t* timer_wheel_front(timer_wheel_t* wheel) {
+  CHECK(wheel != NULL);
+
+  if (wheel->length == 0) return NULL;
+  if (wheel->front == NULL) wheel->front = find_front(wheel);
+  return wheel->front;
+}
+
+void timer_wheel_advance(timer_wheel_t* wheel, period_ms_t now_ms) {
+  CHECK(wheel != NULL);
+
+  // Never move past a pending entry: every entry must stay at or ahead of the
+  // clock for the level invariant to hold.
+  timer_wheel_node_t* front = timer_wheel_front(wheel);
+  if (front != NULL && effective_deadline(wheel, front) < now_ms)
+    now_ms = effective_deadline(wheel, front);
+  if (now_ms <= wheel->clock) return;
+
+  period_ms_t old_clock = wheel->clock;
+  wheel->clock = now_ms;
+
+  int top_shift = LEVEL_BITS * LEVELS;
+  if ((old_clock >> top_shift) != (now_ms >> top_shift))
+    cascade(wheel, &wheel->overflow);
+
+  // Entries in the slot the clock just moved into now share a finer window
+  // with the clock and belong on a lower level. Work top-down so entries
+  // cascaded from above are themselves cascaded further if needed.
+  for (int level = LEVELS - 1; level > 0; --level) {
+    int shift = LEVEL_BITS * level;
+    if ((old_clock >> shift) == (now_ms >> shift)) continue;
+
+    uint8_t slot = (now_ms >> shift) & SLOT_MASK;
+    if (!(wheel->occupied[level] & (1ULL << slot))) continue;
+
+    wheel->occupied[level] &= ~(1ULL << slot);
+    cascade(wheel, &wheel->slots[level][slot]);
+  }
+}
+
+void timer_wheel_foreach(const timer_wheel_t* wheel,
+                         timer_wheel_iter_cb callback, void* context) {
+  CHECK(wheel != NULL);
+  CHECK(callback != NULL);
+
+  for (int level = 0; level < LEVELS; ++level) {
+    for (int slot = 0; slot < SLOTS; ++slot) {
+      const timer_wheel_node_t* head = &wheel->slots[level][slot];
+      for (timer_wheel_node_t* node = head->next; node != head;) {
+        timer_wheel_node_t* next = node->next;
+        if (!callback(node->data, context)) return;
+        node = next;
+      }
+    }
+  }
+
+  const timer_wheel_node_t* head = &wheel->overflow;
+  for (timer_wheel_node_t* node = head->next; node != head;) {
+    timer_wheel_node_t* next = node->next;
+    if (!callback(node->data, context)) return;
+    node = next;
+  }
+}
@@ -173,3 +173,100 @@ TEST_F(ConfigTest, config_save_basic) {
   std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
   EXPECT_TRUE(config_save(*config, CONFIG_FILE));
 }
+
+TEST_F(ConfigTest, config_save_keeps_order) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  config_set_string(config.get(), "B", "second", "2");
+  config_set_string(config.get(), "A", "first", "1");
+  config_set_string(config.get(), "B", "first", "1");
+  config_set_string(config.get(), "A", "second", "2");
+  config_set_string(config.get(), "B", "second", "3");
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+
+  FILE* fp = fopen(CONFIG_FILE, "rt");
+  ASSERT_TRUE(fp != NULL);
+  char content[256] = {0};
+  fread(content, 1, sizeof(content) - 1, fp);
+  fclose(fp);
+
+  EXPECT_STREQ(content,
+               "[B]\nsecond = 3\nfirst = 1\n\n[A]\nfirst = 1\nsecond = 2\n\n");
+}
+
+TEST_F(ConfigTest, config_many_sections) {
+  std::unique_ptr<config_t> config = config_new_empty();
+  for (int i = 0; i < 1000; i++) {
+    std::string section = "section" + std::to_string(i);
+    config_set_int(config.get(), section, "key", i);
+    config_set_int(config.get(), section, "other_key", -i);
+  }
+
+  for (int i = 0; i < 1000; i += 2)
+    EXPECT_TRUE(config_remove_section(config.get(),
+                                      "section" + std::to_string(i)));
+
+  for (int i = 0; i < 1000; i++) {
+    std::string section = "section" + std::to_string(i);
+    EXPECT_EQ(config_has_section(*config, section), i % 2 == 1);
+    EXPECT_EQ(config_get_int(*config, section, "other_key", 1),
+              i % 2 == 1 ? -i : 1);
+  }
+  EXPECT_EQ(config->sections.size(), 500U);
+}
+
+TEST_F(ConfigTest, config_clone_is_independent) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  std::unique_ptr<config_t> clone = config_new_clone(*config);
+
+  EXPECT_TRUE(config_remove_section(clone.get(), "DID"));
+  config_set_string(clone.get(), "New", "key", "value");
+
+  EXPECT_TRUE(config_has_section(*config, "DID"));
+  EXPECT_FALSE(config_has_section(*config, "New"));
+  EXPECT_FALSE(config_has_section(*clone, "DID"));
+  EXPECT_TRUE(config_has_key(*clone, "New", "key"));
+  EXPECT_EQ(config_get_int(*clone, CONFIG_DEFAULT_SECTION, "first_key", 5), 5);
+}
+
+TEST_F(ConfigTest, config_dirty) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  EXPECT_FALSE(config_is_dirty(*config));
+
+  // Writing back an unchanged value is not a modification.
+  config_set_string(config.get(), "DID", "version", "0x1436");
+  EXPECT_FALSE(config_is_dirty(*config));
+  EXPECT_FALSE(config_remove_key(config.get(), "DID", "missing"));
+  EXPECT_FALSE(config_is_dirty(*config));
+
+  config_set_int(config.get(), "DID", "version", 0x1437);
+  EXPECT_TRUE(config_is_dirty(*config));
+  config_clear_dirty(config.get());
+  EXPECT_FALSE(config_is_dirty(*config));
+
+  EXPECT_TRUE(config_remove_key(config.get(), "DID", "version"));
+  EXPECT_TRUE(config_is_dirty(*config));
+  config_clear_dirty(config.get());
+
+  EXPECT_TRUE(config_remove_section(config.get(), "DID"));
+  EXPECT_TRUE(config_is_dirty(*config));
+  config_clear_dirty(config.get());
+
+  config_set_dirty(config.get());
+  EXPECT_TRUE(config_is_dirty(*config));
+}
+
+TEST_F(ConfigTest, config_save_after_modification) {
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+
+  // Only the modified section needs to be serialized again, but the saved
+  // file must reflect every change.
+  config_set_int(config.get(), "DID", "version", 0x2000);
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+
+  std::unique_ptr<config_t> loaded = config_new(CONFIG_FILE);
+  ASSERT_TRUE(loaded.get() != NULL);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "version", 0), 0x2000);
+  EXPECT_EQ(config_get_int(*loaded, "DID", "productId", 0), 0x1200);
+  EXPECT_TRUE(config_has_key(*loaded, CONFIG_DEFAULT_SECTION, "first_key"));
+}
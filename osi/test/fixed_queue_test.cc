@@ -348,3 +348,96 @@ TEST_F(FixedQueueTest, test_fixed_queue_register_dequeue) {
   thread_free(worker_thread);
   fixed_queue_free(queue, NULL);
 }
+
+TEST_F(FixedQueueTest, test_fixed_queue_mpsc_enqueue_dequeue) {
+  // Capacity is rounded up to a power of two.
+  fixed_queue_t* queue = fixed_queue_new_mpsc(TEST_QUEUE_SIZE);
+  ASSERT_TRUE(queue != NULL);
+  EXPECT_EQ(16U, fixed_queue_capacity(queue));
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+  EXPECT_TRUE(fixed_queue_try_dequeue(queue) == NULL);
+  EXPECT_TRUE(fixed_queue_try_peek_first(queue) == NULL);
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING1);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING2);
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING3);
+  EXPECT_EQ(3U, fixed_queue_length(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_try_peek_first(queue));
+
+  EXPECT_EQ(DUMMY_DATA_STRING1, fixed_queue_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING2, fixed_queue_try_dequeue(queue));
+  EXPECT_EQ(DUMMY_DATA_STRING3, fixed_queue_dequeue(queue));
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  // Fill the queue up, and make sure try_enqueue fails once it is full
+  for (size_t i = 0; i < fixed_queue_capacity(queue); i++)
+    EXPECT_TRUE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  EXPECT_FALSE(fixed_queue_try_enqueue(queue, (void*)DUMMY_DATA_STRING));
+  EXPECT_EQ(fixed_queue_capacity(queue), fixed_queue_length(queue));
+
+  test_queue_entry_free_counter = 0;
+  fixed_queue_flush(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(16, test_queue_entry_free_counter);
+  EXPECT_TRUE(fixed_queue_is_empty(queue));
+
+  fixed_queue_enqueue(queue, (void*)DUMMY_DATA_STRING);
+  test_queue_entry_free_counter = 0;
+  fixed_queue_free(queue, test_queue_entry_free_cb);
+  EXPECT_EQ(1, test_queue_entry_free_counter);
+}
+
+static const int MPSC_PRODUCERS = 4;
+static const int MPSC_ITEMS_PER_PRODUCER = 10000;
+static fixed_queue_t* mpsc_queue;
+static int mpsc_received;
+static int mpsc_last_seen[MPSC_PRODUCERS];
+static bool mpsc_in_order;
+
+static void mpsc_producer(void* context) {
+  int producer = PTR_TO_INT(context);
+  for (int i = 0; i < MPSC_ITEMS_PER_PRODUCER; i++) {
+    // Encode the producer and sequence number; never enqueue NULL.
+    int value = (producer * MPSC_ITEMS_PER_PRODUCER + i) + 1;
+    fixed_queue_enqueue(mpsc_queue, INT_TO_PTR(value));
+  }
+}
+
+static void mpsc_ready(fixed_queue_t* queue, UNUSED_ATTR void* context) {
+  int value = PTR_TO_INT(fixed_queue_try_dequeue(queue)) - 1;
+  int producer = value / MPSC_ITEMS_PER_PRODUCER;
+  int sequence = value % MPSC_ITEMS_PER_PRODUCER;
+  if (sequence != mpsc_last_seen[producer] + 1) mpsc_in_order = false;
+  mpsc_last_seen[producer] = sequence;
+
+  if (++mpsc_received == MPSC_PRODUCERS * MPSC_ITEMS_PER_PRODUCER)
+    future_ready(received_message_future, FUTURE_SUCCESS);
+}
+
+TEST_F(FixedQueueTest, test_fixed_queue_mpsc_multiple_producers) {
+  // A small queue makes sure producers block and get woken up again.
+  mpsc_queue = fixed_queue_new_mpsc(8);
+  ASSERT_TRUE(mpsc_queue != NULL);
+  mpsc_received = 0;
+  mpsc_in_order = true;
+  for (int i = 0; i < MPSC_PRODUCERS; i++) mpsc_last_seen[i] = -1;
+
+  received_message_future = future_new();
+  thread_t* consumer = thread_new("test_fixed_queue_mpsc_consumer");
+  fixed_queue_register_dequeue(mpsc_queue, thread_get_reactor(consumer),
+                               mpsc_ready, NULL);
+
+  thread_t* producers[MPSC_PRODUCERS];
+  for (int i = 0; i < MPSC_PRODUCERS; i++) {
+    producers[i] = thread_new("test_fixed_queue_mpsc_producer");
+    thread_post(producers[i], mpsc_producer, INT_TO_PTR(i));
+  }
+
+  EXPECT_EQ(FUTURE_SUCCESS, future_await(received_message_future));
+  EXPECT_TRUE(mpsc_in_order);
+  EXPECT_TRUE(fixed_queue_is_empty(mpsc_queue));
+
+  for (int i = 0; i < MPSC_PRODUCERS; i++) thread_free(producers[i]);
+  fixed_queue_unregister_dequeue(mpsc_queue);
+  thread_free(consumer);
+  fixed_queue_free(mpsc_queue, NULL);
+}
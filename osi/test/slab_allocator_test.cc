@@ -0,0 +1,120 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/allocator.h"
+#include "osi/include/slab_allocator.h"
+
+class SlabAllocatorTest : public AllocationTestHarness {};
+
+TEST_F(SlabAllocatorTest, test_alloc_free_simple) {
+  void* block = slab_allocator_alloc(100);
+  ASSERT_TRUE(block != NULL);
+  EXPECT_TRUE(slab_allocator_owns(block));
+  memset(block, 0x42, 100);
+  slab_allocator_free(block);
+}
+
+TEST_F(SlabAllocatorTest, test_oversized_returns_null) {
+  EXPECT_TRUE(slab_allocator_alloc(64 * 1024) == NULL);
+}
+
+TEST_F(SlabAllocatorTest, test_does_not_own_heap) {
+  void* ptr = malloc(64);
+  EXPECT_FALSE(slab_allocator_owns(ptr));
+  EXPECT_FALSE(slab_allocator_owns(NULL));
+  free(ptr);
+}
+
+TEST_F(SlabAllocatorTest, test_blocks_do_not_overlap) {
+  const size_t sizes[] = {1, 32, 33, 200, 660, 1021, 2048, 4096 + 16};
+  std::vector<std::pair<uint8_t*, size_t>> blocks;
+
+  for (size_t size : sizes) {
+    for (int i = 0; i < 100; i++) {
+      uint8_t* block = static_cast<uint8_t*>(slab_allocator_alloc(size));
+      ASSERT_TRUE(block != NULL);
+      memset(block, (int)blocks.size(), size);
+      blocks.emplace_back(block, size);
+    }
+  }
+
+  for (size_t i = 0; i < blocks.size(); i++) {
+    for (size_t j = 0; j < blocks[i].second; j++)
+      ASSERT_EQ(blocks[i].first[j], (uint8_t)i);
+    slab_allocator_free(blocks[i].first);
+  }
+}
+
+TEST_F(SlabAllocatorTest, test_freed_blocks_are_reused) {
+  std::set<void*> first_round;
+  for (int i = 0; i < 8; i++) {
+    void* block = slab_allocator_alloc(256);
+    first_round.insert(block);
+  }
+  for (void* block : first_round) slab_allocator_free(block);
+
+  for (int i = 0; i < 8; i++) {
+    void* block = slab_allocator_alloc(256);
+    EXPECT_TRUE(first_round.count(block) == 1);
+  }
+  for (void* block : first_round) slab_allocator_free(block);
+}
+
+TEST_F(SlabAllocatorTest, test_osi_pool_malloc) {
+  void* ptr = osi_pool_malloc(660);
+  ASSERT_TRUE(ptr != NULL);
+  memset(ptr, 0, 660);
+  osi_free(ptr);
+
+  // Sizes without a size class fall back to the heap.
+  ptr = osi_pool_malloc(64 * 1024);
+  ASSERT_TRUE(ptr != NULL);
+  EXPECT_FALSE(slab_allocator_owns(ptr));
+  osi_free(ptr);
+}
+
+// Allocates on one thread and frees on another, as the HCI layer does with
+// inbound and outbound packets.
+TEST_F(SlabAllocatorTest, test_cross_thread_free) {
+  const size_t kBlocks = 20000;
+  std::vector<void*> blocks(kBlocks);
+
+  for (int round = 0; round < 4; round++) {
+    std::thread producer([&blocks]() {
+      for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i] = osi_pool_malloc(i % 1100);
+        memset(blocks[i], 0x5a, i % 1100);
+      }
+    });
+    producer.join();
+
+    std::thread consumer([&blocks]() {
+      for (void* block : blocks) osi_free(block);
+    });
+    consumer.join();
+  }
+}
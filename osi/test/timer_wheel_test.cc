@@ -0,0 +1,216 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+#include "AllocationTestHarness.h"
+
+#include "osi/include/osi.h"
+#include "osi/include/timer_wheel.h"
+
+class TimerWheelTest : public AllocationTestHarness {};
+
+static bool count_cb(UNUSED_ATTR void* data, void* context) {
+  (*static_cast<size_t*>(context))++;
+  return true;
+}
+
+TEST_F(TimerWheelTest, test_new_free_simple) {
+  timer_wheel_t* wheel = timer_wheel_new(0);
+  ASSERT_TRUE(wheel != NULL);
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+  EXPECT_EQ(timer_wheel_length(wheel), 0U);
+  EXPECT_TRUE(timer_wheel_front(wheel) == NULL);
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_free_null) { timer_wheel_free(NULL); }
+
+TEST_F(TimerWheelTest, test_insert_remove) {
+  timer_wheel_t* wheel = timer_wheel_new(1000);
+  timer_wheel_node_t node;
+  int data;
+  timer_wheel_node_init(&node, &data);
+
+  EXPECT_FALSE(timer_wheel_node_is_linked(&node));
+  timer_wheel_insert(wheel, &node, 1500);
+  EXPECT_TRUE(timer_wheel_node_is_linked(&node));
+  EXPECT_EQ(timer_wheel_length(wheel), 1U);
+  EXPECT_EQ(timer_wheel_front(wheel), &node);
+  EXPECT_EQ(timer_wheel_node_data(&node), &data);
+  EXPECT_EQ(timer_wheel_node_deadline(&node), 1500U);
+
+  timer_wheel_remove(wheel, &node);
+  EXPECT_FALSE(timer_wheel_node_is_linked(&node));
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+
+  // Removing an unlinked node is a no-op.
+  timer_wheel_remove(wheel, &node);
+  EXPECT_TRUE(timer_wheel_is_empty(wheel));
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_reinsert_moves_node) {
+  timer_wheel_t* wheel = timer_wheel_new(0);
+  timer_wheel_node_t a, b;
+  timer_wheel_node_init(&a, NULL);
+  timer_wheel_node_init(&b, NULL);
+
+  timer_wheel_insert(wheel, &a, 100);
+  timer_wheel_insert(wheel, &b, 200);
+  EXPECT_EQ(timer_wheel_front(wheel), &a);
+
+  timer_wheel_insert(wheel, &a, 300);
+  EXPECT_EQ(timer_wheel_length(wheel), 2U);
+  EXPECT_EQ(timer_wheel_front(wheel), &b);
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_equal_deadlines_keep_insertion_order) {
+  timer_wheel_t* wheel = timer_wheel_new(0);
+  timer_wheel_node_t nodes[16];
+
+  // Far enough out to land on a coarse level and get cascaded.
+  for (size_t i = 0; i < ARRAY_SIZE(nodes); ++i) {
+    timer_wheel_node_init(&nodes[i], INT_TO_PTR(i));
+    timer_wheel_insert(wheel, &nodes[i], 70000);
+  }
+
+  for (size_t i = 0; i < ARRAY_SIZE(nodes); ++i) {
+    timer_wheel_advance(wheel, 70000);
+    timer_wheel_node_t* front = timer_wheel_front(wheel);
+    ASSERT_TRUE(front != NULL);
+    EXPECT_EQ(PTR_TO_INT(timer_wheel_node_data(front)), (int)i);
+    timer_wheel_remove(wheel, front);
+  }
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_advance_does_not_pass_front) {
+  timer_wheel_t* wheel = timer_wheel_new(0);
+  timer_wheel_node_t a, b;
+  timer_wheel_node_init(&a, NULL);
+  timer_wheel_node_init(&b, NULL);
+
+  timer_wheel_insert(wheel, &a, 5000);
+  timer_wheel_insert(wheel, &b, 4000000);
+
+  // Advancing past |a| must not lose it.
+  timer_wheel_advance(wheel, 10000000);
+  EXPECT_EQ(timer_wheel_front(wheel), &a);
+  timer_wheel_remove(wheel, &a);
+
+  timer_wheel_advance(wheel, 10000000);
+  EXPECT_EQ(timer_wheel_front(wheel), &b);
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_past_deadline_is_due) {
+  timer_wheel_t* wheel = timer_wheel_new(1000);
+  timer_wheel_node_t a, b;
+  timer_wheel_node_init(&a, NULL);
+  timer_wheel_node_init(&b, NULL);
+
+  timer_wheel_insert(wheel, &a, 2000);
+  timer_wheel_insert(wheel, &b, 10);
+  EXPECT_EQ(timer_wheel_front(wheel), &b);
+
+  timer_wheel_free(wheel);
+}
+
+TEST_F(TimerWheelTest, test_foreach) {
+  timer_wheel_t* wheel = timer_wheel_new(0);
+  timer_wheel_node_t nodes[5];
+  const period_ms_t deadlines[] = {1, 100, 10000, 1000000, 1ULL << 40};
+
+  for (size_t i = 0; i < ARRAY_SIZE(nodes); ++i) {
+    timer_wheel_node_init(&nodes[i], &nodes[i]);
+    timer_wheel_insert(wheel, &nodes[i], deadlines[i]);
+  }
+
+  size_t count = 0;
+  timer_wheel_foreach(wheel, count_cb, &count);
+  EXPECT_EQ(count, ARRAY_SIZE(nodes));
+
+  timer_wheel_free(wheel);
+}
+
+// Drives the wheel with a random mix of inserts, cancels and expirations and
+// checks every expiration against a sorted reference container.
+TEST_F(TimerWheelTest, test_matches_sorted_reference) {
+  const size_t kNodes = 2000;
+  std::vector<timer_wheel_node_t> nodes(kNodes);
+  std::multimap<period_ms_t, size_t> reference;
+  std::vector<std::multimap<period_ms_t, size_t>::iterator> positions(kNodes);
+  std::vector<bool> linked(kNodes, false);
+
+  period_ms_t now_ms = 123456;
+  timer_wheel_t* wheel = timer_wheel_new(now_ms);
+  for (size_t i = 0; i < kNodes; ++i)
+    timer_wheel_node_init(&nodes[i], INT_TO_PTR(i));
+
+  srand(42);
+  for (int step = 0; step < 200000; ++step) {
+    size_t i = rand() % kNodes;
+    switch (rand() % 4) {
+      case 0:
+      case 1: {
+        // Mostly short timeouts, with the occasional very long one.
+        period_ms_t delay = (rand() % 16 == 0)
+                                ? (period_ms_t)rand() * 1024
+                                : (period_ms_t)(rand() % 300000);
+        if (linked[i]) reference.erase(positions[i]);
+        timer_wheel_insert(wheel, &nodes[i], now_ms + delay);
+        positions[i] = reference.emplace(now_ms + delay, i);
+        linked[i] = true;
+        break;
+      }
+      case 2:
+        if (linked[i]) reference.erase(positions[i]);
+        timer_wheel_remove(wheel, &nodes[i]);
+        linked[i] = false;
+        break;
+      case 3: {
+        now_ms += rand() % 5000;
+        while (!reference.empty() && reference.begin()->first <= now_ms) {
+          timer_wheel_node_t* front = timer_wheel_front(wheel);
+          ASSERT_TRUE(front != NULL);
+          ASSERT_EQ(timer_wheel_node_deadline(front),
+                    reference.begin()->first);
+          size_t index = PTR_TO_INT(timer_wheel_node_data(front));
+          reference.erase(positions[index]);
+          linked[index] = false;
+          timer_wheel_remove(wheel, front);
+        }
+        timer_wheel_advance(wheel, now_ms);
+        break;
+      }
+    }
+    ASSERT_EQ(timer_wheel_length(wheel), reference.size());
+  }
+
+  timer_wheel_free(wheel);
+}
@@ -106,6 +106,7 @@ bool BTM_SecAddBleDevice(const RawAddress& bd_addr, BD_NAME bd_name,
   p_dev_rec->ble.ble_addr_type = addr_type;
 
   p_dev_rec->ble.pseudo_addr = bd_addr;
+  btm_dev_index_add(p_dev_rec);
   /* sync up with the Inq Data base*/
   tBTM_INQ_INFO* p_info = BTM_InqDbRead(bd_addr);
   if (p_info) {
@@ -1897,6 +1898,7 @@ void btm_ble_connected(const RawAddress& bda, uint16_t handle, uint8_t enc_mode,
   p_dev_rec->ble.ble_addr_type = addr_type;
   /* update pseudo address */
   p_dev_rec->ble.pseudo_addr = bda;
+  btm_dev_index_add(p_dev_rec);
 
   p_dev_rec->role_master = false;
   if (role == HCI_ROLE_MASTER) p_dev_rec->role_master = true;
@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unordered_map>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -37,6 +38,34 @@
 #include "hcimsgs.h"
 #include "l2c_api.h"
 
+struct DevRecAddressHash {
+  size_t operator()(const RawAddress& x) const {
+    const uint8_t* a = x.address;
+    return a[0] ^ (a[1] << 8) ^ (a[2] << 16) ^ (a[3] << 24) ^ a[4] ^
+           (a[5] << 8);
+  }
+};
+
+// Lookup indexes over |btm_cb.sec_dev_rec|, by address and by BR/EDR and LE
+// ACL handle. Record fields are updated throughout the stack, so an index
+// entry is only a hint: it is checked against the record before use, and
+// lookups that miss fall back to scanning the list and refresh the entry.
+// Entries are dropped when their record is removed.
+//
+// A record is found by its bd_addr or its pseudo address, so two records can
+// match the same address. The list scan returns the first of them, and an
+// address entry keeps pointing at the earliest matching record it knows of.
+static std::unordered_map<RawAddress, tBTM_SEC_DEV_REC*, DevRecAddressHash>
+    dev_rec_by_address;
+static std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> dev_rec_by_handle;
+static std::unordered_map<uint16_t, tBTM_SEC_DEV_REC*> dev_rec_by_ble_handle;
+
+static void btm_dev_index_add_address(const RawAddress& bd_addr,
+                                      tBTM_SEC_DEV_REC* p_dev_rec);
+static void btm_dev_index_remove(tBTM_SEC_DEV_REC* p_dev_rec);
+static bool btm_dev_rec_precedes(const tBTM_SEC_DEV_REC* p_first,
+                                 const tBTM_SEC_DEV_REC* p_second);
+
 /*******************************************************************************
  *
  * Function         BTM_SecAddDevice
@@ -73,6 +102,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 
     p_dev_rec->bd_addr = bd_addr;
     p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+    btm_dev_index_add_address(bd_addr, p_dev_rec);
 
     /* use default value for background connection params */
     /* update conn params, use default value for background connection params */
@@ -152,6 +182,7 @@ bool BTM_SecAddDevice(const RawAddress& bd_addr, DEV_CLASS dev_class,
 void wipe_secrets_and_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
   memset(p_dev_rec->link_key, 0, LINK_KEY_LEN);
   memset(&p_dev_rec->ble.keys, 0, sizeof(tBTM_SEC_BLE_KEYS));
+  btm_dev_index_remove(p_dev_rec);
   list_remove(btm_cb.sec_dev_rec, p_dev_rec);
 }
 
@@ -260,6 +291,7 @@ tBTM_SEC_DEV_REC* btm_sec_alloc_dev(const RawAddress& bd_addr) {
 
   p_dev_rec->ble_hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_LE);
   p_dev_rec->hci_handle = BTM_GetHCIConnHandle(bd_addr, BT_TRANSPORT_BR_EDR);
+  btm_dev_index_add(p_dev_rec);
 
   return (p_dev_rec);
 }
@@ -333,10 +365,26 @@ bool is_handle_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle) {
-  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  auto it = dev_rec_by_handle.find(handle);
+  if (it != dev_rec_by_handle.end() && it->second->hci_handle == handle)
+    return it->second;
+
+  it = dev_rec_by_ble_handle.find(handle);
+  if (it != dev_rec_by_ble_handle.end() &&
+      it->second->ble_hci_handle == handle)
+    return it->second;
 
-  return NULL;
+  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handle);
+  if (!n) return NULL;
+
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (handle != BTM_SEC_INVALID_HANDLE) {
+    if (p_dev_rec->hci_handle == handle)
+      dev_rec_by_handle[handle] = p_dev_rec;
+    else
+      dev_rec_by_ble_handle[handle] = p_dev_rec;
+  }
+  return p_dev_rec;
 }
 
 bool is_address_equal(void* data, void* context) {
@@ -362,11 +410,20 @@ bool is_address_equal(void* data, void* context) {
  *
  ******************************************************************************/
 tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) {
+  auto it = dev_rec_by_address.find(bd_addr);
+  if (it != dev_rec_by_address.end()) {
+    // Resolving the address can set the pseudo address, and reindex
+    tBTM_SEC_DEV_REC* p_dev_rec = it->second;
+    if (!is_address_equal(p_dev_rec, (void*)&bd_addr)) return p_dev_rec;
+  }
+
   list_node_t* n =
       list_foreach(btm_cb.sec_dev_rec, is_address_equal, (void*)&bd_addr);
-  if (n) return static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  if (!n) return NULL;
 
-  return NULL;
+  tBTM_SEC_DEV_REC* p_dev_rec = static_cast<tBTM_SEC_DEV_REC*>(list_node(n));
+  btm_dev_index_add_address(bd_addr, p_dev_rec);
+  return p_dev_rec;
 }
 
 /*******************************************************************************
@@ -425,6 +482,16 @@ void btm_consolidate_dev(tBTM_SEC_DEV_REC* p_target_rec) {
       }
     }
   }
+
+  // The target may now resolve addresses indexed to records after it, and may
+  // have taken over the handles of the removed records.
+  for (auto it = dev_rec_by_address.begin(); it != dev_rec_by_address.end();) {
+    if (it->second != p_target_rec && BTM_BLE_IS_RESOLVE_BDA(it->first))
+      it = dev_rec_by_address.erase(it);
+    else
+      it++;
+  }
+  btm_dev_index_add(p_target_rec);
 }
 
 /*******************************************************************************
@@ -563,3 +630,99 @@ bool btm_set_bond_type_dev(const RawAddress& bd_addr,
   p_dev_rec->bond_type = bond_type;
   return true;
 }
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_index_add
+ *
+ * Description      Add the addresses and ACL handles of a device record to the
+ *                  lookup indexes. Called again whenever the bd_addr or
+ *                  pseudo address of the record changes.
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+void btm_dev_index_add(tBTM_SEC_DEV_REC* p_dev_rec) {
+  btm_dev_index_add_address(p_dev_rec->bd_addr, p_dev_rec);
+  if (!p_dev_rec->ble.pseudo_addr.IsEmpty())
+    btm_dev_index_add_address(p_dev_rec->ble.pseudo_addr, p_dev_rec);
+  if (p_dev_rec->hci_handle != BTM_SEC_INVALID_HANDLE)
+    dev_rec_by_handle[p_dev_rec->hci_handle] = p_dev_rec;
+  if (p_dev_rec->ble_hci_handle != BTM_SEC_INVALID_HANDLE)
+    dev_rec_by_ble_handle[p_dev_rec->ble_hci_handle] = p_dev_rec;
+}
+
+static void btm_dev_index_add_address(const RawAddress& bd_addr,
+                                      tBTM_SEC_DEV_REC* p_dev_rec) {
+  auto it = dev_rec_by_address.find(bd_addr);
+  if (it != dev_rec_by_address.end()) {
+    tBTM_SEC_DEV_REC* p_indexed = it->second;
+    if (p_indexed != p_dev_rec &&
+        !is_address_equal(p_indexed, (void*)&bd_addr) &&
+        btm_dev_rec_precedes(p_indexed, p_dev_rec))
+      return;
+  } else if (dev_rec_by_address.size() >= BTM_DEV_INDEX_MAX_ADDRESSES) {
+    dev_rec_by_address.clear();
+  }
+  dev_rec_by_address[bd_addr] = p_dev_rec;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_rec_precedes
+ *
+ * Description      Check whether |p_first| comes before |p_second| in
+ *                  btm_cb.sec_dev_rec, and so wins the list scan when both
+ *                  match an address
+ *
+ * Returns          true if |p_first| comes first
+ *
+ ******************************************************************************/
+static bool btm_dev_rec_precedes(const tBTM_SEC_DEV_REC* p_first,
+                                 const tBTM_SEC_DEV_REC* p_second) {
+  for (const list_node_t* node = list_begin(btm_cb.sec_dev_rec);
+       node != list_end(btm_cb.sec_dev_rec); node = list_next(node)) {
+    if (list_node(node) == p_first) return true;
+    if (list_node(node) == p_second) return false;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_index_num_addresses
+ *
+ * Description      Number of entries in the address lookup index
+ *
+ * Returns          The number of indexed addresses
+ *
+ ******************************************************************************/
+size_t btm_dev_index_num_addresses(void) { return dev_rec_by_address.size(); }
+
+/*******************************************************************************
+ *
+ * Function         btm_dev_index_remove
+ *
+ * Description      Drop all lookup index entries pointing to a device record
+ *                  that is about to be freed
+ *
+ * Returns          none
+ *
+ ******************************************************************************/
+static void btm_dev_index_remove(tBTM_SEC_DEV_REC* p_dev_rec) {
+  for (auto it = dev_rec_by_address.begin(); it != dev_rec_by_address.end();) {
+    if (it->second == p_dev_rec)
+      it = dev_rec_by_address.erase(it);
+    else
+      it++;
+  }
+
+  for (auto* index : {&dev_rec_by_handle, &dev_rec_by_ble_handle}) {
+    for (auto it = index->begin(); it != index->end();) {
+      if (it->second == p_dev_rec)
+        it = index->erase(it);
+      else
+        it++;
+    }
+  }
+}
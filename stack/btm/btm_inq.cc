@@ -53,6 +53,13 @@ using bluetooth::Uuid;
 #define BTM_INQ_DEBUG FALSE
 #endif
 
+static_assert(BTM_INQ_DB_SIZE < 0xFF,
+              "inq_db slot numbers plus one must fit in a uint8_t");
+static_assert((BTM_INQ_DB_INDEX_SIZE & (BTM_INQ_DB_INDEX_SIZE - 1)) == 0 &&
+                  BTM_INQ_DB_INDEX_SIZE >= 2 * BTM_INQ_DB_SIZE,
+              "inq_db index must be a power of two at least twice as large "
+              "as inq_db");
+
 /******************************************************************************/
 /*               L O C A L    D A T A    D E F I N I T I O N S                */
 /******************************************************************************/
@@ -116,6 +123,11 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq);
 static tBTM_STATUS btm_set_inq_event_filter(uint8_t filter_cond_type,
                                             tBTM_INQ_FILT_COND* p_filt_cond);
 static void btm_clr_inq_result_flt(void);
+static uint16_t btm_inq_db_bucket(const RawAddress& p_bda);
+static void btm_inq_db_index_remove(const RawAddress& p_bda);
+static void btm_inq_db_lru_unlink(uint16_t slot);
+static void btm_inq_db_lru_append(uint16_t slot);
+static void btm_inq_db_rebuild(const uint8_t* p_lru, uint16_t num_lru);
 
 static uint8_t btm_convert_uuid_to_eir_service(uint16_t uuid16);
 static void btm_set_eir_uuid(uint8_t* p_eir, tBTM_INQ_RESULTS* p_results);
@@ -1148,6 +1160,7 @@ void btm_inq_db_init(void) {
   btm_cb.btm_inq_vars.remote_name_timer =
       alarm_new("btm_inq.remote_name_timer");
   btm_cb.btm_inq_vars.no_inc_ssp = BTM_NO_SSP_ON_INQUIRY;
+  btm_clr_inq_db(NULL);
 }
 
 /*******************************************************************************
@@ -1220,13 +1233,12 @@ void btm_clr_inq_db(const RawAddress* p_bda) {
   BTM_TRACE_DEBUG("btm_clr_inq_db: inq_active:0x%x state:%d",
                   btm_cb.btm_inq_vars.inq_active, btm_cb.btm_inq_vars.state);
 #endif
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use) {
-      /* If this is the specified BD_ADDR or clearing all devices */
-      if (p_bda == NULL || (p_ent->inq_info.results.remote_bd_addr == *p_bda)) {
-        p_ent->in_use = false;
-      }
-    }
+  if (p_bda == NULL) {
+    for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) p_ent->in_use = false;
+    btm_inq_db_rebuild(NULL, 0);
+  } else {
+    p_ent = btm_inq_db_find(*p_bda);
+    if (p_ent) btm_inq_db_free(p_ent);
   }
 #if (BTM_INQ_DEBUG == TRUE)
   BTM_TRACE_DEBUG("inq_active:0x%x state:%d", btm_cb.btm_inq_vars.inq_active,
@@ -1248,8 +1260,17 @@ static void btm_clr_inq_result_flt(void) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
 
   osi_free_and_reset((void**)&p_inq->p_bd_db);
+  osi_free_and_reset((void**)&p_inq->p_bd_db_index);
   p_inq->num_bd_entries = 0;
   p_inq->max_bd_entries = 0;
+  p_inq->bd_db_index_size = 0;
+}
+
+/* Mixes the address bytes so that the low bits can be used as a bucket */
+static uint32_t btm_inq_addr_hash(const RawAddress& p_bda) {
+  uint64_t key = 0;
+  for (int i = 0; i < BD_ADDR_LEN; i++) key = (key << 8) | p_bda.address[i];
+  return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
 }
 
 /*******************************************************************************
@@ -1264,22 +1285,32 @@ static void btm_clr_inq_result_flt(void) {
  ******************************************************************************/
 bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
   tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
-  tINQ_BDADDR* p_db = &p_inq->p_bd_db[0];
-  uint16_t xx;
+  tINQ_BDADDR* p_db;
+  uint16_t mask = p_inq->bd_db_index_size - 1;
+  uint16_t bucket;
 
   /* Don't bother searching, database doesn't exist or periodic mode */
-  if ((p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) || !p_db)
+  if ((p_inq->inq_active & BTM_PERIODIC_INQUIRY_ACTIVE) || !p_inq->p_bd_db)
     return (false);
 
-  for (xx = 0; xx < p_inq->num_bd_entries; xx++, p_db++) {
-    if (p_db->bd_addr == p_bda && p_db->inq_count == p_inq->inq_counter)
-      return (true);
+  bucket = btm_inq_addr_hash(p_bda) & mask;
+  while (p_inq->p_bd_db_index[bucket] != 0) {
+    p_db = &p_inq->p_bd_db[p_inq->p_bd_db_index[bucket] - 1];
+    if (p_db->bd_addr == p_bda) {
+      if (p_db->inq_count == p_inq->inq_counter) return (true);
+
+      /* Seen in an earlier inquiry only, count it for this one */
+      p_db->inq_count = p_inq->inq_counter;
+      return (false);
+    }
+    bucket = (bucket + 1) & mask;
   }
 
-  if (xx < p_inq->max_bd_entries) {
+  if (p_inq->num_bd_entries < p_inq->max_bd_entries) {
+    p_db = &p_inq->p_bd_db[p_inq->num_bd_entries++];
     p_db->inq_count = p_inq->inq_counter;
     p_db->bd_addr = p_bda;
-    p_inq->num_bd_entries++;
+    p_inq->p_bd_db_index[bucket] = p_inq->num_bd_entries;
   }
 
   /* If here, New Entry */
@@ -1297,57 +1328,187 @@ bool btm_inq_find_bdaddr(const RawAddress& p_bda) {
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_find(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (p_ent->in_use && p_ent->inq_info.results.remote_bd_addr == p_bda)
-      return (p_ent);
-  }
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  uint8_t id = p_inq->inq_db_index[btm_inq_db_bucket(p_bda)];
 
   /* If here, not found */
-  return (NULL);
+  if (id == 0) return (NULL);
+
+  btm_inq_db_lru_unlink(id - 1);
+  btm_inq_db_lru_append(id - 1);
+  return (&p_inq->inq_db[id - 1]);
 }
 
 /*******************************************************************************
  *
  * Function         btm_inq_db_new
  *
- * Description      This function looks through the inquiry database for an
- *                  unused entry. If no entry is free, it allocates the oldest
- *                  entry.
+ * Description      This function takes an unused entry from the inquiry
+ *                  database. If no entry is free, it reuses the least recently
+ *                  used entry.
  *
  * Returns          pointer to entry
  *
  ******************************************************************************/
 tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda) {
-  uint16_t xx;
-  tINQ_DB_ENT* p_ent = btm_cb.btm_inq_vars.inq_db;
-  tINQ_DB_ENT* p_old = btm_cb.btm_inq_vars.inq_db;
-  uint32_t ot = 0xFFFFFFFF;
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  tINQ_DB_ENT* p_ent;
+  uint16_t slot;
 
-  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++, p_ent++) {
-    if (!p_ent->in_use) {
-      memset(p_ent, 0, sizeof(tINQ_DB_ENT));
-      p_ent->inq_info.results.remote_bd_addr = p_bda;
-      p_ent->in_use = true;
+  if (p_inq->inq_db_free_head != 0) {
+    slot = p_inq->inq_db_free_head - 1;
+    p_inq->inq_db_free_head = p_inq->inq_db_lru_next[slot];
+  } else {
+    /* If here, no free entry found. Reuse the least recently used. */
+    slot = p_inq->inq_db_lru_head - 1;
+    btm_inq_db_index_remove(
+        p_inq->inq_db[slot].inq_info.results.remote_bd_addr);
+    btm_inq_db_lru_unlink(slot);
+  }
 
-      return (p_ent);
-    }
+  p_ent = &p_inq->inq_db[slot];
+  memset(p_ent, 0, sizeof(tINQ_DB_ENT));
+  p_ent->inq_info.results.remote_bd_addr = p_bda;
+  p_ent->in_use = true;
+
+  p_inq->inq_db_index[btm_inq_db_bucket(p_bda)] = slot + 1;
+  btm_inq_db_lru_append(slot);
+  return (p_ent);
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_free
+ *
+ * Description      This function returns an in-use entry to the unused entries
+ *                  of the inquiry database.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void btm_inq_db_free(tINQ_DB_ENT* p_ent) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  uint16_t slot = (uint16_t)(p_ent - p_inq->inq_db);
+
+  if (!p_ent->in_use) return;
+
+  btm_inq_db_index_remove(p_ent->inq_info.results.remote_bd_addr);
+  btm_inq_db_lru_unlink(slot);
+  p_ent->in_use = false;
 
-    if (p_ent->time_of_resp < ot) {
-      p_old = p_ent;
-      ot = p_ent->time_of_resp;
+  p_inq->inq_db_lru_next[slot] = p_inq->inq_db_free_head;
+  p_inq->inq_db_free_head = slot + 1;
+}
+
+/* Returns the index bucket holding |p_bda|, or else the empty bucket that
+ * ends its probe sequence */
+static uint16_t btm_inq_db_bucket(const RawAddress& p_bda) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  uint16_t bucket = btm_inq_addr_hash(p_bda) & (BTM_INQ_DB_INDEX_SIZE - 1);
+  uint8_t id;
+
+  while ((id = p_inq->inq_db_index[bucket]) != 0) {
+    if (p_inq->inq_db[id - 1].inq_info.results.remote_bd_addr == p_bda) break;
+    bucket = (bucket + 1) & (BTM_INQ_DB_INDEX_SIZE - 1);
+  }
+  return bucket;
+}
+
+/* Removes |p_bda| from the index, shifting back the entries that probed past
+ * its bucket so that no probe sequence is broken */
+static void btm_inq_db_index_remove(const RawAddress& p_bda) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  uint16_t mask = BTM_INQ_DB_INDEX_SIZE - 1;
+  uint16_t hole = btm_inq_db_bucket(p_bda);
+  uint16_t next, home;
+  uint8_t id;
+
+  if (p_inq->inq_db_index[hole] == 0) return;
+
+  for (next = (hole + 1) & mask; (id = p_inq->inq_db_index[next]) != 0;
+       next = (next + 1) & mask) {
+    home = btm_inq_addr_hash(
+               p_inq->inq_db[id - 1].inq_info.results.remote_bd_addr) &
+           mask;
+    /* Move the entry only if the hole lies between its home and its bucket */
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      p_inq->inq_db_index[hole] = id;
+      hole = next;
     }
   }
+  p_inq->inq_db_index[hole] = 0;
+}
 
-  /* If here, no free entry found. Return the oldest. */
+static void btm_inq_db_lru_unlink(uint16_t slot) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  uint8_t prev = p_inq->inq_db_lru_prev[slot];
+  uint8_t next = p_inq->inq_db_lru_next[slot];
 
-  memset(p_old, 0, sizeof(tINQ_DB_ENT));
-  p_old->inq_info.results.remote_bd_addr = p_bda;
-  p_old->in_use = true;
+  if (prev)
+    p_inq->inq_db_lru_next[prev - 1] = next;
+  else
+    p_inq->inq_db_lru_head = next;
+
+  if (next)
+    p_inq->inq_db_lru_prev[next - 1] = prev;
+  else
+    p_inq->inq_db_lru_tail = prev;
 
-  return (p_old);
+  p_inq->inq_db_lru_prev[slot] = 0;
+  p_inq->inq_db_lru_next[slot] = 0;
+}
+
+static void btm_inq_db_lru_append(uint16_t slot) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+
+  p_inq->inq_db_lru_prev[slot] = p_inq->inq_db_lru_tail;
+  p_inq->inq_db_lru_next[slot] = 0;
+  if (p_inq->inq_db_lru_tail)
+    p_inq->inq_db_lru_next[p_inq->inq_db_lru_tail - 1] = slot + 1;
+  else
+    p_inq->inq_db_lru_head = slot + 1;
+  p_inq->inq_db_lru_tail = slot + 1;
+}
+
+/*******************************************************************************
+ *
+ * Function         btm_inq_db_rebuild
+ *
+ * Description      This function rebuilds the address index, the LRU list and
+ *                  the unused list after entries of the inquiry database have
+ *                  been moved or cleared.
+ *
+ * Parameters       p_lru - slots of the in-use entries, least recently used
+ *                          first
+ *                  num_lru - number of slots in p_lru
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void btm_inq_db_rebuild(const uint8_t* p_lru, uint16_t num_lru) {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  uint16_t xx;
+
+  memset(p_inq->inq_db_index, 0, sizeof(p_inq->inq_db_index));
+  memset(p_inq->inq_db_lru_prev, 0, sizeof(p_inq->inq_db_lru_prev));
+  memset(p_inq->inq_db_lru_next, 0, sizeof(p_inq->inq_db_lru_next));
+  p_inq->inq_db_lru_head = 0;
+  p_inq->inq_db_lru_tail = 0;
+  p_inq->inq_db_free_head = 0;
+
+  for (xx = 0; xx < num_lru; xx++) {
+    tINQ_DB_ENT* p_ent = &p_inq->inq_db[p_lru[xx]];
+    p_inq->inq_db_index[btm_inq_db_bucket(
+        p_ent->inq_info.results.remote_bd_addr)] = p_lru[xx] + 1;
+    btm_inq_db_lru_append(p_lru[xx]);
+  }
+
+  /* Hand out the unused entries lowest slot first */
+  for (xx = BTM_INQ_DB_SIZE; xx > 0; xx--) {
+    if (p_inq->inq_db[xx - 1].in_use) continue;
+    p_inq->inq_db_lru_next[xx - 1] = p_inq->inq_db_free_head;
+    p_inq->inq_db_free_head = xx;
+  }
 }
 
 /*******************************************************************************
@@ -1583,6 +1744,13 @@ static void btm_initiate_inquiry(tBTM_INQUIRY_VAR_ST* p_inq) {
     p_inq->max_bd_entries =
         (uint16_t)(BT_DEFAULT_BUFFER_SIZE / sizeof(tINQ_BDADDR));
 
+    /* Index them with at most half of the buckets in use */
+    p_inq->bd_db_index_size = 1;
+    while (p_inq->bd_db_index_size < 2 * p_inq->max_bd_entries)
+      p_inq->bd_db_index_size <<= 1;
+    p_inq->p_bd_db_index = (uint16_t*)osi_calloc(p_inq->bd_db_index_size *
+                                                 sizeof(uint16_t));
+
     btsnd_hcic_inquiry(*lap, p_inqparms->duration, 0);
   }
 }
@@ -1806,11 +1974,18 @@ void btm_sort_inq_result(void) {
   tINQ_DB_ENT* p_next = btm_cb.btm_inq_vars.inq_db + 1;
   int size;
   tINQ_DB_ENT* p_tmp = (tINQ_DB_ENT*)osi_malloc(sizeof(tINQ_DB_ENT));
+  uint8_t moved_from[BTM_INQ_DB_SIZE]; /* Original slot of each entry */
+  uint8_t moved_to[BTM_INQ_DB_SIZE];   /* New slot of each original slot */
+  uint8_t lru[BTM_INQ_DB_SIZE];
+  uint16_t num_lru = 0;
+  uint8_t id, tmp;
 
   num_resp = (btm_cb.btm_inq_vars.inq_cmpl_info.num_resp < BTM_INQ_DB_SIZE)
                  ? btm_cb.btm_inq_vars.inq_cmpl_info.num_resp
                  : BTM_INQ_DB_SIZE;
 
+  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++) moved_from[xx] = xx;
+
   size = sizeof(tINQ_DB_ENT);
   for (xx = 0; xx < num_resp - 1; xx++, p_ent++) {
     for (yy = xx + 1, p_next = p_ent + 1; yy < num_resp; yy++, p_next++) {
@@ -1818,11 +1993,21 @@ void btm_sort_inq_result(void) {
         memcpy(p_tmp, p_next, size);
         memcpy(p_next, p_ent, size);
         memcpy(p_ent, p_tmp, size);
+        tmp = moved_from[yy];
+        moved_from[yy] = moved_from[xx];
+        moved_from[xx] = tmp;
       }
     }
   }
 
   osi_free(p_tmp);
+
+  /* Entries have moved, so re-point the index and keep the LRU order */
+  for (xx = 0; xx < BTM_INQ_DB_SIZE; xx++) moved_to[moved_from[xx]] = xx;
+  for (id = btm_cb.btm_inq_vars.inq_db_lru_head; id != 0;
+       id = btm_cb.btm_inq_vars.inq_db_lru_next[id - 1])
+    lru[num_lru++] = moved_to[id - 1];
+  btm_inq_db_rebuild(lru, num_lru);
 }
 
 /*******************************************************************************
@@ -66,6 +66,7 @@ extern void btm_clr_inq_db(const RawAddress* p_bda);
 extern void btm_inq_db_init(void);
 extern void btm_process_inq_results(uint8_t* p, uint8_t inq_res_mode);
 extern void btm_process_inq_complete(uint8_t status, uint8_t mode);
+extern void btm_sort_inq_result(void);
 extern void btm_process_cancel_complete(uint8_t status, uint8_t mode);
 extern void btm_event_filter_complete(uint8_t* p);
 extern void btm_inq_stop_on_ssp(void);
@@ -215,6 +216,13 @@ extern tBTM_SEC_DEV_REC* btm_find_dev_by_handle(uint16_t handle);
 extern tBTM_BOND_TYPE btm_get_bond_type_dev(const RawAddress& bd_addr);
 extern bool btm_set_bond_type_dev(const RawAddress& bd_addr,
                                   tBTM_BOND_TYPE bond_type);
+extern void btm_dev_index_add(tBTM_SEC_DEV_REC* p_dev_rec);
+extern size_t btm_dev_index_num_addresses(void);
+
+/* Resolvable private addresses rotate, so entries for them pile up in the
+ * address index behind btm_find_dev(). It starts over once it grows past
+ * this. */
+#define BTM_DEV_INDEX_MAX_ADDRESSES (4 * BTM_SEC_MAX_DEVICE_RECORDS)
 
 /* Internal functions provided by btm_sec.cc
  *********************************************
@@ -280,6 +288,7 @@ extern bool btm_ble_start_sec_check(const RawAddress& bd_addr, uint16_t psm,
                                     void* p_ref_data);
 
 extern tINQ_DB_ENT* btm_inq_db_new(const RawAddress& p_bda);
+extern void btm_inq_db_free(tINQ_DB_ENT* p_ent);
 
 extern void btm_rem_oob_req(uint8_t* p);
 extern void btm_read_local_oob_complete(uint8_t* p);
@@ -263,7 +263,20 @@ typedef struct {
   tINQ_BDADDR* p_bd_db;    /* Pointer to memory that holds bdaddrs */
   uint16_t num_bd_entries; /* Number of entries in database */
   uint16_t max_bd_entries; /* Maximum number of entries that can be stored */
+  uint16_t* p_bd_db_index; /* Open-addressing index over p_bd_db by bdaddr */
+  uint16_t bd_db_index_size; /* Number of buckets in p_bd_db_index */
   tINQ_DB_ENT inq_db[BTM_INQ_DB_SIZE];
+  /* Open-addressing index over inq_db by bdaddr. Buckets hold an inq_db slot
+   * number plus one, or 0 when empty. */
+  uint8_t inq_db_index[BTM_INQ_DB_INDEX_SIZE];
+  /* In-use inq_db entries from least to most recently used, as a doubly
+   * linked list of slot numbers plus one (0 ends the list) */
+  uint8_t inq_db_lru_head;
+  uint8_t inq_db_lru_tail;
+  uint8_t inq_db_lru_prev[BTM_INQ_DB_SIZE];
+  uint8_t inq_db_lru_next[BTM_INQ_DB_SIZE];
+  /* Unused inq_db entries, chained through inq_db_lru_next */
+  uint8_t inq_db_free_head;
   tBTM_INQ_PARMS inqparms; /* Contains the parameters for the current inquiry */
   tBTM_INQUIRY_CMPL
       inq_cmpl_info; /* Status and number of responses from the last inquiry */
@@ -87,6 +87,8 @@ void btu_init_core(void) {
  *****************************************************************************/
 void btu_free_core(void) {
   /* Free the mandatory core stack components */
+  SMP_Free();
+
   gatt_free();
 
   l2c_free();
@@ -284,6 +284,7 @@ uint16_t GATTS_AddService(tGATT_IF gatt_if, btgatt_db_element_t* service,
   elem.app_uuid = list.asgn_range.app_uuid128;
   elem.type = list.asgn_range.is_primary ? GATT_UUID_PRI_SERVICE
                                          : GATT_UUID_SEC_SERVICE;
+  gatt_sr_add_hdl_index(rit);
 
   if (elem.type == GATT_UUID_PRI_SERVICE) {
     Uuid* p_uuid = gatts_get_service_uuid(elem.p_db);
@@ -389,6 +390,7 @@ void GATTS_StopService(uint16_t service_handle) {
     SDP_DeleteRecord(it->sdp_handle);
   }
 
+  gatt_sr_remove_hdl_index(it);
   gatt_cb.srv_list_info->erase(it);
   gatt_update_last_srv_info();
 }
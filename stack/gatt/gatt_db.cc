@@ -410,14 +410,18 @@ uint16_t gatts_add_char_descr(tGATT_SVC_DB& db, tGATT_PERM perm,
 /* Service Attribute Database Query Utility Functions */
 /******************************************************************************/
 tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle) {
-  if (!p_db) return nullptr;
+  if (!p_db || p_db->attr_list.empty()) return nullptr;
 
-  for (auto& attr : p_db->attr_list) {
-    if (attr.handle == handle) return &attr;
-    if (attr.handle > handle) return nullptr;
-  }
+  /* allocate_attr_in_db() hands out consecutive handles, so attr_list is
+   * indexed by the handle offset from the service declaration */
+  uint16_t first_handle = p_db->attr_list.front().handle;
+  if (handle < first_handle) return nullptr;
+
+  size_t index = handle - first_handle;
+  if (index >= p_db->attr_list.size()) return nullptr;
 
-  return nullptr;
+  tGATT_ATTR& attr = p_db->attr_list[index];
+  return attr.handle == handle ? &attr : nullptr;
 }
 
 /*******************************************************************************
@@ -263,6 +263,14 @@ typedef struct {
   bool is_primary;
 } tGATT_SRV_LIST_ELEM;
 
+/* Handle range of a started service, kept sorted by s_hdl so that the service
+ * owning a handle is found with a binary search */
+typedef struct {
+  uint16_t s_hdl;
+  uint16_t e_hdl;
+  std::list<tGATT_SRV_LIST_ELEM>::iterator it;
+} tGATT_SRV_HDL_RANGE;
+
 typedef struct {
   std::queue<tGATT_CLCB*> pending_enc_clcb; /* pending encryption channel q */
   tGATT_SEC_ACTION sec_act;
@@ -366,6 +374,7 @@ typedef struct {
   tGATT_IF gatt_if;
   std::list<tGATT_HDL_LIST_ELEM>* hdl_list_info;
   std::list<tGATT_SRV_LIST_ELEM>* srv_list_info;
+  std::vector<tGATT_SRV_HDL_RANGE>* srv_hdl_index; /* of srv_list_info */
 
   fixed_queue_t* srv_chg_clt_q; /* service change clients queue */
   tGATT_REG cl_rcb[GATT_MAX_APPS];
@@ -485,6 +494,9 @@ extern void gatt_deregister_bgdev_list(tGATT_IF gatt_if);
 /* server function */
 extern std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle);
+extern void gatt_sr_add_hdl_index(std::list<tGATT_SRV_LIST_ELEM>::iterator it);
+extern void gatt_sr_remove_hdl_index(
+    std::list<tGATT_SRV_LIST_ELEM>::iterator it);
 extern tGATT_STATUS gatt_sr_process_app_rsp(tGATT_TCB& tcb, tGATT_IF gatt_if,
                                             uint32_t trans_id, uint8_t op_code,
                                             tGATT_STATUS status,
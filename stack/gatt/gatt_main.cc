@@ -137,6 +137,7 @@ void gatt_init(void) {
 
   gatt_cb.hdl_list_info = new std::list<tGATT_HDL_LIST_ELEM>();
   gatt_cb.srv_list_info = new std::list<tGATT_SRV_LIST_ELEM>();
+  gatt_cb.srv_hdl_index = new std::vector<tGATT_SRV_HDL_RANGE>();
   gatt_profile_db_init();
 }
 
@@ -177,6 +178,8 @@ void gatt_free(void) {
   gatt_cb.hdl_list_info = nullptr;
   gatt_cb.srv_list_info->clear();
   gatt_cb.srv_list_info = nullptr;
+  delete gatt_cb.srv_hdl_index;
+  gatt_cb.srv_hdl_index = nullptr;
 }
 
 /*******************************************************************************
@@ -26,6 +26,7 @@
 #include "osi/include/osi.h"
 
 #include <string.h>
+#include <algorithm>
 #include "bt_common.h"
 #include "stdio.h"
 
@@ -645,21 +646,65 @@ void gatt_ind_ack_timeout(void* data) {
  *
  * Description      Search for a service that owns a specific handle.
  *
- * Returns          GATT_MAX_SR_PROFILES if not found. Otherwise the index of
- *                  the service.
+ * Returns          gatt_cb.srv_list_info->end() if not found. Otherwise the
+ *                  service.
  *
  ******************************************************************************/
 std::list<tGATT_SRV_LIST_ELEM>::iterator gatt_sr_find_i_rcb_by_handle(
     uint16_t handle) {
-  auto it = gatt_cb.srv_list_info->begin();
+  const std::vector<tGATT_SRV_HDL_RANGE>& index = *gatt_cb.srv_hdl_index;
 
-  for (; it != gatt_cb.srv_list_info->end(); it++) {
-    if (it->s_hdl <= handle && it->e_hdl >= handle) {
-      return it;
+  /* last service starting at or before the handle */
+  auto range = std::upper_bound(
+      index.begin(), index.end(), handle,
+      [](uint16_t handle, const tGATT_SRV_HDL_RANGE& range) {
+        return handle < range.s_hdl;
+      });
+  if (range == index.begin()) return gatt_cb.srv_list_info->end();
+
+  --range;
+  if (range->e_hdl < handle) return gatt_cb.srv_list_info->end();
+
+  return range->it;
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_add_hdl_index
+ *
+ * Description      Add a started service to the handle range index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_add_hdl_index(std::list<tGATT_SRV_LIST_ELEM>::iterator it) {
+  std::vector<tGATT_SRV_HDL_RANGE>& index = *gatt_cb.srv_hdl_index;
+  auto pos = std::upper_bound(
+      index.begin(), index.end(), it->s_hdl,
+      [](uint16_t s_hdl, const tGATT_SRV_HDL_RANGE& range) {
+        return s_hdl < range.s_hdl;
+      });
+  index.insert(pos, {it->s_hdl, it->e_hdl, it});
+}
+
+/*******************************************************************************
+ *
+ * Function         gatt_sr_remove_hdl_index
+ *
+ * Description      Remove a service from the handle range index, before it is
+ *                  erased from gatt_cb.srv_list_info.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void gatt_sr_remove_hdl_index(std::list<tGATT_SRV_LIST_ELEM>::iterator it) {
+  std::vector<tGATT_SRV_HDL_RANGE>& index = *gatt_cb.srv_hdl_index;
+  for (auto range = index.begin(); range != index.end(); range++) {
+    if (range->it == it) {
+      index.erase(range);
+      return;
     }
   }
-
-  return it;
 }
 
 /*******************************************************************************
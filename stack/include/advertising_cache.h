@@ -0,0 +1,158 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <array>
+
+#include "raw_address.h"
+
+/* Advertising data of devices waiting for either a scan response, or chained
+ * packets on the secondary channel. Entries are kept in a small open-addressing
+ * hash table, and their data in a fixed arena, so caching a report never
+ * allocates. */
+class AdvertisingCache {
+ public:
+  /* Maximum number of devices in the cache, the oldest one is dropped first */
+  static constexpr size_t kMaxEntries = 8;
+
+  /* Maximum length of the advertising data of one device. Data appended past
+   * it is dropped. */
+  static constexpr size_t kMaxDataLen = 1650;
+
+  /* Set the data to |data| for device |addr_type, addr|. Returns the cached
+   * data, with its length in |p_len| */
+  const uint8_t* Set(uint8_t addr_type, const RawAddress& addr,
+                     const uint8_t* data, size_t len, size_t* p_len) {
+    uint8_t index = FindOrAdd(addr_type, addr);
+    entries[index].len = 0;
+    return Append(index, data, len, p_len);
+  }
+
+  /* Append |data| for device |addr_type, addr|. Returns the cached data, with
+   * its length in |p_len| */
+  const uint8_t* Append(uint8_t addr_type, const RawAddress& addr,
+                        const uint8_t* data, size_t len, size_t* p_len) {
+    return Append(FindOrAdd(addr_type, addr), data, len, p_len);
+  }
+
+  /* Return true if there is data for device |addr_type, addr| */
+  bool Contains(uint8_t addr_type, const RawAddress& addr) const {
+    return buckets[Find(addr_type, addr)] != 0;
+  }
+
+  /* Clear data for device |addr_type, addr| */
+  void Clear(uint8_t addr_type, const RawAddress& addr) {
+    size_t hole = Find(addr_type, addr);
+    if (buckets[hole] == 0) return;
+
+    entries[buckets[hole] - 1].in_use = false;
+    num_entries--;
+
+    /* Shift back the entries that probed past the hole */
+    for (size_t next = (hole + 1) % kNumBuckets; buckets[next] != 0;
+         next = (next + 1) % kNumBuckets) {
+      const Entry& entry = entries[buckets[next] - 1];
+      size_t home = Hash(entry.addr_type, entry.addr) % kNumBuckets;
+      if ((next - home) % kNumBuckets >= (next - hole) % kNumBuckets) {
+        buckets[hole] = buckets[next];
+        hole = next;
+      }
+    }
+    buckets[hole] = 0;
+  }
+
+ private:
+  static constexpr size_t kNumBuckets = 2 * kMaxEntries;
+  static_assert((kNumBuckets & (kNumBuckets - 1)) == 0,
+                "kNumBuckets must be a power of two");
+
+  struct Entry {
+    uint8_t addr_type;
+    RawAddress addr;
+    bool in_use;
+    uint32_t age; /* Insertion order, to find the oldest entry */
+    size_t len;
+  };
+
+  static size_t Hash(uint8_t addr_type, const RawAddress& addr) {
+    uint64_t key = addr_type;
+    for (size_t i = 0; i < sizeof(addr.address); i++)
+      key = (key << 8) | addr.address[i];
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32);
+  }
+
+  /* Returns the bucket of device |addr_type, addr|, or else the empty bucket
+   * that ends its probe sequence */
+  size_t Find(uint8_t addr_type, const RawAddress& addr) const {
+    size_t bucket = Hash(addr_type, addr) % kNumBuckets;
+    while (buckets[bucket] != 0) {
+      const Entry& entry = entries[buckets[bucket] - 1];
+      if (entry.addr_type == addr_type && entry.addr == addr) break;
+      bucket = (bucket + 1) % kNumBuckets;
+    }
+    return bucket;
+  }
+
+  uint8_t FindOrAdd(uint8_t addr_type, const RawAddress& addr) {
+    size_t bucket = Find(addr_type, addr);
+    if (buckets[bucket] != 0) return buckets[bucket] - 1;
+
+    if (num_entries == kMaxEntries) {
+      uint8_t oldest = 0;
+      for (uint8_t i = 1; i < kMaxEntries; i++)
+        if (entries[i].age - entries[oldest].age > UINT32_MAX / 2)
+          oldest = i;
+      Clear(entries[oldest].addr_type, entries[oldest].addr);
+      bucket = Find(addr_type, addr);
+    }
+
+    uint8_t index = 0;
+    while (entries[index].in_use) index++;
+
+    Entry& entry = entries[index];
+    entry.addr_type = addr_type;
+    entry.addr = addr;
+    entry.in_use = true;
+    entry.age = next_age++;
+    entry.len = 0;
+    buckets[bucket] = index + 1;
+    num_entries++;
+    return index;
+  }
+
+  const uint8_t* Append(uint8_t index, const uint8_t* data, size_t len,
+                        size_t* p_len) {
+    Entry& entry = entries[index];
+    if (len > kMaxDataLen - entry.len) len = kMaxDataLen - entry.len;
+    if (len != 0) memcpy(arena[index].data() + entry.len, data, len);
+    entry.len += len;
+
+    *p_len = entry.len;
+    return arena[index].data();
+  }
+
+  std::array<Entry, kMaxEntries> entries{};
+  /* Entry index plus one, or 0 for an empty bucket */
+  std::array<uint8_t, kNumBuckets> buckets{};
+  size_t num_entries = 0;
+  uint32_t next_age = 0;
+  std::array<std::array<uint8_t, kMaxDataLen>, kMaxEntries> arena;
+};
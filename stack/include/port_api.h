@@ -99,6 +99,8 @@ typedef int(tPORT_DATA_CALLBACK)(uint16_t port_handle, void* p_data,
 #define DATA_CO_CALLBACK_TYPE_INCOMING 1
 #define DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE 2
 #define DATA_CO_CALLBACK_TYPE_OUTGOING 3
+/* p_buf is an array of len BT_HDR*, fill each one with its len bytes */
+#define DATA_CO_CALLBACK_TYPE_OUTGOING_BATCH 4
 typedef int(tPORT_DATA_CO_CALLBACK)(uint16_t port_handle, uint8_t* p_buf,
                                     uint16_t len, int type);
 
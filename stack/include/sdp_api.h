@@ -121,6 +121,8 @@ typedef struct {
   uint16_t num_attr_filters; /* Number of attribute filters  */
   uint16_t attr_filters[SDP_MAX_ATTR_FILTERS]; /* Attributes to filter */
   uint8_t* p_free_mem; /* Pointer to free memory       */
+  uint32_t mem_max;    /* Size the DB may grow to, 0 for a fixed DB */
+  uint8_t* p_ext_mem;  /* Blocks added as the DB grew  */
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
   uint8_t*
       raw_data; /* Received record from server. allocated/released by client  */
@@ -176,6 +178,19 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
                          uint16_t num_uuid, const bluetooth::Uuid* p_uuid_list,
                          uint16_t num_attr, uint16_t* p_attr_list);
 
+/*******************************************************************************
+ *
+ * Function         SDP_FreeDiscoveryDb
+ *
+ * Description      This function frees the memory a discovery database with a
+ *                  mem_max added as it grew past its buffer. It must be called
+ *                  before the buffer is freed or initialized again.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_FreeDiscoveryDb(tSDP_DISCOVERY_DB* p_db);
+
 /*******************************************************************************
  *
  * Function         SDP_CancelServiceSearch
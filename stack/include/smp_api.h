@@ -43,6 +43,29 @@
  ******************************************************************************/
 extern void SMP_Init(void);
 
+/*******************************************************************************
+ *
+ * Function         SMP_Free
+ *
+ * Description      This function stops the SMP background work.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void SMP_Free(void);
+
+/*******************************************************************************
+ *
+ * Function         SMP_DebugDump
+ *
+ * Description      This function writes the state of the SMP key pool and the
+ *                  LE Secure Connections pairing latencies to |fd|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+extern void SMP_DebugDump(int fd);
+
 /*******************************************************************************
  *
  * Function         SMP_SetTraceLevel
@@ -234,7 +257,7 @@ extern void smp_link_encrypted(const RawAddress& bda, uint8_t encr_enable);
 // |length| - length of the input in byte.
 // |tlen| - lenth of mac desired
 // |p_signature| - data pointer to where signed data to be stored, tlen long.
-// Returns false if out of resources, true in other cases.
+// Returns false if tlen is longer than 16, true in other cases.
 //
 bool aes_cipher_msg_auth_code(BT_OCTET16 key, uint8_t* input, uint16_t length,
                               uint16_t tlen, uint8_t* p_signature);
@@ -101,21 +101,49 @@ static bool do_sar_reassembly(tL2C_CCB* p_ccb, BT_HDR* p_buf,
 static void l2c_fcr_collect_ack_delay(tL2C_CCB* p_ccb, uint8_t num_bufs_acked);
 #endif
 
+/* Look-up tables to compute the CRC 8 bytes at a time. slice[k][b] is the CRC
+ * of byte b followed by k zero bytes, so slice[0] is crctab. */
+namespace {
+struct CrcSliceTables {
+  uint16_t slice[8][256];
+
+  CrcSliceTables() {
+    for (int b = 0; b < 256; b++) {
+      slice[0][b] = crctab[b];
+      for (int k = 1; k < 8; k++)
+        slice[k][b] =
+            (slice[k - 1][b] >> 8) ^ crctab[slice[k - 1][b] & 0xff];
+    }
+  }
+};
+}  // namespace
+
 /*******************************************************************************
  *
  * Function         l2c_fcr_updcrc
  *
- * Description      This function computes the CRC using the look-up table.
+ * Description      This function computes the CRC using the look-up tables,
+ *                  8 bytes at a time (slicing-by-8) and then byte by byte.
  *
  * Returns          CRC
  *
  ******************************************************************************/
-static unsigned short l2c_fcr_updcrc(unsigned short icrc, unsigned char* icp,
-                                     int icnt) {
-  unsigned short crc = icrc;
-  unsigned char* cp = icp;
+uint16_t l2c_fcr_updcrc(uint16_t icrc, const uint8_t* icp, int icnt) {
+  static const CrcSliceTables tables;
+  const uint16_t(*slice)[256] = tables.slice;
+  uint16_t crc = icrc;
+  const uint8_t* cp = icp;
   int cnt = icnt;
 
+  /* The 16 bits of CRC only mix with the first two bytes of each block */
+  while (cnt >= 8) {
+    crc = slice[7][(crc & 0xff) ^ cp[0]] ^ slice[6][(crc >> 8) ^ cp[1]] ^
+          slice[5][cp[2]] ^ slice[4][cp[3]] ^ slice[3][cp[4]] ^
+          slice[2][cp[5]] ^ slice[1][cp[6]] ^ slice[0][cp[7]];
+    cp += 8;
+    cnt -= 8;
+  }
+
   while (cnt--) {
     crc = ((crc >> 8) & 0xff) ^ crctab[(crc & 0xff) ^ *cp++];
   }
@@ -225,7 +253,8 @@ void l2c_fcr_cleanup(tL2C_CCB* p_ccb) {
   fixed_queue_free(p_fcrb->srej_rcv_hold_q, osi_free);
   p_fcrb->srej_rcv_hold_q = NULL;
 
-  fixed_queue_free(p_fcrb->retrans_q, osi_free);
+  /* The retransmission queue only aliases frames of waiting_for_ack_q */
+  fixed_queue_free(p_fcrb->retrans_q, NULL);
   p_fcrb->retrans_q = NULL;
 
 #if (L2CAP_ERTM_STATS == TRUE)
@@ -1039,6 +1068,12 @@ static bool process_reqseq(tL2C_CCB* p_ccb, uint16_t ctrl_word) {
       if ((ls == L2CAP_FCR_UNSEG_SDU) || (ls == L2CAP_FCR_END_SDU))
         full_sdus_xmitted++;
 
+      /* Drop it from the retransmission queue if it was acked before being
+       * resent */
+      while (fixed_queue_try_remove_from_queue(p_fcrb->retrans_q, p_tmp) !=
+             NULL) {
+      }
+
       osi_free(p_tmp);
     }
 
@@ -1623,9 +1658,9 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
       }
     }
 
-    /* Also flush our retransmission queue */
-    while (!fixed_queue_is_empty(p_ccb->fcrb.retrans_q))
-      osi_free(fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q));
+    /* Also flush our retransmission queue, its frames are still owned by
+     * waiting_for_ack_q */
+    fixed_queue_flush(p_ccb->fcrb.retrans_q, NULL);
 
     if (list_ack != NULL) node_ack = list_begin(list_ack);
   }
@@ -1635,14 +1670,10 @@ static bool retransmit_i_frames(tL2C_CCB* p_ccb, uint8_t tx_seq) {
       p_buf = (BT_HDR*)list_node(node_ack);
       node_ack = list_next(node_ack);
 
-      BT_HDR* p_buf2 = l2c_fcr_clone_buf(p_buf, p_buf->offset, p_buf->len);
-      if (p_buf2) {
-        p_buf2->layer_specific = p_buf->layer_specific;
+      /* Queue the frame itself, it is copied when it is actually resent */
+      fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf);
 
-        fixed_queue_enqueue(p_ccb->fcrb.retrans_q, p_buf2);
-      }
-
-      if ((tx_seq != L2C_FCR_RETX_ALL_PKTS) || (p_buf2 == NULL)) break;
+      if (tx_seq != L2C_FCR_RETX_ALL_PKTS) break;
     }
   }
 
@@ -1677,10 +1708,15 @@ BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
   uint8_t* p;
   uint16_t max_pdu = p_ccb->tx_mps /* Needed? - L2CAP_MAX_HEADER_FCS*/;
 
-  /* If there is anything in the retransmit queue, that goes first
+  /* If there is anything in the retransmit queue, that goes first. The queue
+   * holds the frames of waiting_for_ack_q, so send a copy of the frame.
   */
   p_buf = (BT_HDR*)fixed_queue_try_dequeue(p_ccb->fcrb.retrans_q);
   if (p_buf != NULL) {
+    BT_HDR* p_wack = p_buf;
+    p_buf = l2c_fcr_clone_buf(p_wack, p_wack->offset, p_wack->len);
+    p_buf->layer_specific = p_wack->layer_specific;
+
     /* Update Rx Seq and FCS if we acked some packets while this one was queued
      */
     prepare_I_frame(p_ccb, p_buf, true);
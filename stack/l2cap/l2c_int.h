@@ -203,7 +203,7 @@ typedef struct {
   fixed_queue_t*
       waiting_for_ack_q;          /* Buffers sent and waiting for peer to ack */
   fixed_queue_t* srej_rcv_hold_q; /* Buffers rcvd but held pending SREJ rsp */
-  fixed_queue_t* retrans_q;       /* Buffers being retransmitted */
+  fixed_queue_t* retrans_q;       /* Buffers of waiting_for_ack_q to resend */
 
   alarm_t* ack_timer;         /* Timer delaying RR */
   alarm_t* mon_retrans_timer; /* Timer Monitor or Retransmission */
@@ -375,6 +375,29 @@ typedef struct {
 
 #endif /* (L2CAP_ROUND_ROBIN_CHANNEL_SERVICE == TRUE) */
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+
+/* Traffic classes of the link scheduler, most urgent first. Links waiting for
+ * the controller buffers are served in weighted deficit round robin, with the
+ * weight and latency target of the most urgent traffic they have queued.
+ */
+typedef enum {
+  L2C_TRAFFIC_MEDIA,       /* A2DP media and other high priority channels */
+  L2C_TRAFFIC_INTERACTIVE, /* HID and L2CAP signalling */
+  L2C_TRAFFIC_ATT,         /* Attribute protocol */
+  L2C_TRAFFIC_BULK,        /* Everything else, e.g. OPP over RFCOMM */
+  L2C_TRAFFIC_NONE         /* Nothing queued */
+} tL2C_TRAFFIC_CLASS;
+
+typedef struct {
+  uint32_t num_pkts; /* Packets sent in round robin */
+  uint32_t num_late; /* Packets sent past the latency target of their class */
+  uint64_t total_delay_ms; /* Sum of the time the link waited to be served */
+  uint32_t max_delay_ms;
+} tL2C_LINK_SCHED_STATS;
+
+#endif /* (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE) */
+
 /* Define a link control block. There is one link control block between
  * this device and any other device (i.e. BD ADDR).
 */
@@ -453,6 +476,13 @@ typedef struct t_l2c_linkcb {
   uint8_t rr_pri; /* current serving priority group */
 #endif
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+  int16_t sched_deficit;        /* Credit left in the current round */
+  bool sched_waiting;           /* true while queued data waits for a turn */
+  uint32_t sched_wait_start_ms; /* When the link started waiting */
+  tL2C_LINK_SCHED_STATS sched_stats;
+#endif
+
 } tL2C_LCB;
 
 /* Define the L2CAP control structure
@@ -465,6 +495,10 @@ typedef struct {
   uint16_t round_robin_unacked; /* Round-robin unacked */
   bool check_round_robin;       /* Do a round robin check */
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+  uint8_t sched_rr_index; /* Link whose round robin turn it is */
+#endif
+
   bool is_cong_cback_context;
 
   tL2C_LCB lcb_pool[MAX_L2CAP_LINKS];    /* Link Control Block pool */
@@ -759,6 +793,7 @@ extern void l2c_fcr_send_S_frame(tL2C_CCB* p_ccb, uint16_t function_code,
 extern BT_HDR* l2c_fcr_clone_buf(BT_HDR* p_buf, uint16_t new_offset,
                                  uint16_t no_of_bytes);
 extern bool l2c_fcr_is_flow_controlled(tL2C_CCB* p_ccb);
+extern uint16_t l2c_fcr_updcrc(uint16_t icrc, const uint8_t* icp, int icnt);
 extern BT_HDR* l2c_fcr_get_next_xmit_sdu_seg(tL2C_CCB* p_ccb,
                                              uint16_t max_packet_length);
 extern void l2c_fcr_start_timer(tL2C_CCB* p_ccb);
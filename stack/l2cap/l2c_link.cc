@@ -41,10 +41,24 @@
 #include "l2c_int.h"
 #include "l2cdefs.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 
 static bool l2c_link_send_to_lower(tL2C_LCB* p_lcb, BT_HDR* p_buf,
                                    tL2C_TX_COMPLETE_CB_INFO* p_cbi);
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+/* Credit a link gets in each round. A packet costs the quantum divided by the
+ * weight of the class of its channel, so a round fits 4 media packets or a
+ * single bulk one. */
+#define L2C_SCHED_QUANTUM 12
+/* Weight of each traffic class */
+static const uint16_t l2c_traffic_weight[] = {4, 3, 2, 1};
+/* Longest a link should wait for its turn, by traffic class */
+static const uint32_t l2c_traffic_latency_target_ms[] = {20, 15, 30, 200};
+
+static void l2c_link_sched_round_robin(tL2C_LCB* p_lcb, bool single_write);
+#endif
+
 /*******************************************************************************
  *
  * Function         l2c_link_hci_conn_req
@@ -671,6 +685,15 @@ void l2c_link_adjust_allocation(void) {
   uint16_t controller_xmit_quota = l2cb.num_lm_acl_bufs;
   uint16_t high_pri_link_quota = L2CAP_HIGH_PRI_MIN_XMIT_QUOTA_A;
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+  /* The set of links changed, start the round robin over */
+  l2cb.sched_rr_index = 0;
+  for (yy = 0, p_lcb = &l2cb.lcb_pool[0]; yy < MAX_L2CAP_LINKS; yy++, p_lcb++) {
+    p_lcb->sched_deficit = 0;
+    p_lcb->sched_waiting = false;
+  }
+#endif
+
   /* If no links active, reset buffer quotas and controller buffers */
   if (l2cb.num_links_active == 0) {
     l2cb.controller_xmit_window = l2cb.num_lm_acl_bufs;
@@ -956,7 +979,9 @@ bool l2c_link_check_power_mode(tL2C_LCB* p_lcb) {
  *
  ******************************************************************************/
 void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING != TRUE)
   int xx;
+#endif
   bool single_write = false;
 
   /* Save the channel ID for faster counting */
@@ -984,10 +1009,20 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   */
   if (l2cb.is_cong_cback_context) return;
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+  if (p_lcb != NULL && p_lcb->link_xmit_quota == 0 && !p_lcb->sched_waiting) {
+    p_lcb->sched_waiting = true;
+    p_lcb->sched_wait_start_ms = time_get_os_boottime_ms();
+  }
+#endif
+
   /* If we are in a scenario where there are not enough buffers for each link to
   ** have at least 1, then do a round-robin for all the LCBs
   */
   if ((p_lcb == NULL) || (p_lcb->link_xmit_quota == 0)) {
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+    l2c_link_sched_round_robin(p_lcb, single_write);
+#else
     if (p_lcb == NULL)
       p_lcb = l2cb.lcb_pool;
     else if (!single_write)
@@ -1041,6 +1076,7 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
         (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota) &&
         (p_lcb->transport == BT_TRANSPORT_LE))
       l2cb.ble_check_round_robin = false;
+#endif /* (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE) */
   } else /* if this is not round-robin service */
   {
     /* If a partial segment is being sent, can't send anything else */
@@ -1089,6 +1125,258 @@ void l2c_link_check_send_pkts(tL2C_LCB* p_lcb, tL2C_CCB* p_ccb, BT_HDR* p_buf) {
   }
 }
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+/*******************************************************************************
+ *
+ * Function         l2c_ccb_traffic_class
+ *
+ * Description      This function returns the traffic class of a channel.
+ *
+ * Returns          traffic class
+ *
+ ******************************************************************************/
+static tL2C_TRAFFIC_CLASS l2c_ccb_traffic_class(tL2C_LCB* p_lcb,
+                                                tL2C_CCB* p_ccb) {
+  if (p_ccb->local_cid < L2CAP_BASE_APPL_CID)
+    return (p_ccb->local_cid == L2CAP_ATT_CID) ? L2C_TRAFFIC_ATT
+                                               : L2C_TRAFFIC_INTERACTIVE;
+
+  uint16_t psm = (p_ccb->p_rcb != NULL) ? p_ccb->p_rcb->real_psm : 0;
+  if (p_ccb->ccb_priority == L2CAP_CHNL_PRIORITY_HIGH ||
+      (psm == BT_PSM_AVDTP && p_lcb->acl_priority == L2CAP_PRIORITY_HIGH))
+    return L2C_TRAFFIC_MEDIA;
+  if (psm == BT_PSM_HIDC || psm == BT_PSM_HIDI) return L2C_TRAFFIC_INTERACTIVE;
+  if (psm == BT_PSM_ATT) return L2C_TRAFFIC_ATT;
+  return L2C_TRAFFIC_BULK;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_buf_traffic_class
+ *
+ * Description      This function returns the traffic class of a packet sent
+ *                  on a link, from the channel it was sent on. Packets with no
+ *                  channel are signalling.
+ *
+ * Returns          traffic class
+ *
+ ******************************************************************************/
+static tL2C_TRAFFIC_CLASS l2c_link_buf_traffic_class(tL2C_LCB* p_lcb,
+                                                     uint16_t local_cid) {
+  tL2C_CCB* p_ccb;
+
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+  if ((local_cid >= L2CAP_FIRST_FIXED_CHNL) &&
+      (local_cid <= L2CAP_LAST_FIXED_CHNL))
+    p_ccb = p_lcb->p_fixed_ccbs[local_cid - L2CAP_FIRST_FIXED_CHNL];
+  else
+#endif
+    p_ccb = l2cu_find_ccb_by_cid(p_lcb, local_cid);
+
+  if (p_ccb == NULL) return L2C_TRAFFIC_INTERACTIVE;
+
+  return l2c_ccb_traffic_class(p_lcb, p_ccb);
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_traffic_class
+ *
+ * Description      This function returns the class of the most urgent traffic
+ *                  queued on a link.
+ *
+ * Returns          traffic class, or L2C_TRAFFIC_NONE if nothing is queued
+ *
+ ******************************************************************************/
+static tL2C_TRAFFIC_CLASS l2c_link_traffic_class(tL2C_LCB* p_lcb) {
+  tL2C_TRAFFIC_CLASS traffic_class = L2C_TRAFFIC_NONE;
+
+  if (!list_is_empty(p_lcb->link_xmit_data_q))
+    traffic_class = L2C_TRAFFIC_INTERACTIVE;
+
+#if (L2CAP_NUM_FIXED_CHNLS > 0)
+  for (int xx = 0; xx < L2CAP_NUM_FIXED_CHNLS; xx++) {
+    tL2C_CCB* p_ccb = p_lcb->p_fixed_ccbs[xx];
+    if (p_ccb == NULL || (fixed_queue_is_empty(p_ccb->xmit_hold_q) &&
+                          fixed_queue_is_empty(p_ccb->fcrb.retrans_q)))
+      continue;
+
+    tL2C_TRAFFIC_CLASS ccb_class = l2c_ccb_traffic_class(p_lcb, p_ccb);
+    if (ccb_class < traffic_class) traffic_class = ccb_class;
+  }
+#endif
+
+  for (tL2C_CCB* p_ccb = p_lcb->ccb_queue.p_first_ccb; p_ccb;
+       p_ccb = p_ccb->p_next_ccb) {
+    if (fixed_queue_is_empty(p_ccb->xmit_hold_q) &&
+        fixed_queue_is_empty(p_ccb->fcrb.retrans_q))
+      continue;
+
+    tL2C_TRAFFIC_CLASS ccb_class = l2c_ccb_traffic_class(p_lcb, p_ccb);
+    if (ccb_class < traffic_class) traffic_class = ccb_class;
+  }
+
+  return traffic_class;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_can_send
+ *
+ * Description      This function checks if a link sharing the controller
+ *                  buffers in round robin may send a packet now.
+ *
+ * Returns          true if it may
+ *
+ ******************************************************************************/
+static bool l2c_link_sched_can_send(tL2C_LCB* p_lcb) {
+  if ((!p_lcb->in_use) || (p_lcb->partial_segment_being_sent) ||
+      (p_lcb->link_state != LST_CONNECTED) || (p_lcb->link_xmit_quota != 0) ||
+      (L2C_LINK_CHECK_POWER_MODE(p_lcb)))
+    return false;
+
+  if (p_lcb->transport == BT_TRANSPORT_LE)
+    return l2cb.controller_le_xmit_window != 0 &&
+           l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota;
+
+  return l2cb.controller_xmit_window != 0 &&
+         l2cb.round_robin_unacked < l2cb.round_robin_quota;
+}
+
+/*******************************************************************************
+ *
+ * Function         l2c_link_sched_round_robin
+ *
+ * Description      This function shares the controller buffers between the
+ *                  links that have no quota of their own. Each link gets
+ *                  L2C_SCHED_QUANTUM of credit per round, and each packet it
+ *                  sends is charged by the class of its channel. A link that
+ *                  waited past the latency target of its most urgent traffic
+ *                  is served first.
+ *
+ *                  If |single_write| is set, only the link queues are served,
+ *                  starting with |p_lcb|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void l2c_link_sched_round_robin(tL2C_LCB* p_lcb, bool single_write) {
+  bool blocked[MAX_L2CAP_LINKS] = {false};
+  tL2C_TRAFFIC_CLASS traffic_class[MAX_L2CAP_LINKS];
+  uint32_t now_ms = time_get_os_boottime_ms();
+
+  if (single_write && p_lcb != NULL && p_lcb->sched_deficit <= 0)
+    l2cb.sched_rr_index = p_lcb - l2cb.lcb_pool;
+
+  for (;;) {
+    tL2C_LCB* p_serve = NULL;
+    uint32_t most_late_ms = 0;
+
+    /* Find the links that can send, and the one most past its target */
+    for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+      tL2C_LCB* p = &l2cb.lcb_pool[xx];
+      traffic_class[xx] = L2C_TRAFFIC_NONE;
+      if (blocked[xx] || !l2c_link_sched_can_send(p)) continue;
+
+      if (single_write)
+        traffic_class[xx] = list_is_empty(p->link_xmit_data_q)
+                                ? L2C_TRAFFIC_NONE
+                                : L2C_TRAFFIC_INTERACTIVE;
+      else
+        traffic_class[xx] = l2c_link_traffic_class(p);
+
+      if (traffic_class[xx] == L2C_TRAFFIC_NONE) {
+        p->sched_waiting = false;
+        p->sched_deficit = 0;
+        continue;
+      }
+
+      if (!p->sched_waiting) {
+        p->sched_waiting = true;
+        p->sched_wait_start_ms = now_ms;
+      }
+
+      uint32_t wait_ms = now_ms - p->sched_wait_start_ms;
+      uint32_t target_ms = l2c_traffic_latency_target_ms[traffic_class[xx]];
+      if (wait_ms > target_ms && wait_ms - target_ms > most_late_ms) {
+        most_late_ms = wait_ms - target_ms;
+        p_serve = p;
+      }
+    }
+
+    /* Otherwise continue the round from the link whose turn it is */
+    if (p_serve == NULL) {
+      for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+        int index = (l2cb.sched_rr_index + xx) % MAX_L2CAP_LINKS;
+        if (traffic_class[index] != L2C_TRAFFIC_NONE) {
+          p_serve = &l2cb.lcb_pool[index];
+          break;
+        }
+        l2cb.lcb_pool[index].sched_deficit = 0;
+      }
+      if (p_serve == NULL) break;
+
+      l2cb.sched_rr_index = p_serve - l2cb.lcb_pool;
+      /* A new turn, less what the link overdrew in its last one */
+      if (p_serve->sched_deficit <= 0)
+        p_serve->sched_deficit += L2C_SCHED_QUANTUM;
+    }
+
+    int index = p_serve - l2cb.lcb_pool;
+    BT_HDR* p_buf;
+    uint16_t local_cid;
+    tL2C_TX_COMPLETE_CB_INFO cbi;
+    tL2C_TX_COMPLETE_CB_INFO* p_cbi = NULL;
+    if (!list_is_empty(p_serve->link_xmit_data_q)) {
+      p_buf = (BT_HDR*)list_front(p_serve->link_xmit_data_q);
+      list_remove(p_serve->link_xmit_data_q, p_buf);
+      local_cid = p_buf->event;
+    } else {
+      p_buf = l2cu_get_next_buffer_to_send(p_serve, &cbi);
+      p_cbi = &cbi;
+      local_cid = cbi.local_cid;
+    }
+
+    if (p_buf == NULL) {
+      /* Flow controlled or out of credits, try again later */
+      blocked[index] = true;
+      p_serve->sched_deficit = 0;
+      continue;
+    }
+
+    tL2C_TRAFFIC_CLASS buf_class =
+        l2c_link_buf_traffic_class(p_serve, local_cid);
+    uint32_t delay_ms = now_ms - p_serve->sched_wait_start_ms;
+    tL2C_LINK_SCHED_STATS* p_stats = &p_serve->sched_stats;
+    p_stats->num_pkts++;
+    p_stats->total_delay_ms += delay_ms;
+    if (delay_ms > p_stats->max_delay_ms) p_stats->max_delay_ms = delay_ms;
+    if (delay_ms > l2c_traffic_latency_target_ms[buf_class])
+      p_stats->num_late++;
+    p_serve->sched_wait_start_ms = now_ms;
+
+    l2c_link_send_to_lower(p_serve, p_buf, p_cbi);
+
+    /* Charge the turn for the channel the packet came from. The debt carried
+     * to the next turn is kept under one quantum. */
+    p_serve->sched_deficit -= L2C_SCHED_QUANTUM / l2c_traffic_weight[buf_class];
+    if (p_serve->sched_deficit <= -L2C_SCHED_QUANTUM)
+      p_serve->sched_deficit = 1 - L2C_SCHED_QUANTUM;
+    if (p_serve->sched_deficit <= 0 && index == l2cb.sched_rr_index)
+      l2cb.sched_rr_index = (index + 1) % MAX_L2CAP_LINKS;
+  }
+
+  /* Everything that could be sent was, no need for a safety check */
+  if ((l2cb.controller_xmit_window > 0) &&
+      (l2cb.round_robin_unacked < l2cb.round_robin_quota))
+    l2cb.check_round_robin = false;
+
+  if ((l2cb.controller_le_xmit_window > 0) &&
+      (l2cb.ble_round_robin_unacked < l2cb.ble_round_robin_quota))
+    l2cb.ble_check_round_robin = false;
+}
+#endif /* (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE) */
+
 /*******************************************************************************
  *
  * Function         l2c_link_send_to_lower
@@ -152,6 +152,18 @@ void l2cu_release_lcb(tL2C_LCB* p_lcb) {
   /* Release any unfinished L2CAP packet on this link */
   osi_free_and_reset((void**)&p_lcb->p_hcit_rcv_acl);
 
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+  tL2C_LINK_SCHED_STATS* p_stats = &p_lcb->sched_stats;
+  if (p_stats->num_pkts > 0) {
+    L2CAP_TRACE_EVENT(
+        "%s: handle 0x%04x sent %u packets in round robin, %u late, queueing "
+        "delay avg %u ms max %u ms",
+        __func__, p_lcb->handle, p_stats->num_pkts, p_stats->num_late,
+        (uint32_t)(p_stats->total_delay_ms / p_stats->num_pkts),
+        p_stats->max_delay_ms);
+  }
+#endif
+
 #if (BTM_SCO_INCLUDED == TRUE)
   if (p_lcb->transport == BT_TRANSPORT_BR_EDR) /* Release all SCO links */
     btm_remove_sco_links(p_lcb->remote_bd_addr);
@@ -3262,6 +3274,7 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
 
       p_buf = l2c_fcr_get_next_xmit_sdu_seg(p_ccb, 0);
       if (p_buf != NULL) {
+        p_cbi->local_cid = p_ccb->local_cid;
         l2cu_check_channel_congestion(p_ccb);
         l2cu_set_acl_hci_header(p_buf, p_ccb);
         return (p_buf);
@@ -3330,6 +3343,9 @@ BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
       (p_ccb->peer_cfg.fcr.mode != L2CAP_FCR_ERTM_MODE))
     (*p_ccb->p_rcb->api.pL2CA_TxComplete_Cb)(p_ccb->local_cid, 1);
 
+  /* Tell the link scheduler which channel the buffer came from */
+  p_cbi->local_cid = p_ccb->local_cid;
+
   l2cu_check_channel_congestion(p_ccb);
 
   l2cu_set_acl_hci_header(p_buf, p_ccb);
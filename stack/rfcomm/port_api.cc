@@ -1496,41 +1496,64 @@ int PORT_WriteDataCO(uint16_t handle, int* p_len) {
       break;
     }
 
-    /* continue with rfcomm data write */
-    p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
-    p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
-    p_buf->layer_specific = handle;
-
+    /* continue with rfcomm data write, reading as many buffers as stay under
+     * the high water marks with one call */
+    BT_HDR* bufs[PORT_WRITE_CO_BATCH];
+    uint16_t num_bufs = 0;
+    int batch_len = 0;
     if (p_port->peer_mtu < length) length = p_port->peer_mtu;
-    if (available < (int)length) length = (uint16_t)available;
-    p_buf->len = length;
-    p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+    while ((num_bufs < PORT_WRITE_CO_BATCH) && (batch_len < available) &&
+           ((num_bufs == 0) ||
+            ((p_port->tx.queue_size + batch_len <= PORT_TX_HIGH_WM) &&
+             (fixed_queue_length(p_port->tx.queue) + num_bufs <=
+              PORT_TX_BUF_HIGH_WM)))) {
+      p_buf = (BT_HDR*)osi_malloc(RFCOMM_DATA_BUF_SIZE);
+      p_buf->offset = L2CAP_MIN_OFFSET + RFCOMM_MIN_OFFSET;
+      p_buf->layer_specific = handle;
+      p_buf->len = length;
+      if (available - batch_len < (int)length)
+        p_buf->len = (uint16_t)(available - batch_len);
+      p_buf->event = BT_EVT_TO_BTU_SP_DATA;
+
+      bufs[num_bufs++] = p_buf;
+      batch_len += p_buf->len;
+    }
 
-    // memcpy ((uint8_t *)(p_buf + 1) + p_buf->offset, p_data, length);
-    // if(recv(fd, (uint8_t *)(p_buf + 1) + p_buf->offset, (int)length, 0) !=
-    // (int)length)
-    if (!p_port->p_data_co_callback(handle,
-                                    (uint8_t*)(p_buf + 1) + p_buf->offset,
-                                    length, DATA_CO_CALLBACK_TYPE_OUTGOING)) {
+    if (!p_port->p_data_co_callback(handle, (uint8_t*)bufs, num_bufs,
+                                    DATA_CO_CALLBACK_TYPE_OUTGOING_BATCH)) {
       error(
-          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING failed, length:%d",
-          length);
+          "p_data_co_callback DATA_CO_CALLBACK_TYPE_OUTGOING_BATCH failed, "
+          "length:%d",
+          batch_len);
+      for (uint16_t i = 0; i < num_bufs; i++) osi_free(bufs[i]);
       return (PORT_UNKNOWN_ERROR);
     }
 
-    RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", length);
+    for (uint16_t i = 0; i < num_bufs; i++) {
+      p_buf = bufs[i];
+      uint16_t buf_len = p_buf->len;
+      RFCOMM_TRACE_EVENT("PORT_WriteData %d bytes", buf_len);
 
-    rc = port_write(p_port, p_buf);
+      if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) {
+        /* The port failed on an earlier buffer of the batch */
+        osi_free(p_buf);
+        continue;
+      }
 
-    /* If queue went below the threashold need to send flow control */
-    event |= port_flow_control_user(p_port);
+      rc = port_write(p_port, p_buf);
 
-    if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
+      /* If queue went below the threashold need to send flow control */
+      event |= port_flow_control_user(p_port);
 
-    if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
+      if (rc == PORT_SUCCESS) event |= PORT_EV_TXCHAR;
 
-    *p_len += length;
-    available -= (int)length;
+      if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) continue;
+
+      *p_len += buf_len;
+    }
+    available -= batch_len;
+
+    if ((rc != PORT_SUCCESS) && (rc != PORT_CMD_PENDING)) break;
   }
   if (!available && (rc != PORT_CMD_PENDING) && (rc != PORT_TX_QUEUE_DISABLED))
     event |= PORT_EV_TXEMPTY;
@@ -61,6 +61,11 @@ using bluetooth::Uuid;
  *                  num_attr    - (input) number of attribute filters applied
  *                  p_attr_list - (input) list of attribute filters
  *
+ *                  The records have to fit in |len| bytes unless the caller
+ *                  sets mem_max afterwards, in which case the database grows
+ *                  to hold up to mem_max bytes of records and
+ *                  SDP_FreeDiscoveryDb has to be called before the memory is
+ *                  freed.
  *
  * Returns          bool
  *                          true if successful
@@ -103,6 +108,32 @@ bool SDP_InitDiscoveryDb(tSDP_DISCOVERY_DB* p_db, uint32_t len,
   return (true);
 }
 
+/*******************************************************************************
+ *
+ * Function         SDP_FreeDiscoveryDb
+ *
+ * Description      This function frees the blocks a discovery database added
+ *                  as it grew past the memory given to SDP_InitDiscoveryDb.
+ *                  The records are gone afterwards, but the memory given to
+ *                  SDP_InitDiscoveryDb is left to the caller.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SDP_FreeDiscoveryDb(tSDP_DISCOVERY_DB* p_db) {
+  if (p_db == NULL || p_db->p_ext_mem == NULL) return;
+
+  while (p_db->p_ext_mem) {
+    uint8_t* p_next = *(uint8_t**)p_db->p_ext_mem;
+    osi_free(p_db->p_ext_mem);
+    p_db->p_ext_mem = p_next;
+  }
+
+  p_db->p_first_rec = NULL;
+  p_db->p_free_mem = NULL;
+  p_db->mem_free = 0;
+}
+
 /*******************************************************************************
  *
  * Function         SDP_CancelServiceSearch
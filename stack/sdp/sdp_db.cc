@@ -25,6 +25,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
 
 #include "bt_target.h"
 
@@ -37,12 +40,143 @@
 #include "sdp_api.h"
 #include "sdpint.h"
 
+using bluetooth::Uuid;
+
 #if (SDP_SERVER_ENABLED == TRUE)
+/* Handles of the records holding each UUID, in increasing order. Handles only
+ * grow along the database, so this is also the order of the records. */
+static std::unordered_map<Uuid, std::vector<uint32_t>> sdp_db_uuid_index;
+
+/* The UUIDs each record is listed under in sdp_db_uuid_index */
+static std::unordered_map<uint32_t, std::vector<Uuid>> sdp_db_record_uuids;
+
+/* Bumped on every change to the database */
+static uint32_t sdp_db_version;
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
-                             uint16_t his_len, int nest_level);
+static void find_uuids_in_seq(uint8_t* p, uint32_t seq_len,
+                              std::vector<Uuid>* p_uuids, int nest_level);
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_init
+ *
+ * Description      This function empties the UUID index, for the database
+ *                  cleared by sdp_init().
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void sdp_db_init(void) {
+  sdp_db_uuid_index.clear();
+  sdp_db_record_uuids.clear();
+  sdp_db_version++;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_get_version
+ *
+ * Description      This function returns a number that changes whenever a
+ *                  record or an attribute is added to or removed from the
+ *                  database, to tell when responses built from it are stale.
+ *
+ * Returns          The database version
+ *
+ ******************************************************************************/
+uint32_t sdp_db_get_version(void) { return sdp_db_version; }
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_unindex_record
+ *
+ * Description      This function removes a record from the UUID index.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_unindex_record(uint32_t handle) {
+  auto rec_it = sdp_db_record_uuids.find(handle);
+  if (rec_it == sdp_db_record_uuids.end()) return;
+
+  for (const Uuid& uuid : rec_it->second) {
+    auto it = sdp_db_uuid_index.find(uuid);
+    if (it == sdp_db_uuid_index.end()) continue;
+
+    std::vector<uint32_t>& handles = it->second;
+    handles.erase(std::remove(handles.begin(), handles.end(), handle),
+                  handles.end());
+    if (handles.empty()) sdp_db_uuid_index.erase(it);
+  }
+  sdp_db_record_uuids.erase(rec_it);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_index_record
+ *
+ * Description      This function lists a record in the UUID index under every
+ *                  UUID of its attributes, including the ones nested in data
+ *                  element sequences. It is called whenever the attributes of
+ *                  the record change.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void sdp_db_index_record(tSDP_RECORD* p_rec) {
+  std::vector<Uuid> uuids;
+  tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
+  uint16_t xx;
+
+  sdp_db_unindex_record(p_rec->record_handle);
+  sdp_db_version++;
+
+  for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
+    if (p_attr->type == UUID_DESC_TYPE) {
+      Uuid uuid;
+      if (sdpu_uuid_from_array(p_attr->value_ptr, p_attr->len, &uuid))
+        uuids.push_back(uuid);
+    } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
+      find_uuids_in_seq(p_attr->value_ptr, p_attr->len, &uuids, 0);
+    }
+  }
+
+  std::sort(uuids.begin(), uuids.end());
+  uuids.erase(std::unique(uuids.begin(), uuids.end()), uuids.end());
+  if (uuids.empty()) return;
+
+  for (const Uuid& uuid : uuids) {
+    std::vector<uint32_t>& handles = sdp_db_uuid_index[uuid];
+    handles.insert(
+        std::lower_bound(handles.begin(), handles.end(), p_rec->record_handle),
+        p_rec->record_handle);
+  }
+  sdp_db_record_uuids[p_rec->record_handle] = std::move(uuids);
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_lower_bound
+ *
+ * Description      This function finds the first record whose handle is not
+ *                  below |handle|. Records are kept in increasing handle order.
+ *
+ * Returns          Pointer to the record, or NULL if there is none.
+ *
+ ******************************************************************************/
+static tSDP_RECORD* sdp_db_lower_bound(uint32_t handle) {
+  tSDP_RECORD* p_begin = &sdp_cb.server_db.record[0];
+  tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  tSDP_RECORD* p_rec =
+      std::lower_bound(p_begin, p_end, handle,
+                       [](const tSDP_RECORD& rec, uint32_t h) {
+                         return rec.record_handle < h;
+                       });
+
+  return (p_rec == p_end) ? NULL : p_rec;
+}
 
 /*******************************************************************************
  *
@@ -56,64 +190,60 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_his_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec, tSDP_UUID_SEQ* p_seq) {
-  uint16_t xx, yy;
-  tSDP_ATTRIBUTE* p_attr;
-  tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  const std::vector<uint32_t>* p_handles[MAX_UUIDS_PER_SEQ];
+  uint32_t handle = p_rec ? p_rec->record_handle + 1 : 0;
+  uint16_t xx, matched;
+
+  /* The spec says that a match occurs if the record contains all the passed
+   * UUIDs in it, so every UUID has to be in the index */
+  for (xx = 0; xx < p_seq->num_uids; xx++) {
+    Uuid uuid;
+    if (!sdpu_uuid_from_array(p_seq->uuid_entry[xx].value,
+                              p_seq->uuid_entry[xx].len, &uuid))
+      return (NULL);
+
+    auto it = sdp_db_uuid_index.find(uuid);
+    if (it == sdp_db_uuid_index.end()) return (NULL);
+    p_handles[xx] = &it->second;
+  }
 
-  /* If NULL, start at the beginning, else start at the first specified record
-   */
-  if (!p_rec)
-    p_rec = &sdp_cb.server_db.record[0];
-  else
-    p_rec++;
-
-  /* Look through the records. The spec says that a match occurs if */
-  /* the record contains all the passed UUIDs in it.                */
-  for (; p_rec < p_end; p_rec++) {
-    for (yy = 0; yy < p_seq->num_uids; yy++) {
-      p_attr = &p_rec->attribute[0];
-      for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
-        if (p_attr->type == UUID_DESC_TYPE) {
-          if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
-                                       &p_seq->uuid_entry[yy].value[0],
-                                       p_seq->uuid_entry[yy].len))
-            break;
-        } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
-          if (find_uuid_in_seq(p_attr->value_ptr, p_attr->len,
-                               &p_seq->uuid_entry[yy].value[0],
-                               p_seq->uuid_entry[yy].len, 0))
-            break;
-        }
-      }
-      /* If any UUID was not found,  on to the next record */
-      if (xx == p_rec->num_attributes) break;
-    }
+  /* Leapfrog through the handle lists to the first handle past the previous
+   * record that is in all of them */
+  for (xx = 0, matched = 0; matched < p_seq->num_uids;
+       xx = (xx + 1) % p_seq->num_uids) {
+    auto it = std::lower_bound(p_handles[xx]->begin(), p_handles[xx]->end(),
+                               handle);
+    if (it == p_handles[xx]->end()) return (NULL);
 
-    /* If every UUID was found in the record, return the record */
-    if (yy == p_seq->num_uids) return (p_rec);
+    if (*it == handle) {
+      matched++;
+    } else {
+      handle = *it;
+      matched = 1;
+    }
   }
 
-  /* If here, no more records found */
-  return (NULL);
+  return sdp_db_lower_bound(handle);
 }
 
 /*******************************************************************************
  *
- * Function         find_uuid_in_seq
+ * Function         find_uuids_in_seq
  *
- * Description      This function searches a data element sequenct for a UUID.
+ * Description      This function collects the UUIDs in a data element
+ *                  sequence.
  *
- * Returns          true if found, else false
+ * Returns          void
  *
  ******************************************************************************/
-static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
-                             uint16_t uuid_len, int nest_level) {
+static void find_uuids_in_seq(uint8_t* p, uint32_t seq_len,
+                              std::vector<Uuid>* p_uuids, int nest_level) {
   uint8_t* p_end = p + seq_len;
   uint8_t type;
   uint32_t len;
 
   /* A little safety check to avoid excessive recursion */
-  if (nest_level > 3) return (false);
+  if (nest_level > 3) return;
 
   while (p < p_end) {
     type = *p++;
@@ -124,16 +254,13 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
     }
     type = type >> 3;
     if (type == UUID_DESC_TYPE) {
-      if (sdpu_compare_uuid_arrays(p, len, p_uuid, uuid_len)) return (true);
+      Uuid uuid;
+      if (sdpu_uuid_from_array(p, len, &uuid)) p_uuids->push_back(uuid);
     } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
-      if (find_uuid_in_seq(p, len, p_uuid, uuid_len, nest_level + 1))
-        return (true);
+      find_uuids_in_seq(p, len, p_uuids, nest_level + 1);
     }
     p = p + len;
   }
-
-  /* If here, failed to match */
-  return (false);
 }
 
 /*******************************************************************************
@@ -147,13 +274,9 @@ static bool find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
  *
  ******************************************************************************/
 tSDP_RECORD* sdp_db_find_record(uint32_t handle) {
-  tSDP_RECORD* p_rec;
-  tSDP_RECORD* p_end = &sdp_cb.server_db.record[sdp_cb.server_db.num_records];
+  tSDP_RECORD* p_rec = sdp_db_lower_bound(handle);
 
-  /* Look through the records for the caller's handle */
-  for (p_rec = &sdp_cb.server_db.record[0]; p_rec < p_end; p_rec++) {
-    if (p_rec->record_handle == handle) return (p_rec);
-  }
+  if (p_rec && p_rec->record_handle == handle) return (p_rec);
 
   /* Record with that handle not found. */
   return (NULL);
@@ -306,6 +429,7 @@ bool SDP_DeleteRecord(uint32_t handle) {
   if (handle == 0 || sdp_cb.server_db.num_records == 0) {
     /* Delete all records in the database */
     sdp_cb.server_db.num_records = 0;
+    sdp_db_init();
 
     /* require new DI record to be created in SDP_SetLocalDiRecord */
     sdp_cb.server_db.di_primary_handle = 0;
@@ -325,6 +449,8 @@ bool SDP_DeleteRecord(uint32_t handle) {
         }
 
         sdp_cb.server_db.num_records--;
+        sdp_db_unindex_record(handle);
+        sdp_db_version++;
 
         SDP_TRACE_DEBUG("SDP_DeleteRecord ok, num_records:%d",
                         sdp_cb.server_db.num_records);
@@ -450,9 +576,11 @@ bool SDP_AddAttribute(uint32_t handle, uint16_t attr_id, uint8_t attr_type,
             "SDP_AddAttribute fail, length exceed maximum: ID %d: attr_len:%d ",
             attr_id, attr_len);
         p_attr->id = p_attr->type = p_attr->len = 0;
+        sdp_db_index_record(p_rec);
         return (false);
       }
       p_rec->num_attributes++;
+      sdp_db_index_record(p_rec);
       return (true);
     }
   }
@@ -834,6 +962,7 @@ bool SDP_DeleteAttribute(uint32_t handle, uint16_t attr_id) {
             for (yy = 0; yy < xx; yy++, pad_ptr++) *pad_ptr = *(pad_ptr + len);
             p_rec->free_pad_ptr -= len;
           }
+          sdp_db_index_record(p_rec);
           return (true);
         }
       }
@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 
 #include "bt_common.h"
 #include "bt_target.h"
@@ -52,7 +53,8 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                      uint8_t* p_reply_end);
 static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                             uint8_t* p_reply_end);
-static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end);
+static void sdp_parse_start(tCONN_CB* p_ccb);
+static uint16_t sdp_parse_rsp(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_end);
 static tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db,
                                  const RawAddress& p_bda);
 static uint8_t* add_attr(uint8_t* p, uint8_t* p_end, tSDP_DISCOVERY_DB* p_db,
@@ -338,68 +340,25 @@ static void process_service_search_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
  *
  * Function         sdp_copy_raw_data
  *
- * Description      copy the raw data
+ * Description      copy the raw data of an attribute list as it is parsed
  *
  *
  * Returns          void
  *
  ******************************************************************************/
 #if (SDP_RAW_DATA_INCLUDED == TRUE)
-static void sdp_copy_raw_data(tCONN_CB* p_ccb, bool offset) {
-  unsigned int cpy_len, rem_len;
-  uint32_t list_len;
-  uint8_t* p;
-  uint8_t* p_end;
-  uint8_t type;
-
-#if (SDP_DEBUG_RAW == TRUE)
-  uint8_t num_array[SDP_MAX_LIST_BYTE_COUNT];
-  uint32_t i;
+static void sdp_copy_raw_data(tCONN_CB* p_ccb, uint8_t* p, uint32_t len) {
+  tSDP_DISCOVERY_DB* p_db = p_ccb->p_db;
 
-  for (i = 0; i < p_ccb->list_len; i++) {
-    snprintf((char*)&num_array[i * 2], sizeof(num_array) - i * 2, "%02X",
-             (uint8_t)(p_ccb->rsp_list[i]));
-  }
-  SDP_TRACE_WARNING("result :%s", num_array);
-#endif
+  if (p_db->raw_data == NULL) return;
 
-  if (p_ccb->p_db->raw_data) {
-    cpy_len = p_ccb->p_db->raw_size - p_ccb->p_db->raw_used;
-    list_len = p_ccb->list_len;
-    p = &p_ccb->rsp_list[0];
-    p_end = &p_ccb->rsp_list[0] + list_len;
-
-    if (offset) {
-      cpy_len -= 1;
-      type = *p++;
-      uint8_t* old_p = p;
-      p = sdpu_get_len_from_type(p, p_end, type, &list_len);
-      if (p == NULL || (p + list_len) > p_end) {
-        SDP_TRACE_WARNING("%s: bad length", __func__);
-        return;
-      }
-      if ((int)cpy_len < (p - old_p)) {
-        SDP_TRACE_WARNING("%s: no bytes left for data", __func__);
-        return;
-      }
-      cpy_len -= (p - old_p);
-    }
-    if (list_len < cpy_len) {
-      cpy_len = list_len;
-    }
-    rem_len = SDP_MAX_LIST_BYTE_COUNT - (unsigned int)(p - &p_ccb->rsp_list[0]);
-    if (cpy_len > rem_len) {
-      SDP_TRACE_WARNING("rem_len :%d less than cpy_len:%d", rem_len, cpy_len);
-      cpy_len = rem_len;
-    }
-    SDP_TRACE_WARNING(
-        "%s: list_len:%d cpy_len:%d p:%p p_ccb:%p p_db:%p raw_size:%d "
-        "raw_used:%d raw_data:%p",
-        __func__, list_len, cpy_len, p, p_ccb, p_ccb->p_db,
-        p_ccb->p_db->raw_size, p_ccb->p_db->raw_used, p_ccb->p_db->raw_data);
-    memcpy(&p_ccb->p_db->raw_data[p_ccb->p_db->raw_used], p, cpy_len);
-    p_ccb->p_db->raw_used += cpy_len;
+  if (len > p_db->raw_size - p_db->raw_used) {
+    SDP_TRACE_WARNING("%s: raw_data full, dropping %d of %d bytes", __func__,
+                      len - (p_db->raw_size - p_db->raw_used), len);
+    len = p_db->raw_size - p_db->raw_used;
   }
+  memcpy(&p_db->raw_data[p_db->raw_used], p, len);
+  p_db->raw_used += len;
 }
 #endif
 
@@ -416,7 +375,7 @@ static void sdp_copy_raw_data(tCONN_CB* p_ccb, bool offset) {
 static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                      uint8_t* p_reply_end) {
   uint8_t *p_start, *p_param_len;
-  uint16_t param_len, list_byte_count;
+  uint16_t param_len, list_byte_count, status;
   bool cont_request_needed = false;
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -429,6 +388,12 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
     SDP_TRACE_WARNING("ID & len: 0x%02x-%02x-%02x-%02x", p_reply[0], p_reply[1],
                       p_reply[2], p_reply[3]);
 #endif
+    if (p_reply + 4 /* transaction ID and length */ + sizeof(list_byte_count) >
+        p_reply_end) {
+      sdp_disconnect(p_ccb, SDP_INVALID_PDU_SIZE);
+      return;
+    }
+
     /* Skip transaction ID and length */
     p_reply += 4;
 
@@ -437,25 +402,19 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
     SDP_TRACE_WARNING("list_byte_count:%d", list_byte_count);
 #endif
 
-    /* Copy the response to the scratchpad. First, a safety check on the length
-     */
-    if ((p_ccb->list_len + list_byte_count) > SDP_MAX_LIST_BYTE_COUNT) {
+    if (p_reply + list_byte_count + 1 /* continuation */ > p_reply_end) {
       sdp_disconnect(p_ccb, SDP_INVALID_PDU_SIZE);
       return;
     }
 
-#if (SDP_DEBUG_RAW == TRUE)
-    SDP_TRACE_WARNING("list_len: %d, list_byte_count: %d", p_ccb->list_len,
-                      list_byte_count);
-#endif
-    if (p_ccb->rsp_list == NULL)
-      p_ccb->rsp_list = (uint8_t*)osi_malloc(SDP_MAX_LIST_BYTE_COUNT);
-    memcpy(&p_ccb->rsp_list[p_ccb->list_len], p_reply, list_byte_count);
-    p_ccb->list_len += list_byte_count;
+    /* Save the attributes in the database as they come. Stop on any error */
+    status = sdp_parse_rsp(p_ccb, p_reply, p_reply + list_byte_count);
+    if (status != SDP_SUCCESS) {
+      sdp_disconnect(p_ccb, status);
+      return;
+    }
     p_reply += list_byte_count;
 #if (SDP_DEBUG_RAW == TRUE)
-    SDP_TRACE_WARNING("list_len: %d(attr_rsp)", p_ccb->list_len);
-
     /* Check if we need to request a continuation */
     SDP_TRACE_WARNING("*p_reply:%d(%d)", *p_reply, SDP_MAX_CONTINUATION_LEN);
 #endif
@@ -466,20 +425,16 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
       }
       cont_request_needed = true;
     } else {
-#if (SDP_RAW_DATA_INCLUDED == TRUE)
-      SDP_TRACE_WARNING("process_service_attr_rsp");
-      sdp_copy_raw_data(p_ccb, false);
-#endif
-
-      /* Save the response in the database. Stop on any error */
-      if (!save_attr_seq(p_ccb, &p_ccb->rsp_list[0],
-                         &p_ccb->rsp_list[p_ccb->list_len])) {
+      /* The attribute list has to be complete by the last response */
+      if (p_ccb->parse_state != SDP_PARSE_DONE) {
         sdp_disconnect(p_ccb, SDP_DB_FULL);
         return;
       }
-      p_ccb->list_len = 0;
       p_ccb->cur_handle++;
+      sdp_parse_start(p_ccb);
     }
+  } else {
+    sdp_parse_start(p_ccb);
   }
 
   /* Now, ask for the next handle. Re-use the buffer we just got. */
@@ -552,10 +507,8 @@ static void process_service_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
  ******************************************************************************/
 static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
                                             uint8_t* p_reply_end) {
-  uint8_t *p, *p_start, *p_end, *p_param_len;
-  uint8_t type;
-  uint32_t seq_len;
-  uint16_t param_len, lists_byte_count = 0;
+  uint8_t *p_start, *p_param_len;
+  uint16_t param_len, lists_byte_count = 0, status;
   bool cont_request_needed = false;
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -582,32 +535,20 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
     SDP_TRACE_WARNING("lists_byte_count:%d", lists_byte_count);
 #endif
 
-    /* Copy the response to the scratchpad. First, a safety check on the length
-     */
-    if ((p_ccb->list_len + lists_byte_count) > SDP_MAX_LIST_BYTE_COUNT) {
-      sdp_disconnect(p_ccb, SDP_INVALID_PDU_SIZE);
-      return;
-    }
-
-#if (SDP_DEBUG_RAW == TRUE)
-    SDP_TRACE_WARNING("list_len: %d, list_byte_count: %d", p_ccb->list_len,
-                      lists_byte_count);
-#endif
-
     if (p_reply + lists_byte_count + 1 /* continuation */ > p_reply_end) {
       android_errorWriteLog(0x534e4554, "79884292");
       sdp_disconnect(p_ccb, SDP_INVALID_PDU_SIZE);
       return;
     }
 
-    if (p_ccb->rsp_list == NULL)
-      p_ccb->rsp_list = (uint8_t*)osi_malloc(SDP_MAX_LIST_BYTE_COUNT);
-    memcpy(&p_ccb->rsp_list[p_ccb->list_len], p_reply, lists_byte_count);
-    p_ccb->list_len += lists_byte_count;
+    /* Save the records in the database as they come. Stop on any error */
+    status = sdp_parse_rsp(p_ccb, p_reply, p_reply + lists_byte_count);
+    if (status != SDP_SUCCESS) {
+      sdp_disconnect(p_ccb, status);
+      return;
+    }
     p_reply += lists_byte_count;
 #if (SDP_DEBUG_RAW == TRUE)
-    SDP_TRACE_WARNING("list_len: %d(search_attr_rsp)", p_ccb->list_len);
-
     /* Check if we need to request a continuation */
     SDP_TRACE_WARNING("*p_reply:%d(%d)", *p_reply, SDP_MAX_CONTINUATION_LEN);
 #endif
@@ -619,6 +560,8 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
 
       cont_request_needed = true;
     }
+  } else {
+    sdp_parse_start(p_ccb);
   }
 
 #if (SDP_DEBUG_RAW == TRUE)
@@ -687,110 +630,248 @@ static void process_service_search_attr_rsp(tCONN_CB* p_ccb, uint8_t* p_reply,
     return;
   }
 
-/*******************************************************************/
-/* We now have the full response, which is a sequence of sequences */
-/*******************************************************************/
-
-#if (SDP_RAW_DATA_INCLUDED == TRUE)
-  SDP_TRACE_WARNING("process_service_search_attr_rsp");
-  sdp_copy_raw_data(p_ccb, true);
-#endif
-
-  p = &p_ccb->rsp_list[0];
-
-  /* The contents is a sequence of attribute sequences */
-  type = *p++;
-
-  if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE) {
-    SDP_TRACE_WARNING("SDP - Wrong type: 0x%02x in attr_rsp", type);
-    return;
-  }
-  p = sdpu_get_len_from_type(p, p + p_ccb->list_len, type, &seq_len);
-  if (p == NULL || (p + seq_len) > (p + p_ccb->list_len)) {
-    SDP_TRACE_WARNING("%s: bad length", __func__);
-    return;
-  }
-  p_end = &p_ccb->rsp_list[p_ccb->list_len];
-
-  if ((p + seq_len) != p_end) {
+  /* The sequence of attribute lists has to be complete by the last response */
+  if (p_ccb->parse_state != SDP_PARSE_DONE) {
     sdp_disconnect(p_ccb, SDP_INVALID_CONT_STATE);
     return;
   }
 
-  while (p < p_end) {
-    p = save_attr_seq(p_ccb, p, &p_ccb->rsp_list[p_ccb->list_len]);
-    if (!p) {
-      sdp_disconnect(p_ccb, SDP_DB_FULL);
-      return;
-    }
-  }
-
   /* Since we got everything we need, disconnect the call */
   sdp_disconnect(p_ccb, SDP_SUCCESS);
 }
 
 /*******************************************************************************
  *
- * Function         save_attr_seq
+ * Function         sdp_parse_start
  *
- * Description      This function is called when there is a response from
- *                  the server.
+ * Description      This function readies the parser for the attribute lists of
+ *                  a new request: a sequence of them for a service search
+ *                  attribute request, a single one for an attribute request.
  *
- * Returns          pointer to next byte or NULL if error
+ * Returns          void
  *
  ******************************************************************************/
-static uint8_t* save_attr_seq(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_msg_end) {
-  uint32_t seq_len, attr_len;
-  uint16_t attr_id;
-  uint8_t type, *p_seq_end;
-  tSDP_DISC_REC* p_rec;
+static void sdp_parse_start(tCONN_CB* p_ccb) {
+  p_ccb->parse_state =
+      p_ccb->is_attr_search ? SDP_PARSE_LIST_HDR : SDP_PARSE_REC_HDR;
+  p_ccb->parse_list_rem = 0;
+  p_ccb->parse_rec_rem = 0;
+  p_ccb->p_parse_rec = NULL;
+  p_ccb->list_len = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_parse_unit
+ *
+ * Description      This function parses the unit the parser expects next from
+ *                  the bytes in [p, p_end): a sequence header, or an attribute
+ *                  ID and its value. |p_len| is set to the length of the unit,
+ *                  or 0 if more bytes are needed to tell. The unit is only
+ *                  consumed, adding its record or attribute to the database,
+ *                  if all of it is in [p, p_end).
+ *
+ * Returns          SDP_SUCCESS, or the reason to stop if the data is bad
+ *
+ ******************************************************************************/
+static uint16_t sdp_parse_unit(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_end,
+                               uint32_t* p_len) {
+  uint8_t *p_start = p, *p_data;
+  uint32_t elem_len;
+  uint16_t attr_id = 0;
+  uint8_t type;
+
+  *p_len = 0;
+  if (p >= p_end) return SDP_SUCCESS;
 
   type = *p++;
+  switch (p_ccb->parse_state) {
+    case SDP_PARSE_LIST_HDR:
+    case SDP_PARSE_REC_HDR:
+      if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE) {
+        SDP_TRACE_WARNING("SDP - Wrong type: 0x%02x in attr_rsp", type);
+        return (p_ccb->parse_state == SDP_PARSE_LIST_HDR)
+                   ? SDP_INVALID_CONT_STATE
+                   : SDP_DB_FULL;
+      }
+      p = sdpu_get_len_from_type(p, p_end, type, &elem_len);
+      if (p == NULL) return SDP_SUCCESS;
+      *p_len = (uint32_t)(p - p_start);
+      break;
 
-  if ((type >> 3) != DATA_ELE_SEQ_DESC_TYPE) {
-    SDP_TRACE_WARNING("SDP - Wrong type: 0x%02x in attr_rsp", type);
-    return (NULL);
+    case SDP_PARSE_ATTR:
+      if (type != ((UINT_DESC_TYPE << 3) | SIZE_TWO_BYTES)) {
+        SDP_TRACE_WARNING("SDP - Bad type: 0x%02x for attr ID in attr_rsp",
+                          type);
+        return SDP_DB_FULL;
+      }
+      if (p_end - p < 3) return SDP_SUCCESS;
+      BE_STREAM_TO_UINT16(attr_id, p);
+
+      /* Keep p at the value, add_attr() parses its header again */
+      p_data = sdpu_get_len_from_type(p + 1, p_end, *p, &elem_len);
+      if (p_data == NULL) return SDP_SUCCESS;
+      *p_len = (uint32_t)(p_data - p_start) + elem_len;
+      break;
+
+    default:
+      SDP_TRACE_WARNING("SDP - Data after the last attribute list");
+      return SDP_INVALID_CONT_STATE;
   }
-  p = sdpu_get_len_from_type(p, p_msg_end, type, &seq_len);
-  if (p == NULL || (p + seq_len) > p_msg_end) {
-    SDP_TRACE_WARNING("SDP - Bad len in attr_rsp %d", seq_len);
-    return (NULL);
+
+  /* Wait for the rest of the unit */
+  if (*p_len > (uint32_t)(p_end - p_start)) return SDP_SUCCESS;
+  p_end = p_start + *p_len;
+
+  if (p_ccb->parse_state == SDP_PARSE_LIST_HDR) {
+    p_ccb->parse_list_rem = elem_len;
+    p_ccb->parse_state = elem_len ? SDP_PARSE_REC_HDR : SDP_PARSE_DONE;
+    return SDP_SUCCESS;
   }
 
-  /* Create a record */
-  p_rec = add_record(p_ccb->p_db, p_ccb->device_address);
-  if (!p_rec) {
-    SDP_TRACE_WARNING("SDP - DB full add_record");
-    return (NULL);
+#if (SDP_RAW_DATA_INCLUDED == TRUE)
+  sdp_copy_raw_data(p_ccb, p_start, *p_len);
+#endif
+
+  if (p_ccb->is_attr_search) {
+    if (*p_len > p_ccb->parse_list_rem) {
+      SDP_TRACE_WARNING("SDP - Bad len in attr_rsp %d", *p_len);
+      return SDP_DB_FULL;
+    }
+    p_ccb->parse_list_rem -= *p_len;
   }
 
-  p_seq_end = p + seq_len;
+  if (p_ccb->parse_state == SDP_PARSE_REC_HDR) {
+    if (p_ccb->is_attr_search && elem_len > p_ccb->parse_list_rem) {
+      SDP_TRACE_WARNING("SDP - Bad len in attr_rsp %d", elem_len);
+      return SDP_DB_FULL;
+    }
 
-  while (p < p_seq_end) {
-    /* First get the attribute ID */
-    type = *p++;
-    p = sdpu_get_len_from_type(p, p_msg_end, type, &attr_len);
-    if (p == NULL || (p + attr_len) > p_seq_end) {
-      SDP_TRACE_WARNING("%s: Bad len in attr_rsp %d", __func__, attr_len);
-      return (NULL);
+    /* Create a record */
+    p_ccb->p_parse_rec = add_record(p_ccb->p_db, p_ccb->device_address);
+    if (!p_ccb->p_parse_rec) {
+      SDP_TRACE_WARNING("SDP - DB full add_record");
+      return SDP_DB_FULL;
     }
-    if (((type >> 3) != UINT_DESC_TYPE) || (attr_len != 2)) {
-      SDP_TRACE_WARNING("SDP - Bad type: 0x%02x or len: %d in attr_rsp", type,
-                        attr_len);
-      return (NULL);
+    p_ccb->parse_rec_rem = elem_len;
+  } else {
+    if (*p_len > p_ccb->parse_rec_rem) {
+      SDP_TRACE_WARNING("%s: Bad len in attr_rsp %d", __func__, *p_len);
+      return SDP_DB_FULL;
     }
-    BE_STREAM_TO_UINT16(attr_id, p);
+    p_ccb->parse_rec_rem -= *p_len;
 
     /* Now, add the attribute value */
-    p = add_attr(p, p_seq_end, p_ccb->p_db, p_rec, attr_id, NULL, 0);
-
-    if (!p) {
+    if (!add_attr(p, p_end, p_ccb->p_db, p_ccb->p_parse_rec, attr_id, NULL,
+                  0)) {
       SDP_TRACE_WARNING("SDP - DB full add_attr");
-      return (NULL);
+      return SDP_DB_FULL;
     }
   }
 
-  return (p);
+  if (p_ccb->parse_rec_rem)
+    p_ccb->parse_state = SDP_PARSE_ATTR;
+  else if (p_ccb->is_attr_search && p_ccb->parse_list_rem)
+    p_ccb->parse_state = SDP_PARSE_REC_HDR;
+  else
+    p_ccb->parse_state = SDP_PARSE_DONE;
+
+  return SDP_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_parse_rsp
+ *
+ * Description      This function parses the attribute list bytes of a
+ *                  response as they arrive, rather than once the last
+ *                  continuation is in. A unit split across two responses waits
+ *                  in rsp_list for the rest of its bytes.
+ *
+ * Returns          SDP_SUCCESS, or the reason to stop
+ *
+ ******************************************************************************/
+static uint16_t sdp_parse_rsp(tCONN_CB* p_ccb, uint8_t* p, uint8_t* p_end) {
+  uint32_t len = 0, cpy_len;
+  uint16_t status;
+
+  /* Finish the unit the last response ended in the middle of. The parser
+   * only tells its length here, as it isn't all in yet. */
+  if (p_ccb->list_len) {
+    status = sdp_parse_unit(p_ccb, p_ccb->rsp_list,
+                            p_ccb->rsp_list + p_ccb->list_len, &len);
+    if (status != SDP_SUCCESS) return status;
+  }
+  while (p_ccb->list_len && p < p_end) {
+    if (len > SDP_MAX_LIST_BYTE_COUNT) return SDP_INVALID_PDU_SIZE;
+
+    /* Take a byte at a time until the header gives the length */
+    cpy_len = len ? len - p_ccb->list_len : 1;
+    if (cpy_len > (uint32_t)(p_end - p)) cpy_len = (uint32_t)(p_end - p);
+    memcpy(&p_ccb->rsp_list[p_ccb->list_len], p, cpy_len);
+    p_ccb->list_len += cpy_len;
+    p += cpy_len;
+
+    status = sdp_parse_unit(p_ccb, p_ccb->rsp_list,
+                            p_ccb->rsp_list + p_ccb->list_len, &len);
+    if (status != SDP_SUCCESS) return status;
+    if (len && len <= p_ccb->list_len) p_ccb->list_len = 0;
+  }
+
+  /* Then parse the whole units in place */
+  while (p < p_end) {
+    /* An attribute response may have bytes past its list, ignore them */
+    if (p_ccb->parse_state == SDP_PARSE_DONE && !p_ccb->is_attr_search) break;
+
+    status = sdp_parse_unit(p_ccb, p, p_end, &len);
+    if (status != SDP_SUCCESS) return status;
+
+    if (len == 0 || len > (uint32_t)(p_end - p)) {
+      if (len > SDP_MAX_LIST_BYTE_COUNT) return SDP_INVALID_PDU_SIZE;
+
+      if (p_ccb->rsp_list == NULL)
+        p_ccb->rsp_list = (uint8_t*)osi_malloc(SDP_MAX_LIST_BYTE_COUNT);
+      p_ccb->list_len = (uint16_t)(p_end - p);
+      memcpy(p_ccb->rsp_list, p, p_ccb->list_len);
+      break;
+    }
+    p += len;
+  }
+
+  return SDP_SUCCESS;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_db_grow
+ *
+ * Description      This function adds a block of at least |len| bytes to a DB
+ *                  with a mem_max when its current one is too full. The block
+ *                  is at least as large as the DB so far so that a few of them
+ *                  take it to its final size.
+ *
+ * Returns          true if the bytes are free, false if the DB is full
+ *
+ ******************************************************************************/
+static bool sdp_db_grow(tSDP_DISCOVERY_DB* p_db, uint32_t len) {
+  uint32_t block_len;
+  uint8_t* p_block;
+
+  if (p_db->mem_size >= p_db->mem_max || p_db->mem_max - p_db->mem_size < len)
+    return false;
+
+  block_len = std::max(len, p_db->mem_size);
+  block_len = std::min(block_len, p_db->mem_max - p_db->mem_size);
+
+  /* Each block starts with the address of the one added before it */
+  p_block = (uint8_t*)osi_calloc(sizeof(uint8_t*) + block_len);
+  *(uint8_t**)p_block = p_db->p_ext_mem;
+  p_db->p_ext_mem = p_block;
+
+  p_db->p_free_mem = p_block + sizeof(uint8_t*);
+  p_db->mem_free = block_len;
+  p_db->mem_size += block_len;
+  return true;
 }
 
 /*******************************************************************************
@@ -806,7 +887,9 @@ tSDP_DISC_REC* add_record(tSDP_DISCOVERY_DB* p_db, const RawAddress& p_bda) {
   tSDP_DISC_REC* p_rec;
 
   /* See if there is enough space in the database */
-  if (p_db->mem_free < sizeof(tSDP_DISC_REC)) return (NULL);
+  if (p_db->mem_free < sizeof(tSDP_DISC_REC) &&
+      !sdp_db_grow(p_db, sizeof(tSDP_DISC_REC)))
+    return (NULL);
 
   p_rec = (tSDP_DISC_REC*)p_db->p_free_mem;
   p_db->p_free_mem += sizeof(tSDP_DISC_REC);
@@ -882,7 +965,8 @@ static uint8_t* add_attr(uint8_t* p, uint8_t* p_end, tSDP_DISCOVERY_DB* p_db,
   total_len = (total_len + 3) & ~3;
 
   /* See if there is enough space in the database */
-  if (p_db->mem_free < total_len) return (NULL);
+  if (p_db->mem_free < total_len && !sdp_db_grow(p_db, total_len))
+    return (NULL);
 
   p_attr = (tSDP_DISC_ATTR*)p_db->p_free_mem;
   p_attr->attr_id = attr_id;
@@ -87,6 +87,8 @@ void sdp_init(void) {
   sdp_cb.max_recs_per_search = SDP_MAX_DISC_SERVER_RECS;
 
 #if (SDP_SERVER_ENABLED == TRUE)
+  sdp_db_init();
+
   /* Register with Security Manager for the specific security level */
   if (!BTM_SetSecurityLevel(false, SDP_SERVICE_NAME, BTM_SEC_SERVICE_SDP_SERVER,
                             SDP_SECURITY_LEVEL, SDP_PSM, 0, 0)) {
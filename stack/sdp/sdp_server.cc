@@ -27,6 +27,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <list>
+#include <string>
+#include <vector>
 
 #include "bt_common.h"
 #include "bt_types.h"
@@ -48,6 +52,18 @@
 #define SDP_MAX_SERVATTR_RSPHDR_LEN 10
 #define SDP_MAX_ATTR_RSPHDR_LEN 10
 
+using bluetooth::Uuid;
+
+/* A service search attribute response, serialized in full */
+typedef struct {
+  std::string key; /* See sdp_rsp_cache_key() */
+  std::vector<uint8_t> attr_list;
+} tSDP_CACHED_RSP;
+
+/* Most recently used first, all built from database sdp_rsp_cache_version */
+static std::list<tSDP_CACHED_RSP> sdp_rsp_cache;
+static uint32_t sdp_rsp_cache_version;
+
 /******************************************************************************/
 /*            L O C A L    F U N C T I O N     P R O T O T Y P E S            */
 /******************************************************************************/
@@ -397,7 +413,6 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     p_rsp = &p_ccb->rsp_list[3]; /* Leave space for data elem descr */
 
     /* Reset continuation parameters in p_ccb */
-    p_ccb->cont_info.prev_sdp_rec = NULL;
     p_ccb->cont_info.next_attr_index = 0;
     p_ccb->cont_info.attr_offset = 0;
   }
@@ -532,6 +547,157 @@ static void process_service_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   L2CA_DataWrite(p_ccb->connection_id, p_buf);
 }
 
+/*******************************************************************************
+ *
+ * Function         sdp_rsp_cache_key
+ *
+ * Description      This function builds the response cache key of a service
+ *                  search attribute request. The UUIDs are sorted, as any
+ *                  order matches the same records, while the attribute ranges
+ *                  are kept in order, as that is the order of the attributes
+ *                  in the response.
+ *
+ * Returns          true if built, false if a UUID is invalid
+ *
+ ******************************************************************************/
+static bool sdp_rsp_cache_key(tSDP_UUID_SEQ* p_uid_seq,
+                              tSDP_ATTR_SEQ* p_attr_seq, std::string* p_key) {
+  std::vector<Uuid> uuids;
+  uint16_t xx;
+
+  for (xx = 0; xx < p_uid_seq->num_uids; xx++) {
+    Uuid uuid;
+    if (!sdpu_uuid_from_array(p_uid_seq->uuid_entry[xx].value,
+                              p_uid_seq->uuid_entry[xx].len, &uuid))
+      return false;
+    uuids.push_back(uuid);
+  }
+  std::sort(uuids.begin(), uuids.end());
+  uuids.erase(std::unique(uuids.begin(), uuids.end()), uuids.end());
+
+  p_key->clear();
+  p_key->push_back((char)uuids.size());
+  for (const Uuid& uuid : uuids)
+    p_key->append((const char*)uuid.To128BitBE().data(), Uuid::kNumBytes128);
+  p_key->append((const char*)p_attr_seq->attr_entry,
+                p_attr_seq->num_attr * sizeof(tATT_ENT));
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_build_search_attr_list
+ *
+ * Description      This function serializes the whole attribute list of a
+ *                  service search attribute request: one data element
+ *                  sequence per matching record that has any of the
+ *                  attributes, all of them in one data element sequence.
+ *
+ * Returns          true if built, false if the list does not fit the 16 bit
+ *                  continuation offset
+ *
+ ******************************************************************************/
+static bool sdp_build_search_attr_list(tSDP_UUID_SEQ* p_uid_seq,
+                                       tSDP_ATTR_SEQ* p_attr_seq,
+                                       std::vector<uint8_t>* p_list) {
+  std::vector<tSDP_ATTRIBUTE*> attrs;
+  tSDP_RECORD* p_rec;
+  tSDP_ATTRIBUTE* p_attr;
+  uint32_t list_len = 0, seq_len;
+  uint16_t xx, start_id;
+  uint8_t* p;
+
+  /* Leave space for the list's data elem descr */
+  p_list->assign(3, 0);
+
+  for (p_rec = sdp_db_service_search(NULL, p_uid_seq); p_rec;
+       p_rec = sdp_db_service_search(p_rec, p_uid_seq)) {
+    /* Collect the attributes, sticking with a range till no more attributes
+     * are found in it */
+    attrs.clear();
+    seq_len = 0;
+    for (xx = 0; xx < p_attr_seq->num_attr; xx++) {
+      start_id = p_attr_seq->attr_entry[xx].start;
+      while ((p_attr = sdp_db_find_attr_in_rec(
+                  p_rec, start_id, p_attr_seq->attr_entry[xx].end)) != NULL) {
+        attrs.push_back(p_attr);
+        seq_len += sdpu_get_attrib_entry_len(p_attr);
+
+        if (p_attr->id == p_attr_seq->attr_entry[xx].end) break;
+        start_id = p_attr->id + 1;
+      }
+    }
+    if (attrs.empty()) continue;
+
+    list_len += 3 + seq_len;
+    if (list_len + 3 > 0xFFFF) return false;
+
+    size_t rec_offset = p_list->size();
+    p_list->resize(rec_offset + 3 + seq_len);
+    p = &(*p_list)[rec_offset];
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+    UINT16_TO_BE_STREAM(p, seq_len);
+    for (tSDP_ATTRIBUTE* p_rec_attr : attrs)
+      p = sdpu_build_attrib_entry(p, p_rec_attr);
+  }
+
+  /* Put in the sequence header (2 or 3 bytes) */
+  p = &(*p_list)[0];
+  if (list_len + 3 > 255) {
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
+    UINT16_TO_BE_STREAM(p, list_len);
+  } else {
+    p_list->erase(p_list->begin());
+    p = &(*p_list)[0];
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+    UINT8_TO_BE_STREAM(p, list_len);
+  }
+  return true;
+}
+
+/*******************************************************************************
+ *
+ * Function         sdp_rsp_cache_get
+ *
+ * Description      This function returns the serialized attribute list of a
+ *                  service search attribute request, from the response cache
+ *                  if the same UUIDs and attribute ranges were asked for since
+ *                  the database last changed, or else newly built and cached.
+ *
+ * Returns          Pointer to the attribute list, valid until the next call,
+ *                  or NULL if it can't be built.
+ *
+ ******************************************************************************/
+const std::vector<uint8_t>* sdp_rsp_cache_get(tSDP_UUID_SEQ* p_uid_seq,
+                                              tSDP_ATTR_SEQ* p_attr_seq) {
+  std::string key;
+
+  if (sdp_rsp_cache_version != sdp_db_get_version()) {
+    sdp_rsp_cache.clear();
+    sdp_rsp_cache_version = sdp_db_get_version();
+  }
+
+  if (!sdp_rsp_cache_key(p_uid_seq, p_attr_seq, &key)) return NULL;
+
+  for (auto it = sdp_rsp_cache.begin(); it != sdp_rsp_cache.end(); it++) {
+    if (it->key == key) {
+      /* Keep the most recently used response first */
+      sdp_rsp_cache.splice(sdp_rsp_cache.begin(), sdp_rsp_cache, it);
+      return &sdp_rsp_cache.front().attr_list;
+    }
+  }
+
+  std::vector<uint8_t> attr_list;
+  if (!sdp_build_search_attr_list(p_uid_seq, p_attr_seq, &attr_list))
+    return NULL;
+
+  while (!sdp_rsp_cache.empty() &&
+         sdp_rsp_cache.size() >= SDP_MAX_CACHED_RSPS)
+    sdp_rsp_cache.pop_back();
+  sdp_rsp_cache.push_front({std::move(key), std::move(attr_list)});
+  return &sdp_rsp_cache.front().attr_list;
+}
+
 /*******************************************************************************
  *
  * Function         process_service_search_attr_req
@@ -548,17 +714,13 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
                                             uint16_t param_len, uint8_t* p_req,
                                             uint8_t* p_req_end) {
   uint16_t max_list_len;
-  int16_t rem_len;
   uint16_t len_to_send, cont_offset;
   tSDP_UUID_SEQ uid_seq;
   uint8_t *p_rsp, *p_rsp_start, *p_rsp_param_len;
-  uint16_t rsp_param_len, xx;
-  tSDP_RECORD* p_rec;
-  tSDP_ATTR_SEQ attr_seq, attr_seq_sav;
-  tSDP_ATTRIBUTE* p_attr;
-  bool maxxed_out = false, is_cont = false;
-  uint8_t* p_seq_start;
-  uint16_t seq_len, attr_len;
+  uint16_t rsp_param_len;
+  tSDP_ATTR_SEQ attr_seq;
+  const std::vector<uint8_t>* p_list;
+  bool is_cont = false;
 
   /* Extract the UUID sequence to search for */
   p_req = sdpu_extract_uid_seq(p_req, param_len, &uid_seq);
@@ -586,18 +748,12 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
     return;
   }
 
-  memcpy(&attr_seq_sav, &attr_seq, sizeof(tSDP_ATTR_SEQ));
-
   if (max_list_len < 4) {
     sdpu_build_n_send_error(p_ccb, trans_num, SDP_ILLEGAL_PARAMETER, NULL);
     android_errorWriteLog(0x534e4554, "68817966");
     return;
   }
 
-  /* Free and reallocate buffer */
-  osi_free(p_ccb->rsp_list);
-  p_ccb->rsp_list = (uint8_t*)osi_malloc(max_list_len);
-
   /* Check if this is a continuation request */
   if (*p_req) {
     if (*p_req++ != SDP_CONTINUATION_LEN ||
@@ -614,183 +770,38 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
       return;
     }
     is_cont = true;
-
-    /* Initialise for continuation response */
-    p_rsp = &p_ccb->rsp_list[0];
-    attr_seq.attr_entry[p_ccb->cont_info.next_attr_index].start =
-        p_ccb->cont_info.next_attr_start_id;
   } else {
     p_ccb->cont_offset = 0;
-    p_rsp = &p_ccb->rsp_list[3]; /* Leave space for data elem descr */
-
-    /* Reset continuation parameters in p_ccb */
-    p_ccb->cont_info.prev_sdp_rec = NULL;
-    p_ccb->cont_info.next_attr_index = 0;
-    p_ccb->cont_info.last_attr_seq_desc_sent = false;
-    p_ccb->cont_info.attr_offset = 0;
+    p_ccb->cont_info.db_version = sdp_db_get_version();
   }
 
-  /* Get a list of handles that match the UUIDs given to us */
-  for (p_rec = sdp_db_service_search(p_ccb->cont_info.prev_sdp_rec, &uid_seq);
-       p_rec; p_rec = sdp_db_service_search(p_rec, &uid_seq)) {
-    /* Allow space for attribute sequence type and length */
-    p_seq_start = p_rsp;
-    if (!p_ccb->cont_info.last_attr_seq_desc_sent) {
-      /* See if there is enough room to include a new service in the current
-       * response */
-      rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
-      if (rem_len < 3) {
-        /* Not enough room. Update continuation info for next response */
-        p_ccb->cont_info.next_attr_index = 0;
-        p_ccb->cont_info.next_attr_start_id = attr_seq.attr_entry[0].start;
-        break;
-      }
-      p_rsp += 3;
-    }
-
-    /* Get a list of handles that match the UUIDs given to us */
-    for (xx = p_ccb->cont_info.next_attr_index; xx < attr_seq.num_attr; xx++) {
-      p_attr = sdp_db_find_attr_in_rec(p_rec, attr_seq.attr_entry[xx].start,
-                                       attr_seq.attr_entry[xx].end);
-
-      if (p_attr) {
-        /* Check if attribute fits. Assume 3-byte value type/length */
-        rem_len = max_list_len - (int16_t)(p_rsp - &p_ccb->rsp_list[0]);
-
-        /* just in case */
-        if (rem_len <= 0) {
-          p_ccb->cont_info.next_attr_index = xx;
-          p_ccb->cont_info.next_attr_start_id = p_attr->id;
-          maxxed_out = true;
-          break;
-        }
-
-        attr_len = sdpu_get_attrib_entry_len(p_attr);
-        /* if there is a partial attribute pending to be sent */
-        if (p_ccb->cont_info.attr_offset) {
-          if (attr_len < p_ccb->cont_info.attr_offset) {
-            android_errorWriteLog(0x534e4554, "79217770");
-            LOG(ERROR) << "offset is bigger than attribute length";
-            sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE,
-                                    SDP_TEXT_BAD_CONT_LEN);
-            return;
-          }
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, rem_len, &p_ccb->cont_info.attr_offset);
-
-          /* If the partial attrib could not been fully added yet */
-          if (p_ccb->cont_info.attr_offset != attr_len) {
-            maxxed_out = true;
-            break;
-          } else /* If the partial attrib has been added in full by now */
-            p_ccb->cont_info.attr_offset = 0; /* reset attr_offset */
-        } else if (rem_len <
-                   attr_len) /* Not enough space for attr... so add partially */
-        {
-          if (attr_len >= SDP_MAX_ATTR_LEN) {
-            SDP_TRACE_ERROR("SDP attr too big: max_list_len=%d,attr_len=%d",
-                            max_list_len, attr_len);
-            sdpu_build_n_send_error(p_ccb, trans_num, SDP_NO_RESOURCES, NULL);
-            return;
-          }
-
-          /* add the partial attribute if possible */
-          p_rsp = sdpu_build_partial_attrib_entry(
-              p_rsp, p_attr, (uint16_t)rem_len, &p_ccb->cont_info.attr_offset);
-
-          p_ccb->cont_info.next_attr_index = xx;
-          p_ccb->cont_info.next_attr_start_id = p_attr->id;
-          maxxed_out = true;
-          break;
-        } else /* build the whole attribute */
-          p_rsp = sdpu_build_attrib_entry(p_rsp, p_attr);
-
-        /* If doing a range, stick with this one till no more attributes found
-         */
-        if (attr_seq.attr_entry[xx].start != attr_seq.attr_entry[xx].end) {
-          /* Update for next time through */
-          attr_seq.attr_entry[xx].start = p_attr->id + 1;
-
-          xx--;
-        }
-      }
-    }
-
-    /* Go back and put the type and length into the buffer */
-    if (!p_ccb->cont_info.last_attr_seq_desc_sent) {
-      seq_len = sdpu_get_attrib_seq_len(p_rec, &attr_seq_sav);
-      if (seq_len != 0) {
-        UINT8_TO_BE_STREAM(p_seq_start,
-                           (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
-        UINT16_TO_BE_STREAM(p_seq_start, seq_len);
-
-        if (maxxed_out) p_ccb->cont_info.last_attr_seq_desc_sent = true;
-      } else
-        p_rsp = p_seq_start;
-    }
-
-    if (maxxed_out) break;
-
-    /* Restore the attr_seq to look for in the next sdp record */
-    memcpy(&attr_seq, &attr_seq_sav, sizeof(tSDP_ATTR_SEQ));
-
-    /* Reset the next attr index */
-    p_ccb->cont_info.next_attr_index = 0;
-    p_ccb->cont_info.prev_sdp_rec = p_rec;
-    p_ccb->cont_info.last_attr_seq_desc_sent = false;
+  // The continuation offset is into the attribute list as it was when the
+  // first fragment was sent. If a record was added or deleted since, the rest
+  // of the list no longer lines up with it, and continuing could also loop
+  // forever with the client if the list got shorter, so we tell the peer an
+  // error occurred instead.
+  if (is_cont && p_ccb->cont_info.db_version != sdp_db_get_version()) {
+    sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE, NULL);
+    return;
   }
 
-  /* response length */
-  len_to_send = (uint16_t)(p_rsp - &p_ccb->rsp_list[0]);
-  cont_offset = 0;
+  /* Get the whole attribute list, then send the part the client is at */
+  p_list = sdp_rsp_cache_get(&uid_seq, &attr_seq);
+  if (!p_list) {
+    SDP_TRACE_ERROR("%s: attribute list too big", __func__);
+    sdpu_build_n_send_error(p_ccb, trans_num, SDP_NO_RESOURCES, NULL);
+    return;
+  }
+  p_ccb->list_len = (uint16_t)p_list->size();
 
-  // The current SDP server design has a critical flaw where it can run into
-  // an infinite request/response loop with the client. Here's the scenario:
-  // - client makes SDP request
-  // - server returns the first fragment of the response with a continuation
-  //   token
-  // - an SDP record is deleted from the server
-  // - client issues another request with previous continuation token
-  // - server has nothing to send back because the record is unavailable but
-  //   in the first fragment, it had specified more response bytes than are
-  //   now available
-  // - server sends back no additional response bytes and returns the same
-  //   continuation token
-  // - client issues another request with the continuation token, and the
-  //   process repeats
-  //
-  // We work around this design flaw here by checking if we will make forward
-  // progress (i.e. we will send > 0 response bytes) on a continued request.
-  // If not, we must have run into the above situation and we tell the peer an
-  // error occurred.
-  //
-  // TODO(sharvil): rewrite SDP server.
-  if (is_cont && len_to_send == 0) {
+  /* A continuation must make forward progress */
+  if (is_cont && p_ccb->cont_offset >= p_ccb->list_len) {
     sdpu_build_n_send_error(p_ccb, trans_num, SDP_INVALID_CONT_STATE, NULL);
     return;
   }
 
-  /* If first response, insert sequence header */
-  if (!is_cont) {
-    /* Get the total list length for requested uid and attribute sequence */
-    p_ccb->list_len = sdpu_get_list_len(&uid_seq, &attr_seq_sav) + 3;
-    /* Put in the sequence header (2 or 3 bytes) */
-    if (p_ccb->list_len > 255) {
-      p_ccb->rsp_list[0] =
-          (uint8_t)((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_WORD);
-      p_ccb->rsp_list[1] = (uint8_t)((p_ccb->list_len - 3) >> 8);
-      p_ccb->rsp_list[2] = (uint8_t)(p_ccb->list_len - 3);
-    } else {
-      cont_offset = 1;
-
-      p_ccb->rsp_list[1] =
-          (uint8_t)((DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
-      p_ccb->rsp_list[2] = (uint8_t)(p_ccb->list_len - 3);
-
-      p_ccb->list_len--;
-      len_to_send--;
-    }
-  }
+  len_to_send = p_ccb->list_len - p_ccb->cont_offset;
+  if (len_to_send > max_list_len) len_to_send = max_list_len;
 
   /* Get a buffer to use to build the response */
   BT_HDR* p_buf = (BT_HDR*)osi_malloc(SDP_DATA_BUF_SIZE);
@@ -808,16 +819,14 @@ static void process_service_search_attr_req(tCONN_CB* p_ccb, uint16_t trans_num,
   /* Stream the list length to send */
   UINT16_TO_BE_STREAM(p_rsp, len_to_send);
 
-  /* copy from rsp_list to the actual buffer to be sent */
-  memcpy(p_rsp, &p_ccb->rsp_list[cont_offset], len_to_send);
+  /* copy from the attribute list to the actual buffer to be sent */
+  memcpy(p_rsp, &(*p_list)[p_ccb->cont_offset], len_to_send);
   p_rsp += len_to_send;
 
   p_ccb->cont_offset += len_to_send;
 
   /* If anything left to send, continuation needed */
   if (p_ccb->cont_offset < p_ccb->list_len) {
-    is_cont = true;
-
     UINT8_TO_BE_STREAM(p_rsp, SDP_CONTINUATION_LEN);
     UINT16_TO_BE_STREAM(p_rsp, p_ccb->cont_offset);
   } else
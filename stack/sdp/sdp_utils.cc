@@ -684,6 +684,38 @@ bool sdpu_compare_uuid_arrays(uint8_t* p_uuid1, uint32_t len1, uint8_t* p_uuid2,
   }
 }
 
+/*******************************************************************************
+ *
+ * Function         sdpu_uuid_from_array
+ *
+ * Description      This function expands a BE UUID of 2, 4 or 16 bytes into
+ *                  |p_uuid|, so that UUIDs matching under
+ *                  sdpu_compare_uuid_arrays() compare equal.
+ *
+ * Returns          true if converted, false if the length is invalid
+ *
+ ******************************************************************************/
+bool sdpu_uuid_from_array(uint8_t* p_array, uint32_t len, Uuid* p_uuid) {
+  uint16_t uuid16;
+  uint32_t uuid32;
+
+  switch (len) {
+    case 2:
+      BE_STREAM_TO_UINT16(uuid16, p_array);
+      *p_uuid = Uuid::From16Bit(uuid16);
+      return true;
+    case 4:
+      BE_STREAM_TO_UINT32(uuid32, p_array);
+      *p_uuid = Uuid::From32Bit(uuid32);
+      return true;
+    case 16:
+      *p_uuid = Uuid::From128BitBE(p_array);
+      return true;
+    default:
+      return false;
+  }
+}
+
 /*******************************************************************************
  *
  * Function         sdpu_compare_uuid_with_attr
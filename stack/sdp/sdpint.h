@@ -25,6 +25,8 @@
 #ifndef SDP_INT_H
 #define SDP_INT_H
 
+#include <vector>
+
 #include "bluetooth/uuid.h"
 #include "bt_target.h"
 #include "l2c_api.h"
@@ -144,12 +146,10 @@ typedef struct {
   uint16_t next_attr_index;    /* attr index for next continuation response */
   uint16_t next_attr_start_id; /* attr id to start with for the attr index in
                                   next cont. response */
-  tSDP_RECORD* prev_sdp_rec; /* last sdp record that was completely sent in the
-                                response */
-  bool last_attr_seq_desc_sent; /* whether attr seq length has been sent
-                                   previously */
   uint16_t attr_offset; /* offset within the attr to keep trak of partial
                            attributes in the responses */
+  uint32_t db_version; /* database version the service search attribute
+                          response was built from */
 } tSDP_CONT_INFO;
 #endif /* SDP_SERVER_ENABLED == TRUE */
 
@@ -197,6 +197,18 @@ typedef struct {
   uint8_t disc_state;
   uint8_t is_attr_search;
 
+/* Where the parser of the attribute lists in the responses is. The unit it
+ * expects next is kept in rsp_list when a response splits it. */
+#define SDP_PARSE_LIST_HDR 0 /* Header of the sequence of attribute lists */
+#define SDP_PARSE_REC_HDR 1  /* Header of an attribute list */
+#define SDP_PARSE_ATTR 2     /* Attribute ID and value */
+#define SDP_PARSE_DONE 3
+
+  uint8_t parse_state;
+  uint32_t parse_list_rem;    /* Bytes left in the sequence of lists */
+  uint32_t parse_rec_rem;     /* Bytes left in the current attribute list */
+  tSDP_DISC_REC* p_parse_rec; /* Record the attributes go into */
+
 #if (SDP_SERVER_ENABLED == TRUE)
   uint16_t cont_offset;     /* Continuation state data in the server response */
   tSDP_CONT_INFO cont_info; /* structure to hold continuation information for
@@ -268,6 +280,8 @@ extern uint8_t* sdpu_get_len_from_type(uint8_t* p, uint8_t* p_end, uint8_t type,
 extern bool sdpu_is_base_uuid(uint8_t* p_uuid);
 extern bool sdpu_compare_uuid_arrays(uint8_t* p_uuid1, uint32_t len1,
                                      uint8_t* p_uuid2, uint16_t len2);
+extern bool sdpu_uuid_from_array(uint8_t* p_array, uint32_t len,
+                                 bluetooth::Uuid* p_uuid);
 extern bool sdpu_compare_uuid_with_attr(const bluetooth::Uuid& uuid,
                                         tSDP_DISC_ATTR* p_attr);
 
@@ -283,6 +297,8 @@ extern uint8_t* sdpu_build_partial_attrib_entry(uint8_t* p_out,
 
 /* Functions provided by sdp_db.cc
  */
+extern void sdp_db_init(void);
+extern uint32_t sdp_db_get_version(void);
 extern tSDP_RECORD* sdp_db_service_search(tSDP_RECORD* p_rec,
                                           tSDP_UUID_SEQ* p_seq);
 extern tSDP_RECORD* sdp_db_find_record(uint32_t handle);
@@ -294,6 +310,8 @@ extern tSDP_ATTRIBUTE* sdp_db_find_attr_in_rec(tSDP_RECORD* p_rec,
  */
 #if (SDP_SERVER_ENABLED == TRUE)
 extern void sdp_server_handle_client_req(tCONN_CB* p_ccb, BT_HDR* p_msg);
+extern const std::vector<uint8_t>* sdp_rsp_cache_get(tSDP_UUID_SEQ* p_uid_seq,
+                                                     tSDP_ATTR_SEQ* p_attr_seq);
 #else
 #define sdp_server_handle_client_req(p_ccb, p_msg)
 #endif
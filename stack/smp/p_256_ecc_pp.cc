@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "p_256_montgomery.h"
 #include "p_256_multprecision.h"
 
 elliptic_curve_t curve;
@@ -246,6 +247,363 @@ void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n,
   multiprecision_mersenns_mult_mod(q->y, q->y, q->z, keyLength);
 }
 
+// Point on P-256 in Jacobian coordinates, Montgomery form, z = 0 at infinity
+typedef struct {
+  uint64_t x[KEY_LENGTH_QWORDS_P256];
+  uint64_t y[KEY_LENGTH_QWORDS_P256];
+  uint64_t z[KEY_LENGTH_QWORDS_P256];
+} p256_jacobian_t;
+
+// Affine point on P-256, Montgomery form
+typedef struct {
+  uint64_t x[KEY_LENGTH_QWORDS_P256];
+  uint64_t y[KEY_LENGTH_QWORDS_P256];
+} p256_affine_t;
+
+// Width of the NAF for variable base multiplication, and the number of odd
+// multiples 1p, 3p, ..., 15p it needs
+#define P256_WNAF_WIDTH 5
+#define P256_WNAF_TABLE_SIZE (1 << (P256_WNAF_WIDTH - 2))
+
+// The comb for the generator has 8 teeth, 32 bits apart: a dword of the
+// scalar each
+#define P256_COMB_TEETH 8
+#define P256_COMB_SPACING 32
+
+static void p_256_jacobian_from_affine(p256_jacobian_t* q,
+                                       const p256_affine_t* p) {
+  memcpy(q->x, p->x, sizeof(q->x));
+  memcpy(q->y, p->y, sizeof(q->y));
+  memcpy(q->z, p_256_mont_one, sizeof(q->z));
+}
+
+// q = 2p, a = -3 (dbl-2001-b). q and p may be the same.
+static void p_256_jacobian_double(p256_jacobian_t* q,
+                                  const p256_jacobian_t* p) {
+  uint64_t delta[KEY_LENGTH_QWORDS_P256], gamma[KEY_LENGTH_QWORDS_P256];
+  uint64_t beta[KEY_LENGTH_QWORDS_P256], alpha[KEY_LENGTH_QWORDS_P256];
+  uint64_t t1[KEY_LENGTH_QWORDS_P256], t2[KEY_LENGTH_QWORDS_P256];
+
+  if (p_256_mont_iszero(p->z)) {
+    memset(q, 0, sizeof(*q));
+    return;
+  }
+
+  p_256_mont_sqr(delta, p->z);            // delta = z1^2
+  p_256_mont_sqr(gamma, p->y);            // gamma = y1^2
+  p_256_mont_mul(beta, p->x, gamma);      // beta = x1 * gamma
+  p_256_mont_sub(t1, p->x, delta);        // t1 = x1 - delta
+  p_256_mont_add(t2, p->x, delta);        // t2 = x1 + delta
+  p_256_mont_mul(t1, t1, t2);             // alpha = 3 * t1 * t2
+  p_256_mont_add(alpha, t1, t1);
+  p_256_mont_add(alpha, alpha, t1);
+
+  p_256_mont_add(t1, p->y, p->z);         // z3 = (y1 + z1)^2 - gamma - delta
+  p_256_mont_sqr(t1, t1);
+  p_256_mont_sub(t1, t1, gamma);
+  p_256_mont_sub(q->z, t1, delta);
+
+  p_256_mont_add(beta, beta, beta);       // beta = 4 * beta
+  p_256_mont_add(beta, beta, beta);
+  p_256_mont_sqr(t1, alpha);              // x3 = alpha^2 - 2 * beta
+  p_256_mont_sub(t1, t1, beta);
+  p_256_mont_sub(q->x, t1, beta);
+
+  p_256_mont_sub(t1, beta, q->x);         // y3 = alpha * (beta - x3)
+  p_256_mont_mul(t1, t1, alpha);          //      - 8 * gamma^2
+  p_256_mont_sqr(t2, gamma);
+  p_256_mont_add(t2, t2, t2);
+  p_256_mont_add(t2, t2, t2);
+  p_256_mont_add(t2, t2, t2);
+  p_256_mont_sub(q->y, t1, t2);
+}
+
+// r = p + q (add-2007-bl). r may be the same as p or q.
+static void p_256_jacobian_add(p256_jacobian_t* r, const p256_jacobian_t* p,
+                               const p256_jacobian_t* q) {
+  uint64_t z1z1[KEY_LENGTH_QWORDS_P256], z2z2[KEY_LENGTH_QWORDS_P256];
+  uint64_t u1[KEY_LENGTH_QWORDS_P256], u2[KEY_LENGTH_QWORDS_P256];
+  uint64_t s1[KEY_LENGTH_QWORDS_P256], s2[KEY_LENGTH_QWORDS_P256];
+  uint64_t h[KEY_LENGTH_QWORDS_P256], i[KEY_LENGTH_QWORDS_P256];
+  uint64_t j[KEY_LENGTH_QWORDS_P256], rr[KEY_LENGTH_QWORDS_P256];
+  uint64_t v[KEY_LENGTH_QWORDS_P256], t[KEY_LENGTH_QWORDS_P256];
+
+  if (p_256_mont_iszero(p->z)) {
+    *r = *q;
+    return;
+  }
+  if (p_256_mont_iszero(q->z)) {
+    *r = *p;
+    return;
+  }
+
+  p_256_mont_sqr(z1z1, p->z);
+  p_256_mont_sqr(z2z2, q->z);
+  p_256_mont_mul(u1, p->x, z2z2);         // u1 = x1 * z2^2
+  p_256_mont_mul(u2, q->x, z1z1);         // u2 = x2 * z1^2
+  p_256_mont_mul(s1, p->y, q->z);         // s1 = y1 * z2^3
+  p_256_mont_mul(s1, s1, z2z2);
+  p_256_mont_mul(s2, q->y, p->z);         // s2 = y2 * z1^3
+  p_256_mont_mul(s2, s2, z1z1);
+  p_256_mont_sub(h, u2, u1);
+  p_256_mont_sub(rr, s2, s1);
+
+  if (p_256_mont_iszero(h)) {
+    if (p_256_mont_iszero(rr))
+      p_256_jacobian_double(r, p);
+    else
+      memset(r, 0, sizeof(*r));  // p = -q
+    return;
+  }
+
+  p_256_mont_add(rr, rr, rr);             // r = 2 * (s2 - s1)
+  p_256_mont_add(i, h, h);                // i = (2 * h)^2
+  p_256_mont_sqr(i, i);
+  p_256_mont_mul(j, h, i);                // j = h * i
+  p_256_mont_mul(v, u1, i);               // v = u1 * i
+
+  p_256_mont_add(t, p->z, q->z);          // z3 = ((z1 + z2)^2 - z1z1
+  p_256_mont_sqr(t, t);                   //       - z2z2) * h
+  p_256_mont_sub(t, t, z1z1);
+  p_256_mont_sub(t, t, z2z2);
+  p_256_mont_mul(r->z, t, h);
+
+  p_256_mont_sqr(t, rr);                  // x3 = r^2 - j - 2 * v
+  p_256_mont_sub(t, t, j);
+  p_256_mont_sub(t, t, v);
+  p_256_mont_sub(r->x, t, v);
+
+  p_256_mont_sub(t, v, r->x);             // y3 = r * (v - x3) - 2 * s1 * j
+  p_256_mont_mul(t, t, rr);
+  p_256_mont_mul(s1, s1, j);
+  p_256_mont_add(s1, s1, s1);
+  p_256_mont_sub(r->y, t, s1);
+}
+
+// r = p + q, q affine (madd-2007-bl). r may be the same as p.
+static void p_256_jacobian_add_affine(p256_jacobian_t* r,
+                                      const p256_jacobian_t* p,
+                                      const p256_affine_t* q) {
+  uint64_t z1z1[KEY_LENGTH_QWORDS_P256], u2[KEY_LENGTH_QWORDS_P256];
+  uint64_t s2[KEY_LENGTH_QWORDS_P256], h[KEY_LENGTH_QWORDS_P256];
+  uint64_t hh[KEY_LENGTH_QWORDS_P256], i[KEY_LENGTH_QWORDS_P256];
+  uint64_t j[KEY_LENGTH_QWORDS_P256], rr[KEY_LENGTH_QWORDS_P256];
+  uint64_t v[KEY_LENGTH_QWORDS_P256], t[KEY_LENGTH_QWORDS_P256];
+
+  if (p_256_mont_iszero(p->z)) {
+    p_256_jacobian_from_affine(r, q);
+    return;
+  }
+
+  p_256_mont_sqr(z1z1, p->z);
+  p_256_mont_mul(u2, q->x, z1z1);         // u2 = x2 * z1^2
+  p_256_mont_mul(s2, q->y, p->z);         // s2 = y2 * z1^3
+  p_256_mont_mul(s2, s2, z1z1);
+  p_256_mont_sub(h, u2, p->x);
+  p_256_mont_sub(rr, s2, p->y);
+
+  if (p_256_mont_iszero(h)) {
+    if (p_256_mont_iszero(rr))
+      p_256_jacobian_double(r, p);
+    else
+      memset(r, 0, sizeof(*r));  // p = -q
+    return;
+  }
+
+  p_256_mont_add(rr, rr, rr);             // r = 2 * (s2 - y1)
+  p_256_mont_sqr(hh, h);
+  p_256_mont_add(i, hh, hh);              // i = 4 * h^2
+  p_256_mont_add(i, i, i);
+  p_256_mont_mul(j, h, i);                // j = h * i
+  p_256_mont_mul(v, p->x, i);             // v = x1 * i
+
+  p_256_mont_add(t, p->z, h);             // z3 = (z1 + h)^2 - z1z1 - hh
+  p_256_mont_sqr(t, t);
+  p_256_mont_sub(t, t, z1z1);
+  p_256_mont_sub(t, t, hh);
+
+  p_256_mont_mul(s2, p->y, j);            // 2 * y1 * j, before y1 is written
+  p_256_mont_add(s2, s2, s2);
+  memcpy(r->z, t, sizeof(t));
+
+  p_256_mont_sqr(t, rr);                  // x3 = r^2 - j - 2 * v
+  p_256_mont_sub(t, t, j);
+  p_256_mont_sub(t, t, v);
+  p_256_mont_sub(r->x, t, v);
+
+  p_256_mont_sub(t, v, r->x);             // y3 = r * (v - x3) - 2 * y1 * j
+  p_256_mont_mul(t, t, rr);
+  p_256_mont_sub(r->y, t, s2);
+}
+
+// Converts |num| points to affine with a single inversion. None of them may
+// be at infinity.
+static void p_256_jacobian_to_affine_batch(p256_affine_t* q,
+                                           const p256_jacobian_t* p,
+                                           int num) {
+  uint64_t inv[KEY_LENGTH_QWORDS_P256], zinv[KEY_LENGTH_QWORDS_P256];
+  uint64_t zinv2[KEY_LENGTH_QWORDS_P256];
+
+  // q[i].x = z0 * ... * zi until the x coordinates are known
+  memcpy(q[0].x, p[0].z, sizeof(q[0].x));
+  for (int i = 1; i < num; i++) p_256_mont_mul(q[i].x, q[i - 1].x, p[i].z);
+
+  p_256_mont_inv(inv, q[num - 1].x);
+  for (int i = num - 1; i >= 0; i--) {
+    // inv = 1 / (z0 * ... * zi)
+    if (i > 0) {
+      p_256_mont_mul(zinv, inv, q[i - 1].x);
+      p_256_mont_mul(inv, inv, p[i].z);
+    } else {
+      memcpy(zinv, inv, sizeof(zinv));
+    }
+    p_256_mont_sqr(zinv2, zinv);
+    p_256_mont_mul(q[i].x, p[i].x, zinv2);
+    p_256_mont_mul(zinv2, zinv2, zinv);
+    p_256_mont_mul(q[i].y, p[i].y, zinv2);
+  }
+}
+
+// Writes |p| to |q| as the affine dwords the rest of the stack uses
+static void p_256_jacobian_to_point(Point* q, const p256_jacobian_t* p) {
+  memset(q, 0, sizeof(*q));
+  if (p_256_mont_iszero(p->z)) return;  // infinity, only for n = 0 mod r
+
+  p256_affine_t a;
+  p_256_jacobian_to_affine_batch(&a, p, 1);
+  p_256_mont_to_dwords(q->x, a.x);
+  p_256_mont_to_dwords(q->y, a.y);
+  q->z[0] = 1;
+}
+
+// Computes the width-w NAF of the 256 bit |n|, least significant digit first.
+// Every non zero digit is odd and below 2^(w-1) in absolute value. Returns
+// the number of digits, at most 257.
+static int p_256_wnaf(int8_t* naf, const uint32_t* n) {
+  // one more dword for the carry out of the top
+  uint32_t k[KEY_LENGTH_DWORDS_P256 + 1];
+  memcpy(k, n, KEY_LENGTH_DWORDS_P256 * sizeof(uint32_t));
+  k[KEY_LENGTH_DWORDS_P256] = 0;
+
+  int num = 0;
+  int last = 0;
+  while (true) {
+    int top = KEY_LENGTH_DWORDS_P256;
+    while (top >= 0 && k[top] == 0) top--;
+    if (top < 0) break;
+
+    int digit = 0;
+    if (k[0] & 1) {
+      digit = k[0] & ((1 << P256_WNAF_WIDTH) - 1);
+      if (digit >= (1 << (P256_WNAF_WIDTH - 1))) digit -= 1 << P256_WNAF_WIDTH;
+
+      // k -= digit, which clears the low w bits
+      if (digit > 0) {
+        k[0] -= digit;
+      } else {
+        uint32_t add = -digit;
+        for (int i = 0; i <= KEY_LENGTH_DWORDS_P256 && add; i++) {
+          k[i] += add;
+          add = (k[i] < add);
+        }
+      }
+      last = num;
+    }
+    naf[num++] = digit;
+
+    // k >>= 1
+    for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++)
+      k[i] = (k[i] >> 1) | (k[i + 1] << 31);
+    k[KEY_LENGTH_DWORDS_P256] >>= 1;
+  }
+
+  return num ? last + 1 : 0;
+}
+
+// Variable base point multiplication with a width-5 NAF: about 256 doublings
+// and 43 mixed additions with the odd multiples of p
+void ECC_PointMult_WNAF(Point* q, const Point* p, const uint32_t* n) {
+  p256_jacobian_t odd[P256_WNAF_TABLE_SIZE];
+  p256_affine_t table[P256_WNAF_TABLE_SIZE];
+  p256_jacobian_t twice, r;
+  int8_t naf[KEY_LENGTH_DWORDS_P256 * DWORD_BITS + 1];
+
+  // odd[i] = (2i + 1)p
+  p_256_mont_from_dwords(odd[0].x, p->x);
+  p_256_mont_from_dwords(odd[0].y, p->y);
+  memcpy(odd[0].z, p_256_mont_one, sizeof(odd[0].z));
+  p_256_jacobian_double(&twice, &odd[0]);
+  for (int i = 1; i < P256_WNAF_TABLE_SIZE; i++)
+    p_256_jacobian_add(&odd[i], &odd[i - 1], &twice);
+  p_256_jacobian_to_affine_batch(table, odd, P256_WNAF_TABLE_SIZE);
+
+  int num = p_256_wnaf(naf, n);
+  memset(&r, 0, sizeof(r));
+  for (int i = num - 1; i >= 0; i--) {
+    p_256_jacobian_double(&r, &r);
+    if (naf[i] > 0) {
+      p_256_jacobian_add_affine(&r, &r, &table[naf[i] >> 1]);
+    } else if (naf[i] < 0) {
+      static const uint64_t zero[KEY_LENGTH_QWORDS_P256] = {0};
+      p256_affine_t minus = table[(-naf[i]) >> 1];
+      p_256_mont_sub(minus.y, zero, minus.y);
+      p_256_jacobian_add_affine(&r, &r, &minus);
+    }
+  }
+
+  p_256_jacobian_to_point(q, &r);
+}
+
+// comb[i] = sum of 2^(32j) G over the bits j set in i, built on first use
+static const p256_affine_t* p_256_comb_table(void) {
+  static const p256_affine_t* table = [] {
+    const int size = 1 << P256_COMB_TEETH;
+    p256_jacobian_t* jacobian = new p256_jacobian_t[size];
+    p256_affine_t* affine = new p256_affine_t[size];
+
+    p_256_init_curve(KEY_LENGTH_DWORDS_P256);
+    p_256_mont_from_dwords(jacobian[1].x, curve_p256.G.x);
+    p_256_mont_from_dwords(jacobian[1].y, curve_p256.G.y);
+    memcpy(jacobian[1].z, p_256_mont_one, sizeof(jacobian[1].z));
+    for (int j = 1; j < P256_COMB_TEETH; j++) {
+      p256_jacobian_t* tooth = &jacobian[1 << j];
+      *tooth = jacobian[1 << (j - 1)];
+      for (int i = 0; i < P256_COMB_SPACING; i++)
+        p_256_jacobian_double(tooth, tooth);
+    }
+    for (int i = 3; i < size; i++) {
+      int low = i & -i;
+      if (low != i)
+        p_256_jacobian_add(&jacobian[i], &jacobian[i - low], &jacobian[low]);
+    }
+
+    // entry 0 is infinity and never looked up
+    memset(&affine[0], 0, sizeof(affine[0]));
+    p_256_jacobian_to_affine_batch(&affine[1], &jacobian[1], size - 1);
+    delete[] jacobian;
+    return affine;
+  }();
+  return table;
+}
+
+// Fixed base point multiplication with the comb table: 32 doublings and at
+// most 32 mixed additions
+void ECC_PointMult_Base(Point* q, const uint32_t* n) {
+  const p256_affine_t* comb = p_256_comb_table();
+  p256_jacobian_t r;
+
+  memset(&r, 0, sizeof(r));
+  for (int i = P256_COMB_SPACING - 1; i >= 0; i--) {
+    p_256_jacobian_double(&r, &r);
+    uint32_t index = 0;
+    for (int j = 0; j < P256_COMB_TEETH; j++)
+      index |= ((n[j] >> i) & 1) << j;
+    if (index) p_256_jacobian_add_affine(&r, &r, &comb[index]);
+  }
+
+  p_256_jacobian_to_point(q, &r);
+}
+
 bool ECC_ValidatePoint(const Point& pt) {
   const size_t kl = KEY_LENGTH_DWORDS_P256;
   p_256_init_curve(kl);
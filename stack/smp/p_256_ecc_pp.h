@@ -60,7 +60,17 @@ bool ECC_ValidatePoint(const Point& p);
 
 void ECC_PointMult_Bin_NAF(Point* q, Point* p, uint32_t* n, uint32_t keyLength);
 
-#define ECC_PointMult(q, p, n, keyLength) \
-  ECC_PointMult_Bin_NAF(q, p, n, keyLength)
+// q = n * p on P-256 with 64 bit Montgomery arithmetic and a width-5 NAF.
+// p is affine, n is left untouched. q is affine with z = 1, or all zero if n
+// is a multiple of the order of p.
+void ECC_PointMult_WNAF(Point* q, const Point* p, const uint32_t* n);
+
+// q = n * G on P-256, as above, with a comb table precomputed for G
+void ECC_PointMult_Base(Point* q, const uint32_t* n);
+
+#define ECC_PointMult(q, p, n, keyLength)            \
+  ((keyLength) == KEY_LENGTH_DWORDS_P256             \
+       ? ECC_PointMult_WNAF(q, p, n)                 \
+       : ECC_PointMult_Bin_NAF(q, p, n, keyLength))
 
 void p_256_init_curve(uint32_t keyLength);
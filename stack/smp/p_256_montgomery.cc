@@ -0,0 +1,230 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the P-256 field arithmetic on 64 bit limbs used by the
+ *  elliptic curve point multiplication
+ *
+ ******************************************************************************/
+
+#include "p_256_montgomery.h"
+
+#include <string.h>
+
+// p = 2^256 - 2^224 + 2^192 + 2^96 - 1
+static const uint64_t p_256_mont_p[KEY_LENGTH_QWORDS_P256] = {
+    0xffffffffffffffff, 0x00000000ffffffff, 0x0000000000000000,
+    0xffffffff00000001};
+
+// 2^512 mod p, to move into Montgomery form
+static const uint64_t p_256_mont_rr[KEY_LENGTH_QWORDS_P256] = {
+    0x0000000000000003, 0xfffffffbffffffff, 0xfffffffffffffffe,
+    0x00000004fffffffd};
+
+// 2^256 mod p
+const uint64_t p_256_mont_one[KEY_LENGTH_QWORDS_P256] = {
+    0x0000000000000001, 0xffffffff00000000, 0xffffffffffffffff,
+    0x00000000fffffffe};
+
+#if defined(__SIZEOF_INT128__)
+
+// Returns the low half of a * b + c + *carry, the high half goes to *carry
+static inline uint64_t p_256_mac(uint64_t a, uint64_t b, uint64_t c,
+                                 uint64_t* carry) {
+  unsigned __int128 t = (unsigned __int128)a * b + c + *carry;
+  *carry = (uint64_t)(t >> 64);
+  return (uint64_t)t;
+}
+
+#else
+
+// 32 bit targets have no 128 bit type, multiply by halves instead
+static inline uint64_t p_256_mac(uint64_t a, uint64_t b, uint64_t c,
+                                 uint64_t* carry) {
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+
+  uint64_t mid = (lo_lo >> 32) + (uint32_t)hi_lo + (uint32_t)lo_hi;
+  uint64_t lo = (mid << 32) | (uint32_t)lo_lo;
+  uint64_t hi = hi_hi + (hi_lo >> 32) + (lo_hi >> 32) + (mid >> 32);
+
+  lo += c;
+  hi += (lo < c);
+  lo += *carry;
+  hi += (lo < *carry);
+  *carry = hi;
+  return lo;
+}
+
+#endif
+
+// Returns a + b + *carry, the carry out goes to *carry
+static inline uint64_t p_256_adc(uint64_t a, uint64_t b, uint64_t* carry) {
+  uint64_t t = a + *carry;
+  uint64_t c = (t < a);
+  t += b;
+  *carry = c | (t < b);
+  return t;
+}
+
+// Returns a - b - *borrow, the borrow out goes to *borrow
+static inline uint64_t p_256_sbb(uint64_t a, uint64_t b, uint64_t* borrow) {
+  uint64_t t = a - b;
+  uint64_t c = (t > a);
+  uint64_t r = t - *borrow;
+  *borrow = c | (r > t);
+  return r;
+}
+
+// c = t - p if t, with |hi| as its 257th bit, is at least p; c = t otherwise
+static inline void p_256_mont_reduce_once(uint64_t* c, const uint64_t* t,
+                                          uint64_t hi) {
+  uint64_t d[KEY_LENGTH_QWORDS_P256];
+  uint64_t borrow = 0;
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++)
+    d[i] = p_256_sbb(t[i], p_256_mont_p[i], &borrow);
+  p_256_sbb(hi, 0, &borrow);
+
+  // keep t if subtracting p borrowed
+  uint64_t keep = 0 - borrow;
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++)
+    c[i] = (t[i] & keep) | (d[i] & ~keep);
+}
+
+void p_256_mont_add(uint64_t* c, const uint64_t* a, const uint64_t* b) {
+  uint64_t t[KEY_LENGTH_QWORDS_P256];
+  uint64_t carry = 0;
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++)
+    t[i] = p_256_adc(a[i], b[i], &carry);
+  p_256_mont_reduce_once(c, t, carry);
+}
+
+void p_256_mont_sub(uint64_t* c, const uint64_t* a, const uint64_t* b) {
+  uint64_t t[KEY_LENGTH_QWORDS_P256];
+  uint64_t borrow = 0;
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++)
+    t[i] = p_256_sbb(a[i], b[i], &borrow);
+
+  // add p back if a < b
+  uint64_t mask = 0 - borrow;
+  uint64_t carry = 0;
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++)
+    c[i] = p_256_adc(t[i], p_256_mont_p[i] & mask, &carry);
+}
+
+// Montgomery multiplication, operand scanning. -1/p mod 2^64 is 1 for P-256,
+// so the multiple of p to add each round is the lowest limb m, and the shape
+// of p turns m * p into shifts but for its top limb: m * (2^64 - 1) + m
+// carries m out of limb 0, m * (2^32 - 1) + m is m << 32 in limb 1, and limb 2
+// of p is zero.
+void p_256_mont_mul(uint64_t* c, const uint64_t* a, const uint64_t* b) {
+  uint64_t t0 = 0, t1 = 0, t2 = 0, t3 = 0, t4 = 0;
+
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++) {
+    // t += a * b[i]
+    uint64_t carry = 0;
+    t0 = p_256_mac(a[0], b[i], t0, &carry);
+    t1 = p_256_mac(a[1], b[i], t1, &carry);
+    t2 = p_256_mac(a[2], b[i], t2, &carry);
+    t3 = p_256_mac(a[3], b[i], t3, &carry);
+    uint64_t t5 = 0;
+    t4 = p_256_adc(t4, carry, &t5);
+
+    // t = (t + m * p) / 2^64
+    uint64_t m = t0;
+    carry = 0;
+    t0 = p_256_adc(t1, m << 32, &carry);
+    t1 = p_256_adc(t2, m >> 32, &carry);
+    t2 = p_256_mac(m, p_256_mont_p[3], t3, &carry);
+    uint64_t top = 0;
+    t3 = p_256_adc(t4, carry, &top);
+    t4 = t5 + top;
+  }
+
+  uint64_t t[KEY_LENGTH_QWORDS_P256] = {t0, t1, t2, t3};
+  p_256_mont_reduce_once(c, t, t4);
+}
+
+void p_256_mont_sqr(uint64_t* c, const uint64_t* a) { p_256_mont_mul(c, a, a); }
+
+void p_256_mont_from_dwords(uint64_t* c, const uint32_t* a) {
+  uint64_t t[KEY_LENGTH_QWORDS_P256];
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++)
+    t[i] = (uint64_t)a[2 * i] | ((uint64_t)a[2 * i + 1] << 32);
+
+  // bring t below p first, the dwords may hold any 256 bit value
+  p_256_mont_reduce_once(t, t, 0);
+  p_256_mont_mul(c, t, p_256_mont_rr);
+}
+
+void p_256_mont_to_dwords(uint32_t* c, const uint64_t* a) {
+  static const uint64_t one[KEY_LENGTH_QWORDS_P256] = {1, 0, 0, 0};
+  uint64_t t[KEY_LENGTH_QWORDS_P256];
+  p_256_mont_mul(t, a, one);
+  for (int i = 0; i < KEY_LENGTH_QWORDS_P256; i++) {
+    c[2 * i] = (uint32_t)t[i];
+    c[2 * i + 1] = (uint32_t)(t[i] >> 32);
+  }
+}
+
+// c = a^(2^n)
+static void p_256_mont_sqr_n(uint64_t* c, const uint64_t* a, int n) {
+  memcpy(c, a, KEY_LENGTH_QWORDS_P256 * sizeof(uint64_t));
+  for (int i = 0; i < n; i++) p_256_mont_sqr(c, c);
+}
+
+// c = a^(p-2), p-2 being, from the top, 32 ones, 31 zeros and a one, 96 zeros,
+// 64 ones and then 0xfffffffd.
+void p_256_mont_inv(uint64_t* c, const uint64_t* a) {
+  uint64_t x2[KEY_LENGTH_QWORDS_P256], x3[KEY_LENGTH_QWORDS_P256];
+  uint64_t x6[KEY_LENGTH_QWORDS_P256], x12[KEY_LENGTH_QWORDS_P256];
+  uint64_t x15[KEY_LENGTH_QWORDS_P256], x30[KEY_LENGTH_QWORDS_P256];
+  uint64_t x32[KEY_LENGTH_QWORDS_P256], t[KEY_LENGTH_QWORDS_P256];
+
+  // xN = a^(2^N - 1)
+  p_256_mont_sqr(x2, a);
+  p_256_mont_mul(x2, x2, a);
+  p_256_mont_sqr(x3, x2);
+  p_256_mont_mul(x3, x3, a);
+  p_256_mont_sqr_n(t, x3, 3);
+  p_256_mont_mul(x6, t, x3);
+  p_256_mont_sqr_n(t, x6, 6);
+  p_256_mont_mul(x12, t, x6);
+  p_256_mont_sqr_n(t, x12, 3);
+  p_256_mont_mul(x15, t, x3);
+  p_256_mont_sqr_n(t, x15, 15);
+  p_256_mont_mul(x30, t, x15);
+  p_256_mont_sqr_n(t, x30, 2);
+  p_256_mont_mul(x32, t, x2);
+
+  p_256_mont_sqr_n(t, x32, 32);
+  p_256_mont_mul(t, t, a);
+  p_256_mont_sqr_n(t, t, 128);
+  p_256_mont_mul(t, t, x32);
+  p_256_mont_sqr_n(t, t, 32);
+  p_256_mont_mul(t, t, x32);
+  p_256_mont_sqr_n(t, t, 30);
+  p_256_mont_mul(t, t, x30);
+  p_256_mont_sqr_n(t, t, 2);
+  p_256_mont_mul(c, t, a);
+}
@@ -0,0 +1,58 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  Arithmetic modulo the P-256 prime on 64 bit limbs, least significant limb
+ *  first. Elements are kept in Montgomery form, a * 2^256 mod p, and are
+ *  always fully reduced.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+
+#define KEY_LENGTH_QWORDS_P256 4
+
+/* c = a * 2^256 mod p, from the dwords the multiprecision code uses */
+void p_256_mont_from_dwords(uint64_t* c, const uint32_t* a);
+
+/* c = a / 2^256 mod p, as dwords */
+void p_256_mont_to_dwords(uint32_t* c, const uint64_t* a);
+
+/* c = a + b mod p */
+void p_256_mont_add(uint64_t* c, const uint64_t* a, const uint64_t* b);
+
+/* c = a - b mod p */
+void p_256_mont_sub(uint64_t* c, const uint64_t* a, const uint64_t* b);
+
+/* c = a * b / 2^256 mod p */
+void p_256_mont_mul(uint64_t* c, const uint64_t* a, const uint64_t* b);
+
+/* c = a * a / 2^256 mod p */
+void p_256_mont_sqr(uint64_t* c, const uint64_t* a);
+
+/* c = 1 / a, both in Montgomery form; 0 maps to 0 */
+void p_256_mont_inv(uint64_t* c, const uint64_t* a);
+
+/* One in Montgomery form */
+extern const uint64_t p_256_mont_one[KEY_LENGTH_QWORDS_P256];
+
+inline bool p_256_mont_iszero(const uint64_t* a) {
+  return (a[0] | a[1] | a[2] | a[3]) == 0;
+}
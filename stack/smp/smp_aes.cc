@@ -0,0 +1,411 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the AES-128 engines of SMP: AES-NI, the ARMv8
+ *  Cryptography Extension and a bitsliced fallback. None of them indexes
+ *  memory or branches on the key or the data.
+ *
+ ******************************************************************************/
+
+#include "smp_aes.h"
+
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define SMP_AES_NI TRUE
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define SMP_AES_ARMV8_CE TRUE
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#endif
+
+/*******************************************************************************
+ *  Bitsliced AES
+ *
+ *  The 16 bytes of the state are kept as 8 bit planes: bit i of plane b is
+ *  bit b of byte i. SubBytes computes the inverse in GF(2^8) as x^254 on all
+ *  the bytes at once, so that no table is looked up.
+ ******************************************************************************/
+
+/* Bytes of a row of the state in a bit plane; byte i is in row i % 4 */
+#define SMP_AES_ROW_0 0x1111
+#define SMP_AES_ROW_1 0x2222
+#define SMP_AES_ROW_2 0x4444
+#define SMP_AES_ROW_3 0x8888
+
+/* Transposes 8 bytes as an 8 x 8 bit matrix: bit j of byte i and bit i of
+ * byte j trade places */
+static inline uint64_t smp_aes_bs_transpose8(uint64_t x) {
+  uint64_t t;
+
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+  x ^= t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+  x ^= t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+  x ^= t ^ (t << 28);
+  return x;
+}
+
+/* Bytes 0 to |len| - 1 of |in|, |len| <= 16, to bit planes */
+static void smp_aes_bs_pack(const uint8_t* in, int len, uint32_t* q) {
+  uint8_t block[SMP_AES_BLOCK_SIZE] = {0};
+  uint64_t lo = 0, hi = 0;
+
+  memcpy(block, in, len);
+  for (int i = 7; i >= 0; i--) {
+    lo = (lo << 8) | block[i];
+    hi = (hi << 8) | block[i + 8];
+  }
+  lo = smp_aes_bs_transpose8(lo);
+  hi = smp_aes_bs_transpose8(hi);
+  for (int b = 0; b < 8; b++)
+    q[b] = (uint32_t)((lo >> (8 * b)) & 0xFF) |
+           (uint32_t)(((hi >> (8 * b)) & 0xFF) << 8);
+}
+
+static void smp_aes_bs_unpack(const uint32_t* q, int len, uint8_t* out) {
+  uint8_t block[SMP_AES_BLOCK_SIZE];
+  uint64_t lo = 0, hi = 0;
+
+  for (int b = 7; b >= 0; b--) {
+    lo = (lo << 8) | (q[b] & 0xFF);
+    hi = (hi << 8) | ((q[b] >> 8) & 0xFF);
+  }
+  lo = smp_aes_bs_transpose8(lo);
+  hi = smp_aes_bs_transpose8(hi);
+  for (int i = 0; i < 8; i++) {
+    block[i] = (uint8_t)(lo >> (8 * i));
+    block[i + 8] = (uint8_t)(hi >> (8 * i));
+  }
+  memcpy(out, block, len);
+}
+
+/* c = a * b in GF(2^8), one bit of a at a time from the top: c is doubled,
+ * i.e. multiplied by x modulo x^8 + x^4 + x^3 + x + 1, then b is added in */
+static void smp_aes_bs_mul(const uint32_t* a, const uint32_t* b, uint32_t* c) {
+  uint32_t c0 = 0, c1 = 0, c2 = 0, c3 = 0, c4 = 0, c5 = 0, c6 = 0, c7 = 0;
+
+  for (int i = 7; i >= 0; i--) {
+    uint32_t hi = c7, ai = a[i];
+    c7 = c6 ^ (ai & b[7]);
+    c6 = c5 ^ (ai & b[6]);
+    c5 = c4 ^ (ai & b[5]);
+    c4 = c3 ^ hi ^ (ai & b[4]);
+    c3 = c2 ^ hi ^ (ai & b[3]);
+    c2 = c1 ^ (ai & b[2]);
+    c1 = c0 ^ hi ^ (ai & b[1]);
+    c0 = hi ^ (ai & b[0]);
+  }
+  c[0] = c0;
+  c[1] = c1;
+  c[2] = c2;
+  c[3] = c3;
+  c[4] = c4;
+  c[5] = c5;
+  c[6] = c6;
+  c[7] = c7;
+}
+
+/* c = a^2, which is linear: bit b of the square of x^i, reduced, for i < 8 */
+static void smp_aes_bs_sqr(const uint32_t* a, uint32_t* c) {
+  uint32_t t[8];
+
+  t[0] = a[0] ^ a[4] ^ a[6];
+  t[1] = a[4] ^ a[6] ^ a[7];
+  t[2] = a[1] ^ a[5];
+  t[3] = a[4] ^ a[5] ^ a[6] ^ a[7];
+  t[4] = a[2] ^ a[4] ^ a[7];
+  t[5] = a[5] ^ a[6];
+  t[6] = a[3] ^ a[5];
+  t[7] = a[6] ^ a[7];
+  memcpy(c, t, sizeof(t));
+}
+
+/* SubBytes of every byte of |q| */
+static void smp_aes_bs_sbox(uint32_t* q, uint32_t mask) {
+  uint32_t x2[8], x3[8], x12[8], x15[8], t[8];
+
+  /* x^254 = x^-1, through x^3, x^12, x^15, x^240 and x^252 */
+  smp_aes_bs_sqr(q, x2);
+  smp_aes_bs_mul(x2, q, x3);
+  smp_aes_bs_sqr(x3, t);
+  smp_aes_bs_sqr(t, x12);
+  smp_aes_bs_mul(x12, x3, x15);
+  smp_aes_bs_sqr(x15, t);
+  for (int i = 0; i < 3; i++) smp_aes_bs_sqr(t, t);
+  smp_aes_bs_mul(t, x12, t);
+  smp_aes_bs_mul(t, x2, t);
+
+  /* the affine transform, with the constant 0x63 */
+  for (int b = 0; b < 8; b++) {
+    q[b] = t[b] ^ t[(b + 4) % 8] ^ t[(b + 5) % 8] ^ t[(b + 6) % 8] ^
+           t[(b + 7) % 8];
+    if ((0x63 >> b) & 1) q[b] ^= mask;
+  }
+}
+
+static inline uint32_t smp_aes_bs_rotr16(uint32_t x, int n) {
+  return ((x >> n) | (x << (16 - n))) & 0xFFFF;
+}
+
+/* Row r of the state moves r columns to the left */
+static void smp_aes_bs_shift_rows(uint32_t* q) {
+  for (int b = 0; b < 8; b++) {
+    uint32_t x = q[b];
+    q[b] = (x & SMP_AES_ROW_0) | smp_aes_bs_rotr16(x & SMP_AES_ROW_1, 4) |
+           smp_aes_bs_rotr16(x & SMP_AES_ROW_2, 8) |
+           smp_aes_bs_rotr16(x & SMP_AES_ROW_3, 12);
+  }
+}
+
+/* The byte of each column one row down, wrapping within the column */
+static inline uint32_t smp_aes_bs_next_row(uint32_t x) {
+  return ((x >> 1) & (SMP_AES_ROW_0 | SMP_AES_ROW_1 | SMP_AES_ROW_2)) |
+         ((x << 3) & SMP_AES_ROW_3);
+}
+
+/* out_r = 2 * (a_r + a_r+1) + a_r+1 + a_r+2 + a_r+3 */
+static void smp_aes_bs_mix_columns(uint32_t* q) {
+  uint32_t r1[8], r2[8], r3[8], u[8];
+
+  for (int b = 0; b < 8; b++) {
+    r1[b] = smp_aes_bs_next_row(q[b]);
+    r2[b] = smp_aes_bs_next_row(r1[b]);
+    r3[b] = smp_aes_bs_next_row(r2[b]);
+    u[b] = q[b] ^ r1[b];
+  }
+
+  q[0] = u[7] ^ r1[0] ^ r2[0] ^ r3[0];
+  q[1] = u[0] ^ u[7] ^ r1[1] ^ r2[1] ^ r3[1];
+  q[2] = u[1] ^ r1[2] ^ r2[2] ^ r3[2];
+  q[3] = u[2] ^ u[7] ^ r1[3] ^ r2[3] ^ r3[3];
+  q[4] = u[3] ^ u[7] ^ r1[4] ^ r2[4] ^ r3[4];
+  q[5] = u[4] ^ r1[5] ^ r2[5] ^ r3[5];
+  q[6] = u[5] ^ r1[6] ^ r2[6] ^ r3[6];
+  q[7] = u[6] ^ r1[7] ^ r2[7] ^ r3[7];
+}
+
+/* The FIPS-197 key expansion, with the bitsliced S-box for SubWord */
+static void smp_aes_expand_key(const uint8_t* key, tSMP_AES_KEY* p_key) {
+  uint8_t rcon = 0x01;
+
+  memcpy(p_key->rk[0], key, SMP_AES_BLOCK_SIZE);
+  for (int r = 1; r <= SMP_AES_NUM_ROUNDS; r++) {
+    const uint8_t* prev = p_key->rk[r - 1];
+    uint8_t* rk = p_key->rk[r];
+    uint8_t word[4] = {prev[13], prev[14], prev[15], prev[12]};
+    uint32_t q[8];
+
+    smp_aes_bs_pack(word, 4, q);
+    smp_aes_bs_sbox(q, 0xF);
+    smp_aes_bs_unpack(q, 4, word);
+    word[0] ^= rcon;
+    rcon = (uint8_t)((rcon << 1) ^ ((rcon >> 7) * 0x1B));
+
+    for (int i = 0; i < SMP_AES_BLOCK_SIZE; i++) {
+      rk[i] = prev[i] ^ (i < 4 ? word[i] : rk[i - 4]);
+    }
+  }
+}
+
+static void smp_aes_bs_set_key(const uint8_t* key, tSMP_AES_KEY* p_key) {
+  smp_aes_expand_key(key, p_key);
+  for (int r = 0; r <= SMP_AES_NUM_ROUNDS; r++)
+    smp_aes_bs_pack(p_key->rk[r], SMP_AES_BLOCK_SIZE, p_key->bs_rk[r]);
+}
+
+static void smp_aes_bs_encrypt(const tSMP_AES_KEY* p_key, const uint8_t* in,
+                               uint8_t* out) {
+  uint32_t q[8];
+
+  smp_aes_bs_pack(in, SMP_AES_BLOCK_SIZE, q);
+  for (int b = 0; b < 8; b++) q[b] ^= p_key->bs_rk[0][b];
+  for (int r = 1; r <= SMP_AES_NUM_ROUNDS; r++) {
+    smp_aes_bs_sbox(q, 0xFFFF);
+    smp_aes_bs_shift_rows(q);
+    if (r != SMP_AES_NUM_ROUNDS) smp_aes_bs_mix_columns(q);
+    for (int b = 0; b < 8; b++) q[b] ^= p_key->bs_rk[r][b];
+  }
+  smp_aes_bs_unpack(q, SMP_AES_BLOCK_SIZE, out);
+}
+
+static const tSMP_AES_ENGINE smp_aes_bitsliced = {
+    "bitsliced", smp_aes_bs_set_key, smp_aes_bs_encrypt,
+};
+
+#if (SMP_AES_NI == TRUE)
+
+#define SMP_TARGET_AES __attribute__((target("aes,sse2")))
+
+static inline SMP_TARGET_AES __m128i smp_aesni_expand_step(__m128i key,
+                                                           __m128i assist) {
+  assist = _mm_shuffle_epi32(assist, _MM_SHUFFLE(3, 3, 3, 3));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+/* The round constant has to be an immediate */
+#define SMP_AESNI_EXPAND(r, rcon)                                       \
+  rk[r] = smp_aesni_expand_step(                                        \
+      rk[(r)-1], _mm_aeskeygenassist_si128(rk[(r)-1], (rcon)));         \
+  _mm_storeu_si128((__m128i*)p_key->rk[r], rk[r])
+
+static SMP_TARGET_AES void smp_aesni_set_key(const uint8_t* key,
+                                             tSMP_AES_KEY* p_key) {
+  __m128i rk[SMP_AES_NUM_ROUNDS + 1];
+
+  rk[0] = _mm_loadu_si128((const __m128i*)key);
+  _mm_storeu_si128((__m128i*)p_key->rk[0], rk[0]);
+  SMP_AESNI_EXPAND(1, 0x01);
+  SMP_AESNI_EXPAND(2, 0x02);
+  SMP_AESNI_EXPAND(3, 0x04);
+  SMP_AESNI_EXPAND(4, 0x08);
+  SMP_AESNI_EXPAND(5, 0x10);
+  SMP_AESNI_EXPAND(6, 0x20);
+  SMP_AESNI_EXPAND(7, 0x40);
+  SMP_AESNI_EXPAND(8, 0x80);
+  SMP_AESNI_EXPAND(9, 0x1B);
+  SMP_AESNI_EXPAND(10, 0x36);
+}
+
+static SMP_TARGET_AES void smp_aesni_encrypt(const tSMP_AES_KEY* p_key,
+                                             const uint8_t* in, uint8_t* out) {
+  __m128i m = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in),
+                            _mm_loadu_si128((const __m128i*)p_key->rk[0]));
+  for (int r = 1; r < SMP_AES_NUM_ROUNDS; r++)
+    m = _mm_aesenc_si128(m, _mm_loadu_si128((const __m128i*)p_key->rk[r]));
+  m = _mm_aesenclast_si128(
+      m, _mm_loadu_si128((const __m128i*)p_key->rk[SMP_AES_NUM_ROUNDS]));
+  _mm_storeu_si128((__m128i*)out, m);
+}
+
+static const tSMP_AES_ENGINE smp_aes_ni = {
+    "aesni", smp_aesni_set_key, smp_aesni_encrypt,
+};
+
+static bool smp_aes_cpu_supported(const tSMP_AES_ENGINE* p_engine) {
+  unsigned int eax, ebx, ecx, edx;
+
+  if (p_engine != &smp_aes_ni) return true;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  return (ecx & bit_AES) && (ecx & bit_SSE2 || edx & bit_SSE2);
+}
+
+static const tSMP_AES_ENGINE* const smp_aes_engines[] = {&smp_aes_ni,
+                                                         &smp_aes_bitsliced};
+
+#elif (SMP_AES_ARMV8_CE == TRUE)
+
+/* Only the functions below are built for the Cryptography Extension, and
+ * they are only called once getauxval() has reported it. Older arm_neon.h
+ * only declare vaeseq_u8() and vaesmcq_u8() when the whole file targets the
+ * extension, so the two instructions are written out instead. */
+#define SMP_TARGET_CRYPTO __attribute__((target("+crypto")))
+
+/* AESE is AddRoundKey, SubBytes and ShiftRows */
+static inline SMP_TARGET_CRYPTO uint8x16_t smp_armv8_aese(uint8x16_t m,
+                                                          uint8x16_t k) {
+  __asm__(".arch_extension crypto\n\taese %0.16b, %1.16b" : "+w"(m) : "w"(k));
+  return m;
+}
+
+/* AESMC is MixColumns */
+static inline SMP_TARGET_CRYPTO uint8x16_t smp_armv8_aesmc(uint8x16_t m) {
+  __asm__(".arch_extension crypto\n\taesmc %0.16b, %0.16b" : "+w"(m));
+  return m;
+}
+
+static SMP_TARGET_CRYPTO void smp_armv8_ce_encrypt(const tSMP_AES_KEY* p_key,
+                                                   const uint8_t* in,
+                                                   uint8_t* out) {
+  uint8x16_t m = vld1q_u8(in);
+  for (int r = 0; r < SMP_AES_NUM_ROUNDS - 1; r++)
+    m = smp_armv8_aesmc(smp_armv8_aese(m, vld1q_u8(p_key->rk[r])));
+  m = smp_armv8_aese(m, vld1q_u8(p_key->rk[SMP_AES_NUM_ROUNDS - 1]));
+  m = veorq_u8(m, vld1q_u8(p_key->rk[SMP_AES_NUM_ROUNDS]));
+  vst1q_u8(out, m);
+}
+
+/* The key is expanded in software, once per key */
+static const tSMP_AES_ENGINE smp_aes_armv8_ce = {
+    "armv8-ce", smp_aes_expand_key, smp_armv8_ce_encrypt,
+};
+
+static bool smp_aes_cpu_supported(const tSMP_AES_ENGINE* p_engine) {
+  if (p_engine != &smp_aes_armv8_ce) return true;
+  return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+}
+
+static const tSMP_AES_ENGINE* const smp_aes_engines[] = {&smp_aes_armv8_ce,
+                                                         &smp_aes_bitsliced};
+
+#else
+
+static bool smp_aes_cpu_supported(const tSMP_AES_ENGINE* p_engine) {
+  return true;
+}
+
+static const tSMP_AES_ENGINE* const smp_aes_engines[] = {&smp_aes_bitsliced};
+
+#endif
+
+static const tSMP_AES_ENGINE* smp_aes_selected = nullptr;
+
+/*******************************************************************************
+ *
+ * Function         smp_aes_select_engine
+ *
+ * Description      Selects the AES engine by name, or the fastest engine the
+ *                  CPU supports if |name| is nullptr. The engines are listed
+ *                  fastest first.
+ *
+ * Returns          false if the CPU doesn't support |name|
+ *
+ ******************************************************************************/
+bool smp_aes_select_engine(const char* name) {
+  for (const tSMP_AES_ENGINE* p_engine : smp_aes_engines) {
+    if (name != nullptr && strcmp(name, p_engine->name) != 0) continue;
+    if (!smp_aes_cpu_supported(p_engine)) continue;
+    smp_aes_selected = p_engine;
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_aes_engine
+ *
+ * Description      Returns the AES engine in use, selecting the fastest one on
+ *                  first use.
+ *
+ ******************************************************************************/
+const tSMP_AES_ENGINE* smp_aes_engine(void) {
+  if (smp_aes_selected == nullptr) smp_aes_select_engine(nullptr);
+  return smp_aes_selected;
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  AES-128 block encryption for SMP, run by the AES instructions of the CPU
+ *  when it has them and by a constant-time bitsliced implementation
+ *  otherwise. Keys and blocks are in FIPS-197 byte order, i.e. the reverse
+ *  of the little endian order SMP keeps them in.
+ *
+ ******************************************************************************/
+
+#ifndef SMP_AES_H
+#define SMP_AES_H
+
+#include <stdint.h>
+
+#define SMP_AES_BLOCK_SIZE 16
+#define SMP_AES_NUM_ROUNDS 10
+
+/* An expanded AES-128 key. Only the engine that set it up can use it. */
+typedef struct {
+  /* round keys in FIPS-197 byte order */
+  uint8_t rk[SMP_AES_NUM_ROUNDS + 1][SMP_AES_BLOCK_SIZE];
+  /* round keys as bit planes, for the bitsliced engine only */
+  uint32_t bs_rk[SMP_AES_NUM_ROUNDS + 1][8];
+} tSMP_AES_KEY;
+
+typedef struct {
+  const char* name;
+  void (*set_key)(const uint8_t* key, tSMP_AES_KEY* p_key);
+  void (*encrypt)(const tSMP_AES_KEY* p_key, const uint8_t* in, uint8_t* out);
+} tSMP_AES_ENGINE;
+
+/* The engine in use: the fastest the CPU supports unless one was selected */
+extern const tSMP_AES_ENGINE* smp_aes_engine(void);
+
+/* Select the engine by |name|: "aesni", "armv8-ce" or "bitsliced". nullptr
+ * selects the fastest one. Returns false if the CPU doesn't support |name|. */
+extern bool smp_aes_select_engine(const char* name);
+
+/* Expands |key| for smp_aes_encrypt() */
+inline void smp_aes_set_key(const uint8_t* key, tSMP_AES_KEY* p_key) {
+  smp_aes_engine()->set_key(key, p_key);
+}
+
+/* Encrypts one block; |in| and |out| may be the same */
+inline void smp_aes_encrypt(const tSMP_AES_KEY* p_key, const uint8_t* in,
+                            uint8_t* out) {
+  smp_aes_engine()->encrypt(p_key, in, out);
+}
+
+#endif /* SMP_AES_H */
@@ -70,8 +70,21 @@ void SMP_Init(void) {
   if (smp_cb.cert_failure)
     SMP_TRACE_ERROR("%s PTS FAILURE MODE IN EFFECT (CASE %d)", __func__,
                     smp_cb.cert_failure);
+
+  smp_key_pool_init();
 }
 
+/*******************************************************************************
+ *
+ * Function         SMP_Free
+ *
+ * Description      This function stops the SMP background work.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SMP_Free(void) { smp_key_pool_stop(); }
+
 /*******************************************************************************
  *
  * Function         SMP_SetTraceLevel
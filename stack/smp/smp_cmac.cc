@@ -29,20 +29,9 @@
 
 #include "btm_ble_api.h"
 #include "hcimsgs.h"
+#include "smp_aes.h"
 #include "smp_int.h"
 
-typedef struct {
-  uint8_t* text;
-  uint16_t len;
-  uint16_t round;
-} tCMAC_CB;
-
-tCMAC_CB cmac_cb;
-
-/* Rb for AES-128 as block cipher, LSB as [0] */
-BT_OCTET16 const_Rb = {0x87, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                       0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
 void print128(BT_OCTET16 x, const uint8_t* key_name) {
 #if (SMP_DEBUG == TRUE && SMP_DEBUG_VERBOSE == TRUE)
   uint8_t* p = (uint8_t*)x;
@@ -59,205 +48,113 @@ void print128(BT_OCTET16 x, const uint8_t* key_name) {
 #endif
 }
 
-/*******************************************************************************
- *
- * Function         padding
- *
- * Description      utility function to padding the given text to be a 128 bits
- *                  data. The parameter dest is input and output parameter, it
- *                  must point to a BT_OCTET16_LEN memory space; where include
- *                  length bytes valid data.
- *
- * Returns          void
- *
- ******************************************************************************/
-static void padding(BT_OCTET16 dest, uint8_t length) {
-  uint8_t i, *p = dest;
-  /* original last block */
-  for (i = length; i < BT_OCTET16_LEN; i++)
-    p[BT_OCTET16_LEN - i - 1] = (i == length) ? 0x80 : 0;
-}
-/*******************************************************************************
- *
- * Function         leftshift_onebit
- *
- * Description      utility function to left shift one bit for a 128 bits value.
- *
- * Returns          void
- *
- ******************************************************************************/
-static void leftshift_onebit(uint8_t* input, uint8_t* output) {
-  uint8_t i, overflow = 0, next_overflow = 0;
-  SMP_TRACE_EVENT("leftshift_onebit ");
-  /* input[0] is LSB */
-  for (i = 0; i < BT_OCTET16_LEN; i++) {
-    next_overflow = (input[i] & 0x80) ? 1 : 0;
-    output[i] = (input[i] << 1) | overflow;
-    overflow = next_overflow;
+/* Reads a message MSB first: segment after segment, each from its last octet
+ * since SMP keeps values little endian */
+typedef struct {
+  const tSMP_CMAC_SEG* p_seg;
+  uint16_t left; /* octets of p_seg not read yet */
+} tCMAC_READER;
+
+static void cmac_read(tCMAC_READER* p_rd, uint8_t* p_out, uint16_t len) {
+  while (len > 0) {
+    while (p_rd->left == 0) {
+      p_rd->p_seg++;
+      p_rd->left = p_rd->p_seg->len;
+    }
+    *p_out++ = p_rd->p_seg->p_data[--p_rd->left];
+    len--;
   }
-  return;
-}
-/*******************************************************************************
- *
- * Function         cmac_aes_cleanup
- *
- * Description      clean up function for AES_CMAC algorithm.
- *
- * Returns          void
- *
- ******************************************************************************/
-static void cmac_aes_cleanup(void) {
-  osi_free(cmac_cb.text);
-  memset(&cmac_cb, 0, sizeof(tCMAC_CB));
 }
 
 /*******************************************************************************
  *
- * Function         cmac_aes_k_calculate
+ * Function         cmac_double
  *
- * Description      This function is the calculation of block cipher using
- *                  AES-128.
+ * Description      Multiplies a block by x in GF(2^128), MSB first, to derive
+ *                  the subkeys: out = (in << 1) (+) (MSB(in) ? Rb : 0).
  *
  * Returns          void
  *
  ******************************************************************************/
-static bool cmac_aes_k_calculate(BT_OCTET16 key, uint8_t* p_signature,
-                                 uint16_t tlen) {
-  tSMP_ENC output;
-  uint8_t i = 1, err = 0;
-  uint8_t x[16] = {0};
-  uint8_t* p_mac;
-
-  SMP_TRACE_EVENT("cmac_aes_k_calculate ");
+static void cmac_double(const uint8_t* in, uint8_t* out) {
+  uint8_t rb = (uint8_t)(0x87 & -(in[0] >> 7));
 
-  while (i <= cmac_cb.round) {
-    smp_xor_128(&cmac_cb.text[(cmac_cb.round - i) * BT_OCTET16_LEN],
-                x); /* Mi' := Mi (+) X  */
-
-    if (!SMP_Encrypt(key, BT_OCTET16_LEN,
-                     &cmac_cb.text[(cmac_cb.round - i) * BT_OCTET16_LEN],
-                     BT_OCTET16_LEN, &output)) {
-      err = 1;
-      break;
-    }
-
-    memcpy(x, output.param_buf, BT_OCTET16_LEN);
-    i++;
-  }
-
-  if (!err) {
-    p_mac = output.param_buf + (BT_OCTET16_LEN - tlen);
-    memcpy(p_signature, p_mac, tlen);
-
-    SMP_TRACE_DEBUG("tlen = %d p_mac = %d", tlen, p_mac);
-    SMP_TRACE_DEBUG(
-        "p_mac[0] = 0x%02x p_mac[1] = 0x%02x p_mac[2] = 0x%02x p_mac[3] = "
-        "0x%02x",
-        *p_mac, *(p_mac + 1), *(p_mac + 2), *(p_mac + 3));
-    SMP_TRACE_DEBUG(
-        "p_mac[4] = 0x%02x p_mac[5] = 0x%02x p_mac[6] = 0x%02x p_mac[7] = "
-        "0x%02x",
-        *(p_mac + 4), *(p_mac + 5), *(p_mac + 6), *(p_mac + 7));
-
-    return true;
-
-  } else
-    return false;
+  for (int i = 0; i < BT_OCTET16_LEN - 1; i++)
+    out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+  out[BT_OCTET16_LEN - 1] = (uint8_t)(in[BT_OCTET16_LEN - 1] << 1) ^ rb;
 }
+
 /*******************************************************************************
  *
- * Function         cmac_prepare_last_block
+ * Function         aes_cmac
  *
- * Description      This function proceeed to prepare the last block of message
- *                  Mn depending on the size of the message.
+ * Description      This is the AES-CMAC Generation Function with tlen
+ *                  implemented, over a message given in segments. It works on
+ *                  the stack, without copying the message.
  *
- * Returns          void
+ * Parameters       key - CMAC key in little endian order.
+ *                  p_segs - the message, most significant segment first;
+ *                           each segment in little endian byte order.
+ *                  num_segs - number of segments.
+ *                  tlen - lenth of mac desired
+ *                  p_signature - data pointer to where signed data to be
+ *                                stored, tlen long, little endian.
+ *
+ * Returns          false if tlen is too long, true in other cases.
  *
  ******************************************************************************/
-static void cmac_prepare_last_block(BT_OCTET16 k1, BT_OCTET16 k2) {
-  //    uint8_t     x[16] = {0};
-  bool flag;
+bool aes_cmac(const uint8_t* key, const tSMP_CMAC_SEG* p_segs,
+              uint8_t num_segs, uint16_t tlen, uint8_t* p_signature) {
+  tSMP_AES_KEY aes_key;
+  uint8_t rev_key[BT_OCTET16_LEN];
+  uint8_t k1[BT_OCTET16_LEN], k2[BT_OCTET16_LEN];
+  uint8_t x[BT_OCTET16_LEN] = {0};
+  uint8_t m[BT_OCTET16_LEN];
+  tCMAC_READER reader = {p_segs, num_segs > 0 ? p_segs[0].len : (uint16_t)0};
+  uint32_t length = 0;
+  uint32_t n, last_len;
 
-  SMP_TRACE_EVENT("cmac_prepare_last_block ");
-  /* last block is a complete block set flag to 1 */
-  flag =
-      ((cmac_cb.len % BT_OCTET16_LEN) == 0 && cmac_cb.len != 0) ? true : false;
+  if (tlen > BT_OCTET16_LEN) return false;
 
-  SMP_TRACE_WARNING("flag = %d round = %d", flag, cmac_cb.round);
+  for (uint8_t i = 0; i < num_segs; i++) length += p_segs[i].len;
+  /* n is number of rounds */
+  n = (length + BT_OCTET16_LEN - 1) / BT_OCTET16_LEN;
+  if (n == 0) n = 1;
+  last_len = length - (n - 1) * BT_OCTET16_LEN;
 
-  if (flag) { /* last block is complete block */
-    smp_xor_128(&cmac_cb.text[0], k1);
-  } else /* padding then xor with k2 */
-  {
-    padding(&cmac_cb.text[0], (uint8_t)(cmac_cb.len % 16));
+  for (int i = 0; i < BT_OCTET16_LEN; i++)
+    rev_key[i] = key[BT_OCTET16_LEN - 1 - i];
+  smp_aes_set_key(rev_key, &aes_key);
 
-    smp_xor_128(&cmac_cb.text[0], k2);
-  }
-}
-/*******************************************************************************
- *
- * Function         cmac_subkey_cont
- *
- * Description      This is the callback function when CIPHk(0[128]) is
- *                  completed.
- *
- * Returns          void
- *
- ******************************************************************************/
-static void cmac_subkey_cont(tSMP_ENC* p) {
-  uint8_t k1[BT_OCTET16_LEN], k2[BT_OCTET16_LEN];
-  uint8_t* pp = p->param_buf;
-  SMP_TRACE_EVENT("cmac_subkey_cont ");
-  print128(pp, (const uint8_t*)"K1 before shift");
+  /* subkeys from L = CIPHk(0[128]) */
+  smp_aes_encrypt(&aes_key, x, m);
+  cmac_double(m, k1);
+  cmac_double(k1, k2);
 
-  /* If MSB(L) = 0, then K1 = L << 1 */
-  if ((pp[BT_OCTET16_LEN - 1] & 0x80) != 0) {
-    /* Else K1 = ( L << 1 ) (+) Rb */
-    leftshift_onebit(pp, k1);
-    smp_xor_128(k1, const_Rb);
-  } else {
-    leftshift_onebit(pp, k1);
+  for (uint32_t i = 1; i < n; i++) {
+    cmac_read(&reader, m, BT_OCTET16_LEN);
+    smp_xor_128(x, m); /* X := Mi (+) X */
+    smp_aes_encrypt(&aes_key, x, x);
   }
 
-  if ((k1[BT_OCTET16_LEN - 1] & 0x80) != 0) {
-    /* K2 =  (K1 << 1) (+) Rb */
-    leftshift_onebit(k1, k2);
-    smp_xor_128(k2, const_Rb);
+  /* the last block is xored with K1 if complete, padded then xored with K2
+   * otherwise */
+  memset(m, 0, sizeof(m));
+  cmac_read(&reader, m, last_len);
+  if (last_len == BT_OCTET16_LEN) {
+    smp_xor_128(m, k1);
   } else {
-    /* If MSB(K1) = 0, then K2 = K1 << 1 */
-    leftshift_onebit(k1, k2);
+    m[last_len] = 0x80;
+    smp_xor_128(m, k2);
   }
+  smp_xor_128(x, m);
+  smp_aes_encrypt(&aes_key, x, x);
 
-  print128(k1, (const uint8_t*)"K1");
-  print128(k2, (const uint8_t*)"K2");
-
-  cmac_prepare_last_block(k1, k2);
+  /* T = MSB_tlen(X), little endian */
+  for (uint16_t i = 0; i < tlen; i++) p_signature[i] = x[tlen - 1 - i];
+  return true;
 }
-/*******************************************************************************
- *
- * Function         cmac_generate_subkey
- *
- * Description      This is the function to generate the two subkeys.
- *
- * Parameters       key - CMAC key, expect SRK when used by SMP.
- *
- * Returns          void
- *
- ******************************************************************************/
-static bool cmac_generate_subkey(BT_OCTET16 key) {
-  BT_OCTET16 z = {0};
-  bool ret = true;
-  tSMP_ENC output;
-  SMP_TRACE_EVENT(" cmac_generate_subkey");
 
-  if (SMP_Encrypt(key, BT_OCTET16_LEN, z, BT_OCTET16_LEN, &output)) {
-    cmac_subkey_cont(&output);
-    ;
-  } else
-    ret = false;
-
-  return ret;
-}
 /*******************************************************************************
  *
  * Function         aes_cipher_msg_auth_code
@@ -273,41 +170,13 @@ static bool cmac_generate_subkey(BT_OCTET16 key) {
  *                  p_signature - data pointer to where signed data to be
  *                                stored, tlen long.
  *
- * Returns          false if out of resources, true in other cases.
+ * Returns          false if tlen is too long, true in other cases.
  *
  ******************************************************************************/
 bool aes_cipher_msg_auth_code(BT_OCTET16 key, uint8_t* input, uint16_t length,
                               uint16_t tlen, uint8_t* p_signature) {
-  uint16_t len, diff;
-  uint16_t n = (length + BT_OCTET16_LEN - 1) /
-               BT_OCTET16_LEN; /* n is number of rounds */
-  bool ret = false;
+  tSMP_CMAC_SEG seg = {input, input != NULL ? length : (uint16_t)0};
 
   SMP_TRACE_EVENT("%s", __func__);
-
-  if (n == 0) n = 1;
-  len = n * BT_OCTET16_LEN;
-
-  SMP_TRACE_WARNING("AES128_CMAC started, allocate buffer size = %d", len);
-  /* allocate a memory space of multiple of 16 bytes to hold text  */
-  cmac_cb.text = (uint8_t*)osi_calloc(len);
-  cmac_cb.round = n;
-  diff = len - length;
-
-  if (input != NULL && length > 0) {
-    memcpy(&cmac_cb.text[diff], input, (int)length);
-    cmac_cb.len = length;
-  } else {
-    cmac_cb.len = 0;
-  }
-
-  /* prepare calculation for subkey s and last block of data */
-  if (cmac_generate_subkey(key)) {
-    /* start calculation */
-    ret = cmac_aes_k_calculate(key, p_signature, tlen);
-  }
-  /* clean up */
-  cmac_aes_cleanup();
-
-  return ret;
+  return aes_cmac(key, &seg, 1, tlen, p_signature);
 }
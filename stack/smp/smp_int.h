@@ -307,6 +307,7 @@ typedef struct {
   uint8_t
       round; /* authentication stage 1 round for passkey association model */
   uint32_t number_to_display;
+  uint64_t sc_start_us; /* when the local key pair was asked for */
   BT_OCTET16 mac_key;
   uint8_t peer_enc_size;
   uint8_t loc_enc_size;
@@ -537,9 +538,35 @@ extern void smp_debug_print_nbyte_little_endian(uint8_t* p,
 #endif
 
 /* smp_cmac.cc */
+/* A part of an AES-CMAC message, little endian */
+typedef struct {
+  const uint8_t* p_data;
+  uint16_t len;
+} tSMP_CMAC_SEG;
+
+extern bool aes_cmac(const uint8_t* key, const tSMP_CMAC_SEG* p_segs,
+                     uint8_t num_segs, uint16_t tlen, uint8_t* p_signature);
 extern bool aes_cipher_msg_auth_code(BT_OCTET16 key, uint8_t* input,
                                      uint16_t length, uint16_t tlen,
                                      uint8_t* p_signature);
 extern void print128(BT_OCTET16 x, const uint8_t* key_name);
 
+/* smp_key_pool.cc */
+typedef struct {
+  size_t depth;
+  size_t available;
+  uint64_t generated;
+  uint64_t hits;
+  uint64_t misses;
+} tSMP_KEY_POOL_STATS;
+
+extern void smp_key_pool_init(void);
+extern void smp_key_pool_start(size_t depth);
+extern void smp_key_pool_stop(void);
+extern bool smp_key_pool_take(BT_OCTET32 private_key,
+                              tSMP_PUBLIC_KEY* p_public_key);
+extern void smp_key_pool_log_key_latency(bool hit, uint64_t elapsed_us);
+extern void smp_key_pool_log_pairing_latency(uint64_t elapsed_us);
+extern void smp_key_pool_get_stats(tSMP_KEY_POOL_STATS* p_stats);
+
 #endif /* SMP_INT_H */
@@ -0,0 +1,332 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/******************************************************************************
+ *
+ *  This file contains the pool of P-256 key pairs generated ahead of LE
+ *  Secure Connections pairing on a low priority thread, and the metrics on
+ *  how much of the pairing latency it saves.
+ *
+ ******************************************************************************/
+
+#define LOG_TAG "bt_smp_key_pool"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+
+#include "bt_target.h"
+#include "osi/include/log.h"
+#include "osi/include/osi.h"
+#include "osi/include/properties.h"
+#include "osi/include/thread.h"
+#include "p_256_ecc_pp.h"
+#include "smp_int.h"
+
+#define SMP_KEY_POOL_DEPTH_PROPERTY "persist.bluetooth.smp_key_pool_depth"
+#define SMP_KEY_POOL_MAX_DEPTH 32
+
+/* Android's background priority: keys are made while the stack is idle */
+#define SMP_KEY_POOL_THREAD_PRIORITY 10
+
+#define SMP_KEY_POOL_RANDOM_PATH "/dev/urandom"
+
+typedef struct {
+  BT_OCTET32 private_key;
+  tSMP_PUBLIC_KEY public_key;
+} tSMP_KEY_PAIR;
+
+typedef struct {
+  uint64_t count;
+  uint64_t total_us;
+  uint64_t max_us;
+} tSMP_LATENCY;
+
+static std::mutex pool_lock;
+static thread_t* pool_thread;
+static size_t pool_depth;
+static std::atomic<bool> pool_fill_pending;
+
+/* Guarded by pool_lock */
+static tSMP_KEY_PAIR pool_keys[SMP_KEY_POOL_MAX_DEPTH];
+static size_t pool_count;
+static tSMP_KEY_POOL_STATS pool_stats;
+static tSMP_LATENCY hit_key_latency;
+static tSMP_LATENCY miss_key_latency;
+static tSMP_LATENCY pairing_latency;
+
+static void smp_key_pool_wipe(void* p, size_t len) {
+  volatile uint8_t* bytes = (volatile uint8_t*)p;
+  while (len--) *bytes++ = 0;
+}
+
+static bool smp_key_pool_make_key_pair(tSMP_KEY_PAIR* p_pair) {
+  int fd = open(SMP_KEY_POOL_RANDOM_PATH, O_RDONLY | O_CLOEXEC);
+  if (fd == INVALID_FD) {
+    LOG_ERROR(LOG_TAG, "%s can't open %s: %s", __func__,
+              SMP_KEY_POOL_RANDOM_PATH, strerror(errno));
+    return false;
+  }
+  ssize_t len;
+  OSI_NO_INTR(len = read(fd, p_pair->private_key, BT_OCTET32_LEN));
+  close(fd);
+  if (len != BT_OCTET32_LEN) {
+    LOG_ERROR(LOG_TAG, "%s short read from %s", __func__,
+              SMP_KEY_POOL_RANDOM_PATH);
+    return false;
+  }
+
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256];
+  Point public_key;
+  memcpy(private_key, p_pair->private_key, BT_OCTET32_LEN);
+  ECC_PointMult_Base(&public_key, private_key);
+  memcpy(p_pair->public_key.x, public_key.x, BT_OCTET32_LEN);
+  memcpy(p_pair->public_key.y, public_key.y, BT_OCTET32_LEN);
+  smp_key_pool_wipe(private_key, sizeof(private_key));
+  return true;
+}
+
+/* Runs on pool_thread: tops the pool up to its depth */
+static void smp_key_pool_fill(UNUSED_ATTR void* context) {
+  pool_fill_pending = false;
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(pool_lock);
+      if (pool_count >= pool_depth) return;
+    }
+
+    tSMP_KEY_PAIR pair;
+    if (!smp_key_pool_make_key_pair(&pair)) return;
+
+    std::lock_guard<std::mutex> lock(pool_lock);
+    if (pool_count < pool_depth) {
+      pool_keys[pool_count++] = pair;
+      pool_stats.generated++;
+    }
+    smp_key_pool_wipe(&pair, sizeof(pair));
+  }
+}
+
+static void smp_key_pool_request_fill(void) {
+  if (pool_thread == NULL || pool_fill_pending.exchange(true)) return;
+  thread_post(pool_thread, smp_key_pool_fill, NULL);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_init
+ *
+ * Description      Starts the key pool with the depth set by the
+ *                  persist.bluetooth.smp_key_pool_depth property, or
+ *                  SMP_KEY_POOL_DEPTH if it isn't set. A depth of 0 leaves the
+ *                  pool off.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_init(void) {
+  int32_t depth =
+      osi_property_get_int32(SMP_KEY_POOL_DEPTH_PROPERTY, SMP_KEY_POOL_DEPTH);
+  if (depth > 0) smp_key_pool_start(depth);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_start
+ *
+ * Description      Starts generating up to |depth| key pairs in the
+ *                  background, capped at SMP_KEY_POOL_MAX_DEPTH.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_start(size_t depth) {
+  smp_key_pool_stop();
+  if (depth == 0) return;
+
+  if (depth > SMP_KEY_POOL_MAX_DEPTH) {
+    LOG_WARN(LOG_TAG, "%s depth %zu capped to %d", __func__, depth,
+             SMP_KEY_POOL_MAX_DEPTH);
+    depth = SMP_KEY_POOL_MAX_DEPTH;
+  }
+
+  pool_thread = thread_new("bt_smp_key_pool");
+  if (pool_thread == NULL) {
+    LOG_ERROR(LOG_TAG, "%s unable to create the key pool thread", __func__);
+    return;
+  }
+  thread_set_priority(pool_thread, SMP_KEY_POOL_THREAD_PRIORITY);
+
+  {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    pool_depth = depth;
+    pool_stats.depth = depth;
+  }
+  smp_key_pool_request_fill();
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_stop
+ *
+ * Description      Stops the key pool thread and wipes the key pairs it
+ *                  didn't hand out. The metrics are kept.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_stop(void) {
+  if (pool_thread == NULL) return;
+
+  thread_free(pool_thread);
+  pool_thread = NULL;
+  pool_fill_pending = false;
+
+  std::lock_guard<std::mutex> lock(pool_lock);
+  smp_key_pool_wipe(pool_keys, sizeof(pool_keys));
+  pool_count = 0;
+  pool_depth = 0;
+  pool_stats.depth = 0;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_take
+ *
+ * Description      Moves a pre-generated key pair out of the pool. Each pair
+ *                  is handed out once and wiped from the pool as it is.
+ *
+ * Returns          true if the pool had a key pair, false if the caller has to
+ *                  generate one.
+ *
+ ******************************************************************************/
+bool smp_key_pool_take(BT_OCTET32 private_key, tSMP_PUBLIC_KEY* p_public_key) {
+  bool hit = false;
+  {
+    std::lock_guard<std::mutex> lock(pool_lock);
+    if (pool_depth == 0) return false;
+
+    if (pool_count > 0) {
+      tSMP_KEY_PAIR* p_pair = &pool_keys[--pool_count];
+      memcpy(private_key, p_pair->private_key, BT_OCTET32_LEN);
+      *p_public_key = p_pair->public_key;
+      smp_key_pool_wipe(p_pair, sizeof(*p_pair));
+      pool_stats.hits++;
+      hit = true;
+    } else {
+      pool_stats.misses++;
+    }
+  }
+
+  smp_key_pool_request_fill();
+  return hit;
+}
+
+static void smp_key_pool_log_latency(tSMP_LATENCY* p_latency,
+                                     uint64_t elapsed_us) {
+  p_latency->count++;
+  p_latency->total_us += elapsed_us;
+  if (elapsed_us > p_latency->max_us) p_latency->max_us = elapsed_us;
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_log_key_latency
+ *
+ * Description      Records how long a pairing waited for its local key pair,
+ *                  |hit| telling whether it came from the pool.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_log_key_latency(bool hit, uint64_t elapsed_us) {
+  std::lock_guard<std::mutex> lock(pool_lock);
+  smp_key_pool_log_latency(hit ? &hit_key_latency : &miss_key_latency,
+                           elapsed_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_log_pairing_latency
+ *
+ * Description      Records the time from the start of the local key pair
+ *                  generation to the completion of an LE Secure Connections
+ *                  pairing.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_log_pairing_latency(uint64_t elapsed_us) {
+  std::lock_guard<std::mutex> lock(pool_lock);
+  smp_key_pool_log_latency(&pairing_latency, elapsed_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_key_pool_get_stats
+ *
+ * Description      Copies the key pool counters into |p_stats|.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void smp_key_pool_get_stats(tSMP_KEY_POOL_STATS* p_stats) {
+  std::lock_guard<std::mutex> lock(pool_lock);
+  *p_stats = pool_stats;
+  p_stats->available = pool_count;
+}
+
+static void smp_key_pool_dump_latency(int fd, const char* name,
+                                      const tSMP_LATENCY& latency) {
+  dprintf(fd, "  %s: %" PRIu64 " samples, avg %" PRIu64 " us, max %" PRIu64
+              " us\n",
+          name, latency.count,
+          latency.count ? latency.total_us / latency.count : 0,
+          latency.max_us);
+}
+
+/*******************************************************************************
+ *
+ * Function         SMP_DebugDump
+ *
+ * Description      Writes the key pool state and the pairing latencies to
+ *                  |fd| for dumpsys.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+void SMP_DebugDump(int fd) {
+  std::lock_guard<std::mutex> lock(pool_lock);
+  dprintf(fd, "\nSMP LE Secure Connections key pool:\n");
+  dprintf(fd, "  Depth: %zu, available: %zu\n", pool_depth, pool_count);
+  dprintf(fd, "  Key pairs generated: %" PRIu64 "\n", pool_stats.generated);
+  dprintf(fd, "  Pool hits: %" PRIu64 ", misses: %" PRIu64 "\n",
+          pool_stats.hits, pool_stats.misses);
+  smp_key_pool_dump_latency(fd, "Local key pair from the pool",
+                            hit_key_latency);
+  smp_key_pool_dump_latency(fd, "Local key pair generated on demand",
+                            miss_key_latency);
+  smp_key_pool_dump_latency(fd, "Pairing from key generation to completion",
+                            pairing_latency);
+}
@@ -28,7 +28,6 @@
 #endif
 #include <base/bind.h>
 #include <string.h>
-#include "aes.h"
 #include "bt_utils.h"
 #include "btm_ble_api.h"
 #include "btm_ble_int.h"
@@ -36,7 +35,9 @@
 #include "device/include/controller.h"
 #include "hcimsgs.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "p_256_ecc_pp.h"
+#include "smp_aes.h"
 #include "smp_int.h"
 
 using base::Bind;
@@ -49,6 +50,7 @@ static void smp_process_stk(tSMP_CB* p_cb, tSMP_ENC* p);
 static bool smp_calculate_legacy_short_term_key(tSMP_CB* p_cb,
                                                 tSMP_ENC* output);
 static void smp_process_private_key(tSMP_CB* p_cb);
+static void smp_local_key_pair_ready(tSMP_CB* p_cb, bool from_pool);
 
 #define SMP_PASSKEY_MASK 0xfff00000
 
@@ -111,12 +113,11 @@ void smp_debug_print_nbyte_big_endian(uint8_t* p, const char* key_name,
  ******************************************************************************/
 bool smp_encrypt_data(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
                       uint8_t pt_len, tSMP_ENC* p_out) {
-  aes_context ctx;
-  uint8_t* p_start = NULL;
+  tSMP_AES_KEY aes_key;
+  uint8_t data[SMP_ENCRYT_DATA_SIZE] = {0}; /* zero padded input data */
+  uint8_t rev_data[SMP_ENCRYT_DATA_SIZE]; /* input data in big endilan format */
+  uint8_t rev_key[SMP_ENCRYT_KEY_SIZE];   /* input key in big endilan format */
   uint8_t* p = NULL;
-  uint8_t* p_rev_data = NULL;   /* input data in big endilan format */
-  uint8_t* p_rev_key = NULL;    /* input key in big endilan format */
-  uint8_t* p_rev_output = NULL; /* encrypted output in big endilan format */
 
   SMP_TRACE_DEBUG("%s", __func__);
   if ((p_out == NULL) || (key_len != SMP_ENCRYT_KEY_SIZE)) {
@@ -124,29 +125,25 @@ bool smp_encrypt_data(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
     return false;
   }
 
-  p_start = (uint8_t*)osi_calloc(SMP_ENCRYT_DATA_SIZE * 4);
-
   if (pt_len > SMP_ENCRYT_DATA_SIZE) pt_len = SMP_ENCRYT_DATA_SIZE;
 
-  p = p_start;
-  ARRAY_TO_STREAM(p, plain_text, pt_len);          /* byte 0 to byte 15 */
-  p_rev_data = p = p_start + SMP_ENCRYT_DATA_SIZE; /* start at byte 16 */
-  REVERSE_ARRAY_TO_STREAM(p, p_start,
-                          SMP_ENCRYT_DATA_SIZE);        /* byte 16 to byte 31 */
-  p_rev_key = p;                                        /* start at byte 32 */
-  REVERSE_ARRAY_TO_STREAM(p, key, SMP_ENCRYT_KEY_SIZE); /* byte 32 to byte 47 */
+  p = data;
+  ARRAY_TO_STREAM(p, plain_text, pt_len);
+  p = rev_data;
+  REVERSE_ARRAY_TO_STREAM(p, data, SMP_ENCRYT_DATA_SIZE);
+  p = rev_key;
+  REVERSE_ARRAY_TO_STREAM(p, key, SMP_ENCRYT_KEY_SIZE);
 
 #if (SMP_DEBUG == TRUE && SMP_DEBUG_VERBOSE == TRUE)
   smp_debug_print_nbyte_little_endian(key, "Key", SMP_ENCRYT_KEY_SIZE);
-  smp_debug_print_nbyte_little_endian(p_start, "Plain text",
+  smp_debug_print_nbyte_little_endian(data, "Plain text",
                                       SMP_ENCRYT_DATA_SIZE);
 #endif
-  p_rev_output = p;
-  aes_set_key(p_rev_key, SMP_ENCRYT_KEY_SIZE, &ctx);
-  aes_encrypt(p_rev_data, p, &ctx); /* outputs in byte 48 to byte 63 */
+  smp_aes_set_key(rev_key, &aes_key);
+  smp_aes_encrypt(&aes_key, rev_data, rev_data);
 
   p = p_out->param_buf;
-  REVERSE_ARRAY_TO_STREAM(p, p_rev_output, SMP_ENCRYT_DATA_SIZE);
+  REVERSE_ARRAY_TO_STREAM(p, rev_data, SMP_ENCRYT_DATA_SIZE);
 #if (SMP_DEBUG == TRUE && SMP_DEBUG_VERBOSE == TRUE)
   smp_debug_print_nbyte_little_endian(p_out->param_buf, "Encrypted text",
                                       SMP_ENCRYT_KEY_SIZE);
@@ -156,8 +153,6 @@ bool smp_encrypt_data(uint8_t* key, uint8_t key_len, uint8_t* plain_text,
   p_out->status = HCI_SUCCESS;
   p_out->opcode = HCI_BLE_ENCRYPT;
 
-  osi_free(p_start);
-
   return true;
 }
 
@@ -748,8 +743,10 @@ bool smp_calculate_legacy_short_term_key(tSMP_CB* p_cb, tSMP_ENC* output) {
  *
  * Description      This function is called to create private key used to
  *                  calculate public key and DHKey.
- *                  The function starts private key creation requesting
- *                  for the controller to generate [0-7] octets of private key.
+ *                  It takes a key pair from the key pool when the pool has
+ *                  one. Otherwise the function starts private key creation
+ *                  requesting for the controller to generate [0-7] octets of
+ *                  private key.
  *
  * Returns          void
  *
@@ -757,6 +754,12 @@ bool smp_calculate_legacy_short_term_key(tSMP_CB* p_cb, tSMP_ENC* output) {
 void smp_create_private_key(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
   SMP_TRACE_DEBUG("%s", __func__);
 
+  p_cb->sc_start_us = time_get_os_boottime_us();
+  if (smp_key_pool_take(p_cb->private_key, &p_cb->loc_publ_key)) {
+    smp_local_key_pair_ready(p_cb, true);
+    return;
+  }
+
   btsnd_hcic_ble_rand(Bind(
       [](tSMP_CB* p_cb, BT_OCTET8 rand) {
         memcpy((void*)p_cb->private_key, rand, BT_OCTET8_LEN);
@@ -835,17 +838,35 @@ void smp_process_private_key(tSMP_CB* p_cb) {
   SMP_TRACE_DEBUG("%s", __func__);
 
   memcpy(private_key, p_cb->private_key, BT_OCTET32_LEN);
-  ECC_PointMult(&public_key, &(curve_p256.G), (uint32_t*)private_key,
-                KEY_LENGTH_DWORDS_P256);
+  ECC_PointMult_Base(&public_key, (uint32_t*)private_key);
   memcpy(p_cb->loc_publ_key.x, public_key.x, BT_OCTET32_LEN);
   memcpy(p_cb->loc_publ_key.y, public_key.y, BT_OCTET32_LEN);
 
+  smp_local_key_pair_ready(p_cb, false);
+}
+
+/*******************************************************************************
+ *
+ * Function         smp_local_key_pair_ready
+ *
+ * Description      This function notifies SM that private key / public key
+ *                  pair is created, |from_pool| telling whether it came
+ *                  from the key pool.
+ *
+ * Returns          void
+ *
+ ******************************************************************************/
+static void smp_local_key_pair_ready(tSMP_CB* p_cb, bool from_pool) {
   smp_debug_print_nbyte_little_endian(p_cb->private_key, "private",
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->loc_publ_key.x, "local public(x)",
                                       BT_OCTET32_LEN);
   smp_debug_print_nbyte_little_endian(p_cb->loc_publ_key.y, "local public(y)",
                                       BT_OCTET32_LEN);
+  if (p_cb->sc_start_us)
+    smp_key_pool_log_key_latency(
+        from_pool, time_get_os_boottime_us() - p_cb->sc_start_us);
+
   p_cb->flags |= SMP_PAIR_FLAG_HAVE_LOCAL_PUBL_KEY;
   smp_sm_event(p_cb, SMP_LOC_PUBL_KEY_CRTD_EVT, NULL);
 }
@@ -1001,9 +1022,7 @@ void smp_calculate_peer_commitment(tSMP_CB* p_cb, BT_OCTET16 output_buf) {
  ******************************************************************************/
 void smp_calculate_f4(uint8_t* u, uint8_t* v, uint8_t* x, uint8_t z,
                       uint8_t* c) {
-  uint8_t msg_len = BT_OCTET32_LEN /* U size */ + BT_OCTET32_LEN /* V size */ +
-                    1 /* Z size */;
-  uint8_t msg[BT_OCTET32_LEN + BT_OCTET32_LEN + 1];
+  tSMP_CMAC_SEG msg[] = {{u, BT_OCTET32_LEN}, {v, BT_OCTET32_LEN}, {&z, 1}};
   uint8_t key[BT_OCTET16_LEN];
   uint8_t cmac[BT_OCTET16_LEN];
   uint8_t* p = NULL;
@@ -1024,15 +1043,6 @@ void smp_calculate_f4(uint8_t* u, uint8_t* v, uint8_t* x, uint8_t z,
   smp_debug_print_nbyte_little_endian(p_prnt, "Z", 1);
 #endif
 
-  p = msg;
-  UINT8_TO_STREAM(p, z);
-  ARRAY_TO_STREAM(p, v, BT_OCTET32_LEN);
-  ARRAY_TO_STREAM(p, u, BT_OCTET32_LEN);
-#if (SMP_DEBUG == TRUE)
-  p_prnt = msg;
-  smp_debug_print_nbyte_little_endian(p_prnt, "M", msg_len);
-#endif
-
   p = key;
   ARRAY_TO_STREAM(p, x, BT_OCTET16_LEN);
 #if (SMP_DEBUG == TRUE)
@@ -1040,7 +1050,7 @@ void smp_calculate_f4(uint8_t* u, uint8_t* v, uint8_t* x, uint8_t z,
   smp_debug_print_nbyte_little_endian(p_prnt, "K", BT_OCTET16_LEN);
 #endif
 
-  aes_cipher_msg_auth_code(key, msg, msg_len, BT_OCTET16_LEN, cmac);
+  aes_cmac(key, msg, ARRAY_SIZE(msg), BT_OCTET16_LEN, cmac);
 #if (SMP_DEBUG == TRUE)
   p_prnt = cmac;
   smp_debug_print_nbyte_little_endian(p_prnt, "AES_CMAC", BT_OCTET16_LEN);
@@ -1114,9 +1124,8 @@ void smp_calculate_numeric_comparison_display_number(tSMP_CB* p_cb,
  *
  ******************************************************************************/
 uint32_t smp_calculate_g2(uint8_t* u, uint8_t* v, uint8_t* x, uint8_t* y) {
-  uint8_t msg_len = BT_OCTET32_LEN /* U size */ + BT_OCTET32_LEN /* V size */
-                    + BT_OCTET16_LEN /* Y size */;
-  uint8_t msg[BT_OCTET32_LEN + BT_OCTET32_LEN + BT_OCTET16_LEN];
+  tSMP_CMAC_SEG msg[] = {
+      {u, BT_OCTET32_LEN}, {v, BT_OCTET32_LEN}, {y, BT_OCTET16_LEN}};
   uint8_t key[BT_OCTET16_LEN];
   uint8_t cmac[BT_OCTET16_LEN];
   uint8_t* p = NULL;
@@ -1127,10 +1136,6 @@ uint32_t smp_calculate_g2(uint8_t* u, uint8_t* v, uint8_t* x, uint8_t* y) {
 
   SMP_TRACE_DEBUG("%s", __func__);
 
-  p = msg;
-  ARRAY_TO_STREAM(p, y, BT_OCTET16_LEN);
-  ARRAY_TO_STREAM(p, v, BT_OCTET32_LEN);
-  ARRAY_TO_STREAM(p, u, BT_OCTET32_LEN);
 #if (SMP_DEBUG == TRUE)
   p_prnt = u;
   smp_debug_print_nbyte_little_endian(p_prnt, "U", BT_OCTET32_LEN);
@@ -1149,7 +1154,7 @@ uint32_t smp_calculate_g2(uint8_t* u, uint8_t* v, uint8_t* x, uint8_t* y) {
   smp_debug_print_nbyte_little_endian(p_prnt, "K", BT_OCTET16_LEN);
 #endif
 
-  if (!aes_cipher_msg_auth_code(key, msg, msg_len, BT_OCTET16_LEN, cmac)) {
+  if (!aes_cmac(key, msg, ARRAY_SIZE(msg), BT_OCTET16_LEN, cmac)) {
     SMP_TRACE_ERROR("%s failed", __func__);
     return (BTM_MAX_PASSKEY_VAL + 1);
   }
@@ -1347,11 +1352,10 @@ bool smp_calculate_f5_mackey_or_long_term_key(uint8_t* t, uint8_t* counter,
   uint8_t* p = NULL;
   uint8_t cmac[BT_OCTET16_LEN];
   uint8_t key[BT_OCTET16_LEN];
-  uint8_t msg_len = 1 /* Counter size */ + 4 /* keyID size */ +
-                    BT_OCTET16_LEN /* N1 size */ +
-                    BT_OCTET16_LEN /* N2 size */ + 7 /* A1 size*/ +
-                    7 /* A2 size*/ + 2 /* Length size */;
-  uint8_t msg[1 + 4 + BT_OCTET16_LEN + BT_OCTET16_LEN + 7 + 7 + 2];
+  tSMP_CMAC_SEG msg[] = {{counter, 1},         {key_id, 4},
+                         {n1, BT_OCTET16_LEN}, {n2, BT_OCTET16_LEN},
+                         {a1, 7},              {a2, 7},
+                         {length, 2}};
   bool ret = true;
 #if (SMP_DEBUG == TRUE)
   uint8_t* p_prnt = NULL;
@@ -1383,20 +1387,8 @@ bool smp_calculate_f5_mackey_or_long_term_key(uint8_t* t, uint8_t* counter,
   p_prnt = key;
   smp_debug_print_nbyte_little_endian(p_prnt, "K", BT_OCTET16_LEN);
 #endif
-  p = msg;
-  ARRAY_TO_STREAM(p, length, 2);
-  ARRAY_TO_STREAM(p, a2, 7);
-  ARRAY_TO_STREAM(p, a1, 7);
-  ARRAY_TO_STREAM(p, n2, BT_OCTET16_LEN);
-  ARRAY_TO_STREAM(p, n1, BT_OCTET16_LEN);
-  ARRAY_TO_STREAM(p, key_id, 4);
-  ARRAY_TO_STREAM(p, counter, 1);
-#if (SMP_DEBUG == TRUE)
-  p_prnt = msg;
-  smp_debug_print_nbyte_little_endian(p_prnt, "M", msg_len);
-#endif
 
-  if (!aes_cipher_msg_auth_code(key, msg, msg_len, BT_OCTET16_LEN, cmac)) {
+  if (!aes_cmac(key, msg, ARRAY_SIZE(msg), BT_OCTET16_LEN, cmac)) {
     SMP_TRACE_ERROR("%s failed", __func__);
     ret = false;
   }
@@ -1583,11 +1575,9 @@ void smp_calculate_peer_dhkey_check(tSMP_CB* p_cb, tSMP_INT_DATA* p_data) {
 bool smp_calculate_f6(uint8_t* w, uint8_t* n1, uint8_t* n2, uint8_t* r,
                       uint8_t* iocap, uint8_t* a1, uint8_t* a2, uint8_t* c) {
   uint8_t* p = NULL;
-  uint8_t msg_len = BT_OCTET16_LEN /* N1 size */ +
-                    BT_OCTET16_LEN /* N2 size */ + BT_OCTET16_LEN /* R size */ +
-                    3 /* IOcap size */ + 7 /* A1 size*/
-                    + 7 /* A2 size*/;
-  uint8_t msg[BT_OCTET16_LEN + BT_OCTET16_LEN + BT_OCTET16_LEN + 3 + 7 + 7];
+  tSMP_CMAC_SEG msg[] = {{n1, BT_OCTET16_LEN}, {n2, BT_OCTET16_LEN},
+                         {r, BT_OCTET16_LEN},  {iocap, 3},
+                         {a1, 7},              {a2, 7}};
 #if (SMP_DEBUG == TRUE)
   uint8_t* p_print = NULL;
 #endif
@@ -1620,20 +1610,8 @@ bool smp_calculate_f6(uint8_t* w, uint8_t* n1, uint8_t* n2, uint8_t* r,
   smp_debug_print_nbyte_little_endian(p_print, "K", BT_OCTET16_LEN);
 #endif
 
-  p = msg;
-  ARRAY_TO_STREAM(p, a2, 7);
-  ARRAY_TO_STREAM(p, a1, 7);
-  ARRAY_TO_STREAM(p, iocap, 3);
-  ARRAY_TO_STREAM(p, r, BT_OCTET16_LEN);
-  ARRAY_TO_STREAM(p, n2, BT_OCTET16_LEN);
-  ARRAY_TO_STREAM(p, n1, BT_OCTET16_LEN);
-#if (SMP_DEBUG == TRUE)
-  p_print = msg;
-  smp_debug_print_nbyte_little_endian(p_print, "M", msg_len);
-#endif
-
   bool ret = true;
-  if (!aes_cipher_msg_auth_code(key, msg, msg_len, BT_OCTET16_LEN, cmac)) {
+  if (!aes_cmac(key, msg, ARRAY_SIZE(msg), BT_OCTET16_LEN, cmac)) {
     SMP_TRACE_ERROR("%s failed", __func__);
     ret = false;
   }
@@ -34,6 +34,7 @@
 #include "l2c_api.h"
 #include "l2c_int.h"
 #include "osi/include/osi.h"
+#include "osi/include/time.h"
 #include "smp_int.h"
 
 #define SMP_PAIRING_REQ_SIZE 7
@@ -938,6 +939,10 @@ void smp_proc_pairing_cmpl(tSMP_CB* p_cb) {
   SMP_TRACE_DEBUG("send SMP_COMPLT_EVT reason=0x%0x sec_level=0x%0x",
                   evt_data.cmplt.reason, evt_data.cmplt.sec_level);
 
+  if (p_cb->status == SMP_SUCCESS && p_cb->sc_start_us)
+    smp_key_pool_log_pairing_latency(time_get_os_boottime_us() -
+                                     p_cb->sc_start_us);
+
   RawAddress pairing_bda = p_cb->pairing_bda;
 
   smp_reset_control_value(p_cb);
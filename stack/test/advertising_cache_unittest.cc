@@ -0,0 +1,88 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "advertising_cache.h"
+
+namespace {
+
+RawAddress device_address(uint32_t i) {
+  const uint8_t address[6] = {0x00, 0x11, 0x22, (uint8_t)(i >> 16),
+                              (uint8_t)(i >> 8), (uint8_t)i};
+  return RawAddress(address);
+}
+
+std::vector<uint8_t> cached(const uint8_t* data, size_t len) {
+  return std::vector<uint8_t>(data, data + len);
+}
+
+}  // namespace
+
+TEST(AdvertisingCacheTest, SetAppendClear) {
+  AdvertisingCache cache;
+  const uint8_t adv[] = {0x02, 0x01, 0x06};
+  const uint8_t scan_rsp[] = {0x02, 0x0a, 0x00};
+  size_t len;
+
+  EXPECT_FALSE(cache.Contains(0, device_address(1)));
+  const uint8_t* data = cache.Set(0, device_address(1), adv, sizeof(adv), &len);
+  EXPECT_EQ(cached(data, len), std::vector<uint8_t>(adv, adv + sizeof(adv)));
+  EXPECT_TRUE(cache.Contains(0, device_address(1)));
+  EXPECT_FALSE(cache.Contains(1, device_address(1)));
+
+  data = cache.Append(0, device_address(1), scan_rsp, sizeof(scan_rsp), &len);
+  EXPECT_EQ(cached(data, len),
+            std::vector<uint8_t>({0x02, 0x01, 0x06, 0x02, 0x0a, 0x00}));
+
+  // Set starts over.
+  data = cache.Set(0, device_address(1), adv, sizeof(adv), &len);
+  EXPECT_EQ(len, sizeof(adv));
+
+  cache.Clear(0, device_address(1));
+  EXPECT_FALSE(cache.Contains(0, device_address(1)));
+}
+
+TEST(AdvertisingCacheTest, DropsOldest) {
+  AdvertisingCache cache;
+  const uint8_t adv[] = {0x02, 0x01, 0x06};
+  size_t len;
+
+  for (uint32_t i = 0; i <= AdvertisingCache::kMaxEntries; i++)
+    cache.Set(0, device_address(i), adv, sizeof(adv), &len);
+
+  EXPECT_FALSE(cache.Contains(0, device_address(0)));
+  for (uint32_t i = 1; i <= AdvertisingCache::kMaxEntries; i++)
+    EXPECT_TRUE(cache.Contains(0, device_address(i)));
+
+  // Clearing in the middle keeps the other entries reachable.
+  cache.Clear(0, device_address(3));
+  for (uint32_t i = 1; i <= AdvertisingCache::kMaxEntries; i++)
+    EXPECT_EQ(cache.Contains(0, device_address(i)), i != 3);
+}
+
+TEST(AdvertisingCacheTest, TruncatesAtMaxDataLen) {
+  AdvertisingCache cache;
+  std::vector<uint8_t> chunk(1000, 0x01);
+  size_t len;
+
+  cache.Set(0, device_address(1), chunk.data(), chunk.size(), &len);
+  cache.Append(0, device_address(1), chunk.data(), chunk.size(), &len);
+  EXPECT_EQ(len, (size_t)AdvertisingCache::kMaxDataLen);
+}
@@ -0,0 +1,316 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <deque>
+#include <set>
+
+#include "bt_types.h"
+#include "l2c_int.h"
+#include "l2cdefs.h"
+#include "osi/include/alarm.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+
+namespace {
+
+const uint16_t kLocalCid = L2CAP_BASE_APPL_CID;
+const uint16_t kRemoteCid = L2CAP_BASE_APPL_CID + 1;
+const uint16_t kSduLen = 20;
+const uint8_t kTxWindow = 10;
+const uint8_t kMaxTransmit = 3;
+
+// Number of frames the controller holds before the oldest is released
+const size_t kControllerBuffers = 4;
+
+}  // namespace
+
+class StackL2capFcrTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&l2cb, 0, sizeof(l2cb));
+
+    // Leave whatever is queued for HCI on the link queue
+    l2cb.is_cong_cback_context = true;
+
+    p_lcb_ = &l2cb.lcb_pool[0];
+    p_lcb_->in_use = true;
+    p_lcb_->handle = 1;
+    p_lcb_->link_state = LST_CONNECTED;
+    p_lcb_->transport = BT_TRANSPORT_BR_EDR;
+    p_lcb_->link_xmit_data_q = list_new(NULL);
+
+    p_ccb_ = &l2cb.ccb_pool[0];
+    p_ccb_->in_use = true;
+    p_ccb_->p_lcb = p_lcb_;
+    p_ccb_->chnl_state = CST_OPEN;
+    p_ccb_->local_cid = kLocalCid;
+    p_ccb_->remote_cid = kRemoteCid;
+    p_ccb_->bypass_fcs = L2CAP_BYPASS_FCS;
+    p_ccb_->tx_mps = L2CAP_MPS_OVER_BR_EDR;
+    p_ccb_->peer_cfg.fcr.mode = L2CAP_FCR_ERTM_MODE;
+    p_ccb_->peer_cfg.fcr.tx_win_sz = kTxWindow;
+    p_ccb_->peer_cfg.fcr.max_transmit = kMaxTransmit;
+    p_ccb_->our_cfg.fcr.rtrans_tout = L2CAP_MIN_RETRANS_TOUT;
+    p_ccb_->our_cfg.fcr.mon_tout = L2CAP_MIN_MONITOR_TOUT;
+    p_ccb_->xmit_hold_q = fixed_queue_new(SIZE_MAX);
+    p_ccb_->fcrb.ack_timer = alarm_new("l2c_fcrb.ack_timer");
+    p_ccb_->fcrb.mon_retrans_timer = alarm_new("l2c_fcrb.mon_retrans_timer");
+    p_ccb_->fcrb.srej_rcv_hold_q = fixed_queue_new(SIZE_MAX);
+    p_ccb_->fcrb.retrans_q = fixed_queue_new(SIZE_MAX);
+    p_ccb_->fcrb.waiting_for_ack_q = fixed_queue_new(SIZE_MAX);
+  }
+
+  void TearDown() override {
+    l2c_fcr_cleanup(p_ccb_);
+    fixed_queue_free(p_ccb_->xmit_hold_q, osi_free);
+    while (!list_is_empty(p_lcb_->link_xmit_data_q)) {
+      BT_HDR* p_buf = (BT_HDR*)list_front(p_lcb_->link_xmit_data_q);
+      list_remove(p_lcb_->link_xmit_data_q, p_buf);
+      osi_free(p_buf);
+    }
+    list_free(p_lcb_->link_xmit_data_q);
+  }
+
+  // Sends |num_frames| unsegmented I-frames, the way the link scheduler pulls
+  // them from the channel, and drops what would have gone to HCI.
+  void SendIFrames(int num_frames) {
+    for (int xx = 0; xx < num_frames; xx++) {
+      BT_HDR* p_sdu = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
+                                          kSduLen + L2CAP_FCS_LEN);
+      p_sdu->offset = L2CAP_MIN_OFFSET;
+      p_sdu->len = kSduLen;
+      p_sdu->event = 0;
+      p_sdu->layer_specific = 0;
+      memset((uint8_t*)(p_sdu + 1) + p_sdu->offset, xx, kSduLen);
+      fixed_queue_enqueue(p_ccb_->xmit_hold_q, p_sdu);
+
+      BT_HDR* p_xmit = l2c_fcr_get_next_xmit_sdu_seg(p_ccb_, 0);
+      ASSERT_NE(p_xmit, nullptr);
+      osi_free(p_xmit);
+    }
+  }
+
+  // Feeds the channel an S-frame from the peer, as l2c_rcv_acl_data() does
+  // once the basic L2CAP header has been stripped.
+  void ReceiveSFrame(uint16_t function_code, uint8_t req_seq) {
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
+                                        L2CAP_FCR_OVERHEAD);
+    p_buf->offset = L2CAP_MIN_OFFSET;
+    p_buf->len = L2CAP_FCR_OVERHEAD;
+    uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset;
+    UINT16_TO_STREAM(p, L2CAP_FCR_S_FRAME_BIT |
+                            (function_code << L2CAP_FCR_SUP_SHIFT) |
+                            (req_seq << L2CAP_FCR_REQ_SEQ_BITS_SHIFT));
+    l2c_fcr_proc_pdu(p_ccb_, p_buf);
+  }
+
+  static uint16_t GetCtrlWord(BT_HDR* p_buf) {
+    uint8_t* p = (uint8_t*)(p_buf + 1) + p_buf->offset + L2CAP_PKT_OVERHEAD;
+    uint16_t ctrl_word;
+    STREAM_TO_UINT16(ctrl_word, p);
+    return ctrl_word;
+  }
+
+  static uint8_t GetTxSeq(BT_HDR* p_buf) {
+    return (GetCtrlWord(p_buf) & L2CAP_FCR_TX_SEQ_BITS) >>
+           L2CAP_FCR_TX_SEQ_BITS_SHIFT;
+  }
+
+  // Every frame queued for retransmission must still be owned by
+  // waiting_for_ack_q, in the same order.
+  void ExpectRetransAliasesWaitingFrames(size_t num_frames) {
+    list_t* retrans = fixed_queue_get_list(p_ccb_->fcrb.retrans_q);
+    list_t* wack = fixed_queue_get_list(p_ccb_->fcrb.waiting_for_ack_q);
+    ASSERT_EQ(list_length(retrans), num_frames);
+    ASSERT_GE(list_length(wack), num_frames);
+
+    const list_node_t* node_wack = list_begin(wack);
+    for (size_t xx = num_frames; xx < list_length(wack); xx++)
+      node_wack = list_next(node_wack);
+    for (const list_node_t* node = list_begin(retrans);
+         node != list_end(retrans); node = list_next(node)) {
+      EXPECT_EQ(list_node(node), list_node(node_wack));
+      node_wack = list_next(node_wack);
+    }
+  }
+
+  // Bytes of all the frames held by the channel and the controller, counting
+  // a frame queued both for acknowledgement and retransmission once.
+  size_t HeldBytes(const std::deque<BT_HDR*>& controller) {
+    std::set<BT_HDR*> held(controller.begin(), controller.end());
+    for (fixed_queue_t* queue :
+         {p_ccb_->fcrb.waiting_for_ack_q, p_ccb_->fcrb.retrans_q}) {
+      list_t* list = fixed_queue_get_list(queue);
+      for (const list_node_t* node = list_begin(list); node != list_end(list);
+           node = list_next(node))
+        held.insert((BT_HDR*)list_node(node));
+    }
+
+    size_t bytes = 0;
+    for (BT_HDR* p_buf : held) bytes += BT_HDR_SIZE + p_buf->offset + p_buf->len;
+    return bytes;
+  }
+
+  tL2C_LCB* p_lcb_;
+  tL2C_CCB* p_ccb_;
+};
+
+TEST_F(StackL2capFcrTest, rej_queues_unacked_frames_for_retransmission) {
+  SendIFrames(4);
+  ASSERT_EQ(fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q), 4u);
+
+  // Acks frame 0 and asks for everything from frame 1 again
+  ReceiveSFrame(L2CAP_FCR_SUP_REJ, 1);
+
+  EXPECT_EQ(fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q), 3u);
+  ExpectRetransAliasesWaitingFrames(3);
+  EXPECT_EQ(GetTxSeq((BT_HDR*)fixed_queue_try_peek_first(
+                p_ccb_->fcrb.retrans_q)),
+            1);
+}
+
+TEST_F(StackL2capFcrTest, repeated_rej_does_not_duplicate_frames) {
+  SendIFrames(4);
+
+  for (int xx = 0; xx < 3; xx++) ReceiveSFrame(L2CAP_FCR_SUP_REJ, 0);
+
+  ExpectRetransAliasesWaitingFrames(4);
+}
+
+TEST_F(StackL2capFcrTest, ack_drops_frames_from_retransmission_queue) {
+  SendIFrames(4);
+  ReceiveSFrame(L2CAP_FCR_SUP_REJ, 1);
+
+  // The peer acks frames 1 and 2 before they are resent
+  ReceiveSFrame(L2CAP_FCR_SUP_RR, 3);
+
+  EXPECT_EQ(fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q), 1u);
+  ExpectRetransAliasesWaitingFrames(1);
+  EXPECT_EQ(GetTxSeq((BT_HDR*)fixed_queue_try_peek_first(
+                p_ccb_->fcrb.retrans_q)),
+            3);
+
+  // Acking the rest empties both queues
+  ReceiveSFrame(L2CAP_FCR_SUP_RR, 4);
+
+  EXPECT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.waiting_for_ack_q));
+  EXPECT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.retrans_q));
+}
+
+TEST_F(StackL2capFcrTest, retransmission_sends_copy_of_unacked_frame) {
+  SendIFrames(2);
+  ReceiveSFrame(L2CAP_FCR_SUP_REJ, 1);
+  BT_HDR* p_wack =
+      (BT_HDR*)fixed_queue_try_peek_first(p_ccb_->fcrb.waiting_for_ack_q);
+  ASSERT_EQ(p_wack, fixed_queue_try_peek_first(p_ccb_->fcrb.retrans_q));
+
+  BT_HDR* p_xmit = l2c_fcr_get_next_xmit_sdu_seg(p_ccb_, 0);
+
+  ASSERT_NE(p_xmit, nullptr);
+  EXPECT_NE(p_xmit, p_wack);
+  EXPECT_EQ(p_xmit->len, p_wack->len);
+  EXPECT_EQ(p_xmit->event, kLocalCid);
+  EXPECT_EQ(GetTxSeq(p_xmit), 1);
+  EXPECT_EQ(0, memcmp((uint8_t*)(p_xmit + 1) + p_xmit->offset,
+                      (uint8_t*)(p_wack + 1) + p_wack->offset, p_xmit->len));
+  EXPECT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.retrans_q));
+  EXPECT_EQ(fixed_queue_length(p_ccb_->fcrb.waiting_for_ack_q), 1u);
+  osi_free(p_xmit);
+
+  // The frame sent is a copy, acking it frees the original
+  ReceiveSFrame(L2CAP_FCR_SUP_RR, 2);
+  EXPECT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.waiting_for_ack_q));
+}
+
+TEST_F(StackL2capFcrTest, cleanup_with_pending_retransmissions) {
+  SendIFrames(kTxWindow);
+  ReceiveSFrame(L2CAP_FCR_SUP_REJ, 0);
+
+  // TearDown() frees the channel while retrans_q still holds every frame
+  ExpectRetransAliasesWaitingFrames(kTxWindow);
+}
+
+// Measures the memory an ERTM channel holds while its peer keeps rejecting
+// frames. Each round fills the window, the peer rejects all but the first
+// quarter, and acks the whole window once the controller has taken some of the
+// resends. Frames sent stay with the controller until it has
+// kControllerBuffers newer ones.
+TEST_F(StackL2capFcrTest, retransmission_memory_high_water) {
+  const int kNumRounds = 1000;
+
+  std::deque<BT_HDR*> controller;
+  size_t high_water = 0;
+  size_t bytes_resent = 0;
+  auto send = [&](BT_HDR* p_xmit) {
+    controller.push_back(p_xmit);
+    if (controller.size() > kControllerBuffers) {
+      osi_free(controller.front());
+      controller.pop_front();
+    }
+    high_water = std::max(high_water, HeldBytes(controller));
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kNumRounds; round++) {
+    for (int xx = 0; xx < kTxWindow; xx++) {
+      BT_HDR* p_sdu = (BT_HDR*)osi_malloc(BT_HDR_SIZE + L2CAP_MIN_OFFSET +
+                                          kSduLen + L2CAP_FCS_LEN);
+      p_sdu->offset = L2CAP_MIN_OFFSET;
+      p_sdu->len = kSduLen;
+      p_sdu->event = 0;
+      p_sdu->layer_specific = 0;
+      memset((uint8_t*)(p_sdu + 1) + p_sdu->offset, xx, kSduLen);
+      fixed_queue_enqueue(p_ccb_->xmit_hold_q, p_sdu);
+
+      BT_HDR* p_xmit = l2c_fcr_get_next_xmit_sdu_seg(p_ccb_, 0);
+      ASSERT_NE(p_xmit, nullptr);
+      send(p_xmit);
+    }
+
+    ReceiveSFrame(L2CAP_FCR_SUP_REJ, (p_ccb_->fcrb.last_rx_ack + kTxWindow / 4) &
+                                         L2CAP_FCR_SEQ_MODULO);
+    high_water = std::max(high_water, HeldBytes(controller));
+
+    for (size_t xx = 0; xx < kControllerBuffers; xx++) {
+      BT_HDR* p_xmit = l2c_fcr_get_next_xmit_sdu_seg(p_ccb_, 0);
+      ASSERT_NE(p_xmit, nullptr);
+      bytes_resent += p_xmit->len;
+      send(p_xmit);
+    }
+
+    ReceiveSFrame(L2CAP_FCR_SUP_RR, p_ccb_->fcrb.next_tx_seq);
+    ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.waiting_for_ack_q));
+    ASSERT_TRUE(fixed_queue_is_empty(p_ccb_->fcrb.retrans_q));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  for (BT_HDR* p_xmit : controller) osi_free(p_xmit);
+
+  LOG(INFO) << "ERTM retransmission: high water " << high_water
+            << " bytes, resent " << bytes_resent << " bytes in " << elapsed
+            << "us";
+  // Frames queued for retransmission don't take memory of their own
+  size_t frame_size = BT_HDR_SIZE + L2CAP_MIN_OFFSET + kSduLen + L2CAP_FCS_LEN;
+  EXPECT_LE(high_water, (kTxWindow + kControllerBuffers) * frame_size);
+}
@@ -0,0 +1,264 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include <utility>
+#include <vector>
+
+#include "bt_types.h"
+#include "device/include/controller.h"
+#include "l2c_int.h"
+#include "l2cdefs.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "osi/include/list.h"
+#include "osi/include/time.h"
+
+#if (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE)
+
+namespace {
+
+// Packets handed to HCI, as (ACL handle, local CID of the channel)
+std::vector<std::pair<uint16_t, uint16_t>> sent_packets;
+
+// The channel of each link that l2cu_get_next_buffer_to_send() served last
+tL2C_CCB* last_served_ccb[MAX_L2CAP_LINKS];
+
+uint16_t get_acl_data_size() { return 1021; }
+uint16_t get_acl_packet_size() { return 1021 + HCI_DATA_PREAMBLE_SIZE; }
+
+controller_t controller;
+
+}  // namespace
+
+const controller_t* controller_get_interface() { return &controller; }
+
+void bte_main_hci_send(BT_HDR* p_msg, uint16_t event) {
+  uint8_t* p = (uint8_t*)(p_msg + 1) + p_msg->offset;
+  uint16_t handle, local_cid;
+  STREAM_TO_UINT16(handle, p);
+  STREAM_TO_UINT16(local_cid, p);
+  sent_packets.push_back(std::make_pair(handle, local_cid));
+  osi_free(p_msg);
+}
+
+tL2C_CCB* l2cu_find_ccb_by_cid(tL2C_LCB* p_lcb, uint16_t local_cid) {
+  if (local_cid < L2CAP_BASE_APPL_CID) return NULL;
+  local_cid -= L2CAP_BASE_APPL_CID;
+  if (local_cid >= MAX_L2CAP_CHANNELS) return NULL;
+
+  tL2C_CCB* p_ccb = &l2cb.ccb_pool[local_cid];
+  if (!p_ccb->in_use || (p_lcb && p_lcb != p_ccb->p_lcb)) return NULL;
+  return p_ccb;
+}
+
+// Serves the channels of a link in turn, whatever their class, the way
+// l2cu_get_next_channel_in_rr() serves channels of the same priority.
+BT_HDR* l2cu_get_next_buffer_to_send(tL2C_LCB* p_lcb,
+                                     tL2C_TX_COMPLETE_CB_INFO* p_cbi) {
+  tL2C_CCB* p_ccb = last_served_ccb[p_lcb - l2cb.lcb_pool];
+  p_cbi->cb = NULL;
+
+  for (int xx = 0; xx < MAX_L2CAP_CHANNELS; xx++) {
+    p_ccb = (p_ccb == NULL || p_ccb->p_next_ccb == NULL)
+                ? p_lcb->ccb_queue.p_first_ccb
+                : p_ccb->p_next_ccb;
+    if (p_ccb == NULL) return NULL;
+    if (fixed_queue_is_empty(p_ccb->xmit_hold_q)) continue;
+
+    last_served_ccb[p_lcb - l2cb.lcb_pool] = p_ccb;
+    p_cbi->local_cid = p_ccb->local_cid;
+    return (BT_HDR*)fixed_queue_try_dequeue(p_ccb->xmit_hold_q);
+  }
+  return NULL;
+}
+
+class StackL2capLinkTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    controller.get_acl_data_size_classic = get_acl_data_size;
+    controller.get_acl_data_size_ble = get_acl_data_size;
+    controller.get_acl_packet_size_classic = get_acl_packet_size;
+    controller.get_acl_packet_size_ble = get_acl_packet_size;
+
+    memset(&l2cb, 0, sizeof(l2cb));
+    memset(last_served_ccb, 0, sizeof(last_served_ccb));
+    sent_packets.clear();
+    num_ccbs_ = 0;
+  }
+
+  void TearDown() override {
+    for (int xx = 0; xx < MAX_L2CAP_LINKS; xx++) {
+      tL2C_LCB* p_lcb = &l2cb.lcb_pool[xx];
+      if (!p_lcb->in_use) continue;
+      while (!list_is_empty(p_lcb->link_xmit_data_q)) {
+        BT_HDR* p_buf = (BT_HDR*)list_front(p_lcb->link_xmit_data_q);
+        list_remove(p_lcb->link_xmit_data_q, p_buf);
+        osi_free(p_buf);
+      }
+      list_free(p_lcb->link_xmit_data_q);
+    }
+    for (int xx = 0; xx < num_ccbs_; xx++)
+      fixed_queue_free(l2cb.ccb_pool[xx].xmit_hold_q, osi_free);
+  }
+
+  // Sets the controller window shared by the round robin links
+  void SetWindow(uint16_t num_pkts) {
+    l2cb.controller_xmit_window = num_pkts;
+    l2cb.round_robin_quota = num_pkts;
+    l2cb.round_robin_unacked = 0;
+  }
+
+  tL2C_LCB* AddLink(uint16_t handle) {
+    tL2C_LCB* p_lcb = &l2cb.lcb_pool[handle - 1];
+    p_lcb->in_use = true;
+    p_lcb->handle = handle;
+    p_lcb->link_state = LST_CONNECTED;
+    p_lcb->transport = BT_TRANSPORT_BR_EDR;
+    p_lcb->link_xmit_data_q = list_new(NULL);
+    return p_lcb;
+  }
+
+  tL2C_CCB* AddChannel(tL2C_LCB* p_lcb, uint16_t psm,
+                       tL2CAP_CHNL_PRIORITY pri) {
+    tL2C_RCB* p_rcb = &l2cb.rcb_pool[num_ccbs_];
+    p_rcb->in_use = true;
+    p_rcb->psm = p_rcb->real_psm = psm;
+
+    tL2C_CCB* p_ccb = &l2cb.ccb_pool[num_ccbs_++];
+    p_ccb->in_use = true;
+    p_ccb->local_cid = L2CAP_BASE_APPL_CID + (p_ccb - l2cb.ccb_pool);
+    p_ccb->chnl_state = CST_OPEN;
+    p_ccb->p_lcb = p_lcb;
+    p_ccb->p_rcb = p_rcb;
+    p_ccb->ccb_priority = pri;
+    p_ccb->xmit_hold_q = fixed_queue_new(SIZE_MAX);
+
+    tL2C_CCB** pp_next = &p_lcb->ccb_queue.p_first_ccb;
+    while (*pp_next != NULL) pp_next = &(*pp_next)->p_next_ccb;
+    *pp_next = p_ccb;
+    p_lcb->ccb_queue.p_last_ccb = p_ccb;
+    return p_ccb;
+  }
+
+  // Builds a packet that tells bte_main_hci_send() where it came from
+  static BT_HDR* MakePacket(uint16_t handle, uint16_t local_cid) {
+    BT_HDR* p_buf = (BT_HDR*)osi_malloc(BT_HDR_SIZE + 4);
+    p_buf->offset = 0;
+    p_buf->len = 4;
+    p_buf->event = 0;
+    p_buf->layer_specific = 0;
+    uint8_t* p = (uint8_t*)(p_buf + 1);
+    UINT16_TO_STREAM(p, handle);
+    UINT16_TO_STREAM(p, local_cid);
+    return p_buf;
+  }
+
+  static void QueuePackets(tL2C_CCB* p_ccb, int num_pkts) {
+    for (int xx = 0; xx < num_pkts; xx++)
+      fixed_queue_enqueue(p_ccb->xmit_hold_q,
+                          MakePacket(p_ccb->p_lcb->handle, p_ccb->local_cid));
+  }
+
+  int num_ccbs_;
+};
+
+TEST_F(StackL2capLinkTest, media_link_gets_its_weight_per_round) {
+  tL2C_LCB* p_media_lcb = AddLink(1);
+  tL2C_CCB* p_media =
+      AddChannel(p_media_lcb, BT_PSM_AVDTP, L2CAP_CHNL_PRIORITY_HIGH);
+  tL2C_LCB* p_bulk_lcb = AddLink(2);
+  tL2C_CCB* p_bulk =
+      AddChannel(p_bulk_lcb, BT_PSM_RFCOMM, L2CAP_CHNL_PRIORITY_LOW);
+  QueuePackets(p_media, 10);
+  QueuePackets(p_bulk, 10);
+  SetWindow(10);
+
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+
+  std::vector<uint16_t> handles;
+  for (auto& sent : sent_packets) handles.push_back(sent.first);
+  EXPECT_EQ(handles, std::vector<uint16_t>({1, 1, 1, 1, 2, 1, 1, 1, 1, 2}));
+}
+
+TEST_F(StackL2capLinkTest, bulk_channel_charged_as_bulk_next_to_hid) {
+  // A HID channel with one report queued must not let the bulk channel on
+  // the same link send at the HID weight.
+  tL2C_LCB* p_lcb_1 = AddLink(1);
+  tL2C_CCB* p_hid = AddChannel(p_lcb_1, BT_PSM_HIDI, L2CAP_CHNL_PRIORITY_LOW);
+  tL2C_CCB* p_bulk_1 =
+      AddChannel(p_lcb_1, BT_PSM_RFCOMM, L2CAP_CHNL_PRIORITY_LOW);
+  tL2C_LCB* p_lcb_2 = AddLink(2);
+  tL2C_CCB* p_bulk_2 =
+      AddChannel(p_lcb_2, BT_PSM_RFCOMM, L2CAP_CHNL_PRIORITY_LOW);
+  QueuePackets(p_hid, 1);
+  QueuePackets(p_bulk_1, 10);
+  QueuePackets(p_bulk_2, 10);
+  SetWindow(8);
+
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+
+  // The first turn overdraws by one bulk packet, then the links alternate
+  std::vector<std::pair<uint16_t, uint16_t>> expected = {
+      {1, p_hid->local_cid},    {1, p_bulk_1->local_cid},
+      {2, p_bulk_2->local_cid}, {1, p_bulk_1->local_cid},
+      {2, p_bulk_2->local_cid}, {1, p_bulk_1->local_cid},
+      {2, p_bulk_2->local_cid}, {1, p_bulk_1->local_cid}};
+  EXPECT_EQ(sent_packets, expected);
+}
+
+TEST_F(StackL2capLinkTest, link_queue_charged_as_signalling) {
+  tL2C_LCB* p_lcb_1 = AddLink(1);
+  tL2C_LCB* p_lcb_2 = AddLink(2);
+  tL2C_CCB* p_bulk_2 =
+      AddChannel(p_lcb_2, BT_PSM_RFCOMM, L2CAP_CHNL_PRIORITY_LOW);
+  for (int xx = 0; xx < 4; xx++)
+    list_append(p_lcb_1->link_xmit_data_q, MakePacket(1, L2CAP_SIGNALLING_CID));
+  QueuePackets(p_bulk_2, 10);
+  SetWindow(6);
+
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+
+  std::vector<uint16_t> handles;
+  for (auto& sent : sent_packets) handles.push_back(sent.first);
+  EXPECT_EQ(handles, std::vector<uint16_t>({1, 1, 1, 2, 1, 2}));
+}
+
+TEST_F(StackL2capLinkTest, late_link_served_out_of_turn) {
+  tL2C_LCB* p_lcb_1 = AddLink(1);
+  tL2C_CCB* p_bulk_1 =
+      AddChannel(p_lcb_1, BT_PSM_RFCOMM, L2CAP_CHNL_PRIORITY_LOW);
+  tL2C_LCB* p_lcb_2 = AddLink(2);
+  tL2C_CCB* p_hid = AddChannel(p_lcb_2, BT_PSM_HIDI, L2CAP_CHNL_PRIORITY_LOW);
+  QueuePackets(p_bulk_1, 10);
+  QueuePackets(p_hid, 1);
+  SetWindow(1);
+
+  // The HID link has waited well past its latency target
+  p_lcb_2->sched_waiting = true;
+  p_lcb_2->sched_wait_start_ms = time_get_os_boottime_ms() - 100;
+
+  l2c_link_check_send_pkts(NULL, NULL, NULL);
+
+  ASSERT_EQ(sent_packets.size(), 1u);
+  EXPECT_EQ(sent_packets[0].second, p_hid->local_cid);
+  EXPECT_EQ(p_lcb_2->sched_stats.num_pkts, 1u);
+  EXPECT_EQ(p_lcb_2->sched_stats.num_late, 1u);
+}
+
+#endif /* (L2CAP_WEIGHTED_LINK_SCHEDULING == TRUE) */
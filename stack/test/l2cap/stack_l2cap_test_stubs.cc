@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+/* The parts of the stack the L2CAP sources under test call into, but that the
+ * tests do not exercise. */
+
+#include <stdarg.h>
+
+#include "btm_api.h"
+#include "btm_int.h"
+#include "hcimsgs.h"
+#include "l2c_api.h"
+#include "l2c_int.h"
+
+tL2C_CB l2cb;
+tBTM_CB btm_cb;
+
+void LogMsg(uint32_t trace_set_mask, const char* fmt_str, ...) {}
+
+tBTM_SEC_DEV_REC* btm_find_dev(const RawAddress& bd_addr) { return NULL; }
+bool btm_dev_support_switch(const RawAddress& bd_addr) { return false; }
+void btm_acl_created(const RawAddress& bda, DEV_CLASS dc, BD_NAME bdn,
+                     uint16_t hci_handle, uint8_t link_role,
+                     tBT_TRANSPORT transport) {}
+void btm_acl_removed(const RawAddress& bda, tBT_TRANSPORT transport) {}
+void btm_acl_update_busy_level(tBTM_BLI_EVENT event) {}
+void btm_sco_acl_removed(const RawAddress* bda) {}
+tBTM_STATUS btm_sec_disconnect(uint16_t handle, uint8_t reason) {
+  return BTM_SUCCESS;
+}
+void btm_ble_update_link_topology_mask(uint8_t link_role, bool increase) {}
+tBTM_STATUS BTM_ReadPowerMode(const RawAddress& remote_bda,
+                              tBTM_PM_MODE* p_mode) {
+  *p_mode = BTM_PM_MD_ACTIVE;
+  return BTM_SUCCESS;
+}
+tBTM_STATUS BTM_SetLinkSuperTout(const RawAddress& remote_bda,
+                                 uint16_t timeout) {
+  return BTM_SUCCESS;
+}
+
+void btsnd_hcic_disconnect(uint16_t handle, uint8_t reason) {}
+void btsnd_hcic_accept_conn(const RawAddress& bd_addr, uint8_t role) {}
+void btsnd_hcic_reject_conn(const RawAddress& bd_addr, uint8_t reason) {}
+
+bool L2CA_CancelBleConnectReq(const RawAddress& rem_bda) { return false; }
+void l2c_csm_execute(tL2C_CCB* p_ccb, uint16_t event, void* p_data) {}
+void l2c_ccb_timer_timeout(void* data) {}
+void l2c_lcb_timer_timeout(void* data) {}
+void l2c_process_held_packets(bool timed_out) {}
+void l2c_fcrb_ack_timer_timeout(void* data) {}
+tL2C_LCB* l2cu_allocate_lcb(const RawAddress& p_bd_addr, bool is_bonding,
+                            tBT_TRANSPORT transport) {
+  return NULL;
+}
+bool l2cu_start_post_bond_timer(uint16_t handle) { return false; }
+void l2cu_release_lcb(tL2C_LCB* p_lcb) {}
+tL2C_LCB* l2cu_find_lcb_by_bd_addr(const RawAddress& p_bd_addr,
+                                   tBT_TRANSPORT transport) {
+  return NULL;
+}
+tL2C_LCB* l2cu_find_lcb_by_handle(uint16_t handle) { return NULL; }
+tL2C_LCB* l2cu_find_lcb_by_state(tL2C_LINK_STATE state) { return NULL; }
+bool l2cu_lcb_disconnecting(void) { return false; }
+uint8_t l2cu_get_conn_role(tL2C_LCB* p_this_lcb) { return HCI_ROLE_MASTER; }
+bool l2cu_set_acl_priority(const RawAddress& bd_addr, uint8_t priority,
+                           bool reset_after_rs) {
+  return true;
+}
+bool l2cu_create_conn(tL2C_LCB* p_lcb, tBT_TRANSPORT transport) {
+  return false;
+}
+bool l2cu_create_conn_after_switch(tL2C_LCB* p_lcb) { return false; }
+void l2cu_release_ccb(tL2C_CCB* p_ccb) {}
+void l2cu_disconnect_chnl(tL2C_CCB* p_ccb) {}
+void l2cu_set_acl_hci_header(BT_HDR* p_buf, tL2C_CCB* p_ccb) {}
+void l2cu_send_peer_config_req(tL2C_CCB* p_ccb, tL2CAP_CFG_INFO* p_cfg) {}
+void l2cu_process_our_cfg_req(tL2C_CCB* p_ccb, tL2CAP_CFG_INFO* p_cfg) {}
+void l2cu_send_peer_echo_req(tL2C_LCB* p_lcb, uint8_t* p_data,
+                             uint16_t data_len) {}
+void l2cu_send_peer_info_req(tL2C_LCB* p_lcb, uint16_t info_type) {}
+void l2cu_check_channel_congestion(tL2C_CCB* p_ccb) {}
+void l2cu_process_fixed_disc_cback(tL2C_LCB* p_lcb) {}
+void l2cu_tx_complete(tL2C_TX_COMPLETE_CB_INFO* p_cbi) {
+  if (p_cbi->cb != NULL) p_cbi->cb(p_cbi->local_cid, p_cbi->num_sdu);
+}
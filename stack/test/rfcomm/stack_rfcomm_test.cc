@@ -121,6 +121,36 @@ void port_event_cback_1(uint32_t code, uint16_t port_handle) {
   rfcomm_callback->PortEventCallback(code, port_handle, 1);
 }
 
+// Data the app socket has queued for PORT_WriteDataCO to read
+std::string data_co_outgoing;
+size_t data_co_outgoing_read = 0;
+// Number of buffers asked for in each DATA_CO_CALLBACK_TYPE_OUTGOING_BATCH
+std::vector<uint16_t> data_co_batch_sizes;
+bool data_co_batch_fails = false;
+
+int port_data_co_cback(uint16_t port_handle, uint8_t* p_buf, uint16_t len,
+                       int type) {
+  switch (type) {
+    case DATA_CO_CALLBACK_TYPE_OUTGOING_SIZE:
+      *(int*)p_buf = data_co_outgoing.size() - data_co_outgoing_read;
+      return true;
+    case DATA_CO_CALLBACK_TYPE_OUTGOING_BATCH: {
+      data_co_batch_sizes.push_back(len);
+      if (data_co_batch_fails) return false;
+      BT_HDR** bufs = (BT_HDR**)p_buf;
+      for (uint16_t i = 0; i < len; i++) {
+        CHECK_LE(data_co_outgoing_read + bufs[i]->len, data_co_outgoing.size());
+        memcpy((uint8_t*)(bufs[i] + 1) + bufs[i]->offset,
+               data_co_outgoing.data() + data_co_outgoing_read, bufs[i]->len);
+        data_co_outgoing_read += bufs[i]->len;
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
 RawAddress GetTestAddress(int index) {
   CHECK_LT(index, UINT8_MAX);
   RawAddress result = {
@@ -889,4 +919,86 @@ TEST_F(StackRfcommTest, TestConnectionCollision) {
   l2cap_appl_info_.pL2CA_DataInd_Cb(new_lcid, uih_msc_rsp_from_peer);
 }
 
+TEST_F(StackRfcommTest, WriteDataCoBatchesOutgoingBuffers) {
+  static const uint16_t acl_handle = 0x0009;
+  static const uint16_t lcid = 0x0054;
+  static const uint16_t test_uuid = 0x1112;
+  static const uint8_t test_scn = 8;
+  // Small MTU so that one write spans several buffers
+  static const uint16_t test_mtu = 50;
+  static const RawAddress test_address = GetTestAddress(0);
+  uint16_t server_handle = 0;
+  ASSERT_NO_FATAL_FAILURE(StartServerPort(test_uuid, test_scn, test_mtu,
+                                          port_mgmt_cback_0, port_event_cback_0,
+                                          &server_handle));
+  ASSERT_NO_FATAL_FAILURE(ConnectServerL2cap(test_address, acl_handle, lcid));
+  ASSERT_NO_FATAL_FAILURE(ConnectServerPort(
+      test_address, server_handle, test_scn, test_mtu, acl_handle, lcid, 0));
+  ASSERT_NO_FATAL_FAILURE(ReceiveAndVerifyIncomingTransmission(
+      server_handle, false, test_scn, true, "Hello World!\r", 50, acl_handle,
+      lcid, 0));
+  ASSERT_EQ(PORT_SetDataCOCallback(server_handle, port_data_co_cback),
+            PORT_SUCCESS);
+
+  VLOG(1) << "Step 1";
+  // 4 full buffers and a partial one, read from the app in one batch
+  data_co_outgoing.clear();
+  for (int i = 0; i < 4 * test_mtu + 10; i++) {
+    data_co_outgoing.push_back(static_cast<char>('a' + i % 26));
+  }
+  data_co_outgoing_read = 0;
+  data_co_batch_sizes.clear();
+  data_co_batch_fails = false;
+  testing::InSequence s;
+  std::vector<BT_HDR*> data_packets;
+  for (size_t offset = 0; offset < data_co_outgoing.size();
+       offset += test_mtu) {
+    std::string chunk = data_co_outgoing.substr(offset, test_mtu);
+    // Credits for the received data go out with the last buffer
+    bool is_last = offset + test_mtu >= data_co_outgoing.size();
+    BT_HDR* data_packet = AllocateWrappedOutgoingL2capAclPacket(
+        CreateQuickDataPacket(GetDlci(false, test_scn), false, lcid, acl_handle,
+                              is_last ? 4 : 0, chunk));
+    EXPECT_CALL(l2cap_interface_, DataWrite(lcid, BtHdrEqual(data_packet)))
+        .WillOnce(Return(L2CAP_DW_SUCCESS));
+    data_packets.push_back(data_packet);
+  }
+  int written = 0;
+  ASSERT_EQ(PORT_WriteDataCO(server_handle, &written), PORT_SUCCESS);
+  ASSERT_EQ(written, static_cast<int>(data_co_outgoing.size()));
+  ASSERT_EQ(data_co_outgoing_read, data_co_outgoing.size());
+  ASSERT_THAT(data_co_batch_sizes, testing::ElementsAre(5));
+  for (BT_HDR* data_packet : data_packets) osi_free(data_packet);
+}
+
+TEST_F(StackRfcommTest, WriteDataCoBatchFailureSendsNothing) {
+  static const uint16_t acl_handle = 0x0009;
+  static const uint16_t lcid = 0x0054;
+  static const uint16_t test_uuid = 0x1112;
+  static const uint8_t test_scn = 8;
+  static const uint16_t test_mtu = 50;
+  static const RawAddress test_address = GetTestAddress(0);
+  uint16_t server_handle = 0;
+  ASSERT_NO_FATAL_FAILURE(StartServerPort(test_uuid, test_scn, test_mtu,
+                                          port_mgmt_cback_0, port_event_cback_0,
+                                          &server_handle));
+  ASSERT_NO_FATAL_FAILURE(ConnectServerL2cap(test_address, acl_handle, lcid));
+  ASSERT_NO_FATAL_FAILURE(ConnectServerPort(
+      test_address, server_handle, test_scn, test_mtu, acl_handle, lcid, 0));
+  ASSERT_EQ(PORT_SetDataCOCallback(server_handle, port_data_co_cback),
+            PORT_SUCCESS);
+
+  VLOG(1) << "Step 1";
+  // The app socket fails the read, no buffer of the batch may be sent
+  data_co_outgoing.assign(2 * test_mtu, 'x');
+  data_co_outgoing_read = 0;
+  data_co_batch_sizes.clear();
+  data_co_batch_fails = true;
+  int written = 0;
+  ASSERT_EQ(PORT_WriteDataCO(server_handle, &written), PORT_UNKNOWN_ERROR);
+  ASSERT_EQ(written, 0);
+  ASSERT_THAT(data_co_batch_sizes, testing::ElementsAre(2));
+  data_co_batch_fails = false;
+}
+
 }  // namespace
@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "stack/btm/btm_int.h"
+
+namespace {
+
+const uint8_t kAdvInd = 0x00;
+const uint8_t kAdvNonconnInd = 0x03;
+const uint8_t kScanRsp = 0x04;
+
+// Flags and a 16-bit service UUID, and a short local name.
+const std::vector<uint8_t> kAdvData = {0x02, 0x01, 0x06, 0x03,
+                                       0x03, 0x0f, 0x18};
+const std::vector<uint8_t> kScanRspData = {0x05, 0x09, 'n', 'a', 'm', 'e'};
+
+size_t num_results;
+size_t num_result_bytes;
+size_t num_short_results;
+
+RawAddress device_address(uint32_t i) {
+  const uint8_t address[6] = {0x00, 0x11, 0x22, (uint8_t)(i >> 16),
+                              (uint8_t)(i >> 8), (uint8_t)i};
+  return RawAddress(address);
+}
+
+// Every third device is a non-connectable beacon.
+bool is_beacon(uint32_t device) { return device % 3 == 0; }
+
+// Builds an HCI LE Advertising Report event carrying one report, with the
+// data zero padded to 31 bytes the way controllers send it.
+std::vector<uint8_t> adv_report(uint8_t evt_type, const RawAddress& bda,
+                                const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> event(1 + 1 + 1 + 6 + 1 + 31 + 1);
+  uint8_t* p = event.data();
+  UINT8_TO_STREAM(p, 1);
+  UINT8_TO_STREAM(p, evt_type);
+  UINT8_TO_STREAM(p, BLE_ADDR_PUBLIC);
+  BDADDR_TO_STREAM(p, bda);
+  UINT8_TO_STREAM(p, 31);
+  memcpy(p, data.data(), data.size());
+  p += 31;
+  INT8_TO_STREAM(p, -60);
+  return event;
+}
+
+void observe_results_cb(tBTM_INQ_RESULTS* p_inq_results, uint8_t* p_eir,
+                        uint16_t eir_len) {
+  num_results++;
+  num_result_bytes += eir_len;
+  // Devices answering scan requests must be reported with both parts.
+  const RawAddress& bda = p_inq_results->remote_bd_addr;
+  if (!is_beacon((bda.address[4] << 8) | bda.address[5]) &&
+      eir_len != kAdvData.size() + kScanRspData.size())
+    num_short_results++;
+}
+
+}  // namespace
+
+class StackBtmBleScanTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    btm_cb.sec_dev_rec = list_new(osi_free);
+    memset(&btm_cb.btm_inq_vars, 0, sizeof(btm_cb.btm_inq_vars));
+    btm_clr_inq_db(NULL);
+
+    btm_cb.ble_ctr_cb.scan_activity = BTM_LE_OBSERVE_ACTIVE;
+    btm_cb.ble_ctr_cb.inq_var.scan_type = BTM_BLE_SCAN_MODE_ACTI;
+    btm_cb.ble_ctr_cb.p_obs_results_cb = observe_results_cb;
+
+    num_results = 0;
+    num_result_bytes = 0;
+    num_short_results = 0;
+  }
+
+  void TearDown() override {
+    btm_cb.ble_ctr_cb.scan_activity = 0;
+    btm_cb.ble_ctr_cb.p_obs_results_cb = NULL;
+    btm_inq_db_reset();
+    list_free(btm_cb.sec_dev_rec);
+    btm_cb.sec_dev_rec = NULL;
+  }
+};
+
+// Replays one second of a busy active scan at 10,000 reports per second
+// through btm_ble_process_adv_pkt(): beacons sending non-connectable adverts,
+// and connectable devices answering every advert with a scan response.
+TEST_F(StackBtmBleScanTest, test_adv_report_replay_speed) {
+  const size_t kNumReports = 10000;
+  const uint32_t kNumDevices = 300;
+
+  std::minstd_rand generator(1);
+  std::vector<std::vector<uint8_t>> events;
+  size_t num_scannable = 0;
+  while (events.size() < kNumReports) {
+    uint32_t device = generator() % kNumDevices;
+    if (is_beacon(device)) {
+      events.push_back(
+          adv_report(kAdvNonconnInd, device_address(device), kAdvData));
+      continue;
+    }
+    events.push_back(adv_report(kAdvInd, device_address(device), kAdvData));
+    events.push_back(
+        adv_report(kScanRsp, device_address(device), kScanRspData));
+    num_scannable++;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (std::vector<uint8_t>& event : events)
+    btm_ble_process_adv_pkt(event.size(), event.data());
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  LOG(INFO) << "Replayed " << events.size() << " reports, delivered "
+            << num_results << " results (" << num_result_bytes << " bytes) in "
+            << elapsed << "us";
+  EXPECT_EQ(num_results, events.size() - num_scannable);
+  EXPECT_EQ(num_short_results, 0u);
+}
@@ -0,0 +1,274 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "osi/include/list.h"
+#include "stack/btm/btm_int.h"
+
+// The list_foreach predicates btm_find_dev() and btm_find_dev_by_handle()
+// fall back to when their indexes miss.
+bool is_address_equal(void* data, void* context);
+bool is_handle_equal(void* data, void* context);
+
+namespace {
+
+RawAddress device_address(uint32_t i) {
+  const uint8_t address[6] = {0x00, 0x11, 0x22, (uint8_t)(i >> 16),
+                              (uint8_t)(i >> 8), (uint8_t)i};
+  return RawAddress(address);
+}
+
+// Allocates a record the way an incoming connection does, then gives it the
+// ACL handles btm_acl_created() would.
+tBTM_SEC_DEV_REC* add_device(uint32_t i, uint16_t hci_handle,
+                             uint16_t ble_hci_handle) {
+  tBTM_SEC_DEV_REC* p_dev_rec = btm_sec_alloc_dev(device_address(i));
+  p_dev_rec->hci_handle = hci_handle;
+  p_dev_rec->ble_hci_handle = ble_hci_handle;
+  return p_dev_rec;
+}
+
+// Appends a record the way btm_sec_allocate_dev_rec() does, without its cap
+// on the number of records.
+tBTM_SEC_DEV_REC* append_device(uint32_t i, uint16_t hci_handle,
+                                uint16_t ble_hci_handle) {
+  tBTM_SEC_DEV_REC* p_dev_rec =
+      static_cast<tBTM_SEC_DEV_REC*>(osi_calloc(sizeof(tBTM_SEC_DEV_REC)));
+  list_append(btm_cb.sec_dev_rec, p_dev_rec);
+  p_dev_rec->sec_flags = BTM_SEC_IN_USE;
+  p_dev_rec->bd_addr = device_address(i);
+  p_dev_rec->hci_handle = hci_handle;
+  p_dev_rec->ble_hci_handle = ble_hci_handle;
+  btm_dev_index_add(p_dev_rec);
+  return p_dev_rec;
+}
+
+// What the list scan btm_find_dev() replaces would return
+tBTM_SEC_DEV_REC* scan_for_address(const RawAddress& bd_addr) {
+  list_node_t* n = list_foreach(btm_cb.sec_dev_rec, is_address_equal,
+                                (void*)&bd_addr);
+  return n ? static_cast<tBTM_SEC_DEV_REC*>(list_node(n)) : nullptr;
+}
+
+}  // namespace
+
+class StackBtmDevTest : public ::testing::Test {
+ protected:
+  void SetUp() override { btm_cb.sec_dev_rec = list_new(osi_free); }
+
+  // Removes the records the way btm_free() does, so that their index entries
+  // go with them.
+  void TearDown() override {
+    RemoveAll();
+    list_free(btm_cb.sec_dev_rec);
+    btm_cb.sec_dev_rec = NULL;
+  }
+
+  static void RemoveAll() {
+    while (!list_is_empty(btm_cb.sec_dev_rec))
+      wipe_secrets_and_remove(
+          static_cast<tBTM_SEC_DEV_REC*>(list_front(btm_cb.sec_dev_rec)));
+  }
+};
+
+TEST_F(StackBtmDevTest, test_find_by_address_and_handle) {
+  std::vector<tBTM_SEC_DEV_REC*> records;
+  for (uint32_t i = 0; i < 10; i++)
+    records.push_back(add_device(i, i + 1, 0x0100 + i));
+
+  for (uint32_t i = 0; i < 10; i++) {
+    EXPECT_EQ(btm_find_dev(device_address(i)), records[i]);
+    EXPECT_EQ(btm_find_dev_by_handle(i + 1), records[i]);
+    EXPECT_EQ(btm_find_dev_by_handle(0x0100 + i), records[i]);
+  }
+  EXPECT_EQ(btm_find_dev(device_address(10)), nullptr);
+  EXPECT_EQ(btm_find_dev_by_handle(11), nullptr);
+  EXPECT_EQ(btm_find_dev_by_handle(BTM_SEC_INVALID_HANDLE), nullptr);
+}
+
+TEST_F(StackBtmDevTest, test_no_stale_entries_after_remove) {
+  tBTM_SEC_DEV_REC* p_dev_rec = add_device(1, 0x0001, 0x0101);
+  add_device(2, 0x0002, 0x0102);
+  ASSERT_EQ(btm_find_dev(device_address(1)), p_dev_rec);
+  ASSERT_EQ(btm_find_dev_by_handle(0x0001), p_dev_rec);
+  ASSERT_EQ(btm_find_dev_by_handle(0x0101), p_dev_rec);
+
+  // The record is freed here, so an entry left behind would be read after
+  // free by the lookups below.
+  wipe_secrets_and_remove(p_dev_rec);
+
+  EXPECT_EQ(btm_find_dev(device_address(1)), nullptr);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0001), nullptr);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0101), nullptr);
+  EXPECT_NE(btm_find_dev(device_address(2)), nullptr);
+
+  // A new record for the same peer is found again
+  tBTM_SEC_DEV_REC* p_new_rec = add_device(1, 0x0003, 0x0103);
+  EXPECT_EQ(btm_find_dev(device_address(1)), p_new_rec);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0003), p_new_rec);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0103), p_new_rec);
+}
+
+TEST_F(StackBtmDevTest, test_handle_reassignment) {
+  tBTM_SEC_DEV_REC* p_first = add_device(1, 0x0005, BTM_SEC_INVALID_HANDLE);
+  tBTM_SEC_DEV_REC* p_second =
+      add_device(2, BTM_SEC_INVALID_HANDLE, BTM_SEC_INVALID_HANDLE);
+  ASSERT_EQ(btm_find_dev_by_handle(0x0005), p_first);
+
+  // The first link goes down and the controller hands its handle to the
+  // second peer, on either transport.
+  p_first->hci_handle = BTM_SEC_INVALID_HANDLE;
+  p_second->hci_handle = 0x0005;
+  EXPECT_EQ(btm_find_dev_by_handle(0x0005), p_second);
+
+  p_second->hci_handle = BTM_SEC_INVALID_HANDLE;
+  p_second->ble_hci_handle = 0x0005;
+  EXPECT_EQ(btm_find_dev_by_handle(0x0005), p_second);
+
+  // The first peer reconnects on a new handle
+  p_first->hci_handle = 0x0006;
+  EXPECT_EQ(btm_find_dev_by_handle(0x0006), p_first);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0005), p_second);
+
+  p_second->ble_hci_handle = BTM_SEC_INVALID_HANDLE;
+  EXPECT_EQ(btm_find_dev_by_handle(0x0005), nullptr);
+}
+
+TEST_F(StackBtmDevTest, test_consolidate_dev) {
+  // A BR/EDR record, and an LE record for the same identity address that
+  // SMP has just resolved.
+  tBTM_SEC_DEV_REC* p_bredr = add_device(1, 0x0001, BTM_SEC_INVALID_HANDLE);
+  tBTM_SEC_DEV_REC* p_le = add_device(2, BTM_SEC_INVALID_HANDLE, 0x0102);
+  ASSERT_EQ(btm_find_dev(device_address(1)), p_bredr);
+  ASSERT_EQ(btm_find_dev_by_handle(0x0001), p_bredr);
+  ASSERT_EQ(btm_find_dev_by_handle(0x0102), p_le);
+
+  p_le->bd_addr = device_address(1);
+  btm_consolidate_dev(p_le);
+
+  EXPECT_EQ(list_length(btm_cb.sec_dev_rec), 1u);
+  EXPECT_EQ(btm_find_dev(device_address(1)), p_le);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0001), p_le);
+  EXPECT_EQ(btm_find_dev_by_handle(0x0102), p_le);
+  EXPECT_EQ(btm_find_dev(device_address(2)), nullptr);
+}
+
+TEST_F(StackBtmDevTest, test_pseudo_address_precedence) {
+  tBTM_SEC_DEV_REC* p_first = add_device(1, 0x0001, BTM_SEC_INVALID_HANDLE);
+  tBTM_SEC_DEV_REC* p_second = add_device(2, 0x0002, BTM_SEC_INVALID_HANDLE);
+  ASSERT_EQ(btm_find_dev(device_address(2)), p_second);
+
+  // The first record picks up the address of the second as its pseudo
+  // address, and reindexes as the stack does when it sets one. It comes
+  // first in the list, so it wins the lookup.
+  p_first->ble.pseudo_addr = device_address(2);
+  btm_dev_index_add(p_first);
+  EXPECT_EQ(scan_for_address(device_address(2)), p_first);
+  EXPECT_EQ(btm_find_dev(device_address(2)), p_first);
+
+  // A later record taking the address does not take the lookup over
+  tBTM_SEC_DEV_REC* p_third = add_device(3, 0x0003, BTM_SEC_INVALID_HANDLE);
+  p_third->ble.pseudo_addr = device_address(1);
+  btm_dev_index_add(p_third);
+  EXPECT_EQ(scan_for_address(device_address(1)), p_first);
+  EXPECT_EQ(btm_find_dev(device_address(1)), p_first);
+  EXPECT_EQ(btm_find_dev(device_address(3)), p_third);
+
+  // Once the first record moves on, the second is found again
+  p_first->ble.pseudo_addr = device_address(4);
+  btm_dev_index_add(p_first);
+  EXPECT_EQ(btm_find_dev(device_address(2)), p_second);
+  EXPECT_EQ(btm_find_dev(device_address(4)), p_first);
+
+  // Removing the first record hands its addresses to the next match
+  wipe_secrets_and_remove(p_first);
+  EXPECT_EQ(btm_find_dev(device_address(1)), p_third);
+  EXPECT_EQ(btm_find_dev(device_address(4)), nullptr);
+}
+
+TEST_F(StackBtmDevTest, test_address_index_reset) {
+  tBTM_SEC_DEV_REC* p_dev_rec = add_device(1, 0x0001, BTM_SEC_INVALID_HANDLE);
+  ASSERT_EQ(btm_find_dev(device_address(1)), p_dev_rec);
+
+  // Rotate the pseudo address often enough to reset the address index
+  size_t resets = 0;
+  for (uint32_t i = 0; i <= 4 * BTM_DEV_INDEX_MAX_ADDRESSES; i++) {
+    size_t num_addresses = btm_dev_index_num_addresses();
+    p_dev_rec->ble.pseudo_addr = device_address(0x10000 + i);
+    ASSERT_EQ(btm_find_dev(device_address(0x10000 + i)), p_dev_rec);
+    if (btm_dev_index_num_addresses() < num_addresses) resets++;
+    ASSERT_LE(btm_dev_index_num_addresses(), BTM_DEV_INDEX_MAX_ADDRESSES);
+  }
+  EXPECT_EQ(resets, 4u);
+
+  // Addresses dropped by a reset are still found through the list scan
+  EXPECT_EQ(btm_find_dev(device_address(1)), p_dev_rec);
+  EXPECT_EQ(btm_find_dev(device_address(0x10000)), nullptr);
+}
+
+// Looks up device databases the way the stack does for the peers it is
+// connected to, and compares with the list scan the lookups fall back to.
+TEST_F(StackBtmDevTest, test_lookup_speed) {
+  const uint32_t kNumLookups = 100000;
+
+  for (uint32_t num_records : {10, 100, 1000}) {
+    RemoveAll();
+    for (uint32_t i = 0; i < num_records; i++)
+      append_device(i, i + 1, 0x0800 + i);
+
+    // Connected peers are the newest records
+    std::vector<RawAddress> addresses;
+    std::vector<uint16_t> handles;
+    for (uint32_t i = 0; i < kNumLookups; i++) {
+      uint32_t index = num_records - 1 - i % 4;
+      addresses.push_back(device_address(index));
+      handles.push_back(i % 2 ? index + 1 : 0x0800 + index);
+    }
+
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kNumLookups; i++) {
+      if (list_foreach(btm_cb.sec_dev_rec, is_address_equal, &addresses[i]))
+        found++;
+      if (list_foreach(btm_cb.sec_dev_rec, is_handle_equal, &handles[i]))
+        found++;
+    }
+    auto scan_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < kNumLookups; i++) {
+      if (btm_find_dev(addresses[i])) found++;
+      if (btm_find_dev_by_handle(handles[i])) found++;
+    }
+    auto index_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+    LOG(INFO) << kNumLookups << " address and handle lookups in "
+              << num_records << " records: list scan " << scan_us
+              << "us, index " << index_us << "us";
+    EXPECT_EQ(found, 4 * kNumLookups);
+  }
+}
@@ -0,0 +1,160 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "stack/btm/btm_int.h"
+
+namespace {
+
+RawAddress device_address(uint32_t i) {
+  const uint8_t address[6] = {0x00, 0x11, 0x22, (uint8_t)(i >> 16),
+                              (uint8_t)(i >> 8), (uint8_t)i};
+  return RawAddress(address);
+}
+
+// Sets up the per-inquiry dedup set the way btm_initiate_inquiry() does.
+void start_inquiry() {
+  tBTM_INQUIRY_VAR_ST* p_inq = &btm_cb.btm_inq_vars;
+  p_inq->p_bd_db = (tINQ_BDADDR*)osi_calloc(BT_DEFAULT_BUFFER_SIZE);
+  p_inq->max_bd_entries =
+      (uint16_t)(BT_DEFAULT_BUFFER_SIZE / sizeof(tINQ_BDADDR));
+  p_inq->bd_db_index_size = 1;
+  while (p_inq->bd_db_index_size < 2 * p_inq->max_bd_entries)
+    p_inq->bd_db_index_size <<= 1;
+  p_inq->p_bd_db_index =
+      (uint16_t*)osi_calloc(p_inq->bd_db_index_size * sizeof(uint16_t));
+}
+
+}  // namespace
+
+class StackBtmInqTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&btm_cb.btm_inq_vars, 0, sizeof(btm_cb.btm_inq_vars));
+    btm_clr_inq_db(NULL);
+  }
+
+  void TearDown() override { btm_inq_db_reset(); }
+};
+
+TEST_F(StackBtmInqTest, test_find_new_and_clear) {
+  for (uint32_t i = 0; i < BTM_INQ_DB_SIZE; i++) {
+    EXPECT_EQ(btm_inq_db_find(device_address(i)), nullptr);
+    tINQ_DB_ENT* p_ent = btm_inq_db_new(device_address(i));
+    EXPECT_EQ(btm_inq_db_find(device_address(i)), p_ent);
+  }
+
+  RawAddress cleared = device_address(3);
+  btm_clr_inq_db(&cleared);
+  EXPECT_EQ(btm_inq_db_find(cleared), nullptr);
+  for (uint32_t i = 0; i < BTM_INQ_DB_SIZE; i++) {
+    if (i == 3) continue;
+    tINQ_DB_ENT* p_ent = btm_inq_db_find(device_address(i));
+    ASSERT_NE(p_ent, nullptr);
+    EXPECT_EQ(p_ent->inq_info.results.remote_bd_addr, device_address(i));
+  }
+
+  btm_clr_inq_db(NULL);
+  for (uint32_t i = 0; i < BTM_INQ_DB_SIZE; i++)
+    EXPECT_EQ(btm_inq_db_find(device_address(i)), nullptr);
+}
+
+TEST_F(StackBtmInqTest, test_evicts_least_recently_used) {
+  for (uint32_t i = 0; i < BTM_INQ_DB_SIZE; i++)
+    btm_inq_db_new(device_address(i));
+
+  // Using the first entry makes the second one the least recently used.
+  EXPECT_NE(btm_inq_db_find(device_address(0)), nullptr);
+  btm_inq_db_new(device_address(BTM_INQ_DB_SIZE));
+
+  EXPECT_NE(btm_inq_db_find(device_address(0)), nullptr);
+  EXPECT_EQ(btm_inq_db_find(device_address(1)), nullptr);
+  EXPECT_NE(btm_inq_db_find(device_address(BTM_INQ_DB_SIZE)), nullptr);
+}
+
+TEST_F(StackBtmInqTest, test_sort_keeps_index) {
+  for (uint32_t i = 0; i < BTM_INQ_DB_SIZE; i++) {
+    tINQ_DB_ENT* p_ent = btm_inq_db_new(device_address(i));
+    p_ent->inq_info.results.rssi = (int8_t)i;
+  }
+  btm_cb.btm_inq_vars.inq_cmpl_info.num_resp = BTM_INQ_DB_SIZE;
+  btm_sort_inq_result();
+
+  EXPECT_EQ(btm_cb.btm_inq_vars.inq_db[0].inq_info.results.remote_bd_addr,
+            device_address(BTM_INQ_DB_SIZE - 1));
+  for (uint32_t i = 0; i < BTM_INQ_DB_SIZE; i++) {
+    tINQ_DB_ENT* p_ent = btm_inq_db_find(device_address(i));
+    ASSERT_NE(p_ent, nullptr);
+    EXPECT_EQ(p_ent->inq_info.results.rssi, (int8_t)i);
+  }
+
+  // The find loop above used the entries in address order.
+  btm_inq_db_new(device_address(BTM_INQ_DB_SIZE));
+  EXPECT_EQ(btm_inq_db_find(device_address(0)), nullptr);
+}
+
+TEST_F(StackBtmInqTest, test_find_bdaddr_dedups_per_inquiry) {
+  start_inquiry();
+
+  EXPECT_FALSE(btm_inq_find_bdaddr(device_address(1)));
+  EXPECT_TRUE(btm_inq_find_bdaddr(device_address(1)));
+  EXPECT_FALSE(btm_inq_find_bdaddr(device_address(2)));
+
+  btm_cb.btm_inq_vars.inq_counter++;
+  EXPECT_FALSE(btm_inq_find_bdaddr(device_address(1)));
+  EXPECT_TRUE(btm_inq_find_bdaddr(device_address(1)));
+}
+
+// Replays the same advertising report trace on every run: 500 beacons with a
+// skewed report rate, looked up the way btm_ble_process_adv_pkt_cont() does.
+TEST_F(StackBtmInqTest, test_adv_report_replay_speed) {
+  const uint32_t kNumBeacons = 500;
+  const size_t kNumReports = 200000;
+
+  std::minstd_rand generator(1);
+  std::geometric_distribution<uint32_t> beacon(0.02);
+  std::vector<RawAddress> reports;
+  for (size_t i = 0; i < kNumReports; i++)
+    reports.push_back(device_address(beacon(generator) % kNumBeacons));
+
+  start_inquiry();
+
+  size_t num_new = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const RawAddress& bda : reports) {
+    tINQ_DB_ENT* p_i = btm_inq_db_find(bda);
+    if (btm_inq_find_bdaddr(bda) && p_i) continue;
+    if (p_i == NULL) {
+      btm_inq_db_new(bda);
+      num_new++;
+    }
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+
+  LOG(INFO) << "Replayed " << kNumReports << " advertising reports ("
+            << num_new << " new entries) in " << elapsed << "us";
+  EXPECT_GE(num_new, (size_t)BTM_INQ_DB_SIZE);
+}
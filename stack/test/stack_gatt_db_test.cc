@@ -0,0 +1,220 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <list>
+#include <vector>
+
+#include "stack/gatt/gatt_int.h"
+
+using bluetooth::Uuid;
+
+extern tGATT_ATTR* find_attr_by_handle(tGATT_SVC_DB* p_db, uint16_t handle);
+
+namespace {
+
+// A service declaration and kCharsPerService characteristics
+constexpr int kCharsPerService = 5;
+constexpr int kAttrsPerService = 1 + 2 * kCharsPerService;
+
+// The services the way GATTS_AddService() and GATTS_StartService() set them
+// up, without the SDP records and the application registration.
+class GattServerDb {
+ public:
+  explicit GattServerDb(int num_attrs, uint16_t gap = 0) {
+    saved_srv_list_info_ = gatt_cb.srv_list_info;
+    saved_srv_hdl_index_ = gatt_cb.srv_hdl_index;
+    gatt_cb.srv_list_info = &srv_list_info_;
+    gatt_cb.srv_hdl_index = &srv_hdl_index_;
+
+    uint16_t s_hdl = GATT_APP_START_HANDLE;
+    for (int i = 0; i < num_attrs; i += kAttrsPerService) {
+      dbs_.emplace_back();
+      tGATT_SVC_DB& db = dbs_.back();
+      gatts_init_service_db(db, Uuid::From16Bit(0x1800 + i), true, s_hdl,
+                            kAttrsPerService);
+      for (int c = 0; c < kCharsPerService; c++)
+        gatts_add_characteristic(db, GATT_PERM_READ, GATT_CHAR_PROP_BIT_READ,
+                                 Uuid::From16Bit(0x2A00 + c));
+      Start(db, s_hdl, s_hdl + kAttrsPerService - 1);
+      s_hdl += kAttrsPerService + gap;
+    }
+  }
+
+  ~GattServerDb() {
+    gatt_cb.srv_list_info = saved_srv_list_info_;
+    gatt_cb.srv_hdl_index = saved_srv_hdl_index_;
+  }
+
+  void Stop(uint16_t s_hdl) {
+    auto it = gatt_sr_find_i_rcb_by_handle(s_hdl);
+    ASSERT_NE(it, srv_list_info_.end());
+    gatt_sr_remove_hdl_index(it);
+    srv_list_info_.erase(it);
+  }
+
+  // The service declarations and characteristic declarations, which are read
+  // straight from the database
+  std::vector<uint16_t> DeclarationHandles() const {
+    std::vector<uint16_t> handles;
+    for (const tGATT_SVC_DB& db : dbs_) {
+      handles.push_back(db.attr_list[0].handle);
+      for (size_t i = 1; i < db.attr_list.size(); i += 2)
+        handles.push_back(db.attr_list[i].handle);
+    }
+    return handles;
+  }
+
+ private:
+  void Start(tGATT_SVC_DB& db, uint16_t s_hdl, uint16_t e_hdl) {
+    auto it = srv_list_info_.begin();
+    while (it != srv_list_info_.end() && it->s_hdl < s_hdl) it++;
+    it = srv_list_info_.emplace(it);
+    it->s_hdl = s_hdl;
+    it->e_hdl = e_hdl;
+    it->p_db = &db;
+    it->type = GATT_UUID_PRI_SERVICE;
+    it->is_primary = true;
+    gatt_sr_add_hdl_index(it);
+  }
+
+  std::list<tGATT_SVC_DB> dbs_;
+  std::list<tGATT_SRV_LIST_ELEM> srv_list_info_;
+  std::vector<tGATT_SRV_HDL_RANGE> srv_hdl_index_;
+  std::list<tGATT_SRV_LIST_ELEM>* saved_srv_list_info_;
+  std::vector<tGATT_SRV_HDL_RANGE>* saved_srv_hdl_index_;
+};
+
+// The lookups the way gatt_sr_find_i_rcb_by_handle() and
+// find_attr_by_handle() used to do them
+tGATT_SRV_LIST_ELEM* linear_find_service(uint16_t handle) {
+  for (tGATT_SRV_LIST_ELEM& el : *gatt_cb.srv_list_info)
+    if (el.s_hdl <= handle && el.e_hdl >= handle) return &el;
+  return nullptr;
+}
+
+tGATT_ATTR* linear_find_attr(tGATT_SVC_DB* p_db, uint16_t handle) {
+  for (auto& attr : p_db->attr_list) {
+    if (attr.handle == handle) return &attr;
+    if (attr.handle > handle) return nullptr;
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(StackGattDbTest, test_find_service_by_handle) {
+  GattServerDb server(3 * kAttrsPerService, 10);
+  uint16_t first = GATT_APP_START_HANDLE;
+  uint16_t stride = kAttrsPerService + 10;
+
+  EXPECT_EQ(gatt_sr_find_i_rcb_by_handle(first - 1),
+            gatt_cb.srv_list_info->end());
+  for (int s = 0; s < 3; s++) {
+    uint16_t s_hdl = first + s * stride;
+    uint16_t e_hdl = s_hdl + kAttrsPerService - 1;
+    for (uint16_t handle = s_hdl; handle <= e_hdl; handle++)
+      EXPECT_EQ(gatt_sr_find_i_rcb_by_handle(handle)->s_hdl, s_hdl);
+    // Handles between services belong to none
+    EXPECT_EQ(gatt_sr_find_i_rcb_by_handle(e_hdl + 1),
+              gatt_cb.srv_list_info->end());
+  }
+
+  server.Stop(first + stride);
+  EXPECT_EQ(gatt_sr_find_i_rcb_by_handle(first + stride),
+            gatt_cb.srv_list_info->end());
+  EXPECT_EQ(gatt_sr_find_i_rcb_by_handle(first)->s_hdl, first);
+  EXPECT_EQ(gatt_sr_find_i_rcb_by_handle(first + 2 * stride)->s_hdl,
+            first + 2 * stride);
+}
+
+TEST(StackGattDbTest, test_find_attr_by_handle) {
+  GattServerDb server(kAttrsPerService);
+  tGATT_SVC_DB* p_db = gatt_cb.srv_list_info->front().p_db;
+  uint16_t s_hdl = GATT_APP_START_HANDLE;
+
+  EXPECT_EQ(find_attr_by_handle(p_db, s_hdl - 1), nullptr);
+  for (uint16_t handle = s_hdl; handle < s_hdl + kAttrsPerService; handle++) {
+    tGATT_ATTR* p_attr = find_attr_by_handle(p_db, handle);
+    ASSERT_NE(p_attr, nullptr);
+    EXPECT_EQ(p_attr->handle, handle);
+  }
+  EXPECT_EQ(find_attr_by_handle(p_db, s_hdl + kAttrsPerService), nullptr);
+  EXPECT_EQ(find_attr_by_handle(nullptr, s_hdl), nullptr);
+}
+
+// Reads every declaration of databases of 10, 100 and 1000 attributes through
+// gatts_read_attr_value_by_handle(), finding the owning service first the way
+// gatts_process_read_req() does. The lookups alone are timed against the
+// linear scans they replaced.
+TEST(StackGattDbTest, test_read_attr_value_by_handle_speed) {
+  const int kNumReads = 100000;
+  tGATT_TCB tcb;
+
+  for (int num_attrs : {10, 100, 1000}) {
+    GattServerDb server(num_attrs);
+    std::vector<uint16_t> handles = server.DeclarationHandles();
+    uint8_t value[GATT_MAX_ATTR_LEN];
+    uint16_t len;
+
+    auto start = std::chrono::steady_clock::now();
+    int found = 0;
+    for (int i = 0; i < kNumReads; i++) {
+      uint16_t handle = handles[i % handles.size()];
+      tGATT_SRV_LIST_ELEM* el = linear_find_service(handle);
+      if (linear_find_attr(el->p_db, handle) != nullptr) found++;
+    }
+    auto linear_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    EXPECT_EQ(found, kNumReads);
+
+    start = std::chrono::steady_clock::now();
+    found = 0;
+    for (int i = 0; i < kNumReads; i++) {
+      uint16_t handle = handles[i % handles.size()];
+      auto it = gatt_sr_find_i_rcb_by_handle(handle);
+      if (find_attr_by_handle(it->p_db, handle) != nullptr) found++;
+    }
+    auto indexed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    EXPECT_EQ(found, kNumReads);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumReads; i++) {
+      uint16_t handle = handles[i % handles.size()];
+      auto it = gatt_sr_find_i_rcb_by_handle(handle);
+      ASSERT_NE(it, gatt_cb.srv_list_info->end());
+      ASSERT_EQ(GATT_SUCCESS,
+                gatts_read_attr_value_by_handle(
+                    tcb, it->p_db, GATT_REQ_READ, handle, 0, value, &len,
+                    GATT_DEF_BLE_MTU_SIZE, 0, 0, 0));
+    }
+    auto read_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+    LOG(INFO) << num_attrs << " attributes, " << kNumReads
+              << " reads: linear lookups " << linear_us
+              << "us, indexed lookups " << indexed_us
+              << "us, indexed lookups and reads " << read_us << "us";
+  }
+}
@@ -0,0 +1,181 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "embdrv/sbc/encoder/include/sbc_encoder.h"
+
+namespace {
+
+constexpr int kNumFrames = 200;
+constexpr size_t kMaxFrameSize = 1024;
+
+const char* kKernels[] = {"sse4.1", "avx2", "neon"};
+
+struct EncoderConfig {
+  const char* name;
+  int16_t num_of_subbands;
+  int16_t channel_mode;
+  int16_t num_of_blocks;
+  int16_t sampling_freq;
+  int16_t allocation_method;
+  uint16_t bit_rate;
+};
+
+const EncoderConfig kConfigs[] = {
+    {"4 subbands mono", 4, SBC_MONO, 16, SBC_sf48000, SBC_LOUDNESS, 128},
+    {"4 subbands joint stereo", 4, SBC_JOINT_STEREO, 16, SBC_sf48000,
+     SBC_LOUDNESS, 229},
+    {"8 subbands mono", 8, SBC_MONO, 16, SBC_sf48000, SBC_LOUDNESS, 128},
+    {"8 subbands joint stereo", 8, SBC_JOINT_STEREO, 16, SBC_sf44100,
+     SBC_LOUDNESS, 328},
+    {"8 subbands joint stereo, 12 blocks, SNR", 8, SBC_JOINT_STEREO, 12,
+     SBC_sf44100, SBC_SNR, 229},
+    {"4 subbands joint stereo, 4 blocks", 4, SBC_JOINT_STEREO, 4, SBC_sf48000,
+     SBC_LOUDNESS, 229},
+};
+
+// A sweep and a square wave, clipped to full scale every so often, so that
+// the filters see the largest values they can.
+std::vector<int16_t> make_pcm(size_t num_samples, int num_channels) {
+  std::vector<int16_t> pcm(num_samples);
+  uint32_t noise = 12345;
+  for (size_t i = 0; i < num_samples; i++) {
+    size_t t = i / num_channels;
+    noise = noise * 1103515245 + 12345;
+    int32_t value;
+    if ((t / 512) % 4 == 3)
+      value = (t & 16) ? 32767 : -32768;
+    else if (i % num_channels == 0)
+      value = (int32_t)((t * t * 7) % 65536) - 32768;
+    else
+      value = (int16_t)(noise >> 16);
+    pcm[i] = (int16_t)value;
+  }
+  return pcm;
+}
+
+void init_encoder(SBC_ENC_PARAMS* params, const EncoderConfig& config) {
+  memset(params, 0, sizeof(*params));
+  params->s16NumOfSubBands = config.num_of_subbands;
+  params->s16ChannelMode = config.channel_mode;
+  params->s16NumOfBlocks = config.num_of_blocks;
+  params->s16SamplingFreq = config.sampling_freq;
+  params->s16AllocationMethod = config.allocation_method;
+  params->u16BitRate = config.bit_rate;
+  SBC_Encoder_Init(params);
+}
+
+size_t samples_per_frame(const SBC_ENC_PARAMS& params) {
+  return params.s16NumOfBlocks * params.s16NumOfSubBands *
+         params.s16NumOfChannels;
+}
+
+// Encodes kNumFrames with the kernels called |kernel|, keeping the frames
+// and the subband samples of each frame.
+void encode(const EncoderConfig& config, const char* kernel,
+            std::vector<uint8_t>* frames, std::vector<int32_t>* subbands) {
+  SBC_ENC_PARAMS params;
+  init_encoder(&params, config);
+  ASSERT_TRUE(SBC_Encoder_SelectKernels(kernel));
+
+  size_t frame_samples = samples_per_frame(params);
+  size_t num_subbands = frame_samples;
+  std::vector<int16_t> pcm =
+      make_pcm(frame_samples * kNumFrames, params.s16NumOfChannels);
+  uint8_t output[kMaxFrameSize];
+
+  for (int i = 0; i < kNumFrames; i++) {
+    uint32_t len = SBC_Encode(&params, &pcm[i * frame_samples], output);
+    ASSERT_GT(len, 0u);
+    ASSERT_LE(len, kMaxFrameSize);
+    frames->insert(frames->end(), output, output + len);
+    subbands->insert(subbands->end(), params.s32SbBuffer,
+                     params.s32SbBuffer + num_subbands);
+  }
+}
+
+class StackSbcEncoderTest : public ::testing::Test {
+ protected:
+  void TearDown() override { SBC_Encoder_SelectKernels(nullptr); }
+};
+
+}  // namespace
+
+TEST_F(StackSbcEncoderTest, test_select_kernels) {
+  EXPECT_TRUE(SBC_Encoder_SelectKernels("c"));
+  EXPECT_TRUE(SBC_Encoder_SelectKernels(nullptr));
+  EXPECT_FALSE(SBC_Encoder_SelectKernels("mmx"));
+}
+
+// Every SIMD version must encode exactly what the C code does
+TEST_F(StackSbcEncoderTest, test_kernels_bit_exact) {
+  for (const EncoderConfig& config : kConfigs) {
+    std::vector<uint8_t> c_frames;
+    std::vector<int32_t> c_subbands;
+    encode(config, "c", &c_frames, &c_subbands);
+
+    for (const char* kernel : kKernels) {
+      if (!SBC_Encoder_SelectKernels(kernel)) continue;
+
+      std::vector<uint8_t> frames;
+      std::vector<int32_t> subbands;
+      encode(config, kernel, &frames, &subbands);
+      EXPECT_EQ(c_subbands, subbands) << kernel << ", " << config.name;
+      EXPECT_EQ(c_frames, frames) << kernel << ", " << config.name;
+    }
+  }
+}
+
+// Encodes one second of audio per configuration with each kernel available
+TEST_F(StackSbcEncoderTest, test_encode_speed) {
+  for (int c = 0; c < 4; c++) {
+    const EncoderConfig& config = kConfigs[c];
+    SBC_ENC_PARAMS params;
+    init_encoder(&params, config);
+    size_t frame_samples = samples_per_frame(params);
+    int num_frames = 48000 / (params.s16NumOfBlocks * params.s16NumOfSubBands);
+    std::vector<int16_t> pcm =
+        make_pcm(frame_samples * num_frames, params.s16NumOfChannels);
+    uint8_t output[kMaxFrameSize];
+
+    std::vector<const char*> kernels = {"c"};
+    for (const char* kernel : kKernels)
+      if (SBC_Encoder_SelectKernels(kernel)) kernels.push_back(kernel);
+
+    for (const char* kernel : kernels) {
+      init_encoder(&params, config);
+      ASSERT_TRUE(SBC_Encoder_SelectKernels(kernel));
+      auto start = std::chrono::steady_clock::now();
+      for (int round = 0; round < 10; round++)
+        for (int i = 0; i < num_frames; i++)
+          SBC_Encode(&params, &pcm[i * frame_samples], output);
+      auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+
+      LOG(INFO) << config.name << ", " << kernel << ": "
+                << (10LL * num_frames * 1000000 / (elapsed_us + 1))
+                << " frames/s";
+    }
+  }
+}
@@ -0,0 +1,490 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "bt_types.h"
+#include "osi/include/alarm.h"
+#include "osi/include/allocator.h"
+#include "osi/include/fixed_queue.h"
+#include "stack/include/sdp_api.h"
+#include "stack/l2cap/l2c_int.h"
+#include "stack/sdp/sdpint.h"
+
+using bluetooth::Uuid;
+
+namespace {
+
+const uint16_t kLocalCid = L2CAP_BASE_APPL_CID;
+const uint16_t kMtu = 672;
+
+const uint8_t kBaseUuid[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00,
+                             0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB};
+
+// Searches the records one by one for the UUIDs, the way
+// sdp_db_service_search() did before the database was indexed.
+bool linear_find_uuid_in_seq(uint8_t* p, uint32_t seq_len, uint8_t* p_uuid,
+                             uint16_t uuid_len, int nest_level) {
+  uint8_t* p_end = p + seq_len;
+  uint8_t type;
+  uint32_t len;
+
+  if (nest_level > 3) return false;
+
+  while (p < p_end) {
+    type = *p++;
+    p = sdpu_get_len_from_type(p, p_end, type, &len);
+    if (p == NULL || (p + len) > p_end) break;
+    type = type >> 3;
+    if (type == UUID_DESC_TYPE) {
+      if (sdpu_compare_uuid_arrays(p, len, p_uuid, uuid_len)) return true;
+    } else if (type == DATA_ELE_SEQ_DESC_TYPE) {
+      if (linear_find_uuid_in_seq(p, len, p_uuid, uuid_len, nest_level + 1))
+        return true;
+    }
+    p = p + len;
+  }
+  return false;
+}
+
+std::vector<tSDP_RECORD*> linear_service_search(tSDP_UUID_SEQ* p_seq) {
+  std::vector<tSDP_RECORD*> records;
+
+  for (uint16_t zz = 0; zz < sdp_cb.server_db.num_records; zz++) {
+    tSDP_RECORD* p_rec = &sdp_cb.server_db.record[zz];
+    uint16_t xx, yy;
+    for (yy = 0; yy < p_seq->num_uids; yy++) {
+      tSDP_ATTRIBUTE* p_attr = &p_rec->attribute[0];
+      for (xx = 0; xx < p_rec->num_attributes; xx++, p_attr++) {
+        if (p_attr->type == UUID_DESC_TYPE) {
+          if (sdpu_compare_uuid_arrays(p_attr->value_ptr, p_attr->len,
+                                       p_seq->uuid_entry[yy].value,
+                                       p_seq->uuid_entry[yy].len))
+            break;
+        } else if (p_attr->type == DATA_ELE_SEQ_DESC_TYPE) {
+          if (linear_find_uuid_in_seq(p_attr->value_ptr, p_attr->len,
+                                      p_seq->uuid_entry[yy].value,
+                                      p_seq->uuid_entry[yy].len, 0))
+            break;
+        }
+      }
+      if (xx == p_rec->num_attributes) break;
+    }
+    if (yy == p_seq->num_uids) records.push_back(p_rec);
+  }
+  return records;
+}
+
+std::vector<tSDP_RECORD*> service_search(tSDP_UUID_SEQ* p_seq) {
+  std::vector<tSDP_RECORD*> records;
+  for (tSDP_RECORD* p_rec = sdp_db_service_search(NULL, p_seq); p_rec;
+       p_rec = sdp_db_service_search(p_rec, p_seq))
+    records.push_back(p_rec);
+  return records;
+}
+
+// Writes |uuid16| in its 2, 4 or 16 byte form
+uint16_t uuid_to_array(uint16_t uuid16, uint16_t len, uint8_t* p) {
+  if (len == Uuid::kNumBytes128) {
+    memcpy(p, kBaseUuid, Uuid::kNumBytes128);
+    p[2] = (uint8_t)(uuid16 >> 8);
+    p[3] = (uint8_t)uuid16;
+  } else if (len == Uuid::kNumBytes32) {
+    UINT32_TO_BE_STREAM(p, (uint32_t)uuid16);
+  } else {
+    UINT16_TO_BE_STREAM(p, uuid16);
+  }
+  return len;
+}
+
+tSDP_UUID_SEQ uuid_seq(std::vector<uint16_t> uuids, uint16_t len) {
+  tSDP_UUID_SEQ seq;
+  memset(&seq, 0, sizeof(seq));
+  for (uint16_t uuid16 : uuids) {
+    tUID_ENT* p_ent = &seq.uuid_entry[seq.num_uids++];
+    p_ent->len = uuid_to_array(uuid16, len, p_ent->value);
+  }
+  return seq;
+}
+
+tSDP_ATTR_SEQ all_attributes() {
+  tSDP_ATTR_SEQ seq;
+  memset(&seq, 0, sizeof(seq));
+  seq.num_attr = 1;
+  seq.attr_entry[0].start = 0x0000;
+  seq.attr_entry[0].end = 0xFFFF;
+  return seq;
+}
+
+// Adds a service class ID list holding |uuid16| in its 2, 4 or 16 byte form
+bool add_service_class(uint32_t handle, uint16_t uuid16, uint16_t len) {
+  uint8_t seq[2 + Uuid::kNumBytes128];
+  uint8_t* p = seq;
+  uint8_t size = (len == Uuid::kNumBytes128)
+                     ? SIZE_SIXTEEN_BYTES
+                     : (len == Uuid::kNumBytes32) ? SIZE_FOUR_BYTES
+                                                  : SIZE_TWO_BYTES;
+  UINT8_TO_BE_STREAM(p, (UUID_DESC_TYPE << 3) | size);
+  p += uuid_to_array(uuid16, len, p);
+  return SDP_AddAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST,
+                          DATA_ELE_SEQ_DESC_TYPE, p - seq, seq);
+}
+
+// Builds a record of the kind the profiles register, with some of the UUIDs
+// nested in the protocol lists.
+uint32_t add_record(uint16_t service_class, bool rfcomm) {
+  uint32_t handle = SDP_CreateRecord();
+  tSDP_PROTOCOL_ELEM proto_list[2];
+  memset(proto_list, 0, sizeof(proto_list));
+
+  proto_list[0].protocol_uuid = UUID_PROTOCOL_L2CAP;
+  proto_list[1].protocol_uuid = UUID_PROTOCOL_RFCOMM;
+  proto_list[1].num_params = 1;
+  proto_list[1].params[0] = 1;
+
+  EXPECT_TRUE(SDP_AddServiceClassIdList(handle, 1, &service_class));
+  EXPECT_TRUE(SDP_AddProtocolList(handle, rfcomm ? 2 : 1, proto_list));
+  return handle;
+}
+
+}  // namespace
+
+class StackSdpServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { SDP_DeleteRecord(0); }
+
+  void TearDown() override { SDP_DeleteRecord(0); }
+
+  // Checks the index against the linear scan for every form of the UUIDs
+  void ExpectSearchMatchesLinearScan(std::vector<uint16_t> uuids) {
+    for (uint16_t len :
+         {Uuid::kNumBytes16, Uuid::kNumBytes32, Uuid::kNumBytes128}) {
+      tSDP_UUID_SEQ seq = uuid_seq(uuids, len);
+      EXPECT_EQ(service_search(&seq), linear_service_search(&seq))
+          << "UUID 0x" << std::hex << uuids[0] << " in " << std::dec << len
+          << " bytes";
+    }
+  }
+};
+
+TEST_F(StackSdpServerTest, test_search_matches_linear_scan) {
+  const uint16_t kUuidLens[] = {Uuid::kNumBytes16, Uuid::kNumBytes32,
+                                Uuid::kNumBytes128};
+  std::vector<uint32_t> handles;
+  for (uint16_t i = 0; i < SDP_MAX_RECORDS; i++) {
+    uint32_t handle = add_record(0x1100 + i % 5, i % 2);
+    handles.push_back(handle);
+
+    // Service class UUIDs in every size, and a service ID on its own
+    if (i % 7 == 0) add_service_class(handle, 0x1100 + i % 5, kUuidLens[i % 3]);
+    if (i % 3 == 0) {
+      uint8_t uuid[Uuid::kNumBytes32];
+      uuid_to_array(0x1200 + i % 4, Uuid::kNumBytes32, uuid);
+      SDP_AddAttribute(handle, ATTR_ID_SERVICE_ID, UUID_DESC_TYPE,
+                       Uuid::kNumBytes32, uuid);
+    }
+    if (i % 4 == 0) {
+      tSDP_PROTO_LIST_ELEM add_proto_list;
+      memset(&add_proto_list, 0, sizeof(add_proto_list));
+      add_proto_list.num_elems = 2;
+      add_proto_list.list_elem[0].protocol_uuid = UUID_PROTOCOL_L2CAP;
+      add_proto_list.list_elem[1].protocol_uuid = UUID_PROTOCOL_AVCTP;
+      SDP_AddAdditionProtoLists(handle, 1, &add_proto_list);
+    }
+  }
+  for (uint16_t i = 5; i < handles.size(); i += 6) SDP_DeleteRecord(handles[i]);
+
+  for (uint16_t uuid16 = 0x1100; uuid16 < 0x1105; uuid16++)
+    ExpectSearchMatchesLinearScan({uuid16});
+  for (uint16_t uuid16 = 0x1200; uuid16 < 0x1204; uuid16++)
+    ExpectSearchMatchesLinearScan({uuid16});
+  ExpectSearchMatchesLinearScan({UUID_PROTOCOL_L2CAP});
+  ExpectSearchMatchesLinearScan({UUID_PROTOCOL_RFCOMM});
+  ExpectSearchMatchesLinearScan({UUID_PROTOCOL_AVCTP});
+  ExpectSearchMatchesLinearScan({0x9999});
+  ExpectSearchMatchesLinearScan({0x1101, UUID_PROTOCOL_RFCOMM});
+  ExpectSearchMatchesLinearScan(
+      {UUID_PROTOCOL_RFCOMM, 0x1200, UUID_PROTOCOL_L2CAP});
+  ExpectSearchMatchesLinearScan({UUID_PROTOCOL_AVCTP, 0x1102, 0x1202});
+  ExpectSearchMatchesLinearScan({0x1101, 0x9999});
+
+  // Mixing the sizes in one search
+  tSDP_UUID_SEQ seq = uuid_seq({0x1103}, Uuid::kNumBytes128);
+  seq.uuid_entry[1].len =
+      uuid_to_array(UUID_PROTOCOL_RFCOMM, Uuid::kNumBytes16,
+                    seq.uuid_entry[1].value);
+  seq.num_uids = 2;
+  EXPECT_FALSE(service_search(&seq).empty());
+  EXPECT_EQ(service_search(&seq), linear_service_search(&seq));
+}
+
+TEST_F(StackSdpServerTest, test_index_follows_attribute_changes) {
+  uint32_t handle = add_record(0x1101, false);
+  tSDP_UUID_SEQ old_class = uuid_seq({0x1101}, Uuid::kNumBytes16);
+  tSDP_UUID_SEQ new_class = uuid_seq({0x1102}, Uuid::kNumBytes16);
+  ASSERT_EQ(service_search(&old_class).size(), 1u);
+
+  // Replacing the attribute drops the old UUID
+  add_service_class(handle, 0x1102, Uuid::kNumBytes128);
+  EXPECT_TRUE(service_search(&old_class).empty());
+  ASSERT_EQ(service_search(&new_class).size(), 1u);
+  EXPECT_EQ(service_search(&new_class)[0]->record_handle, handle);
+
+  // Deleting it drops the new one, but not the protocol list's
+  EXPECT_TRUE(SDP_DeleteAttribute(handle, ATTR_ID_SERVICE_CLASS_ID_LIST));
+  EXPECT_TRUE(service_search(&new_class).empty());
+  tSDP_UUID_SEQ l2cap = uuid_seq({UUID_PROTOCOL_L2CAP}, Uuid::kNumBytes16);
+  EXPECT_EQ(service_search(&l2cap).size(), 1u);
+
+  EXPECT_TRUE(SDP_DeleteAttribute(handle, ATTR_ID_PROTOCOL_DESC_LIST));
+  EXPECT_TRUE(service_search(&l2cap).empty());
+}
+
+TEST_F(StackSdpServerTest, test_index_follows_record_deletion) {
+  uint32_t handles[4];
+  handles[0] = add_record(0x1101, true);
+  handles[1] = add_record(0x1101, true);
+  handles[2] = add_record(0x1102, true);
+  handles[3] = add_record(0x1101, true);
+  tSDP_UUID_SEQ seq = uuid_seq({0x1101}, Uuid::kNumBytes16);
+
+  // The records after the deleted one move down the table, and the handle
+  // left behind would now find the next record
+  ASSERT_TRUE(SDP_DeleteRecord(handles[1]));
+  std::vector<tSDP_RECORD*> records = service_search(&seq);
+  ASSERT_EQ(records.size(), 2u);
+  EXPECT_EQ(records[0]->record_handle, handles[0]);
+  EXPECT_EQ(records[1]->record_handle, handles[3]);
+  EXPECT_EQ(records, linear_service_search(&seq));
+
+  uint32_t new_handle = add_record(0x1101, true);
+  records = service_search(&seq);
+  ASSERT_EQ(records.size(), 3u);
+  EXPECT_EQ(records[2]->record_handle, new_handle);
+}
+
+TEST_F(StackSdpServerTest, test_db_init_clears_index) {
+  uint32_t handle = add_record(0x1101, true);
+  ASSERT_TRUE(SDP_DeleteRecord(0));
+
+  // The new record reuses the handle of the deleted one
+  ASSERT_EQ(add_record(0x1102, false), handle);
+
+  tSDP_UUID_SEQ seq = uuid_seq({0x1101}, Uuid::kNumBytes16);
+  EXPECT_TRUE(service_search(&seq).empty());
+  seq = uuid_seq({UUID_PROTOCOL_RFCOMM}, Uuid::kNumBytes16);
+  EXPECT_TRUE(service_search(&seq).empty());
+  seq = uuid_seq({0x1102}, Uuid::kNumBytes16);
+  EXPECT_EQ(service_search(&seq).size(), 1u);
+}
+
+TEST_F(StackSdpServerTest, test_rsp_cache_invalidated_on_db_change) {
+  uint32_t handle = add_record(0x1101, true);
+  add_record(0x1101, false);
+  tSDP_UUID_SEQ seq = uuid_seq({0x1101}, Uuid::kNumBytes16);
+  tSDP_ATTR_SEQ attr_seq = all_attributes();
+
+  const std::vector<uint8_t>* p_list = sdp_rsp_cache_get(&seq, &attr_seq);
+  ASSERT_NE(p_list, nullptr);
+  std::vector<uint8_t> list = *p_list;
+
+  // The same UUIDs in another size are the same search
+  tSDP_UUID_SEQ seq128 = uuid_seq({0x1101}, Uuid::kNumBytes128);
+  p_list = sdp_rsp_cache_get(&seq128, &attr_seq);
+  ASSERT_NE(p_list, nullptr);
+  EXPECT_EQ(*p_list, list);
+
+  // A new attribute shows up in the response
+  uint8_t name[] = "name";
+  ASSERT_TRUE(SDP_AddAttribute(handle, ATTR_ID_SERVICE_NAME,
+                               TEXT_STR_DESC_TYPE, sizeof(name), name));
+  tSDP_ATTRIBUTE* p_attr = sdp_db_find_attr_in_rec(
+      sdp_db_find_record(handle), ATTR_ID_SERVICE_NAME, ATTR_ID_SERVICE_NAME);
+  ASSERT_NE(p_attr, nullptr);
+  p_list = sdp_rsp_cache_get(&seq, &attr_seq);
+  ASSERT_NE(p_list, nullptr);
+  EXPECT_EQ(p_list->size(), list.size() + sdpu_get_attrib_entry_len(p_attr));
+  list = *p_list;
+
+  // A deleted record drops out of it
+  ASSERT_TRUE(SDP_DeleteRecord(handle));
+  p_list = sdp_rsp_cache_get(&seq, &attr_seq);
+  ASSERT_NE(p_list, nullptr);
+  EXPECT_LT(p_list->size(), list.size());
+
+  ASSERT_TRUE(SDP_DeleteRecord(0));
+  p_list = sdp_rsp_cache_get(&seq, &attr_seq);
+  ASSERT_NE(p_list, nullptr);
+  EXPECT_EQ(*p_list, std::vector<uint8_t>({(DATA_ELE_SEQ_DESC_TYPE << 3) |
+                                               SIZE_IN_NEXT_BYTE,
+                                           0}));
+}
+
+// Serves requests on an open L2CAP channel, and reads back what the server
+// sends on it.
+class StackSdpServerConnTest : public StackSdpServerTest {
+ protected:
+  void SetUp() override {
+    StackSdpServerTest::SetUp();
+    memset(&l2cb, 0, sizeof(l2cb));
+
+    // Leave what the server sends on the channel queue
+    l2cb.is_cong_cback_context = true;
+
+    p_lcb_ = &l2cb.lcb_pool[0];
+    p_lcb_->in_use = true;
+    p_lcb_->transport = BT_TRANSPORT_BR_EDR;
+    p_lcb_->link_xmit_quota = 1;
+
+    p_ccb_ = &l2cb.ccb_pool[0];
+    p_ccb_->in_use = true;
+    p_ccb_->p_lcb = p_lcb_;
+    p_ccb_->chnl_state = CST_OPEN;
+    p_ccb_->local_cid = kLocalCid;
+    p_ccb_->peer_cfg.mtu = kMtu;
+    p_ccb_->peer_cfg.fcr.mode = L2CAP_FCR_BASIC_MODE;
+    p_ccb_->xmit_hold_q = fixed_queue_new(SIZE_MAX);
+
+    memset(&conn_, 0, sizeof(conn_));
+    conn_.connection_id = kLocalCid;
+    conn_.rem_mtu_size = kMtu;
+    conn_.sdp_conn_timer = alarm_new("sdp.sdp_conn_timer");
+  }
+
+  void TearDown() override {
+    alarm_free(conn_.sdp_conn_timer);
+    fixed_queue_free(p_ccb_->xmit_hold_q, osi_free);
+    memset(&l2cb, 0, sizeof(l2cb));
+    StackSdpServerTest::TearDown();
+  }
+
+  // Sends a service search attribute request for |uuid16| and every
+  // attribute, continuing from |cont_offset| if it is not 0.
+  std::vector<uint8_t> SearchAttr(uint16_t uuid16, uint16_t max_list_len,
+                                  uint16_t cont_offset) {
+    BT_HDR* p_msg = (BT_HDR*)osi_malloc(BT_HDR_SIZE + 32);
+    uint8_t* p_start = (uint8_t*)(p_msg + 1);
+    uint8_t* p = p_start;
+    p_msg->offset = 0;
+
+    UINT8_TO_BE_STREAM(p, SDP_PDU_SERVICE_SEARCH_ATTR_REQ);
+    UINT16_TO_BE_STREAM(p, ++trans_num_);
+    uint8_t* p_param_len = p;
+    p += 2;
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+    UINT8_TO_BE_STREAM(p, 3);
+    UINT8_TO_BE_STREAM(p, (UUID_DESC_TYPE << 3) | SIZE_TWO_BYTES);
+    UINT16_TO_BE_STREAM(p, uuid16);
+    UINT16_TO_BE_STREAM(p, max_list_len);
+    UINT8_TO_BE_STREAM(p, (DATA_ELE_SEQ_DESC_TYPE << 3) | SIZE_IN_NEXT_BYTE);
+    UINT8_TO_BE_STREAM(p, 5);
+    UINT8_TO_BE_STREAM(p, (UINT_DESC_TYPE << 3) | SIZE_FOUR_BYTES);
+    UINT32_TO_BE_STREAM(p, 0x0000FFFF);
+    if (cont_offset) {
+      UINT8_TO_BE_STREAM(p, SDP_CONTINUATION_LEN);
+      UINT16_TO_BE_STREAM(p, cont_offset);
+    } else {
+      UINT8_TO_BE_STREAM(p, 0);
+    }
+    uint16_t param_len = p - p_param_len - 2;
+    UINT16_TO_BE_STREAM(p_param_len, param_len);
+    p_msg->len = p - p_start;
+
+    sdp_server_handle_client_req(&conn_, p_msg);
+    osi_free(p_msg);
+
+    // Strip the L2CAP header off what was sent
+    BT_HDR* p_rsp = (BT_HDR*)fixed_queue_try_dequeue(p_ccb_->xmit_hold_q);
+    EXPECT_NE(p_rsp, nullptr);
+    if (p_rsp == nullptr) return {};
+    uint8_t* p_data = (uint8_t*)(p_rsp + 1) + p_rsp->offset;
+    std::vector<uint8_t> rsp(p_data + L2CAP_PKT_OVERHEAD, p_data + p_rsp->len);
+    osi_free(p_rsp);
+    return rsp;
+  }
+
+  // Returns the continuation offset of a service search attribute response
+  static uint16_t ContOffset(const std::vector<uint8_t>& rsp) {
+    if (rsp.size() < 8 || rsp[0] != SDP_PDU_SERVICE_SEARCH_ATTR_RSP) {
+      ADD_FAILURE() << "not a service search attribute response";
+      return 0;
+    }
+    size_t cont = 7 + ((rsp[5] << 8) | rsp[6]);
+    if (rsp.size() == cont + 1 && rsp[cont] == 0) return 0;
+    if (rsp.size() != cont + 3 || rsp[cont] != SDP_CONTINUATION_LEN) {
+      ADD_FAILURE() << "bad continuation state";
+      return 0;
+    }
+    return (rsp[cont + 1] << 8) | rsp[cont + 2];
+  }
+
+  static uint16_t ErrorCode(const std::vector<uint8_t>& rsp) {
+    if (rsp.size() < 7 || rsp[0] != SDP_PDU_ERROR_RESPONSE) {
+      ADD_FAILURE() << "not an error response";
+      return 0;
+    }
+    return (rsp[5] << 8) | rsp[6];
+  }
+
+  tL2C_LCB* p_lcb_;
+  tL2C_CCB* p_ccb_;
+  tCONN_CB conn_;
+  uint16_t trans_num_ = 0;
+};
+
+TEST_F(StackSdpServerConnTest, test_continuation_rejected_after_db_change) {
+  const uint16_t kMaxListLen = 32;
+  for (int i = 0; i < 4; i++) add_record(0x1101, true);
+
+  std::vector<uint8_t> rsp = SearchAttr(0x1101, kMaxListLen, 0);
+  uint16_t cont_offset = ContOffset(rsp);
+  ASSERT_EQ(cont_offset, kMaxListLen);
+
+  // Continuing against the same database is fine
+  rsp = SearchAttr(0x1101, kMaxListLen, cont_offset);
+  cont_offset = ContOffset(rsp);
+  ASSERT_EQ(cont_offset, 2 * kMaxListLen);
+
+  // The rest of the list no longer lines up with what was sent
+  add_record(0x1101, true);
+  rsp = SearchAttr(0x1101, kMaxListLen, cont_offset);
+  EXPECT_EQ(ErrorCode(rsp), SDP_INVALID_CONT_STATE);
+
+  // A new search starts over from the new database
+  rsp = SearchAttr(0x1101, kMaxListLen, 0);
+  EXPECT_EQ(ContOffset(rsp), kMaxListLen);
+  rsp = SearchAttr(0x1101, kMaxListLen, kMaxListLen);
+  EXPECT_EQ(ContOffset(rsp), 2 * kMaxListLen);
+}
+
+TEST_F(StackSdpServerConnTest,
+       test_continuation_rejected_after_record_deleted) {
+  const uint16_t kMaxListLen = 32;
+  uint32_t handle = add_record(0x1101, true);
+  for (int i = 0; i < 3; i++) add_record(0x1101, true);
+
+  std::vector<uint8_t> rsp = SearchAttr(0x1101, kMaxListLen, 0);
+  uint16_t cont_offset = ContOffset(rsp);
+  ASSERT_NE(cont_offset, 0);
+
+  // The list got shorter, continuing could loop forever with the client
+  ASSERT_TRUE(SDP_DeleteRecord(handle));
+  rsp = SearchAttr(0x1101, kMaxListLen, cont_offset);
+  EXPECT_EQ(ErrorCode(rsp), SDP_INVALID_CONT_STATE);
+}
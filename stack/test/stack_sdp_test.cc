@@ -0,0 +1,493 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 The Android Open Source Project
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "bt_types.h"
+#include "osi/include/alarm.h"
+#include "osi/include/allocator.h"
+#include "stack/include/sdp_api.h"
+#include "stack/sdp/sdpint.h"
+
+using bluetooth::Uuid;
+
+namespace {
+
+typedef std::vector<uint8_t> Bytes;
+
+const uint32_t kDbLen = 8000;
+const uint32_t kRawLen = 4096;
+
+std::vector<uint16_t> disc_results;
+
+void sdp_disc_cmpl_cb(uint16_t result) { disc_results.push_back(result); }
+
+Bytes cat(std::initializer_list<Bytes> parts) {
+  Bytes bytes;
+  for (const Bytes& part : parts)
+    bytes.insert(bytes.end(), part.begin(), part.end());
+  return bytes;
+}
+
+// A data element of a variable size type, with the smallest header that fits
+Bytes var_elem(uint8_t type, const Bytes& value) {
+  Bytes elem;
+  uint32_t len = value.size();
+  if (len < 0x100) {
+    elem = {(uint8_t)((type << 3) | SIZE_IN_NEXT_BYTE), (uint8_t)len};
+  } else if (len < 0x10000) {
+    elem = {(uint8_t)((type << 3) | SIZE_IN_NEXT_WORD), (uint8_t)(len >> 8),
+            (uint8_t)len};
+  } else {
+    elem = {(uint8_t)((type << 3) | SIZE_IN_NEXT_LONG), (uint8_t)(len >> 24),
+            (uint8_t)(len >> 16), (uint8_t)(len >> 8), (uint8_t)len};
+  }
+  elem.insert(elem.end(), value.begin(), value.end());
+  return elem;
+}
+
+Bytes seq_elem(const Bytes& contents) {
+  return var_elem(DATA_ELE_SEQ_DESC_TYPE, contents);
+}
+
+Bytes text_elem(const std::string& text) {
+  return var_elem(TEXT_STR_DESC_TYPE, Bytes(text.begin(), text.end()));
+}
+
+Bytes uint8_elem(uint8_t value) {
+  return {(UINT_DESC_TYPE << 3) | SIZE_ONE_BYTE, value};
+}
+
+Bytes uint16_elem(uint16_t value) {
+  return {(UINT_DESC_TYPE << 3) | SIZE_TWO_BYTES, (uint8_t)(value >> 8),
+          (uint8_t)value};
+}
+
+Bytes uint32_elem(uint32_t value) {
+  return {(UINT_DESC_TYPE << 3) | SIZE_FOUR_BYTES, (uint8_t)(value >> 24),
+          (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+}
+
+Bytes uuid16_elem(uint16_t uuid16) {
+  return {(UUID_DESC_TYPE << 3) | SIZE_TWO_BYTES, (uint8_t)(uuid16 >> 8),
+          (uint8_t)uuid16};
+}
+
+Bytes attr(uint16_t attr_id, const Bytes& value) {
+  return cat({uint16_elem(attr_id), value});
+}
+
+// The attribute list of an RFCOMM service record
+Bytes service_record(uint8_t scn) {
+  return seq_elem(cat(
+      {attr(ATTR_ID_SERVICE_RECORD_HDL, uint32_elem(0x10000 + scn)),
+       attr(ATTR_ID_SERVICE_CLASS_ID_LIST, seq_elem(uuid16_elem(0x1101))),
+       attr(ATTR_ID_PROTOCOL_DESC_LIST,
+            seq_elem(cat({seq_elem(uuid16_elem(UUID_PROTOCOL_L2CAP)),
+                          seq_elem(cat({uuid16_elem(UUID_PROTOCOL_RFCOMM),
+                                        uint8_elem(scn)}))}))),
+       attr(ATTR_ID_SERVICE_NAME, text_elem("Serial port " +
+                                            std::to_string(scn)))}));
+}
+
+// The attribute lists of |num_records| service records
+Bytes service_records(int num_records) {
+  Bytes records;
+  for (int i = 0; i < num_records; i++) {
+    Bytes record = service_record(i + 1);
+    records.insert(records.end(), record.begin(), record.end());
+  }
+  return seq_elem(records);
+}
+
+// Describes an attribute and everything nested in it
+std::string dump_attr(tSDP_DISC_ATTR* p_attr) {
+  uint16_t len = SDP_DISC_ATTR_LEN(p_attr->attr_len_type);
+  uint8_t type = SDP_DISC_ATTR_TYPE(p_attr->attr_len_type);
+  std::string dump = std::to_string(p_attr->attr_id) + ":" +
+                     std::to_string(type) + ":" + std::to_string(len) + "=";
+
+  if (type == DATA_ELE_SEQ_DESC_TYPE || type == DATA_ELE_ALT_DESC_TYPE) {
+    dump += "(";
+    for (tSDP_DISC_ATTR* p_sub = p_attr->attr_value.v.p_sub_attr; p_sub;
+         p_sub = p_sub->p_next_attr)
+      dump += dump_attr(p_sub) + " ";
+    return dump + ")";
+  }
+  if (len == 1 && type != TEXT_STR_DESC_TYPE)
+    return dump + std::to_string(p_attr->attr_value.v.u8);
+  if (len == 2 && type != TEXT_STR_DESC_TYPE)
+    return dump + std::to_string(p_attr->attr_value.v.u16);
+  if (len == 4 && type != TEXT_STR_DESC_TYPE)
+    return dump + std::to_string(p_attr->attr_value.v.u32);
+  return dump + std::string((char*)p_attr->attr_value.v.array, len);
+}
+
+std::vector<std::string> dump_db(tSDP_DISCOVERY_DB* p_db) {
+  std::vector<std::string> records;
+  for (tSDP_DISC_REC* p_rec = p_db->p_first_rec; p_rec;
+       p_rec = p_rec->p_next_rec) {
+    std::string record;
+    for (tSDP_DISC_ATTR* p_attr = p_rec->p_first_attr; p_attr;
+         p_attr = p_attr->p_next_attr)
+      record += dump_attr(p_attr) + "\n";
+    records.push_back(record);
+  }
+  return records;
+}
+
+size_t num_db_blocks(tSDP_DISCOVERY_DB* p_db) {
+  size_t num_blocks = 0;
+  for (uint8_t* p_block = p_db->p_ext_mem; p_block;
+       p_block = *(uint8_t**)p_block)
+    num_blocks++;
+  return num_blocks;
+}
+
+}  // namespace
+
+// Runs a service search attribute discovery, feeding the client the server's
+// responses.
+class StackSdpTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&ccb_, 0, sizeof(ccb_));
+    ccb_.sdp_conn_timer = alarm_new("sdp.sdp_conn_timer");
+    p_db_ = NULL;
+  }
+
+  void TearDown() override {
+    FreeDb();
+    osi_free(ccb_.rsp_list);
+    alarm_free(ccb_.sdp_conn_timer);
+  }
+
+  void FreeDb() {
+    if (p_db_ == NULL) return;
+    SDP_FreeDiscoveryDb(p_db_);
+    osi_free(p_db_);
+    p_db_ = NULL;
+  }
+
+  // Connects with a DB of |db_len| bytes that may grow to |mem_max|. The
+  // connection ID is left 0, so the requests are dropped and the result is
+  // reported as soon as the discovery ends.
+  void StartDiscovery(uint32_t db_len = kDbLen, uint32_t mem_max = 0) {
+    FreeDb();
+    p_db_ = (tSDP_DISCOVERY_DB*)osi_malloc(db_len);
+    Uuid uuid = Uuid::From16Bit(UUID_PROTOCOL_L2CAP);
+    ASSERT_TRUE(SDP_InitDiscoveryDb(p_db_, db_len, 1, &uuid, 0, NULL));
+    p_db_->mem_max = mem_max;
+    p_db_->raw_data = raw_data_;
+    p_db_->raw_size = kRawLen;
+
+    osi_free_and_reset((void**)&ccb_.rsp_list);
+    ccb_.list_len = 0;
+    ccb_.con_state = SDP_STATE_CONN_SETUP;
+    ccb_.is_attr_search = true;
+    ccb_.p_db = p_db_;
+    ccb_.p_cb = sdp_disc_cmpl_cb;
+    disc_results.clear();
+
+    sdp_disc_connected(&ccb_);
+    ASSERT_EQ(ccb_.disc_state, SDP_DISC_WAIT_SEARCH_ATTR);
+  }
+
+  // Sends the server's response carrying |lists| from |offset|, with a
+  // continuation state if it isn't the last one.
+  void SendResponse(const Bytes& lists, size_t offset, size_t len) {
+    bool last = offset + len == lists.size();
+    BT_HDR* p_msg = (BT_HDR*)osi_malloc(BT_HDR_SIZE + len + 10);
+    uint8_t* p_start = (uint8_t*)(p_msg + 1);
+    uint8_t* p = p_start;
+    p_msg->offset = 0;
+
+    UINT8_TO_BE_STREAM(p, SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+    UINT16_TO_BE_STREAM(p, ccb_.transaction_id - 1);
+    UINT16_TO_BE_STREAM(p, len + (last ? 3 : 5));
+    UINT16_TO_BE_STREAM(p, len);
+    ARRAY_TO_BE_STREAM(p, &lists[offset], (int)len);
+    if (last) {
+      UINT8_TO_BE_STREAM(p, 0);
+    } else {
+      UINT8_TO_BE_STREAM(p, SDP_CONTINUATION_LEN);
+      UINT16_TO_BE_STREAM(p, offset + len);
+    }
+    p_msg->len = p - p_start;
+
+    sdp_disc_server_rsp(&ccb_, p_msg);
+    osi_free(p_msg);
+  }
+
+  // Sends |lists| split at |cuts|, until the discovery ends
+  void SendResponses(const Bytes& lists, std::vector<size_t> cuts) {
+    size_t offset = 0;
+    cuts.push_back(lists.size());
+    for (size_t cut : cuts) {
+      if (!disc_results.empty()) return;
+      SendResponse(lists, offset, cut - offset);
+      offset = cut;
+    }
+  }
+
+  // Runs a whole discovery, returning its result
+  uint16_t Discover(const Bytes& lists, std::vector<size_t> cuts = {},
+                    uint32_t db_len = kDbLen, uint32_t mem_max = 0) {
+    StartDiscovery(db_len, mem_max);
+    SendResponses(lists, cuts);
+    EXPECT_EQ(disc_results.size(), 1u);
+    return disc_results.empty() ? SDP_GENERIC_ERROR : disc_results[0];
+  }
+
+  tCONN_CB ccb_;
+  tSDP_DISCOVERY_DB* p_db_;
+  uint8_t raw_data_[kRawLen];
+};
+
+TEST_F(StackSdpTest, test_single_response) {
+  Bytes lists = service_records(3);
+  ASSERT_EQ(Discover(lists), SDP_SUCCESS);
+
+  tSDP_DISC_REC* p_rec = p_db_->p_first_rec;
+  for (uint8_t scn = 1; scn <= 3; scn++, p_rec = p_rec->p_next_rec) {
+    ASSERT_NE(p_rec, nullptr);
+    tSDP_DISC_ATTR* p_attr =
+        SDP_FindAttributeInRec(p_rec, ATTR_ID_SERVICE_RECORD_HDL);
+    ASSERT_NE(p_attr, nullptr);
+    EXPECT_EQ(p_attr->attr_value.v.u32, 0x10000u + scn);
+
+    tSDP_PROTOCOL_ELEM elem;
+    ASSERT_TRUE(
+        SDP_FindProtocolListElemInRec(p_rec, UUID_PROTOCOL_RFCOMM, &elem));
+    EXPECT_EQ(elem.num_params, 1);
+    EXPECT_EQ(elem.params[0], scn);
+  }
+  EXPECT_EQ(p_rec, nullptr);
+
+  // The raw data is the attribute lists as received
+  ASSERT_EQ(lists[0] & 7, SIZE_IN_NEXT_BYTE);
+  EXPECT_EQ(Bytes(raw_data_, raw_data_ + p_db_->raw_used),
+            Bytes(lists.begin() + 2, lists.end()));
+}
+
+TEST_F(StackSdpTest, test_fragment_at_every_offset) {
+  Bytes lists = service_records(3);
+  ASSERT_EQ(Discover(lists), SDP_SUCCESS);
+  std::vector<std::string> expected = dump_db(p_db_);
+  Bytes expected_raw(raw_data_, raw_data_ + p_db_->raw_used);
+
+  for (size_t cut = 1; cut < lists.size(); cut++) {
+    ASSERT_EQ(Discover(lists, {cut}), SDP_SUCCESS) << "cut at " << cut;
+    EXPECT_EQ(dump_db(p_db_), expected) << "cut at " << cut;
+    EXPECT_EQ(Bytes(raw_data_, raw_data_ + p_db_->raw_used), expected_raw)
+        << "cut at " << cut;
+  }
+
+  // A byte per response
+  std::vector<size_t> cuts;
+  for (size_t cut = 1; cut < lists.size(); cut++) cuts.push_back(cut);
+  ASSERT_EQ(Discover(lists, cuts), SDP_SUCCESS);
+  EXPECT_EQ(dump_db(p_db_), expected);
+  EXPECT_EQ(Bytes(raw_data_, raw_data_ + p_db_->raw_used), expected_raw);
+}
+
+TEST_F(StackSdpTest, test_nested_sequences) {
+  // A sequence three deep, next to an empty one
+  Bytes nested = seq_elem(cat(
+      {uint8_elem(1),
+       seq_elem(cat({uint8_elem(2), seq_elem(cat({uint8_elem(3)}))})),
+       seq_elem({})}));
+  Bytes lists = seq_elem(seq_elem(cat(
+      {attr(ATTR_ID_SERVICE_RECORD_HDL, uint32_elem(0x10000)),
+       attr(0x0200, nested)})));
+
+  for (size_t cut = 0; cut < lists.size(); cut++) {
+    std::vector<size_t> cuts;
+    if (cut) cuts.push_back(cut);
+    ASSERT_EQ(Discover(lists, cuts), SDP_SUCCESS) << "cut at " << cut;
+    ASSERT_NE(p_db_->p_first_rec, nullptr);
+
+    tSDP_DISC_ATTR* p_attr = SDP_FindAttributeInRec(p_db_->p_first_rec, 0x0200);
+    ASSERT_NE(p_attr, nullptr);
+    ASSERT_EQ(SDP_DISC_ATTR_TYPE(p_attr->attr_len_type),
+              DATA_ELE_SEQ_DESC_TYPE);
+    tSDP_DISC_ATTR* p_sub = p_attr->attr_value.v.p_sub_attr;
+    ASSERT_NE(p_sub, nullptr);
+    EXPECT_EQ(p_sub->attr_value.v.u8, 1);
+
+    p_sub = p_sub->p_next_attr;
+    ASSERT_NE(p_sub, nullptr);
+    ASSERT_EQ(SDP_DISC_ATTR_TYPE(p_sub->attr_len_type), DATA_ELE_SEQ_DESC_TYPE);
+    tSDP_DISC_ATTR* p_sub2 = p_sub->attr_value.v.p_sub_attr;
+    ASSERT_NE(p_sub2, nullptr);
+    EXPECT_EQ(p_sub2->attr_value.v.u8, 2);
+    p_sub2 = p_sub2->p_next_attr;
+    ASSERT_NE(p_sub2, nullptr);
+    ASSERT_NE(p_sub2->attr_value.v.p_sub_attr, nullptr);
+    EXPECT_EQ(p_sub2->attr_value.v.p_sub_attr->attr_value.v.u8, 3);
+
+    p_sub = p_sub->p_next_attr;
+    ASSERT_NE(p_sub, nullptr);
+    EXPECT_EQ(SDP_DISC_ATTR_LEN(p_sub->attr_len_type), 0);
+    EXPECT_EQ(p_sub->attr_value.v.p_sub_attr, nullptr);
+    EXPECT_EQ(p_sub->p_next_attr, nullptr);
+  }
+}
+
+TEST_F(StackSdpTest, test_truncated_data) {
+  Bytes record = service_record(1);
+  Bytes lists = seq_elem(record);
+
+  // The responses end before the lists do
+  Bytes short_lists(lists.begin(), lists.end() - 1);
+  EXPECT_EQ(Discover(short_lists), SDP_INVALID_CONT_STATE);
+  EXPECT_EQ(Discover(short_lists, {10}), SDP_INVALID_CONT_STATE);
+
+  // The sequence of lists claims fewer bytes than its record has
+  Bytes bad_lists = lists;
+  bad_lists[1]--;
+  EXPECT_EQ(Discover(bad_lists), SDP_DB_FULL);
+
+  // The record claims fewer bytes than its attributes have
+  bad_lists = lists;
+  bad_lists[3]--;
+  EXPECT_EQ(Discover(bad_lists), SDP_DB_FULL);
+
+  // An attribute ID that is not a 16 bit unsigned integer
+  bad_lists = seq_elem(seq_elem(cat({uint8_elem(1), uint8_elem(2)})));
+  EXPECT_EQ(Discover(bad_lists), SDP_DB_FULL);
+
+  // Lists that are not in a sequence
+  bad_lists = text_elem("lists");
+  EXPECT_EQ(Discover(bad_lists), SDP_INVALID_CONT_STATE);
+
+  // A response whose byte count runs past its end
+  StartDiscovery();
+  BT_HDR* p_msg = (BT_HDR*)osi_malloc(BT_HDR_SIZE + 16);
+  uint8_t* p = (uint8_t*)(p_msg + 1);
+  p_msg->offset = 0;
+  p_msg->len = 10;
+  UINT8_TO_BE_STREAM(p, SDP_PDU_SERVICE_SEARCH_ATTR_RSP);
+  UINT16_TO_BE_STREAM(p, 0);
+  UINT16_TO_BE_STREAM(p, 5);
+  UINT16_TO_BE_STREAM(p, 8);
+  sdp_disc_server_rsp(&ccb_, p_msg);
+  osi_free(p_msg);
+  ASSERT_EQ(disc_results.size(), 1u);
+  EXPECT_EQ(disc_results[0], SDP_INVALID_PDU_SIZE);
+}
+
+TEST_F(StackSdpTest, test_oversized_data) {
+  // An attribute that does not fit the buffer for split units
+  Bytes name(SDP_MAX_LIST_BYTE_COUNT, 'n');
+  Bytes lists = seq_elem(seq_elem(
+      cat({attr(ATTR_ID_SERVICE_RECORD_HDL, uint32_elem(0x10000)),
+           attr(ATTR_ID_SERVICE_NAME,
+                var_elem(TEXT_STR_DESC_TYPE, name))})));
+  std::vector<size_t> cuts;
+  for (size_t cut = 600; cut < lists.size(); cut += 600) cuts.push_back(cut);
+  EXPECT_EQ(Discover(lists, cuts, 2 * SDP_MAX_LIST_BYTE_COUNT),
+            SDP_INVALID_PDU_SIZE);
+
+  // An element that claims more bytes than an attribute can have
+  lists = seq_elem(seq_elem(cat(
+      {attr(ATTR_ID_SERVICE_RECORD_HDL, uint32_elem(0x10000)),
+       uint16_elem(ATTR_ID_SERVICE_NAME),
+       Bytes({(TEXT_STR_DESC_TYPE << 3) | SIZE_IN_NEXT_LONG, 0xFF, 0xFF, 0xFF,
+              0xFF, 'n'})})));
+  EXPECT_EQ(Discover(lists), SDP_INVALID_PDU_SIZE);
+  EXPECT_EQ(Discover(lists, {lists.size() - 3}), SDP_INVALID_PDU_SIZE);
+
+  // Just under the limit is fine when it is split
+  name.resize(SDP_MAX_LIST_BYTE_COUNT - 8);
+  lists = seq_elem(seq_elem(
+      cat({attr(ATTR_ID_SERVICE_RECORD_HDL, uint32_elem(0x10000)),
+           attr(ATTR_ID_SERVICE_NAME,
+                var_elem(TEXT_STR_DESC_TYPE, name))})));
+  cuts.clear();
+  for (size_t cut = 600; cut < lists.size(); cut += 600) cuts.push_back(cut);
+  ASSERT_EQ(Discover(lists, cuts, 2 * SDP_MAX_LIST_BYTE_COUNT), SDP_SUCCESS);
+  tSDP_DISC_ATTR* p_attr =
+      SDP_FindAttributeInRec(p_db_->p_first_rec, ATTR_ID_SERVICE_NAME);
+  ASSERT_NE(p_attr, nullptr);
+  EXPECT_EQ(SDP_DISC_ATTR_LEN(p_attr->attr_len_type), name.size());
+}
+
+TEST_F(StackSdpTest, test_db_grows_to_mem_max) {
+  const uint32_t kSmallDbLen = sizeof(tSDP_DISCOVERY_DB) + 256;
+  const int kNumRecords = 20;
+  Bytes lists = service_records(kNumRecords);
+  std::vector<size_t> cuts;
+  for (size_t cut = 200; cut < lists.size(); cut += 200) cuts.push_back(cut);
+
+  ASSERT_EQ(Discover(lists, cuts), SDP_SUCCESS);
+  std::vector<std::string> expected = dump_db(p_db_);
+  ASSERT_EQ(expected.size(), (size_t)kNumRecords);
+
+  // A fixed DB keeps the records that fit
+  EXPECT_EQ(Discover(lists, cuts, kSmallDbLen), SDP_DB_FULL);
+  EXPECT_EQ(p_db_->p_ext_mem, nullptr);
+  std::vector<std::string> records = dump_db(p_db_);
+  EXPECT_LT(records.size(), expected.size());
+
+  // A growing one holds them all
+  ASSERT_EQ(Discover(lists, cuts, kSmallDbLen, kDbLen), SDP_SUCCESS);
+  EXPECT_EQ(dump_db(p_db_), expected);
+  EXPECT_GT(num_db_blocks(p_db_), 1u);
+  EXPECT_LE(p_db_->mem_size, kDbLen);
+
+  // But never past mem_max
+  uint32_t mem_used = p_db_->mem_size - p_db_->mem_free;
+  ASSERT_EQ(Discover(lists, cuts, kSmallDbLen, mem_used / 2), SDP_DB_FULL);
+  EXPECT_LE(p_db_->mem_size, mem_used / 2);
+  records = dump_db(p_db_);
+  EXPECT_GT(records.size(), 0u);
+  EXPECT_LT(records.size(), expected.size());
+
+  // The last record may have been cut short
+  for (size_t i = 0; i + 1 < records.size(); i++)
+    EXPECT_EQ(records[i], expected[i]);
+}
+
+TEST_F(StackSdpTest, test_free_discovery_db) {
+  const uint32_t kSmallDbLen = sizeof(tSDP_DISCOVERY_DB) + 64;
+  Bytes lists = service_records(20);
+
+  ASSERT_EQ(Discover(lists, {}, kSmallDbLen, kDbLen), SDP_SUCCESS);
+  ASSERT_GT(num_db_blocks(p_db_), 2u);
+
+  // Each block goes, the leak checker tells if one is missed
+  SDP_FreeDiscoveryDb(p_db_);
+  EXPECT_EQ(p_db_->p_ext_mem, nullptr);
+  EXPECT_EQ(p_db_->p_first_rec, nullptr);
+  EXPECT_EQ(p_db_->mem_free, 0u);
+
+  // Freeing again, or a DB that never grew, does nothing
+  SDP_FreeDiscoveryDb(p_db_);
+  EXPECT_EQ(p_db_->p_ext_mem, nullptr);
+  ASSERT_EQ(Discover(service_records(1)), SDP_SUCCESS);
+  tSDP_DISC_REC* p_first_rec = p_db_->p_first_rec;
+  SDP_FreeDiscoveryDb(p_db_);
+  EXPECT_EQ(p_db_->p_first_rec, p_first_rec);
+
+  // The DB can be used again once freed
+  ASSERT_EQ(Discover(lists, {}, kSmallDbLen, kDbLen), SDP_SUCCESS);
+  EXPECT_EQ(dump_db(p_db_).size(), 20u);
+}
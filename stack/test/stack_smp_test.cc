@@ -17,13 +17,20 @@
  ******************************************************************************/
 #include <stdarg.h>
 
+#include <base/logging.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "bt_trace.h"
 #include "hcidefs.h"
 #include "stack/include/smp_api.h"
 #include "stack/smp/p_256_ecc_pp.h"
+#include "stack/smp/smp_aes.h"
 #include "stack/smp/smp_int.h"
 
 /*
@@ -308,4 +315,461 @@ TEST(SmpEccValidationTest, test_invalid_points) {
 
   EXPECT_FALSE(ECC_ValidatePoint(p));
 }
+
+// Parses |hex|, MSB first, into |len| octets in little endian order
+void parse_little_endian(const char* hex, uint8_t* output, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    sscanf(hex + 2 * i, "%2hhx", &output[len - 1 - i]);
+}
+
+// Dumps |len| octets in little endian order as hex, MSB first
+std::string dump_little_endian(const uint8_t* a, size_t len) {
+  std::string str;
+  char buf[3];
+  for (size_t i = len; i > 0; i--) {
+    snprintf(buf, sizeof(buf), "%02x", a[i - 1]);
+    str += buf;
+  }
+  return str;
+}
+
+const char* kAesEngines[] = {"aesni", "armv8-ce", "bitsliced"};
+
+class SmpAesTest : public Test {
+ protected:
+  void TearDown() override { smp_aes_select_engine(nullptr); }
+};
+
+// FIPS-197 Appendix C.1
+TEST_F(SmpAesTest, test_fips_197_vector) {
+  uint8_t key[16], plain[16], cipher[16];
+  for (int i = 0; i < 16; i++) {
+    key[i] = i;
+    plain[i] = i * 0x11;
+  }
+
+  EXPECT_TRUE(smp_aes_select_engine("bitsliced"));
+  EXPECT_FALSE(smp_aes_select_engine("rot13"));
+  for (const char* engine : kAesEngines) {
+    if (!smp_aes_select_engine(engine)) continue;
+    tSMP_AES_KEY aes_key;
+    smp_aes_set_key(key, &aes_key);
+    smp_aes_encrypt(&aes_key, plain, cipher);
+    // |cipher| is big endian, dump it reversed
+    std::reverse(cipher, cipher + 16);
+    EXPECT_EQ("69c4e0d86a7b0430d8cdb78070b4c55a", dump_little_endian(cipher, 16))
+        << engine;
+  }
+}
+
+// Every engine must encrypt exactly what the bitsliced one does
+TEST_F(SmpAesTest, test_engines_agree) {
+  uint32_t seed = 1;
+  for (int round = 0; round < 1000; round++) {
+    uint8_t key[16], plain[16], expected[16];
+    for (int i = 0; i < 16; i++) {
+      seed = seed * 1103515245 + 12345;
+      key[i] = seed >> 24;
+      plain[i] = seed >> 16;
+    }
+
+    tSMP_AES_KEY aes_key;
+    smp_aes_select_engine("bitsliced");
+    smp_aes_set_key(key, &aes_key);
+    smp_aes_encrypt(&aes_key, plain, expected);
+
+    for (const char* engine : kAesEngines) {
+      if (!smp_aes_select_engine(engine)) continue;
+      uint8_t cipher[16];
+      smp_aes_set_key(key, &aes_key);
+      smp_aes_encrypt(&aes_key, plain, cipher);
+      ASSERT_EQ(0, memcmp(expected, cipher, 16)) << engine;
+    }
+  }
+}
+
+// RFC 4493 section 4
+TEST_F(SmpAesTest, test_cmac_rfc_4493_vectors) {
+  const char* msg_hex =
+      "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+      "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+  const struct {
+    uint16_t len;
+    const char* mac;
+  } kVectors[] = {
+      {0, "bb1d6929e95937287fa37d129b756746"},
+      {16, "070a16b46b4d4144f79bdd9dd04a287c"},
+      {40, "dfa66747de9ae63030ca32611497c827"},
+      {64, "51f0bebf7e3b9d92fc49741779363cfe"},
+  };
+  BT_OCTET16 key;
+  parse_little_endian("2b7e151628aed2a6abf7158809cf4f3c", key, 16);
+
+  for (const char* engine : kAesEngines) {
+    if (!smp_aes_select_engine(engine)) continue;
+    for (const auto& vector : kVectors) {
+      uint8_t msg[64], mac[16];
+      parse_little_endian(msg_hex, msg, vector.len);
+      ASSERT_TRUE(aes_cipher_msg_auth_code(key, msg, vector.len, 16, mac));
+      EXPECT_EQ(vector.mac, dump_little_endian(mac, 16))
+          << engine << ", " << vector.len << " octets";
+    }
+  }
+}
+
+// The message in segments, MSB first, and the MAC truncated to its MSBs
+TEST_F(SmpAesTest, test_cmac_segments) {
+  const char* msg_hex =
+      "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+      "30c81c46a35ce411";
+  BT_OCTET16 key;
+  uint8_t a[3], c[17], d[20], mac[8];
+  parse_little_endian("2b7e151628aed2a6abf7158809cf4f3c", key, 16);
+  parse_little_endian(msg_hex, a, sizeof(a));
+  parse_little_endian(msg_hex + 2 * 3, c, sizeof(c));
+  parse_little_endian(msg_hex + 2 * 20, d, sizeof(d));
+
+  tSMP_CMAC_SEG segs[] = {
+      {a, sizeof(a)}, {nullptr, 0}, {c, sizeof(c)}, {d, sizeof(d)}};
+  ASSERT_TRUE(aes_cmac(key, segs, 4, 8, mac));
+  EXPECT_EQ("dfa66747de9ae630", dump_little_endian(mac, 8));
+  EXPECT_FALSE(aes_cmac(key, segs, 4, 17, mac));
+}
+
+// The LE Secure Connections functions, with the samples of the Bluetooth Core
+// Specification Version 5.0 | Vol 3, Part H | Appendix D
+class SmpCryptoToolboxTest : public Test {
+ protected:
+  void SetUp() override {
+    parse_little_endian(
+        "20b003d2f297be2c5e2c83a7e9f9a5b9eff49111acf4fddbcc0301480e359de6", u_,
+        32);
+    parse_little_endian(
+        "55188b3d32f6bb9a900afcfbeed4e72a59cb9ac2f19d7cfb6b4fdd49f47fc5fd", v_,
+        32);
+    parse_little_endian(
+        "ec0234a357c8ad05341010a60a397d9b99796b13b4f866f1868d34f373bfa698", w_,
+        32);
+    parse_little_endian("d5cb8454d177733effffb2ec712baeab", n1_, 16);
+    parse_little_endian("a6e8e7cc25a75f6e216583f7ff3dc4cf", n2_, 16);
+    parse_little_endian("0056123737bfce", a1_, 7);
+    parse_little_endian("00a713702dcfc1", a2_, 7);
+  }
+
+  void TearDown() override { smp_aes_select_engine(nullptr); }
+
+  BT_OCTET32 u_, v_, w_;
+  BT_OCTET16 n1_, n2_;
+  uint8_t a1_[7], a2_[7];
+};
+
+TEST_F(SmpCryptoToolboxTest, test_toolbox_vectors) {
+  for (const char* engine : kAesEngines) {
+    if (!smp_aes_select_engine(engine)) continue;
+    SCOPED_TRACE(engine);
+
+    BT_OCTET16 c;
+    smp_calculate_f4(u_, v_, n1_, 0, c);
+    EXPECT_EQ("f2c916f107a9bd1cf1eda1bea974872d", dump_little_endian(c, 16));
+
+    EXPECT_EQ(0x2f9ed5bau % 1000000, smp_calculate_g2(u_, v_, n1_, n2_));
+
+    BT_OCTET16 mac_key, ltk;
+    ASSERT_TRUE(smp_calculate_f5(w_, n1_, n2_, a1_, a2_, mac_key, ltk));
+    EXPECT_EQ("2965f176a1084a02fd3f6a20ce636e20",
+              dump_little_endian(mac_key, 16));
+    EXPECT_EQ("6986791169d7cd23980522b594750a38", dump_little_endian(ltk, 16));
+
+    BT_OCTET16 r;
+    uint8_t iocap[3];
+    parse_little_endian("12a3343bb453bb5408da42d20c2d0fc8", r, 16);
+    parse_little_endian("010102", iocap, 3);
+    ASSERT_TRUE(smp_calculate_f6(mac_key, n1_, n2_, r, iocap, a1_, a2_, c));
+    EXPECT_EQ("e3c473989cd0e8c5d26c0b09da958f61", dump_little_endian(c, 16));
+
+    BT_OCTET16 key;
+    uint8_t key_id[4];
+    parse_little_endian("ec0234a357c8ad05341010a60a397d9b", key, 16);
+    parse_little_endian("6c656272", key_id, 4);
+    ASSERT_TRUE(smp_calculate_h6(key, key_id, c));
+    EXPECT_EQ("2d9ae102e76dc91ce8d3a9e280b16399", dump_little_endian(c, 16));
+  }
+}
+
+// The crypto of one LE Secure Connections pairing with passkey entry, the
+// association model that needs the most: the ECDH key generation and DHKey,
+// 20 rounds of f4 to send and check commitments, f5, f6 for both DHKey checks
+// and h6 twice for the BR/EDR link key.
+TEST_F(SmpCryptoToolboxTest, test_pairing_crypto_speed) {
+  const int kNumPairings = 200;
+
+  for (const char* engine : kAesEngines) {
+    if (!smp_aes_select_engine(engine)) continue;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumPairings; i++) {
+      BT_OCTET16 c, mac_key, ltk, link_key, r = {0};
+      uint8_t iocap[3] = {1, 1, 2}, key_id[4] = {0x31, 0x70, 0x6d, 0x74};
+      for (int round = 0; round < 20; round++) {
+        smp_calculate_f4(u_, v_, n1_, 0x80 | (round & 1), c);
+        smp_calculate_f4(v_, u_, n2_, 0x80 | (round & 1), c);
+      }
+      smp_calculate_f5(w_, n1_, n2_, a1_, a2_, mac_key, ltk);
+      smp_calculate_f6(mac_key, n1_, n2_, r, iocap, a1_, a2_, c);
+      smp_calculate_f6(mac_key, n2_, n1_, r, iocap, a2_, a1_, c);
+      smp_calculate_h6(ltk, key_id, c);
+      smp_calculate_h6(c, key_id, link_key);
+    }
+    auto aes_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    LOG(INFO) << engine << ": " << aes_us / kNumPairings
+              << "us of AES-CMAC per pairing";
+  }
+
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256];
+  memcpy(private_key, w_, sizeof(private_key));
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumPairings; i++) {
+    Point public_key, dhkey;
+    ECC_PointMult_Base(&public_key, private_key);
+    ECC_PointMult(&dhkey, &public_key, private_key, KEY_LENGTH_DWORDS_P256);
+  }
+  auto ecdh_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  LOG(INFO) << ecdh_us / kNumPairings << "us of ECDH per pairing";
+}
+
+// The order of the P-256 generator
+const char* kP256Order =
+    "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551";
+
+// Parses |hex|, MSB first, into a scalar for the point multiplication
+void parse_scalar(const char* hex, uint32_t* n) {
+  uint8_t octets[KEY_LENGTH_DWORDS_P256 * DWORD_BYTES];
+  parse_little_endian(hex, octets, sizeof(octets));
+  memcpy(n, octets, sizeof(octets));
+}
+
+std::string dump_dwords(const uint32_t* a) {
+  return dump_little_endian(reinterpret_cast<const uint8_t*>(a),
+                            KEY_LENGTH_DWORDS_P256 * DWORD_BYTES);
+}
+
+// Random 256 bit scalars, which may be above the order
+void random_scalar(uint32_t* seed, uint32_t* n) {
+  for (int i = 0; i < KEY_LENGTH_DWORDS_P256; i++) {
+    *seed = *seed * 1103515245 + 12345;
+    n[i] = *seed;
+    *seed = *seed * 1103515245 + 12345;
+    n[i] ^= *seed >> 16;
+  }
+}
+
+// The Bin_NAF multiplication spends its scalar, hand it a copy
+void point_mult_bin_naf(Point* q, const Point& p, const uint32_t* n) {
+  Point base = p;
+  uint32_t scalar[KEY_LENGTH_DWORDS_P256];
+  memcpy(scalar, n, sizeof(scalar));
+  ECC_PointMult_Bin_NAF(q, &base, scalar, KEY_LENGTH_DWORDS_P256);
+}
+
+class SmpEccPointMultTest : public Test {
+ protected:
+  void SetUp() override { p_256_init_curve(KEY_LENGTH_DWORDS_P256); }
+};
+
+// The debug key pair of Bluetooth Core Specification
+// Version 5.0 | Vol 3, Part H | 2.3.5.6.1
+TEST_F(SmpEccPointMultTest, test_debug_key) {
+  uint32_t private_key[KEY_LENGTH_DWORDS_P256];
+  parse_scalar(
+      "3f49f6d4a3c55f3874c9b3e3d2103f504aff607beb40b7995899b8a6cd3c1abd",
+      private_key);
+
+  Point public_key;
+  ECC_PointMult_Base(&public_key, private_key);
+  EXPECT_EQ("20b003d2f297be2c5e2c83a7e9f9a5b9eff49111acf4fddbcc0301480e359de6",
+            dump_dwords(public_key.x));
+  EXPECT_EQ("dc809c49652aeb6d63329abf5a52155c766345c28fed3024741c8ed01589d28b",
+            dump_dwords(public_key.y));
+
+  ECC_PointMult_WNAF(&public_key, &curve_p256.G, private_key);
+  EXPECT_EQ("20b003d2f297be2c5e2c83a7e9f9a5b9eff49111acf4fddbcc0301480e359de6",
+            dump_dwords(public_key.x));
+  EXPECT_EQ("dc809c49652aeb6d63329abf5a52155c766345c28fed3024741c8ed01589d28b",
+            dump_dwords(public_key.y));
+}
+
+TEST_F(SmpEccPointMultTest, test_edge_scalars) {
+  uint32_t n[KEY_LENGTH_DWORDS_P256] = {1};
+  Point q, minus_g;
+  ECC_PointMult_Base(&q, n);
+  EXPECT_EQ(0, memcmp(q.x, curve_p256.G.x, sizeof(q.x)));
+  EXPECT_EQ(0, memcmp(q.y, curve_p256.G.y, sizeof(q.y)));
+
+  // (r - 1)G = -G
+  parse_scalar(kP256Order, n);
+  n[0]--;
+  memcpy(minus_g.x, curve_p256.G.x, sizeof(minus_g.x));
+  multiprecision_sub(minus_g.y, curve_p256.p, curve_p256.G.y,
+                     KEY_LENGTH_DWORDS_P256);
+  ECC_PointMult_Base(&q, n);
+  EXPECT_EQ(dump_dwords(minus_g.x), dump_dwords(q.x));
+  EXPECT_EQ(dump_dwords(minus_g.y), dump_dwords(q.y));
+  ECC_PointMult_WNAF(&q, &curve_p256.G, n);
+  EXPECT_EQ(dump_dwords(minus_g.x), dump_dwords(q.x));
+  EXPECT_EQ(dump_dwords(minus_g.y), dump_dwords(q.y));
+
+  // rG is the point at infinity
+  n[0]++;
+  ECC_PointMult_Base(&q, n);
+  EXPECT_TRUE(multiprecision_iszero(q.z, KEY_LENGTH_DWORDS_P256));
+  ECC_PointMult_WNAF(&q, &curve_p256.G, n);
+  EXPECT_TRUE(multiprecision_iszero(q.z, KEY_LENGTH_DWORDS_P256));
+
+  // and (r + 1)G = G
+  n[0]++;
+  ECC_PointMult_WNAF(&q, &curve_p256.G, n);
+  EXPECT_EQ(dump_dwords(curve_p256.G.x), dump_dwords(q.x));
+  EXPECT_EQ(dump_dwords(curve_p256.G.y), dump_dwords(q.y));
+}
+
+// Key generation and DH must give what the 32 bit Bin_NAF code does
+TEST_F(SmpEccPointMultTest, test_matches_bin_naf) {
+  uint32_t seed = 1;
+  for (int i = 0; i < 50; i++) {
+    uint32_t local[KEY_LENGTH_DWORDS_P256], peer[KEY_LENGTH_DWORDS_P256];
+    random_scalar(&seed, local);
+    random_scalar(&seed, peer);
+
+    Point expected, public_key;
+    point_mult_bin_naf(&expected, curve_p256.G, peer);
+    ECC_PointMult_Base(&public_key, peer);
+    ASSERT_EQ(dump_dwords(expected.x), dump_dwords(public_key.x));
+    ASSERT_EQ(dump_dwords(expected.y), dump_dwords(public_key.y));
+    ASSERT_TRUE(ECC_ValidatePoint(public_key));
+
+    Point dhkey;
+    point_mult_bin_naf(&expected, public_key, local);
+    ECC_PointMult(&dhkey, &public_key, local, KEY_LENGTH_DWORDS_P256);
+    ASSERT_EQ(dump_dwords(expected.x), dump_dwords(dhkey.x));
+    ASSERT_EQ(dump_dwords(expected.y), dump_dwords(dhkey.y));
+  }
+}
+
+// Key generations and DH computations per second, before and after
+TEST_F(SmpEccPointMultTest, test_point_mult_speed) {
+  const int kNumOps = 200;
+  uint32_t seed = 2;
+  uint32_t scalars[kNumOps][KEY_LENGTH_DWORDS_P256];
+  Point public_keys[kNumOps];
+  for (int i = 0; i < kNumOps; i++) {
+    random_scalar(&seed, scalars[i]);
+    ECC_PointMult_Base(&public_keys[i], scalars[i]);
+  }
+
+  auto ops_per_sec = [](std::chrono::steady_clock::time_point start) {
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+    return kNumOps * 1000000LL / (us + 1);
+  };
+
+  Point q;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumOps; i++)
+    point_mult_bin_naf(&q, curve_p256.G, scalars[i]);
+  LOG(INFO) << "Bin_NAF key generation: " << ops_per_sec(start) << " ops/s";
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumOps; i++)
+    point_mult_bin_naf(&q, public_keys[(i + 1) % kNumOps], scalars[i]);
+  LOG(INFO) << "Bin_NAF DH: " << ops_per_sec(start) << " ops/s";
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumOps; i++) ECC_PointMult_Base(&q, scalars[i]);
+  LOG(INFO) << "Comb key generation: " << ops_per_sec(start) << " ops/s";
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kNumOps; i++)
+    ECC_PointMult_WNAF(&q, &public_keys[(i + 1) % kNumOps], scalars[i]);
+  LOG(INFO) << "wNAF DH: " << ops_per_sec(start) << " ops/s";
+}
+
+// Waits for the key pool to hold |count| key pairs
+bool wait_for_key_pool(size_t count) {
+  for (int i = 0; i < 500; i++) {
+    tSMP_KEY_POOL_STATS stats;
+    smp_key_pool_get_stats(&stats);
+    if (stats.available >= count) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+class SmpKeyPoolTest : public Test {
+ protected:
+  void SetUp() override { p_256_init_curve(KEY_LENGTH_DWORDS_P256); }
+  void TearDown() override { smp_key_pool_stop(); }
+};
+
+TEST_F(SmpKeyPoolTest, test_off_without_depth) {
+  BT_OCTET32 private_key;
+  tSMP_PUBLIC_KEY public_key;
+  tSMP_KEY_POOL_STATS before, after;
+  smp_key_pool_get_stats(&before);
+  EXPECT_FALSE(smp_key_pool_take(private_key, &public_key));
+  smp_key_pool_get_stats(&after);
+  EXPECT_EQ(0u, after.depth);
+  EXPECT_EQ(before.misses, after.misses);
+}
+
+// Every key pair is valid, distinct, and handed out once
+TEST_F(SmpKeyPoolTest, test_single_use_key_pairs) {
+  const size_t kDepth = 4;
+  tSMP_KEY_POOL_STATS before, stats;
+  smp_key_pool_get_stats(&before);
+  smp_key_pool_start(kDepth);
+  ASSERT_TRUE(wait_for_key_pool(kDepth));
+
+  std::vector<std::string> private_keys;
+  for (size_t i = 0; i < kDepth; i++) {
+    BT_OCTET32 private_key;
+    tSMP_PUBLIC_KEY public_key;
+    ASSERT_TRUE(smp_key_pool_take(private_key, &public_key));
+
+    uint32_t scalar[KEY_LENGTH_DWORDS_P256];
+    Point expected;
+    memcpy(scalar, private_key, sizeof(scalar));
+    ECC_PointMult_Base(&expected, scalar);
+    EXPECT_EQ(0, memcmp(expected.x, public_key.x, BT_OCTET32_LEN));
+    EXPECT_EQ(0, memcmp(expected.y, public_key.y, BT_OCTET32_LEN));
+
+    std::string key = dump_little_endian(private_key, BT_OCTET32_LEN);
+    EXPECT_EQ(private_keys.end(),
+              std::find(private_keys.begin(), private_keys.end(), key));
+    private_keys.push_back(key);
+  }
+
+  smp_key_pool_get_stats(&stats);
+  EXPECT_EQ(kDepth, stats.depth);
+  EXPECT_EQ(before.hits + kDepth, stats.hits);
+
+  // The pool refills in the background, with fresh key pairs
+  ASSERT_TRUE(wait_for_key_pool(kDepth));
+  BT_OCTET32 private_key;
+  tSMP_PUBLIC_KEY public_key;
+  ASSERT_TRUE(smp_key_pool_take(private_key, &public_key));
+  EXPECT_EQ(private_keys.end(),
+            std::find(private_keys.begin(), private_keys.end(),
+                      dump_little_endian(private_key, BT_OCTET32_LEN)));
+
+  smp_key_pool_stop();
+  smp_key_pool_get_stats(&stats);
+  EXPECT_EQ(0u, stats.available);
+  EXPECT_FALSE(smp_key_pool_take(private_key, &public_key));
+}
+
 }  // namespace testing
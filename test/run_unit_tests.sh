@@ -8,8 +8,10 @@ known_tests=(
   net_test_btcore
   net_test_bta
   net_test_btif
+  net_test_btif_config_journal
   net_test_btif_profile_queue
   net_test_btif_state_machine
+  net_test_btif_sock_thread
   net_test_device
   net_test_hci
   net_test_stack
@@ -21,6 +23,7 @@ known_tests=(
   net_test_osi
   net_test_performance
   net_test_stack_rfcomm
+  net_test_stack_l2cap
 )
 
 known_remote_tests=(
@@ -0,0 +1,144 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "osi/include/list.h"
+#include "osi/include/timer_wheel.h"
+
+// Compares the sorted list previously used for pending alarms against the
+// timer wheel now backing osi/src/alarm.cc. Note that the sorted list is
+// quadratic, so its 100k alarm run takes a couple of minutes.
+
+static const size_t ALARM_COUNTS[] = {10, 1000, 100000};
+
+// Typical stack timeouts range from a few ms up to a couple of minutes.
+#define MAX_TIMEOUT_MS 120000
+
+typedef struct {
+  timer_wheel_node_t node;
+  period_ms_t deadline;
+} perf_alarm_t;
+
+static std::vector<perf_alarm_t> make_alarms(size_t count) {
+  std::vector<perf_alarm_t> alarms(count);
+  srand(count);
+  for (perf_alarm_t& alarm : alarms) {
+    timer_wheel_node_init(&alarm.node, &alarm);
+    alarm.deadline = 1000 + rand() % MAX_TIMEOUT_MS;
+  }
+  return alarms;
+}
+
+static long long elapsed_ns(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+static void sorted_list_insert(list_t* list, perf_alarm_t* alarm) {
+  if (list_is_empty(list) ||
+      ((perf_alarm_t*)list_front(list))->deadline > alarm->deadline) {
+    list_prepend(list, alarm);
+    return;
+  }
+
+  for (list_node_t* node = list_begin(list); node != list_end(list);
+       node = list_next(node)) {
+    list_node_t* next = list_next(node);
+    if (next == list_end(list) ||
+        ((perf_alarm_t*)list_node(next))->deadline > alarm->deadline) {
+      list_insert_after(list, node, alarm);
+      return;
+    }
+  }
+}
+
+static void log_result(const char* backend, const char* operation,
+                       size_t count, long long duration_ns) {
+  LOG(INFO) << backend << " " << operation << " took " << duration_ns
+            << "ns for " << count << " alarms ("
+            << (duration_ns > 0 ? count * 1000000000LL / duration_ns : 0)
+            << " ops/sec)";
+}
+
+TEST(AlarmPerformanceTest, sorted_list_speed_test) {
+  for (size_t count : ALARM_COUNTS) {
+    std::vector<perf_alarm_t> alarms = make_alarms(count);
+    list_t* list = list_new(NULL);
+
+    auto start = std::chrono::steady_clock::now();
+    for (perf_alarm_t& alarm : alarms) sorted_list_insert(list, &alarm);
+    log_result("Sorted list", "insert", count, elapsed_ns(start));
+
+    // Cancel every other alarm, then fire the rest in deadline order.
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i += 2) list_remove(list, &alarms[i]);
+    log_result("Sorted list", "cancel", count / 2, elapsed_ns(start));
+
+    size_t fired = 0;
+    start = std::chrono::steady_clock::now();
+    while (!list_is_empty(list)) {
+      list_remove(list, list_front(list));
+      fired++;
+    }
+    log_result("Sorted list", "fire", fired, elapsed_ns(start));
+
+    EXPECT_EQ(fired, count / 2);
+    list_free(list);
+  }
+}
+
+TEST(AlarmPerformanceTest, timer_wheel_speed_test) {
+  for (size_t count : ALARM_COUNTS) {
+    std::vector<perf_alarm_t> alarms = make_alarms(count);
+    timer_wheel_t* wheel = timer_wheel_new(0);
+
+    auto start = std::chrono::steady_clock::now();
+    for (perf_alarm_t& alarm : alarms)
+      timer_wheel_insert(wheel, &alarm.node, alarm.deadline);
+    log_result("Timer wheel", "insert", count, elapsed_ns(start));
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i += 2)
+      timer_wheel_remove(wheel, &alarms[i].node);
+    log_result("Timer wheel", "cancel", count / 2, elapsed_ns(start));
+
+    size_t fired = 0;
+    period_ms_t last_deadline = 0;
+    start = std::chrono::steady_clock::now();
+    while (!timer_wheel_is_empty(wheel)) {
+      timer_wheel_node_t* node = timer_wheel_front(wheel);
+      period_ms_t deadline = timer_wheel_node_deadline(node);
+      EXPECT_LE(last_deadline, deadline);
+      last_deadline = deadline;
+
+      timer_wheel_remove(wheel, node);
+      timer_wheel_advance(wheel, deadline);
+      fired++;
+    }
+    log_result("Timer wheel", "fire", fired, elapsed_ns(start));
+
+    EXPECT_EQ(fired, count / 2);
+    timer_wheel_free(wheel);
+  }
+}
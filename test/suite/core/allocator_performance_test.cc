@@ -0,0 +1,70 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "osi/include/allocator.h"
+#include "osi/include/osi.h"
+
+// Compares plain osi_malloc against the slab allocator behind
+// osi_pool_malloc using a BT_HDR-like size mix, allocating in bursts and
+// freeing in FIFO order like packets flowing through the HCI layer.
+
+#define NUM_ROUNDS 2000
+#define BURST_SIZE 64
+
+static const size_t BUFFER_SIZES[] = {32, 272, 660, 1021 + 32, 4096 + 16};
+
+static void run_allocator_benchmark(const char* name,
+                                    void* (*alloc)(size_t size)) {
+  std::vector<void*> burst(BURST_SIZE);
+  size_t count = 0;
+
+  std::chrono::steady_clock::time_point start_time =
+      std::chrono::steady_clock::now();
+  for (int round = 0; round < NUM_ROUNDS; round++) {
+    for (size_t i = 0; i < burst.size(); i++) {
+      size_t size = BUFFER_SIZES[(round + i) % ARRAY_SIZE(BUFFER_SIZES)];
+      burst[i] = alloc(size);
+      *static_cast<char*>(burst[i]) = 0;
+    }
+    for (void* buffer : burst) osi_free(buffer);
+    count += burst.size();
+  }
+  std::chrono::steady_clock::time_point end_time =
+      std::chrono::steady_clock::now();
+
+  std::chrono::nanoseconds duration =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(end_time -
+                                                           start_time);
+  LOG(INFO) << name << " took " << duration.count() << "ns for " << count
+            << " allocations (" << duration.count() / count
+            << "ns per allocation/free pair)";
+}
+
+TEST(AllocatorPerformanceTest, osi_malloc_speed_test) {
+  run_allocator_benchmark("osi_malloc", osi_malloc);
+}
+
+TEST(AllocatorPerformanceTest, osi_pool_malloc_speed_test) {
+  run_allocator_benchmark("osi_pool_malloc", osi_pool_malloc);
+}
@@ -0,0 +1,121 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "osi/include/config.h"
+#include "osi/include/osi.h"
+
+// Measures config_t on a synthetic bt_config.conf with 2,000 devices, and
+// compares lookups against the linear section/key scan it used to do.
+
+#define NUM_DEVICES 2000
+
+static const char CONFIG_FILE[] = "/data/local/tmp/config_performance.conf";
+
+static const char* DEVICE_KEYS[] = {
+    "Timestamp", "Name",        "DevClass",   "DevType",
+    "AddrType",  "Manufacturer", "LmpVer",     "LmpSubVer",
+    "Service",   "LinkKeyType", "PinLength",  "LinkKey"};
+
+static std::string device_address(int i) {
+  char address[18];
+  snprintf(address, sizeof(address), "00:11:22:%02x:%02x:%02x",
+           (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+  return address;
+}
+
+static void write_synthetic_config() {
+  FILE* fp = fopen(CONFIG_FILE, "wt");
+  ASSERT_TRUE(fp != NULL);
+  fprintf(fp, "[Info]\nFileSource = Empty\n\n[Adapter]\nAddress = "
+              "00:00:00:00:00:01\n\n");
+  for (int i = 0; i < NUM_DEVICES; i++) {
+    fprintf(fp, "[%s]\n", device_address(i).c_str());
+    for (const char* key : DEVICE_KEYS) fprintf(fp, "%s = %d\n", key, i);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+}
+
+static const std::string* linear_get_string(const config_t& config,
+                                            const std::string& section,
+                                            const std::string& key) {
+  auto sec = std::find_if(
+      config.sections.begin(), config.sections.end(),
+      [&section](const section_t& s) { return s.name == section; });
+  if (sec == config.sections.end()) return nullptr;
+
+  for (const entry_t& entry : sec->entries)
+    if (entry.key == key) return &entry.value;
+  return nullptr;
+}
+
+static long long elapsed_us(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+TEST(ConfigPerformanceTest, config_speed_test) {
+  write_synthetic_config();
+
+  auto start = std::chrono::steady_clock::now();
+  std::unique_ptr<config_t> config = config_new(CONFIG_FILE);
+  LOG(INFO) << "Loading " << NUM_DEVICES << " devices took "
+            << elapsed_us(start) << "us";
+  ASSERT_TRUE(config.get() != NULL);
+
+  std::vector<std::string> addresses;
+  for (int i = 0; i < NUM_DEVICES; i++) addresses.push_back(device_address(i));
+
+  size_t found = 0;
+  start = std::chrono::steady_clock::now();
+  for (const std::string& address : addresses)
+    for (const char* key : DEVICE_KEYS)
+      found += (linear_get_string(*config, address, key) != nullptr);
+  LOG(INFO) << "Linear scan of " << found << " keys took " << elapsed_us(start)
+            << "us";
+
+  found = 0;
+  start = std::chrono::steady_clock::now();
+  for (const std::string& address : addresses)
+    for (const char* key : DEVICE_KEYS)
+      found += (config_get_string(*config, address, key, nullptr) != nullptr);
+  LOG(INFO) << "Indexed lookup of " << found << " keys took "
+            << elapsed_us(start) << "us";
+  EXPECT_EQ(found, NUM_DEVICES * ARRAY_SIZE(DEVICE_KEYS));
+
+  start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+  LOG(INFO) << "Saving all sections took " << elapsed_us(start) << "us";
+
+  config_set_int(config.get(), addresses[NUM_DEVICES / 2], "Timestamp", -1);
+  start = std::chrono::steady_clock::now();
+  EXPECT_TRUE(config_save(*config, CONFIG_FILE));
+  LOG(INFO) << "Saving after changing one section took " << elapsed_us(start)
+            << "us";
+
+  remove(CONFIG_FILE);
+}
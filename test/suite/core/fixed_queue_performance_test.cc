@@ -0,0 +1,114 @@
+/******************************************************************************
+ *
+ *  Copyright 2018 Google, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at:
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ******************************************************************************/
+
+#include <base/logging.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "osi/include/fixed_queue.h"
+#include "osi/include/future.h"
+#include "osi/include/osi.h"
+#include "osi/include/thread.h"
+
+// Compares the list-backed fixed queue against the lock-free MPSC ring with
+// several producer threads feeding a consumer registered on a reactor.
+
+#define NUM_PRODUCERS 4
+#define NUM_MESSAGES_PER_PRODUCER 250000
+#define QUEUE_CAPACITY 128
+
+typedef struct {
+  std::chrono::steady_clock::time_point enqueue_time;
+} perf_message_t;
+
+static fixed_queue_t* queue;
+static std::vector<perf_message_t> messages;
+static std::vector<int64_t> latencies_ns;
+static size_t received;
+static future_t* done;
+
+static void producer(void* context) {
+  size_t first = PTR_TO_INT(context) * NUM_MESSAGES_PER_PRODUCER;
+  for (size_t i = first; i < first + NUM_MESSAGES_PER_PRODUCER; i++) {
+    messages[i].enqueue_time = std::chrono::steady_clock::now();
+    fixed_queue_enqueue(queue, &messages[i]);
+  }
+}
+
+static void consumer(fixed_queue_t* queue, UNUSED_ATTR void* context) {
+  perf_message_t* message =
+      static_cast<perf_message_t*>(fixed_queue_try_dequeue(queue));
+  latencies_ns[received++] =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - message->enqueue_time)
+          .count();
+
+  if (received == latencies_ns.size()) future_ready(done, FUTURE_SUCCESS);
+}
+
+static void run_queue_benchmark(const char* name, fixed_queue_t* test_queue) {
+  const size_t total = NUM_PRODUCERS * NUM_MESSAGES_PER_PRODUCER;
+  queue = test_queue;
+  messages.assign(total, perf_message_t());
+  latencies_ns.assign(total, 0);
+  received = 0;
+  done = future_new();
+
+  thread_t* consumer_thread = thread_new("queue performance consumer");
+  fixed_queue_register_dequeue(queue, thread_get_reactor(consumer_thread),
+                               consumer, NULL);
+
+  thread_t* producers[NUM_PRODUCERS];
+  for (int i = 0; i < NUM_PRODUCERS; i++)
+    producers[i] = thread_new("queue performance producer");
+
+  std::chrono::steady_clock::time_point start_time =
+      std::chrono::steady_clock::now();
+  for (int i = 0; i < NUM_PRODUCERS; i++)
+    thread_post(producers[i], producer, INT_TO_PTR(i));
+  future_await(done);
+  std::chrono::steady_clock::time_point end_time =
+      std::chrono::steady_clock::now();
+
+  for (int i = 0; i < NUM_PRODUCERS; i++) thread_free(producers[i]);
+  fixed_queue_unregister_dequeue(queue);
+  thread_free(consumer_thread);
+  fixed_queue_free(queue, NULL);
+  queue = nullptr;
+
+  std::sort(latencies_ns.begin(), latencies_ns.end());
+  std::chrono::microseconds duration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end_time -
+                                                            start_time);
+
+  LOG(INFO) << name << " took " << duration.count() << "us for " << total
+            << " messages ("
+            << (duration.count() > 0 ? total * 1000000 / duration.count() : 0)
+            << " ops/sec), p50 latency " << latencies_ns[total / 2]
+            << "ns, p99 latency " << latencies_ns[total * 99 / 100] << "ns";
+}
+
+TEST(FixedQueuePerformanceTest, list_queue_speed_test) {
+  run_queue_benchmark("List queue", fixed_queue_new(QUEUE_CAPACITY));
+}
+
+TEST(FixedQueuePerformanceTest, mpsc_queue_speed_test) {
+  run_queue_benchmark("MPSC queue", fixed_queue_new_mpsc(QUEUE_CAPACITY));
+}